@@ -6,6 +6,28 @@
 void* alloc_memory(VM* vm, size_t size);
 void free_memory(VM* vm, void* ptr, size_t curr_size);
 
+#define SWEPT_SLAB_COUNT 4
+
+/**
+ * Memory released by a background sweep. The sweeper thread must not touch the byte count or the slab free lists
+ * the program keeps allocating from, so its frees are collected here until the program takes them back.
+ */
+typedef struct {
+	size_t bytes_freed;
+	void *slab_heads[SWEPT_SLAB_COUNT]; // freed slots of slab_24, slab_32, slab_48 and slab_64
+	void *slab_tails[SWEPT_SLAB_COUNT];
+} SweptMemory;
+
+/**
+ * @brief Sends the frees of the calling thread to <swept> instead of the VM, until called again with NULL
+ */
+void collect_frees_into(SweptMemory *swept);
+
+/**
+ * @brief Hands the slots and bytes of a finished background sweep back to <vm> and clears <swept>
+ */
+void return_swept_memory(VM* vm, SweptMemory *swept);
+
 #define FREE_OBJECT(vm, type, pointer) free_memory((vm), (pointer), sizeof(type))
 
 #endif // CRUX_LANG_ALLOC_H
@@ -163,14 +163,43 @@ typedef enum {
 	OP_0_FLOAT,
 	OP_1_FLOAT,
 	OP_2_FLOAT,
+	OP_YIELD,
+	OP_NEW_STRUCT,
+	OP_TAIL_CALL,
+	OP_COUNT, // number of opcodes, keep last
 } OpCode;
 
+// Operand of the typed Vector and Complex arithmetic opcodes. The flagged operands are temporaries that nothing else
+// references, so the result can be written into one of them instead of a new object.
+#define REUSE_LEFT_OPERAND 1
+#define REUSE_RIGHT_OPERAND 2
+
+// First operand of each capture of OP_CLOSURE, followed by the upvalue or local slot index.
+#define CAPTURE_UPVALUE 0 // an upvalue of the enclosing closure
+#define CAPTURE_LOCAL 1 // a local that may still be assigned, shared through an open upvalue
+#define CAPTURE_LOCAL_VALUE 2 // a local that is never assigned, copied into a closed upvalue
+
+/**
+ * One word of a chunk translated for execution: every code word keeps its offset, so jump operands stay valid.
+ * Whether a word is an opcode or an operand is only known to the instruction that reads it, so each word carries
+ * both readings.
+ */
+typedef struct {
+	void *handler; // address of the handler when the word is executed as an opcode, replaced when it is quickened
+	union {
+		Value constant; // the chunk constant the word indexes, if it is in range
+		Value *global; // the global slot the word indexes, once a global access reading it was quickened
+	};
+	uint16_t operand; // the word itself
+} ThreadedWord;
+
 typedef struct {
 	int count;
 	int capacity;
 	uint16_t *code;
 	int *lines;
 	ValueArray constants;
+	ThreadedWord *threaded; // built on the first call of the function, NULL until then
 } Chunk;
 
 /**
@@ -14,9 +14,14 @@
 
 #define UINT8_COUNT (UINT8_MAX + 1)
 #define MAX_ARRAY_SIZE (UINT16_MAX - 1)
-#define FRAMES_MAX 128
-#define STACK_MAX (FRAMES_MAX * UINT8_COUNT * 8) // Approx 2MB stack size
-#define IMPORT_MAX (FRAMES_MAX / 2)
+#define FRAMES_INITIAL 8 // frames of a new VM, the array grows as calls nest
+#define STACK_INITIAL (UINT8_COUNT * 8) // Values of a new VM's stack, it grows as calls need it
+#define COROUTINE_FRAMES_INITIAL 4
+#define COROUTINE_STACK_INITIAL UINT8_COUNT
+#define STACK_RESERVE (UINT8_COUNT * 2) // free Values above every frame, for natives and transient pushes
+#define DEFAULT_MAX_FRAMES 100000 // call depth limit unless CRUX_MAX_FRAMES sets another one
+#define MAX_REENTRY_DEPTH 1000 // natives calling back into the VM nest run() on the C stack, this bounds them
+#define IMPORT_MAX 64
 #define RUNTIME_EXIT_CODE 70
 #define COMPILER_EXIT_CODE 65
 #define STRUCT_INSTANCE_DEPTH 16
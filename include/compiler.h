@@ -58,6 +58,7 @@ typedef struct {
 	Token name;
 	int depth;
 	bool is_captured;
+	bool capture_by_reference; // assigned after its declaration, or captured where the capture could not be recorded
 	ObjectTypeRecord *type;
 } Local;
 
@@ -154,6 +155,8 @@ struct Compiler {
 	Local locals[UINT8_COUNT];
     MatchCompiler match_compiler[MATCH_NEST_DEPTH];
 	Upvalue upvalues[UINT8_COUNT];
+	int capture_sites[UINT8_COUNT]; // code offsets of the OP_CLOSURE operands that capture a live local
+	int capture_site_count;
 	NarrowingInfo current_narrowing;
 	Table globals;
 	int scope_depth; // 0 is global scope
@@ -163,6 +166,8 @@ struct Compiler {
 	FunctionType type;
 	int type_stack_count;
     int match_depth;
+	int temporary_end; // code offset just after the last instruction that created an unshared Vector or Complex
+	int call_end; // code offset just after the last OP_CALL
 	bool has_return;
 };
 typedef void (*ParseFn)(Compiler *compiler, const bool can_assign);
@@ -231,7 +236,7 @@ int emit_jump(const Compiler *compiler, uint16_t instruction);
 /**
  * Patches a jump instruction with the calculated offset.
  */
-void patch_jump(const Compiler *compiler, int offset);
+void patch_jump(Compiler *compiler, int offset);
 
 void emit_return(const Compiler *compiler);
 
@@ -365,6 +370,27 @@ void add_local(Compiler *compiler, Token name, ObjectTypeRecord *type);
  */
 int resolve_upvalue(Compiler *compiler, Token *name);
 
+/**
+ * Records that the variable written by <set_op> with operand <arg> is assigned, so closures capture it by reference.
+ *
+ * @param compiler The current compiler.
+ * @param set_op OP_SET_LOCAL, OP_SET_UPVALUE or OP_SET_GLOBAL.
+ * @param arg The local slot, upvalue index or global index.
+ */
+void mark_assigned(Compiler *compiler, uint16_t set_op, int arg);
+
+/**
+ * Records the code offset of an OP_CLOSURE operand that captures the local <slot>, so that the capture can be turned
+ * into a copy once the local turns out to never be assigned.
+ */
+void record_capture_site(Compiler *compiler, int offset, int slot);
+
+/**
+ * Turns the recorded captures of the locals from <first_slot> on that are never assigned into copies and forgets
+ * their capture sites.
+ */
+void resolve_capture_sites(Compiler *compiler, int first_slot);
+
 void ensure_local_name_available(const Compiler *compiler, const Token name);
 
 void declare_named_variable(Compiler *compiler, Token name, ObjectTypeRecord *type);
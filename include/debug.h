@@ -31,4 +31,12 @@ void disassemble_chunk(const Chunk *chunk, const char *name);
  */
 int disassemble_instruction(const Chunk *chunk, int offset);
 
+/**
+ * @brief Returns the name of an opcode, such as "OP_RETURN"
+ *
+ * @param opcode The opcode
+ * @return A static string, "OP_UNKNOWN" for values outside the enum
+ */
+const char *opcode_name(int opcode);
+
 #endif // DEBUG_H
@@ -0,0 +1,48 @@
+#ifndef FUNCTION_STATS_H
+#define FUNCTION_STATS_H
+
+#include "vm.h"
+
+void init_function_stats(FunctionStats *stats);
+void free_function_stats(FunctionStats *stats);
+
+/**
+ * @brief Turns measurement on or off. Calls already in progress when it is turned on are not measured
+ */
+void set_function_stats_enabled(VM *vm, bool enabled);
+
+/**
+ * @brief Forgets every measurement taken so far
+ */
+void reset_function_stats(VM *vm);
+
+/**
+ * @brief Counts a call and starts timing the frame. Called by call() while statistics are enabled
+ */
+void enter_function_stats(VM *vm, CallFrame *frame);
+
+/**
+ * @brief Stops timing the innermost frame before it returns
+ */
+void exit_function_stats(VM *vm);
+
+/**
+ * @brief Charges <size> allocated bytes to the innermost running function
+ */
+void record_function_allocation(VM *vm, size_t size);
+
+/**
+ * @brief Returns the statistics entry of <function>, creating it if needed
+ *
+ * @return The entry, or NULL if it could not be allocated
+ */
+FunctionStatsEntry *function_stats_entry(VM *vm, ObjectFunction *function);
+
+/**
+ * @brief Prints the measured functions to stderr, slowest exclusive time first
+ */
+void print_function_stats_report(VM *vm);
+
+void mark_function_stats_roots(VM *vm);
+
+#endif // FUNCTION_STATS_H
@@ -23,6 +23,13 @@ CruxObject *allocate_pooled_object(VM *vm, size_t size, ObjectType type);
 
 #define ALLOCATE_OBJECT(vm, type, objectType) (type *)allocate_pooled_object(vm, sizeof(type), objectType)
 
+typedef enum {
+	GC_TRIGGER_THRESHOLD, // the heap grew past next_gc
+	GC_TRIGGER_ALLOCATION_FAILURE, // an allocation failed and is retried after collecting
+	GC_TRIGGER_STRESS, // DEBUG_STRESS_GC collects on every allocation
+	GC_TRIGGER_EXPLICIT, // gc.collect()
+} GcTrigger;
+
 /**
  * @brief Reallocates a block of memory.
  *
@@ -63,8 +70,9 @@ void mark_value(VM *vm, Value value);
  * 5. Updates the `nextGC` threshold based on the current allocated memory.
  *
  * @param vm The virtual machine.
+ * @param trigger Why the collection runs, reported in the GC event log.
  */
-void collect_garbage(VM *vm);
+void collect_garbage(VM *vm, GcTrigger trigger);
 
 /**
  * @brief Frees all remaining objects in the VM's object list.
@@ -77,8 +85,43 @@ void collect_garbage(VM *vm);
  */
 void free_objects(VM *vm, bool free_all);
 
+/**
+ * @brief Chooses whether collections hand their dead objects to a helper thread instead of freeing them before the
+ * program continues
+ *
+ * Marking still stops the program. Explicit collections, and collections while the heap profiler or the GC event
+ * log need per-type counts, always sweep before returning. The CRUX_GC_BACKGROUND_SWEEP environment variable turns
+ * this on for the whole run.
+ *
+ * @param error_out Set to a static message when the platform has no threads
+ * @return false if background sweeping is not available
+ */
+bool set_background_sweep(VM *vm, bool enabled, const char **error_out);
+
+/**
+ * @brief Waits for the running background sweep, if any, and takes back the memory it freed
+ *
+ * Anything that walks the object list has to call this first.
+ */
+void finish_background_sweep(VM *vm);
+
+/**
+ * @brief Takes back the memory of a background sweep if it already finished. Called from the allocation path
+ */
+void poll_background_sweep(VM *vm);
+
+/**
+ * @brief Finishes the running sweep and stops the sweeper thread. Called when <vm> is freed
+ */
+void free_background_sweeper(VM *vm);
+
 void mark_object_internal(VM* vm, CruxObject* object);
 
+/**
+ * @brief Marks <object> once the running background sweep is finished, since the sweeper may be rewriting its header
+ */
+void defer_mark(VM *vm, CruxObject *object);
+
 
 /**
  * @brief Marks an object as reachable during garbage collection.
@@ -93,7 +136,13 @@ void mark_object_internal(VM* vm, CruxObject* object);
  */
 static inline void mark_object(VM *vm, CruxObject *object)
 {
-	if (object == NULL || object_is_marked(object) || object_is_immortal(object))
+	if (object == NULL)
+		return;
+	if (__builtin_expect(vm->gc_sweep_pending, 0)) {
+		defer_mark(vm, object);
+		return;
+	}
+	if (object_is_marked(object) || object_is_immortal(object))
 		return;
 
 	mark_object_internal(vm, object);
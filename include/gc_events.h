@@ -0,0 +1,42 @@
+#ifndef GC_EVENTS_H
+#define GC_EVENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "garbage_collector.h"
+#include "vm.h"
+
+/**
+ * @brief Starts appending one JSON line per collection to <path>, replacing any log that is already open
+ *
+ * The CRUX_GC_LOG environment variable opens a log for the whole run.
+ *
+ * @param vm The virtual machine
+ * @param path File to append to
+ * @param error_out Set to a static message when the file cannot be opened
+ * @return true if the log was opened
+ */
+bool open_gc_event_log(VM *vm, const char *path, const char **error_out);
+
+void close_gc_event_log(VM *vm);
+
+/**
+ * @brief Writes the collection that just finished to the event log
+ *
+ * @param vm The virtual machine, with the gc_last_* statistics of the collection filled in
+ * @param trigger Why the collection ran
+ * @param start_ns Monotonic time at which the collection started
+ * @param freed_counts Objects freed by type, SENTINEL_OBJECT_COUNT entries
+ */
+void write_gc_event(VM *vm, GcTrigger trigger, uint64_t start_ns, const uint32_t *freed_counts);
+
+void record_gc_pause(GcPauseHistogram *histogram, uint64_t pause_ns);
+
+/**
+ * @return The pause that <percentile> percent of the recorded pauses do not exceed, rounded up to the end of its
+ * bucket, or 0 if nothing was recorded
+ */
+uint64_t gc_pause_percentile(const GcPauseHistogram *histogram, double percentile);
+
+#endif // GC_EVENTS_H
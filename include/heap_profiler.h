@@ -0,0 +1,65 @@
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "object.h"
+#include "vm.h"
+
+#define HEAP_PROFILER_DEFAULT_SAMPLE_BYTES (64 * 1024)
+
+// Allocations made through reallocate() grow the storage behind objects (array items, table entries, string bytes)
+#define HEAP_PROFILE_STORAGE SENTINEL_OBJECT_COUNT
+#define HEAP_PROFILE_TYPE_COUNT (SENTINEL_OBJECT_COUNT + 1)
+
+/**
+ * @brief Starts attributing allocated bytes to the allocating source line and object type
+ *
+ * Every <sample_bytes>th allocated byte is sampled: the allocation containing it is charged <sample_bytes> bytes to
+ * the innermost frame's function and line. While the profiler runs, every collection also records how many objects
+ * of each type survived.
+ *
+ * @param vm The virtual machine
+ * @param sample_bytes Bytes between two samples, 1 records every allocation exactly
+ * @param error_out Set to a static message when the profiler cannot start
+ * @return true if the profiler was started
+ */
+bool heap_profiler_start(VM *vm, int64_t sample_bytes, const char **error_out);
+
+/**
+ * @brief Stops the heap profiler and writes what it recorded
+ *
+ * Writes <prefix>.folded (sampled bytes per "function (path:line);Type", the input format of flamegraph.pl and
+ * speedscope) and <prefix>.census (a CSV row of live objects by type per collection).
+ *
+ * @param vm The virtual machine
+ * @param prefix Path prefix of the output files, NULL to discard the profile
+ * @param error_out Set to a static message when the profile could not be written
+ * @return true if the profile was written (or discarded)
+ */
+bool heap_profiler_stop(VM *vm, const char *prefix, const char **error_out);
+
+/**
+ * @brief Counts <size> allocated bytes of <type> towards the next sample. Called while vm->heap_profiler is set
+ */
+void record_heap_allocation(VM *vm, uint32_t type, size_t size);
+
+/**
+ * @brief Stores the live objects by type counted by the sweep of the collection that just finished
+ */
+void record_heap_census(VM *vm, const uint32_t *live_counts);
+
+/**
+ * @brief Counts the objects currently on the heap by type, dead ones included until the next collection
+ */
+void count_heap_objects(const VM *vm, uint32_t counts[SENTINEL_OBJECT_COUNT]);
+
+/**
+ * @return The object_type_name() of <type>, "Storage" for HEAP_PROFILE_STORAGE
+ */
+const char *heap_profile_type_name(uint32_t type);
+
+void mark_heap_profiler_roots(VM *vm);
+
+#endif // HEAP_PROFILER_H
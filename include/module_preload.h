@@ -0,0 +1,37 @@
+#ifndef MODULE_PRELOAD_H
+#define MODULE_PRELOAD_H
+
+#include <stdbool.h>
+
+#include "vm.h"
+
+void init_module_preload(ModulePreload *preload);
+
+/**
+ * @brief Reads every file reachable through static imports before compilation starts
+ *
+ * Discovers the transitive `use ... from "path"` graph of <entry_source> with the scanner alone and reads the
+ * files of each level of the graph concurrently. The compiler then finds their sources in memory instead of
+ * blocking on disk for each import in turn. Files that cannot be read are left for the compiler to report.
+ *
+ * @param vm The virtual machine that will compile <entry_source>
+ * @param entry_path The path of the file being compiled, used to resolve relative imports
+ * @param entry_source The source of the file being compiled
+ */
+void preload_import_graph(VM *vm, const char *entry_path, const char *entry_source);
+
+/**
+ * @brief Hands a preloaded source over to the caller
+ *
+ * @param vm The virtual machine
+ * @param path A path produced by resolve_path
+ * @return The source, which the caller must free, or NULL if <path> was not preloaded
+ */
+char *take_preloaded_source(VM *vm, const char *path);
+
+/**
+ * @brief Frees every preloaded source the compiler did not take
+ */
+void release_preloaded_sources(ModulePreload *preload);
+
+#endif // MODULE_PRELOAD_H
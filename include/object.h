@@ -19,22 +19,17 @@
 // Only works with string literals -- gc_safe_static_message
 #define MAKE_GC_SAFE_ERROR(vm, gc_safe_static_message, gc_safe_error_type)                                             \
 	({                                                                                                                 \
-		ObjectString *message = copy_string((vm), (gc_safe_static_message),                                            \
-											STATIC_STRING_LEN((gc_safe_static_message)));                              \
-		push((vm)->current_module_record, OBJECT_VAL(message));                                                        \
-		ObjectError *gc_safe_error = new_error((vm), message, (gc_safe_error_type), false);                            \
-		push((vm)->current_module_record, OBJECT_VAL(gc_safe_error));                                                  \
-		ObjectResult *gcSafeErrorResult = new_error_result((vm), gc_safe_error);                                       \
-		pop((vm)->current_module_record);                                                                              \
-		pop((vm)->current_module_record);                                                                              \
+		ObjectResult *gcSafeErrorResult = static_error_result((vm), (gc_safe_static_message),                          \
+															  STATIC_STRING_LEN((gc_safe_static_message)),             \
+															  (gc_safe_error_type));                                   \
 		OBJECT_VAL(gcSafeErrorResult);                                                                                 \
 	})
 
 #define MAKE_GC_SAFE_RESULT(vm, object)                                                                                \
 	({                                                                                                                 \
-		push((vm)->current_module_record, OBJECT_VAL(object));                                                         \
+		push((vm), OBJECT_VAL(object));                                                                                \
 		ObjectResult *gcSafeResult = new_ok_result((vm), OBJECT_VAL(object));                                          \
-		pop((vm)->current_module_record);                                                                              \
+		pop((vm));                                                                                                     \
 		OBJECT_VAL(gcSafeResult);                                                                                      \
 	})
 
@@ -171,9 +166,21 @@ struct CruxObject {
 
 // Object getters
 
+#ifdef CRUX_TAGGED_OBJECT
+// A background sweep rewrites the headers of surviving objects while the program reads their types, so the header
+// word is accessed atomically. Relaxed loads and stores compile to plain moves.
+static inline uintptr_t object_load_tags(const CruxObject* object) {
+    return __atomic_load_n(&object->tagged_next, __ATOMIC_RELAXED);
+}
+
+static inline void object_store_tags(CruxObject* object, uintptr_t tags) {
+    __atomic_store_n(&object->tagged_next, tags, __ATOMIC_RELAXED);
+}
+#endif
+
 static inline CruxObject* object_get_next(CruxObject* object) {
     #ifdef CRUX_TAGGED_OBJECT
-    return (CruxObject*)(object->tagged_next & CRUX_TAGGED_POINTER_MASK);
+    return (CruxObject*)(object_load_tags(object) & CRUX_TAGGED_POINTER_MASK);
     #else
     return object->next;
     #endif
@@ -181,7 +188,7 @@ static inline CruxObject* object_get_next(CruxObject* object) {
 
 static inline ObjectType object_get_type(CruxObject* object) {
     #ifdef CRUX_TAGGED_OBJECT
-    return (ObjectType)((object->tagged_next >> CRUX_TAGGED_TYPE_SHIFT) & CRUX_TAGGED_TYPE_MASK);
+    return (ObjectType)((object_load_tags(object) >> CRUX_TAGGED_TYPE_SHIFT) & CRUX_TAGGED_TYPE_MASK);
     #else
     return object->type;
     #endif
@@ -189,7 +196,7 @@ static inline ObjectType object_get_type(CruxObject* object) {
 
 static inline bool object_is_marked(CruxObject* object) {
     #ifdef CRUX_TAGGED_OBJECT
-    return (object->tagged_next >> CRUX_TAGGED_MARKED_SHIFT) & 1;
+    return (object_load_tags(object) >> CRUX_TAGGED_MARKED_SHIFT) & 1;
     #else
     return object->is_marked;
     #endif
@@ -197,7 +204,7 @@ static inline bool object_is_marked(CruxObject* object) {
 
 static inline bool object_is_immortal(CruxObject* object) {
     #ifdef CRUX_TAGGED_OBJECT
-    return (object->tagged_next >> CRUX_TAGGED_IMMORTAL_SHIFT) & 1;
+    return (object_load_tags(object) >> CRUX_TAGGED_IMMORTAL_SHIFT) & 1;
     #else
     return object->is_immortal;
     #endif
@@ -206,7 +213,7 @@ static inline bool object_is_immortal(CruxObject* object) {
 
 static inline void object_set_next(CruxObject* object, CruxObject* next) {
     #ifdef CRUX_TAGGED_OBJECT
-    object->tagged_next = (object->tagged_next & ~CRUX_TAGGED_POINTER_MASK) | ((uintptr_t)next & CRUX_TAGGED_POINTER_MASK);
+    object_store_tags(object, (object_load_tags(object) & ~CRUX_TAGGED_POINTER_MASK) | ((uintptr_t)next & CRUX_TAGGED_POINTER_MASK));
     #else
     object->next = next;
     #endif
@@ -214,7 +221,7 @@ static inline void object_set_next(CruxObject* object, CruxObject* next) {
 
 static inline void object_set_marked(CruxObject* object, bool marked) {
     #ifdef CRUX_TAGGED_OBJECT
-    object->tagged_next = (object->tagged_next & ~(1ULL << CRUX_TAGGED_MARKED_SHIFT)) | ((uintptr_t)marked << CRUX_TAGGED_MARKED_SHIFT);
+    object_store_tags(object, (object_load_tags(object) & ~(1ULL << CRUX_TAGGED_MARKED_SHIFT)) | ((uintptr_t)marked << CRUX_TAGGED_MARKED_SHIFT));
     #else
     object->is_marked = marked;
     #endif
@@ -222,7 +229,7 @@ static inline void object_set_marked(CruxObject* object, bool marked) {
 
 static inline void object_set_immortal(CruxObject* object, bool immortal) {
     #ifdef CRUX_TAGGED_OBJECT
-    object->tagged_next = (object->tagged_next & ~(1ULL << CRUX_TAGGED_IMMORTAL_SHIFT)) | ((uintptr_t)immortal << CRUX_TAGGED_IMMORTAL_SHIFT);
+    object_store_tags(object, (object_load_tags(object) & ~(1ULL << CRUX_TAGGED_IMMORTAL_SHIFT)) | ((uintptr_t)immortal << CRUX_TAGGED_IMMORTAL_SHIFT));
     #else
     object->is_immortal = immortal;
     #endif
@@ -235,7 +242,7 @@ static inline void object_init(CruxObject* object, CruxObject* next,  ObjectType
     tags |= ((uintptr_t) marked) << CRUX_TAGGED_MARKED_SHIFT;
     tags |= ((uintptr_t) immortal) << CRUX_TAGGED_IMMORTAL_SHIFT;
 
-    object->tagged_next = ((uintptr_t) next & CRUX_TAGGED_POINTER_MASK) | tags;
+    object_store_tags(object, ((uintptr_t) next & CRUX_TAGGED_POINTER_MASK) | tags);
     #else
     object->next = next;
     object->type = type;
@@ -257,13 +264,16 @@ struct ObjectString {
 
 typedef struct ObjectModuleRecord ObjectModuleRecord;
 
-typedef struct {
+typedef struct ObjectFunction {
 	CruxObject object;
 	int arity;
 	int upvalue_count;
 	Chunk chunk;
 	ObjectString *name;
 	ObjectModuleRecord *module_record;
+	bool is_generator; // declared with fn*, calling it returns a suspended coroutine
+	uint32_t stats_slot; // 1-based index into VM::function_stats, 0 until the function is measured
+	struct ObjectClosure *shared_closure; // the closure of a function without upvalues, created by its first OP_CLOSURE
 } ObjectFunction;
 
 typedef struct ObjectUpvalue {
@@ -336,11 +346,11 @@ struct ObjectResult {
 	} as;
 };
 
-typedef struct {
+struct ObjectOption {
 	CruxObject object;
 	Value value;
 	bool is_some;
-} ObjectOption;
+};
 
 typedef struct {
 	CruxObject object;
@@ -423,14 +433,15 @@ struct ObjectTypeRecord {
 
 typedef Value (*CruxCallable)(VM *vm, const Value *args);
 
-typedef struct {
+struct ObjectNativeCallable {
 	CruxObject object;
 	CruxCallable function;
 	ObjectString *name;
 	int arity;
+	bool is_pure; // only computes its result from numeric arguments, so it can run on any thread
 	ObjectTypeRecord **arg_types;
 	ObjectTypeRecord *return_type;
-} ObjectNativeCallable;
+};
 
 typedef struct {
 	Value key;
@@ -457,10 +468,12 @@ typedef struct {
 struct ObjectStructInstance {
 	CruxObject object;
 	ObjectStruct *struct_type;
-	Value *fields;
 	uint16_t field_count;
+	Value fields[]; // allocated with the instance, so small instances share one slab slot
 };
 
+#define STRUCT_INSTANCE_SIZE(field_count) (sizeof(ObjectStructInstance) + sizeof(Value) * (field_count))
+
 #define STATIC_VECTOR_SIZE 4
 #define VECTOR_COMPONENTS(vec)                                                                                         \
 	((vec)->dimensions <= STATIC_VECTOR_SIZE ? (vec)->as.s_components : (vec)->as.h_components)
@@ -491,14 +504,32 @@ typedef struct {
 typedef enum {
 	STATE_LOADING,
 	STATE_LOADED,
+	STATE_EXECUTING, // its script is running on the VM stack
 	STATE_ERROR,
 	STATE_EXECUTED,
 } ModuleState;
 
+typedef enum {
+	ITERATOR_SEQUENCE, // walks a builtin iterable by index
+	ITERATOR_MAP,
+	ITERATOR_FILTER,
+	ITERATOR_TAKE,
+	ITERATOR_SKIP,
+	ITERATOR_ZIP,
+	ITERATOR_ENUMERATE,
+	ITERATOR_CHAIN,
+} IteratorKind;
+
+/**
+ * Sequences walk <iterable> directly. Adapters pull lazily from the upstream iterator stored in <iterable>, so a chain
+ * of them runs as a single pass without intermediate collections.
+ */
 struct ObjectIterator {
 	CruxObject object;
-	Value iterable;
-	uint32_t index;
+	Value iterable; // the collection for sequences, the upstream iterator for adapters
+	Value operand; // callback for map/filter, second iterator for zip/chain
+	uint32_t index; // element position, remaining take/skip count, or enumerate counter
+	IteratorKind kind;
 };
 
 struct ObjectModuleRecord {
@@ -509,21 +540,52 @@ struct ObjectModuleRecord {
 	Table publics;
 	ObjectTypeTable *types;
 	ObjectClosure *module_closure;
-	ObjectModuleRecord *enclosing_module;
-	ObjectUpvalue *open_upvalues;
 	Value *globals;
-	Value *stack;
-	Value *stack_top;
-	Value *stack_limit;
-	CallFrame *frames;
 	uint32_t global_count;
 	ModuleState state;
-	uint8_t frame_count;
-	uint8_t frame_capacity;
 	bool is_repl;
 	bool is_main;
 };
 
+typedef enum {
+	COROUTINE_CREATED,
+	COROUTINE_SUSPENDED,
+	COROUTINE_RUNNING,
+	COROUTINE_DONE,
+	COROUTINE_ERROR,
+} CoroutineState;
+
+typedef enum {
+	COROUTINE_WAIT_NONE,
+	COROUTINE_WAIT_TIMER,
+	COROUTINE_WAIT_READABLE,
+	COROUTINE_WAIT_READ_LINE,
+} CoroutineWait;
+
+/**
+ * A stackful coroutine. Its execution context (stack, frames and open upvalues) is swapped with the one in the
+ * VM on every resume/suspend, so while the coroutine is running these fields hold the context of whoever resumed it.
+ */
+struct ObjectCoroutine {
+	CruxObject object;
+	ObjectClosure *closure;
+	ObjectCoroutine *resumer;
+	ObjectCoroutine *next_live; // VM-wide list used to close upvalues of unreachable coroutines
+	Value transfer; // value handed across the last resume/suspend boundary
+	Value *stack;
+	Value *stack_top;
+	Value *stack_limit;
+	CallFrame *frames;
+	ObjectUpvalue *open_upvalues;
+	uint64_t wake_at_ms;
+	int wait_fd;
+	CoroutineState state;
+	CoroutineWait wait;
+	uint32_t frame_count;
+	uint32_t frame_capacity;
+	bool is_scheduled;
+};
+
 struct ObjectRange {
 	CruxObject object;
 	int32_t start;
@@ -557,13 +619,52 @@ static bool is_object_type(const Value value, const ObjectType type)
 
 ObjectError *new_error(VM *vm, ObjectString *message, ErrorType type, bool is_panic);
 ObjectUpvalue *new_upvalue(VM *vm, Value *slot);
+
+/**
+ * @brief Allocates an upvalue that is closed over a copy of <value> and never on the open upvalue list
+ */
+ObjectUpvalue *new_closed_upvalue(VM *vm, Value value);
 ObjectClosure *new_closure(VM *vm, ObjectFunction *function);
 ObjectNativeCallable *new_native_callable(VM *vm, CruxCallable function, int arity, ObjectString *name,
 										  ObjectTypeRecord **arg_types, ObjectTypeRecord *return_type);
 ObjectFunction *new_function(VM *vm);
+
+/**
+ * @return The name of <type> as shown in heap profiles and GC logs, e.g. "StructInstance"
+ */
+const char *object_type_name(ObjectType type);
 ObjectTable *new_object_table(VM *vm, int element_count);
 ObjectResult *new_ok_result(VM *vm, Value value);
+
+/**
+ * @brief Returns <value> as the successful result of the running native
+ *
+ * When the caller of the native unwraps the result right away, the value is returned as is and no Result is
+ * allocated. Only use it in the return statement of a native that call_native() runs; pure natives are also called
+ * from pool threads and must not use it.
+ */
+Value native_ok(VM *vm, Value value);
 ObjectResult *new_error_result(VM *vm, ObjectError *error);
+
+/**
+ * @brief Allocates an error result of <type> whose error holds a copy of <message>
+ */
+Value make_error_result(VM *vm, const char *message, ErrorType type);
+
+/**
+ * @brief Returns the error result of the static string <message>
+ *
+ * The result, its error and the message are allocated once per VM and are immortal. Later calls with the same string
+ * literal and type return the same result.
+ */
+ObjectResult *static_error_result(VM *vm, const char *message, uint32_t length, ErrorType type);
+
+/**
+ * @brief Allocates the immortal None, Ok(nil), Ok(true) and Ok(false) that new_option() and new_ok_result() return
+ */
+void init_immortal_values(VM *vm);
+
+void free_static_errors(VM *vm);
 ObjectArray *new_array(VM *vm, uint32_t element_count);
 ObjectString *take_string(VM *vm, char *chars, uint32_t length);
 ObjectString *copy_string(VM *vm, const char *chars, uint32_t length);
@@ -605,9 +706,10 @@ bool validate_range_values(int32_t start, int32_t step, int32_t end, const char
 
 uint32_t range_len(const ObjectRange *range);
 bool range_contains(const ObjectRange *range, int32_t value);
-bool iterate_next(ObjectModuleRecord *module_record, ObjectIterator *iterator, Value *result);
+bool iterate_next(VM *vm, ObjectIterator *iterator, Value *result);
 
 ObjectOption *new_option(VM *vm, Value value, bool is_some);
+ObjectCoroutine *new_coroutine(VM *vm, ObjectClosure *closure);
 
 uint32_t hash_string(const char *key, const size_t length);
 #endif
@@ -0,0 +1,51 @@
+#ifndef OPCODE_STATS_H
+#define OPCODE_STATS_H
+
+#ifdef OPCODE_STATS
+
+#include <stdint.h>
+
+#include "chunk.h"
+#include "object.h"
+
+typedef struct {
+	const ObjectNativeCallable *native; // natives are immortal, so the pointer identifies them for the whole run
+	uint64_t calls;
+	uint64_t total_ns; // includes Crux callbacks the native made
+} NativeCallStats;
+
+/**
+ * Execution counters collected by builds with CRUX_OPCODE_STATS and written as JSON when the VM is freed.
+ */
+typedef struct OpcodeStats {
+	uint64_t counts[OP_COUNT];
+	uint64_t pairs[OP_COUNT][OP_COUNT]; // [previous][current]
+	uint16_t previous;
+	NativeCallStats *natives;
+	uint32_t native_count;
+	uint32_t native_capacity;
+} OpcodeStats;
+
+OpcodeStats *new_opcode_stats(void);
+
+static inline void record_opcode(OpcodeStats *stats, const uint16_t opcode)
+{
+	stats->counts[opcode]++;
+	stats->pairs[stats->previous][opcode]++;
+	stats->previous = opcode;
+}
+
+uint64_t opcode_stats_now_ns(void);
+void record_native_call(OpcodeStats *stats, const ObjectNativeCallable *native, uint64_t elapsed_ns);
+
+/**
+ * @brief Writes the counters as JSON and frees them
+ *
+ * The output goes to the file named by the CRUX_OPCODE_STATS_FILE environment variable, or crux-opcode-stats.json
+ * in the working directory.
+ */
+void dump_opcode_stats(OpcodeStats *stats);
+
+#endif // OPCODE_STATS
+
+#endif // OPCODE_STATS_H
@@ -15,8 +15,7 @@ typedef struct {
  *
  * NOTE!: Any code called after this will not execute
  */
-void runtime_panic(ObjectModuleRecord *module_record,
-		   ErrorType type, const char *format, ...);
+void runtime_panic(VM *vm, ErrorType type, const char *format, ...);
 
 /**
  * Creates a formatted error message for type mismatches with type
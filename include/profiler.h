@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+#include "vm.h"
+
+#define PROFILER_DEFAULT_HZ 1000
+
+/**
+ * @brief Starts sampling the running Crux program
+ *
+ * A CPU time timer (SIGPROF) counts ticks, and the interpreter records the call stack at the next safe point
+ * (a backward jump or a call), so sampling costs a single predictable branch while the profiler is off.
+ *
+ * @param vm The virtual machine
+ * @param hz Samples per second of CPU time
+ * @param error_out Set to a static message when the profiler cannot start
+ * @return true if the profiler was started
+ */
+bool profiler_start(VM *vm, int hz, const char **error_out);
+
+/**
+ * @brief Stops the profiler and writes what it recorded
+ *
+ * Writes <prefix>.folded (folded stacks weighted in microseconds of CPU time, the input format of flamegraph.pl and
+ * speedscope) and <prefix>.pprof (an uncompressed profile.proto readable by `go tool pprof`).
+ *
+ * @param vm The virtual machine
+ * @param prefix Path prefix of the output files, NULL to discard the samples
+ * @param error_out Set to a static message when the profile could not be written
+ * @return true if the profile was written (or discarded)
+ */
+bool profiler_stop(VM *vm, const char *prefix, const char **error_out);
+
+/**
+ * @brief Records the current call stack, weighted by the CPU time used since the last sample
+ *
+ * Called from the interpreter's safe points when vm->profile_ticks is non-zero.
+ */
+void profiler_record_sample(VM *vm);
+
+/**
+ * @return The source line of the instruction <frame> is executing, 0 if the function has no line information
+ */
+int call_frame_line(const CallFrame *frame);
+
+/**
+ * @brief Marks the functions referenced by recorded samples so their names outlive the closures
+ */
+void mark_profiler_roots(VM *vm);
+
+#endif // PROFILER_H
@@ -0,0 +1,35 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include "../object.h"
+#include "../value.h"
+
+void init_event_loop(EventLoop *loop);
+void free_event_loop(EventLoop *loop);
+
+/**
+ * Parks the running event loop task until <delay_ms> milliseconds have passed.
+ * Returns false when the caller is not a scheduled task and should block instead.
+ */
+bool coroutine_park_timer(VM *vm, double delay_ms);
+
+/**
+ * Parks the running event loop task until <fd> becomes readable. For COROUTINE_WAIT_READ_LINE the loop reads the
+ * line from stdin itself and resumes the task with the result.
+ * Returns false when the caller is not a scheduled task, or the descriptor is always ready (regular files), and
+ * the caller should do the operation synchronously.
+ */
+bool coroutine_park_fd(VM *vm, int fd, CoroutineWait wait);
+
+// Coroutine functions
+Value coroutine_create_function(VM *vm, const Value *args);
+Value coroutine_resume_function(VM *vm, const Value *args);
+Value coroutine_suspend_function(VM *vm, const Value *args);
+Value coroutine_is_done_function(VM *vm, const Value *args);
+
+// Event loop functions
+Value coroutine_spawn_function(VM *vm, const Value *args);
+Value coroutine_run_function(VM *vm, const Value *args);
+Value coroutine_wait_readable_function(VM *vm, const Value *args);
+
+#endif // COROUTINE_H
@@ -13,5 +13,11 @@ Value gc_heap_used_function(VM *vm, const Value *args);
 Value gc_heap_capacity_function(VM *vm, const Value *args);
 Value gc_is_on_function(VM *vm, const Value *args);
 Value gc_stats_function(VM *vm, const Value *args);
+Value gc_heap_profile_start_function(VM *vm, const Value *args);
+Value gc_heap_profile_stop_function(VM *vm, const Value *args);
+Value gc_census_function(VM *vm, const Value *args);
+Value gc_start_event_log_function(VM *vm, const Value *args);
+Value gc_stop_event_log_function(VM *vm, const Value *args);
+Value gc_set_background_sweep_function(VM *vm, const Value *args);
 
 #endif
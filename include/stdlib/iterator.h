@@ -0,0 +1,26 @@
+#ifndef ITERATOR_H
+#define ITERATOR_H
+
+#include "../object.h"
+#include "../value.h"
+
+/**
+ * Produces the next element of a lazy adapter (map, filter, take, ...) by pulling from its upstream iterator.
+ * @return false once the adapter is exhausted
+ */
+bool iterator_adapter_next(VM *vm, ObjectIterator *iterator, Value *value_out);
+
+// Lazy adapters
+Value map_iterator_method(VM *vm, const Value *args);
+Value filter_iterator_method(VM *vm, const Value *args);
+Value take_iterator_method(VM *vm, const Value *args);
+Value skip_iterator_method(VM *vm, const Value *args);
+Value zip_iterator_method(VM *vm, const Value *args);
+Value enumerate_iterator_method(VM *vm, const Value *args);
+Value chain_iterator_method(VM *vm, const Value *args);
+
+// Consumers
+Value collect_iterator_method(VM *vm, const Value *args);
+Value sum_iterator_method(VM *vm, const Value *args);
+
+#endif // ITERATOR_H
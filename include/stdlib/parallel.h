@@ -0,0 +1,11 @@
+#ifndef CRUX_PARALLEL_H
+#define CRUX_PARALLEL_H
+
+#include "object.h"
+
+Value array_par_map_method(VM *vm, const Value *args);
+Value array_par_reduce_method(VM *vm, const Value *args);
+Value parallel_for_range_function(VM *vm, const Value *args);
+Value parallel_threads_function(VM *vm, const Value *args);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef CRUX_PROFILE_H
+#define CRUX_PROFILE_H
+
+#include "object.h"
+
+Value profile_start_stats_function(VM *vm, const Value *args);
+Value profile_stop_stats_function(VM *vm, const Value *args);
+Value profile_reset_function(VM *vm, const Value *args);
+Value profile_report_function(VM *vm, const Value *args);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef CRUX_SERDE_H
+#define CRUX_SERDE_H
+
+#include "object.h"
+
+Value serde_pack_function(VM *vm, const Value *args);
+Value serde_unpack_function(VM *vm, const Value *args);
+
+#endif
@@ -10,5 +10,7 @@ Value pid_function(VM *vm, const Value *args);
 Value get_env_function(VM *vm, const Value *args);
 Value sleep_function(VM *vm, const Value *args);
 Value exit_function(VM *vm, const Value *args);
+Value profile_start_function(VM *vm, const Value *args);
+Value profile_stop_function(VM *vm, const Value *args);
 
 #endif // SYS_H
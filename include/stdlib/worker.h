@@ -0,0 +1,13 @@
+#ifndef CRUX_WORKER_H
+#define CRUX_WORKER_H
+
+#include "object.h"
+
+Value worker_spawn_function(VM *vm, const Value *args);
+Value worker_send_function(VM *vm, const Value *args);
+Value worker_receive_function(VM *vm, const Value *args);
+Value worker_join_function(VM *vm, const Value *args);
+Value worker_send_parent_function(VM *vm, const Value *args);
+Value worker_receive_parent_function(VM *vm, const Value *args);
+
+#endif
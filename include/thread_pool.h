@@ -0,0 +1,34 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+#define THREAD_POOL_MAX_THREADS 64
+
+/**
+ * Runs task <task_index> of a parallel job. <thread_index> identifies the thread running it, from 0 (the thread that
+ * called run_parallel()) to thread_pool_size() - 1, so tasks can keep per-thread state.
+ */
+typedef void (*ParallelTask)(void *context, uint32_t task_index, uint32_t thread_index);
+
+/**
+ * @return How many threads run_parallel() uses, including the calling thread. The CRUX_THREADS environment variable
+ * overrides the number of online cores
+ */
+uint32_t thread_pool_size(VM *vm);
+
+/**
+ * @brief Runs tasks 0 to <task_count> - 1 on the VM's thread pool and returns once all of them finished
+ *
+ * Every thread starts on its own contiguous share of the task indices and steals from the other end of another
+ * thread's share once its own is done. The pool threads are started on first use and live until the VM is freed.
+ * Tasks must not touch the VM's heap except to read values the caller keeps alive.
+ */
+void run_parallel(VM *vm, uint32_t task_count, ParallelTask task, void *context);
+
+void free_thread_pool(VM *vm);
+
+#endif // THREAD_POOL_H
@@ -1,6 +1,9 @@
 #ifndef VM_H
 #define VM_H
 
+#include <signal.h>
+#include <stdio.h>
+
 #include "chunk.h"
 #include "common.h"
 #include "table.h"
@@ -8,26 +11,38 @@
 #include "value.h"
 
 typedef struct ObjectClosure ObjectClosure;
+typedef struct ObjectFunction ObjectFunction;
 typedef struct ObjectUpvalue ObjectUpvalue;
 typedef struct ObjectModuleRecord ObjectModuleRecord;
 typedef struct ObjectIterator ObjectIterator;
 typedef struct ObjectResult ObjectResult;
+typedef struct ObjectOption ObjectOption;
 typedef struct ObjectStructInstance ObjectStructInstance;
 typedef struct ObjectTypeRecord ObjectTypeRecord;
 typedef struct ObjectTypeTable ObjectTypeTable;
 typedef struct ObjectRange ObjectRange;
+typedef struct ObjectCoroutine ObjectCoroutine;
+typedef struct ObjectNativeCallable ObjectNativeCallable;
 typedef struct SlabAllocator SlabAllocator;
+typedef struct SamplingProfiler SamplingProfiler;
+typedef struct HeapProfiler HeapProfiler;
+typedef struct OpcodeStats OpcodeStats;
 typedef struct Compiler Compiler;
+typedef struct Worker Worker;
+typedef struct ThreadPool ThreadPool;
+typedef struct BackgroundSweeper BackgroundSweeper;
 
-typedef enum { INTERPRET_OK = 0, INTERPRET_COMPILE_ERROR = 1, INTERPRET_RUNTIME_ERROR = 2, INTERPRET_EXIT = 3 } InterpretResult;
+typedef enum { INTERPRET_OK = 0, INTERPRET_COMPILE_ERROR = 1, INTERPRET_RUNTIME_ERROR = 2, INTERPRET_EXIT = 3, INTERPRET_YIELD = 4 } InterpretResult;
 
 /**
  * An ongoing function call
  */
 typedef struct {
 	ObjectClosure *closure;
-	uint16_t *ip;
+	ThreadedWord *ip;
 	Value *slots;
+	uint64_t stats_start_ns; // 0 unless the call started while function statistics were enabled
+	uint64_t stats_child_ns; // time spent in calls made from this frame
 } CallFrame;
 
 typedef struct {
@@ -59,6 +74,30 @@ typedef struct {
 	uint32_t capacity;
 } ImportStack;
 
+typedef struct {
+	char *path; // resolved path, as produced by resolve_path
+	char *source; // NULL once taken by the compiler or when the file could not be read
+	uint32_t hash;
+} PreloadedModule;
+
+typedef struct {
+	PreloadedModule *modules; // every file reachable through static imports of the source being compiled
+	uint32_t count;
+	uint32_t capacity;
+} ModulePreload;
+
+typedef struct {
+	const char *message; // the static message, compared by address
+	int type; // ErrorType of the error
+	ObjectResult *result;
+} StaticError;
+
+typedef struct {
+	StaticError *entries; // open addressing, NULL message marks an empty slot
+	uint32_t count;
+	uint32_t capacity;
+} StaticErrorCache;
+
 typedef struct {
 	ObjectStructInstance **structs;
 	uint32_t count;
@@ -71,11 +110,54 @@ typedef struct {
 	uint32_t capacity;
 } MatchHandlerStack;
 
+typedef struct {
+	ObjectFunction *function;
+	uint64_t calls;
+	uint64_t inclusive_ns;
+	uint64_t exclusive_ns;
+	uint64_t alloc_bytes; // allocated while the function was the innermost frame
+	uint32_t active_frames; // recursive calls only add inclusive time once, when the outermost one returns
+} FunctionStatsEntry;
+
+typedef struct {
+	FunctionStatsEntry *entries; // indexed by ObjectFunction::stats_slot - 1
+	uint32_t count;
+	uint32_t capacity;
+	bool enabled;
+	bool report_on_exit;
+} FunctionStats;
+
+typedef struct {
+	ObjectCoroutine **tasks; // spawned coroutines that have not finished yet
+	uint32_t count;
+	uint32_t capacity;
+	int poll_fd; // epoll instance, created on first use
+} EventLoop;
+
+typedef struct {
+	Worker **items; // indexed by worker id, NULL once joined
+	uint32_t count;
+	uint32_t capacity;
+} WorkerSet;
+
 typedef enum {
 	PAUSED,
 	RUNNING,
 } GC_STATUS;
 
+#define GC_PAUSE_SUB_BUCKETS 16
+#define GC_PAUSE_BUCKETS (61 * GC_PAUSE_SUB_BUCKETS)
+
+/**
+ * Log-linear histogram of collection pauses in nanoseconds. Values below 16 get their own bucket, larger ones share
+ * 16 buckets per power of two, so any recorded pause is known within 1/16 of its value.
+ */
+typedef struct {
+	uint64_t counts[GC_PAUSE_BUCKETS];
+	uint64_t total;
+	uint64_t max_ns;
+} GcPauseHistogram;
+
 struct VM {
 	CruxObject *objects; // Head of global object linked list
 	size_t object_count;
@@ -85,12 +167,30 @@ struct VM {
 	SlabAllocator *slab_48;
 	SlabAllocator *slab_64;
 
-	ObjectModuleRecord *current_module_record;
+	ObjectModuleRecord *current_module_record; // the module whose script is running or being compiled
 	ImportStack import_stack;
+
+	// every module runs on this stack; a running coroutine has its own swapped in, see ObjectCoroutine
+	Value *stack;
+	Value *stack_top;
+	Value *stack_limit;
+	CallFrame *frames;
+	ObjectUpvalue *open_upvalues;
+	uint32_t frame_count;
+	uint32_t frame_capacity;
+
 	MatchHandlerStack match_handler_stack;
 
 	Table module_cache;
+	ModulePreload module_preload;
 	Table strings;
+
+	// immortal values returned instead of allocating equal ones
+	ObjectOption *none_option;
+	ObjectResult *ok_nil_result;
+	ObjectResult *ok_bool_results[2]; // indexed by the bool
+	StaticErrorCache static_errors; // see static_error_result()
+
 	Table core_fns;
 	Table random_type;
 	Table string_type;
@@ -107,12 +207,34 @@ struct VM {
 	Table set_type;
 	Table tuple_type;
 	Table buffer_type;
+	Table iterator_type;
 
 	StructInstanceStack struct_instance_stack;
 
+	ObjectCoroutine *current_coroutine;
+	ObjectCoroutine *coroutines; // every coroutine that may still own open upvalues
+	EventLoop event_loop;
+	uint32_t reentry_depth; // nested run() calls made on behalf of natives
+	uint32_t max_frames; // call depth at which a call panics with a stack overflow
+	bool yield_requested;
+	bool unwrap_native_result; // the running native's caller unwraps its result, see native_ok()
+	bool native_result_unboxed; // set by native_ok() when it returned the value without a Result
+
+	FunctionStats function_stats;
+	SamplingProfiler *profiler; // NULL unless sampling
+	volatile sig_atomic_t profile_ticks; // timer ticks not yet attributed to a stack
+	HeapProfiler *heap_profiler; // NULL unless allocations are being sampled
+#ifdef OPCODE_STATS
+	OpcodeStats *opcode_stats;
+#endif
+
 	NativeModules native_modules;
 	Args args;
 
+	WorkerSet workers; // isolates started by this VM
+	Worker *worker; // the worker this VM runs in, NULL for the main VM
+	ThreadPool *thread_pool; // started by the first parallel array operation
+
 	double heap_growth_factor;
 	size_t min_gc_heap_size;
 	size_t min_gc_growth_delta;
@@ -148,6 +270,11 @@ struct VM {
 	size_t gc_last_strings_tombstones;
 	size_t gc_last_sweep_slots_scanned;
 	size_t gc_sweep_slots_scanned;
+	GcPauseHistogram gc_pauses;
+	FILE *gc_event_log; // one JSON line per collection, NULL unless enabled
+	bool gc_background_sweep; // free dead objects on a helper thread while the program continues
+	bool gc_sweep_pending; // a background sweep was started and its results were not taken back yet
+	BackgroundSweeper *background_sweeper; // started by the first background sweep
 
 	GC_STATUS gc_status;
 
@@ -160,27 +287,27 @@ struct VM {
 };
 
 #ifdef STACK_SAFETY
-#define push(module_record, value)                                                                                     \
+#define push(vm, value)                                                                                                \
 	do {                                                                                                               \
-		if (__builtin_expect((module_record)->stack_top >= (module_record)->stack_limit, 0)) {                         \
-			runtime_panic((module_record), STACK_OVERFLOW, "Stack overflow error");                                    \
+		if (__builtin_expect((vm)->stack_top >= (vm)->stack_limit, 0)) {                                               \
+			runtime_panic((vm), STACK_OVERFLOW, "Stack overflow error");                                               \
 		}                                                                                                              \
-		*(module_record)->stack_top++ = (value);                                                                       \
+		*(vm)->stack_top++ = (value);                                                                                  \
 	} while (0)
 
-#define pop(module_record)                                                                                             \
+#define pop(vm)                                                                                                        \
 	({                                                                                                                 \
-		if (__builtin_expect((module_record)->stack_top <= (module_record)->stack, 0)) {                               \
-			runtime_panic((module_record), RUNTIME, "Stack underflow error");                                          \
+		if (__builtin_expect((vm)->stack_top <= (vm)->stack, 0)) {                                                     \
+			runtime_panic((vm), RUNTIME, "Stack underflow error");                                                     \
 		}                                                                                                              \
-		*--(module_record)->stack_top;                                                                                 \
+		*--(vm)->stack_top;                                                                                            \
 	})
 #else
-#define push(module_record, value) *(module_record)->stack_top++ = (value)
-#define pop(module_record) *--(module_record)->stack_top
+#define push(vm, value) *(vm)->stack_top++ = (value)
+#define pop(vm) *--(vm)->stack_top
 #endif
 
-#define PEEK(module_record, distance) ((module_record)->stack_top[-1 - (distance)])
+#define PEEK(vm, distance) ((vm)->stack_top[-1 - (distance)])
 
 VM *new_vm(int argc, const char **argv);
 
@@ -192,9 +319,23 @@ InterpretResult interpret(VM *vm, char *source);
 
 InterpretResult run(VM *vm, bool is_anonymous_frame);
 
-void reset_stack(ObjectModuleRecord *moduleRecord);
+/**
+ * Translates <chunk> into the threaded form that run() executes and stores it in the chunk.
+ * @return The threaded code, or NULL if it could not be allocated
+ */
+ThreadedWord *translate_chunk(Chunk *chunk);
 
-void close_upvalues(ObjectModuleRecord *moduleRecord, const Value *last);
+/**
+ * Returns the threaded code a call frame of <chunk> starts at, translating the chunk on its first call.
+ */
+static inline ThreadedWord *threaded_code(Chunk *chunk)
+{
+	return chunk->threaded != NULL ? chunk->threaded : translate_chunk(chunk);
+}
+
+void reset_stack(VM *vm);
+
+void close_upvalues(VM *vm, const Value *last);
 
 void init_import_stack(VM *vm);
 
@@ -207,21 +348,28 @@ void pop_import_stack(VM *vm);
 
 bool is_in_import_stack(const VM *vm, const ObjectString *path);
 
-ObjectResult *execute_callable(VM *vm, Value callable, int arg_count, InterpretResult *result);
+/**
+ * Calls <callable> from native code without boxing the outcome. The callable (or, for methods, the receiver) and its
+ * <arg_count> arguments must be on top of the stack; they are popped again before returning. The callee runs on the
+ * current frame stack, and runtime errors unwind through the usual panic path.
+ * @param result_out Receives the returned value. It is no longer rooted, so push it before allocating
+ * @return INTERPRET_OK if the call completed
+ */
+InterpretResult call_from_native(VM *vm, Value callable, int arg_count, Value *result_out);
 
 bool get_module_global_index(const ObjectModuleRecord *module_record, const ObjectString *name, uint32_t *index_out);
 
 bool is_falsy(Value value);
 
-void pop_push(ObjectModuleRecord *moduleRecord, Value value);
+void pop_push(VM *vm, Value value);
 
-#define pop_two(module_record)                                                                                         \
-	pop((module_record));                                                                                              \
-	pop((module_record))
+#define pop_two(vm)                                                                                                    \
+	pop((vm));                                                                                                         \
+	pop((vm))
 
-#define pop_push(module_record, value)                                                                                 \
-	pop((module_record));                                                                                              \
-	push((module_record), (value))
+#define pop_push(vm, value)                                                                                            \
+	pop((vm));                                                                                                         \
+	push((vm), (value))
 
 bool binary_operation(VM *vm, OpCode operation);
 
@@ -236,6 +384,17 @@ bool concatenate(VM *vm);
  */
 bool call_value(VM *vm, Value callee, int arg_count);
 
+/**
+ * Calls a native function with the given arguments.
+ * @param vm The virtual machine
+ * @param native The native function to call
+ * @param arg_count Number of arguments on the stack
+ * @param unwrap Whether the caller unwraps the result right away. The native may then return its ok value unboxed
+ * and the value left on the stack is the unwrapped one
+ * @return true if the call succeeds, false otherwise
+ */
+bool call_native(VM *vm, const ObjectNativeCallable *native, int arg_count, bool unwrap);
+
 /**
  * Captures a local variable in an upvalue for closures.
  * @param vm The virtual machine
@@ -249,6 +408,13 @@ bool handle_invoke(VM *vm, int arg_count, Value receiver, Value original, Value
 bool get_iterator_from_value(VM *vm, Value value, Value *iterator_out);
 bool get_next_option_from_iterator(VM *vm, Value iterator, Value *option_out);
 
+/**
+ * Advances any iterator value (builtin, adapter, generator or struct with __next) without wrapping the element in an
+ * Option.
+ * @return false once the iterator is exhausted
+ */
+bool next_iterator_value(VM *vm, Value iterator, Value *value_out);
+
 /**
  * Invokes a method on an object with the given arguments.
  * @param vm The virtual machine
@@ -269,12 +435,19 @@ InterpretResult global_compound_operation(VM *vm, uint16_t index, OpCode opcode,
 
 /**
  * Calls a function closure with the given arguments.
- * @param module_record The currently executing module
+ * @param vm The virtual machine
  * @param closure The function closure to call
  * @param arg_count Number of arguments on the stack
  * @return true if the call succeeds, false otherwise
  */
-bool call(ObjectModuleRecord *module_record, ObjectClosure *closure, int arg_count);
+bool call(VM *vm, ObjectClosure *closure, int arg_count);
+
+/**
+ * Makes sure the running stack of <vm> has room for a frame of <function>, whose callee and arguments are on top of
+ * it. Growing the stack moves it, so pointers into it must be reloaded afterwards.
+ * @return false if the stack could not grow
+ */
+bool reserve_frame_stack(VM *vm, const ObjectFunction *function);
 
 Value typeof_value(VM *vm, Value value);
 
@@ -282,10 +455,40 @@ ObjectStructInstance *pop_struct_stack(VM *vm);
 bool pushStructStack(VM *vm, ObjectStructInstance *struct_instance);
 ObjectStructInstance *peek_struct_stack(const VM *vm);
 
-bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *target, Value operand, OpCode op);
+bool handle_compound_assignment(VM *vm, Value *target, Value operand, OpCode op);
 bool range_indices_in_bounds(const ObjectRange *range, const uint32_t collection_size);
 bool collect_string_codepoint_starts(VM *vm, const ObjectString *string, const utf8_int8_t ***starts_out);
 
 bool bind_core_globals(VM *vm, ObjectModuleRecord *module_record);
 
+/**
+ * Runs a coroutine until it suspends, returns or panics. Panics are propagated to the resumer's handler after the
+ * resumer's execution context has been restored.
+ * @param vm The virtual machine
+ * @param coroutine The coroutine to resume; must be created or suspended
+ * @param send The value produced by the coroutine's pending suspend() call, or its argument on the first resume
+ * @return INTERPRET_OK once the coroutine has suspended or finished
+ */
+InterpretResult resume_coroutine(VM *vm, ObjectCoroutine *coroutine, Value send);
+
+/**
+ * Requests that the running coroutine suspends once control returns to the dispatch loop.
+ * @return false if there is no coroutine that can be suspended from this point
+ */
+bool request_coroutine_yield(VM *vm, Value value);
+
+/**
+ * Calls a generator function: moves the closure and its arguments into a new coroutine, primed at the start of the
+ * body, and leaves the coroutine on the caller's stack in their place.
+ * @return false if the argument count does not match the generator's arity
+ */
+bool call_generator(VM *vm, ObjectClosure *closure, int arg_count);
+
+/**
+ * Resumes a coroutine being used as an iterator.
+ * @param value_out Receives the next yielded value
+ * @return false once the coroutine has finished
+ */
+bool next_coroutine_value(VM *vm, ObjectCoroutine *coroutine, Value *value_out);
+
 #endif // VM_H
@@ -0,0 +1,110 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "value.h"
+#include "vm.h"
+
+/**
+ * A value copied out of one VM's heap so that another VM, possibly on another thread, can rebuild it. Nil, Bool, Int,
+ * Float, String, Array, Table and Tuple values can be copied; nested values are copied recursively.
+ */
+typedef struct WorkerMessage WorkerMessage;
+
+typedef struct Worker Worker;
+
+/**
+ * @brief Copies <value> into a message that does not reference the heap of <vm>
+ * @param error_out Set to a static message when the value cannot be copied
+ * @return The message, or NULL on error
+ */
+WorkerMessage *encode_worker_message(Value value, const char **error_out);
+
+/**
+ * @brief Copies <count> values into a message that decodes to an Array of them
+ */
+WorkerMessage *encode_worker_values(const Value *values, uint32_t count, const char **error_out);
+
+/**
+ * @brief Rebuilds the value of <message> on the heap of <vm>
+ * @param value_out Receives the value. It is not rooted, so push it before allocating
+ * @return false if the value could not be allocated
+ */
+bool decode_worker_message(VM *vm, const WorkerMessage *message, Value *value_out);
+
+void free_worker_message(WorkerMessage *message);
+
+/**
+ * @brief Runs the script at <path> in <vm>, a VM created for it with new_vm(), and looks up its global function
+ * <function_name>
+ * @param arity The number of arguments the function must take
+ * @param function_out Receives the function. It stays reachable through the script's globals
+ * @param error_out Set to a static message when the script cannot run or has no such function
+ */
+bool load_isolate(VM *vm, const char *path, const char *function_name, int arity, Value *function_out,
+				  const char **error_out);
+
+/**
+ * @brief Calls <function> of an isolate set up with load_isolate() with <arg_count> values of the isolate's heap
+ *
+ * Values the caller pushed on the isolate's stack stay there, so results can be collected across calls.
+ *
+ * @param result_out Receives the returned value. It is not rooted, so push it before allocating
+ * @return false if the call panicked
+ */
+bool call_isolate_function(VM *vm, Value function, const Value *args, int arg_count, Value *result_out);
+
+/**
+ * @brief Starts a new isolate on its own thread that runs the script at <path> and then calls its global function
+ * <function_name> with a copy of <argument>
+ *
+ * The isolate has its own VM: heap, string table, slab allocators and native type tables are never shared with <vm>.
+ *
+ * @param vm The virtual machine that owns the worker
+ * @param path Resolved path of the script
+ * @param function_name Name of a global function of the script taking one argument
+ * @param argument The message passed to the function. Ownership moves to the worker
+ * @param id_out Receives the id of the worker, used by the other worker functions
+ * @param error_out Set to a static message when the worker could not be started
+ */
+bool spawn_worker(VM *vm, const char *path, const char *function_name, WorkerMessage *argument, uint32_t *id_out,
+				  const char **error_out);
+
+/**
+ * @brief Queues <message> for the worker's receive_parent(). Ownership of the message moves to the worker
+ */
+bool send_to_worker(VM *vm, uint32_t id, WorkerMessage *message, const char **error_out);
+
+/**
+ * @brief Waits for the next message the worker sent with send_parent()
+ * @return NULL with <error_out> set once the worker has finished and every message was received
+ */
+WorkerMessage *receive_from_worker(VM *vm, uint32_t id, const char **error_out);
+
+/**
+ * @brief Waits for the worker to finish. Messages it sent and that were not received are discarded
+ * @param result_out Receives the copied return value of the worker function
+ * @return false if the worker failed or <id> is not a running worker
+ */
+bool join_worker(VM *vm, uint32_t id, WorkerMessage **result_out, const char **error_out);
+
+/**
+ * @brief Queues <message> for the parent's receive(). Only valid inside a worker
+ */
+bool send_to_parent(VM *vm, WorkerMessage *message, const char **error_out);
+
+/**
+ * @brief Waits for the next message the parent sent with send()
+ * @return NULL with <error_out> set when not inside a worker or once the parent stopped waiting for this worker
+ */
+WorkerMessage *receive_from_parent(VM *vm, const char **error_out);
+
+/**
+ * @brief Joins every worker that was not joined yet. Called when <vm> is freed
+ */
+void free_workers(VM *vm);
+
+#endif // WORKER_H
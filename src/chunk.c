@@ -9,6 +9,7 @@ void init_chunk(Chunk *chunk)
 	chunk->capacity = 0;
 	chunk->code = NULL;
 	chunk->lines = NULL;
+	chunk->threaded = NULL;
 	init_value_array(&chunk->constants);
 }
 
@@ -33,13 +34,14 @@ void free_chunk(VM *vm, Chunk *chunk)
 	FREE_ARRAY(vm, uint16_t, chunk->code, chunk->capacity);
 	FREE_ARRAY(vm, int, chunk->lines, chunk->capacity);
 	free_value_array(vm, &chunk->constants);
+	free(chunk->threaded);
 	init_chunk(chunk);
 }
 
 int add_constant(VM *vm, Chunk *chunk, const Value value)
 {
-	push(vm->current_module_record, value);
+	push(vm, value);
 	write_value_array(vm, &chunk->constants, value);
-	pop(vm->current_module_record);
+	pop(vm);
 	return chunk->constants.count - 1;
 }
@@ -10,6 +10,7 @@
 #include "debug.h"
 #include "file_handler.h"
 #include "garbage_collector.h"
+#include "module_preload.h"
 #include "object.h"
 #include "panic.h"
 #include "scanner.h"
@@ -93,14 +94,14 @@ static bool resolve_assignment_target(Compiler *compiler, const Token name, uint
 									  ObjectTypeRecord **target_type)
 {
 	ObjectString *name_str = copy_string(compiler->owner, name.start, name.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(name_str));
+	push(compiler->owner, OBJECT_VAL(name_str));
 
 	// First check if it's a local variable
 	*arg = resolve_local(compiler, &name);
 	if (*arg != -1) {
 		*set_op = OP_SET_LOCAL;
 		*target_type = compiler->locals[*arg].type;
-		pop(compiler->owner->current_module_record);
+		pop(compiler->owner);
 		return true;
 	}
 
@@ -110,7 +111,7 @@ static bool resolve_assignment_target(Compiler *compiler, const Token name, uint
 	if (*arg != -1) {
 		*set_op = OP_SET_UPVALUE;
 		*target_type = compiler->upvalues[*arg].type;
-		pop(compiler->owner->current_module_record);
+		pop(compiler->owner);
 		return true;
 	}
 
@@ -137,18 +138,18 @@ static bool resolve_assignment_target(Compiler *compiler, const Token name, uint
 	// if the variable is still not found, it's undeclared - panic
 	if (*target_type == NULL) {
 		compiler_panicf(compiler->parser, TYPE, "Undeclared variable '%.*s'.", name.length, name.start);
-		pop(compiler->owner->current_module_record);
+		pop(compiler->owner);
 		return false;
 	}
 	if (global_index == -1) {
 		compiler_panicf(compiler->parser, TYPE, "Failed to get index for global variable '%.*s'.", name.length,
 						name.start);
-		pop(compiler->owner->current_module_record);
+		pop(compiler->owner);
 		return false;
 	}
 	*arg = global_index;
 
-	pop(compiler->owner->current_module_record);
+	pop(compiler->owner);
 	return true;
 }
 
@@ -207,6 +208,7 @@ static void for_in(Compiler *compiler, const bool declares_binding)
 	emit_words(compiler, OP_GET_LOCAL, iterator_slot);
 	const int exit_jump = emit_jump(compiler, OP_ITER_NEXT);
 	emit_words(compiler, set_op, target_arg);
+	mark_assigned(compiler, set_op, target_arg);
 	emit_word(compiler, OP_POP);
 
 	statement(compiler);
@@ -281,16 +283,16 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 		if (match(compiler, CRUX_TOKEN_LEFT_BRACE)) {
 			int field_count = 0;
 			ObjectTypeTable *field_types = new_type_table(compiler->owner, 8);
-			push(compiler->owner->current_module_record, OBJECT_VAL(field_types));
+			push(compiler->owner, OBJECT_VAL(field_types));
 			if (!check(compiler, CRUX_TOKEN_RIGHT_BRACE)) {
 				do {
 					consume(compiler, CRUX_TOKEN_IDENTIFIER, "Expected field name.");
 					ObjectString *fieldName = copy_string(compiler->owner, compiler->parser->previous.start,
 														  compiler->parser->previous.length);
-					push(compiler->owner->current_module_record, OBJECT_VAL(fieldName));
+					push(compiler->owner, OBJECT_VAL(fieldName));
 					consume(compiler, CRUX_TOKEN_COLON, "Expected ':' after field name.");
 					ObjectTypeRecord *field_type = parse_type_record(compiler);
-					push(compiler->owner->current_module_record, OBJECT_VAL(field_type));
+					push(compiler->owner, OBJECT_VAL(field_type));
 					type_table_set(field_types, fieldName, field_type);
 					field_count++;
 				} while (match(compiler, CRUX_TOKEN_COMMA));
@@ -299,10 +301,10 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 			type_record = new_shape_type_rec(compiler->owner, field_types, field_count);
 
 			for (int i = 0; i < field_count; i++) {
-				pop(compiler->owner->current_module_record); // field type
-				pop(compiler->owner->current_module_record); // field name
+				pop(compiler->owner); // field type
+				pop(compiler->owner); // field name
 			}
-			pop(compiler->owner->current_module_record); // field_types
+			pop(compiler->owner); // field_types
 
 		} else {
 			compiler_panic(compiler->parser, "Expected '{' for shape type definition.", TYPE);
@@ -311,11 +313,11 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 	} else if (match(compiler, CRUX_TOKEN_ARRAY_TYPE)) {
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			type_record = new_type_rec(compiler->owner, ARRAY_TYPE);
-			push(compiler->owner->current_module_record, OBJECT_VAL(type_record));
+			push(compiler->owner, OBJECT_VAL(type_record));
 			ObjectTypeRecord *parsed_type = parse_type_record(compiler);
 			type_record->as.array_type.element_type = parsed_type;
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after array element type.");
-			pop(compiler->owner->current_module_record); // type_record
+			pop(compiler->owner); // type_record
 		} else {
 			compiler_panic(compiler->parser, "Expected '[' for array type definition.", TYPE);
 			type_record = T_ANY;
@@ -323,13 +325,13 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 	} else if (match(compiler, CRUX_TOKEN_TABLE_TYPE)) {
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			type_record = new_type_rec(compiler->owner, TABLE_TYPE);
-			push(compiler->owner->current_module_record, OBJECT_VAL(type_record));
+			push(compiler->owner, OBJECT_VAL(type_record));
 			ObjectTypeRecord *key_type = parse_type_record(compiler);
-			push(compiler->owner->current_module_record, OBJECT_VAL(key_type));
+			push(compiler->owner, OBJECT_VAL(key_type));
 
 			if (!is_valid_table_key_type(key_type)) {
-				pop(compiler->owner->current_module_record); // key_type
-				pop(compiler->owner->current_module_record); // type_record
+				pop(compiler->owner); // key_type
+				pop(compiler->owner); // type_record
 				char got[128];
 				type_record_name(key_type, got, sizeof(got));
 				compiler_panicf(
@@ -342,8 +344,8 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 			consume(compiler, CRUX_TOKEN_COMMA, "Expected ',' after key type.");
 			type_record->as.table_type.value_type = parse_type_record(compiler);
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after table element type.");
-			pop(compiler->owner->current_module_record); // key_type
-			pop(compiler->owner->current_module_record); // type_record
+			pop(compiler->owner); // key_type
+			pop(compiler->owner); // type_record
 		} else {
 			compiler_panic(compiler->parser, "Expected '[' for table type definition.", TYPE);
 			type_record = T_ANY;
@@ -357,16 +359,16 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 		if (!match(compiler, CRUX_TOKEN_RIGHT_SQUARE)) {
 			compiler_panic(compiler->parser, "Expected ']' after iterator element type.", TYPE);
 		}
-		push(compiler->owner->current_module_record, OBJECT_VAL(element_type));
+		push(compiler->owner, OBJECT_VAL(element_type));
 		type_record = new_iterator_type_rec(compiler->owner, element_type);
-		pop(compiler->owner->current_module_record); // element_type
+		pop(compiler->owner); // element_type
 	} else if (match(compiler, CRUX_TOKEN_VECTOR_TYPE)) {
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			type_record = new_type_rec(compiler->owner, VECTOR_TYPE);
-			push(compiler->owner->current_module_record, OBJECT_VAL(type_record));
+			push(compiler->owner, OBJECT_VAL(type_record));
 
 			if (match(compiler, CRUX_TOKEN_RIGHT_SQUARE)) {
-				pop(compiler->owner->current_module_record); // type_record
+				pop(compiler->owner); // type_record
 				type_record->as.vector_type.dimensions = -1;
 				return type_record;
 			}
@@ -375,7 +377,7 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 			const int dimensions = (int)strtol(compiler->parser->previous.start, NULL, 10);
 			type_record->as.vector_type.dimensions = dimensions;
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after vector element type.");
-			pop(compiler->owner->current_module_record); // type_record
+			pop(compiler->owner); // type_record
 		} else {
 			compiler_panic(compiler->parser, "Expected '[' for vector type definition.", TYPE);
 			type_record = T_ANY;
@@ -383,16 +385,16 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 	} else if (match(compiler, CRUX_TOKEN_MATRIX_TYPE)) {
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			type_record = new_type_rec(compiler->owner, MATRIX_TYPE);
-			push(compiler->owner->current_module_record, OBJECT_VAL(type_record));
+			push(compiler->owner, OBJECT_VAL(type_record));
 
 			if (match(compiler, CRUX_TOKEN_COMMA)) {
 				if (match(compiler, CRUX_TOKEN_RIGHT_SQUARE)) {
 					type_record->as.matrix_type.cols = -1;
 					type_record->as.matrix_type.rows = -1;
-					pop(compiler->owner->current_module_record); // type_record
+					pop(compiler->owner); // type_record
 					return type_record;
 				} else {
-					pop(compiler->owner->current_module_record); // type_record
+					pop(compiler->owner); // type_record
 					compiler_panic(compiler->parser, "Expected ']' to end definition of generic matrix type", SYNTAX);
 					return T_ANY;
 				}
@@ -405,7 +407,7 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 			type_record->as.matrix_type.rows = row_dim;
 			type_record->as.matrix_type.cols = col_dim;
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after matrix element type.");
-			pop(compiler->owner->current_module_record); // type_record
+			pop(compiler->owner); // type_record
 		} else {
 			compiler_panic(compiler->parser, "Expected '[' for matrix type definition.", TYPE);
 			type_record = T_ANY;
@@ -417,10 +419,10 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 	} else if (match(compiler, CRUX_TOKEN_RESULT_TYPE)) {
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			ObjectTypeRecord *value_type = parse_type_record(compiler);
-			push(compiler->owner->current_module_record, OBJECT_VAL(value_type));
+			push(compiler->owner, OBJECT_VAL(value_type));
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after result value type.");
 			type_record = new_result_type_rec(compiler->owner, value_type);
-			pop(compiler->owner->current_module_record); // value_type
+			pop(compiler->owner); // value_type
 		} else {
 			compiler_panic(compiler->parser, "Expected '[' for result type definition.", TYPE);
 			type_record = T_ANY;
@@ -428,10 +430,10 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 	} else if (match(compiler, CRUX_TOKEN_OPTION_TYPE)) {
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			ObjectTypeRecord *some_type = parse_type_record(compiler);
-			push(compiler->owner->current_module_record, OBJECT_VAL(some_type));
+			push(compiler->owner, OBJECT_VAL(some_type));
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after option some type.");
 			type_record = new_option_type_rec(compiler->owner, some_type);
-			pop(compiler->owner->current_module_record); // some_type
+			pop(compiler->owner); // some_type
 		} else {
 			compiler_panic(compiler->parser, "Expected '[' for option type definition.", TYPE);
 			type_record = T_ANY;
@@ -458,21 +460,21 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 						if (!grown) {
 							FREE_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, old_capacity);
 							for (int i = 0; i < param_count; i++)
-								pop(compiler->owner->current_module_record);
+								pop(compiler->owner);
 							compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
 							return T_ANY;
 						}
 						param_types = grown;
 					}
 					ObjectTypeRecord *param_type = parse_type_record(compiler);
-					push(compiler->owner->current_module_record, OBJECT_VAL(param_type));
+					push(compiler->owner, OBJECT_VAL(param_type));
 					param_types[param_count++] = param_type;
 				} while (match(compiler, CRUX_TOKEN_COMMA));
 			}
 			param_types = GROW_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, param_capacity, param_count);
 			type_record = new_tuple_type_rec(compiler->owner, param_types, param_count);
 			for (int i = 0; i < param_count; i++) {
-				pop(compiler->owner->current_module_record); // param_types[i]
+				pop(compiler->owner); // param_types[i]
 			}
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after tuple element types.");
 		} else {
@@ -499,7 +501,7 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 				}
 
 				// protect inner before array grows
-				push(compiler->owner->current_module_record, OBJECT_VAL(inner));
+				push(compiler->owner, OBJECT_VAL(inner));
 
 				if (param_count == param_capacity) {
 					param_capacity = GROW_CAPACITY(param_capacity);
@@ -509,7 +511,7 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 						FREE_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, param_count);
 						// +1: account for inner
 						for (int i = 0; i < param_count + 1; i++)
-							pop(compiler->owner->current_module_record);
+							pop(compiler->owner);
 						compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
 						return T_ANY;
 					}
@@ -524,13 +526,13 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 		ObjectTypeRecord *return_type = parse_type_record(compiler);
 		if (!return_type) {
 			for (int i = 0; i < param_count; i++) {
-				pop(compiler->owner->current_module_record); // param_types[i]
+				pop(compiler->owner); // param_types[i]
 			}
 			compiler_panic(compiler->parser, "Expected type.", TYPE);
 			FREE_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, param_capacity);
 			return T_ANY;
 		}
-		push(compiler->owner->current_module_record, OBJECT_VAL(return_type));
+		push(compiler->owner, OBJECT_VAL(return_type));
 
 		if (param_count < param_capacity) {
 			param_types = GROW_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, param_capacity, param_count);
@@ -541,21 +543,21 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 		type_record->as.function_type.arg_count = param_count;
 		type_record->as.function_type.return_type = return_type;
 
-		pop(compiler->owner->current_module_record); // return_type
+		pop(compiler->owner); // return_type
 		for (int i = 0; i < param_count; i++) {
-			pop(compiler->owner->current_module_record); // param_types[i]
+			pop(compiler->owner); // param_types[i]
 		}
 
 	} else if (match(compiler, CRUX_TOKEN_SET_TYPE)) {
 		type_record = new_type_rec(compiler->owner, SET_TYPE);
-		push(compiler->owner->current_module_record, OBJECT_VAL(type_record));
+		push(compiler->owner, OBJECT_VAL(type_record));
 		if (match(compiler, CRUX_TOKEN_LEFT_SQUARE)) {
 			ObjectTypeRecord *element_type = parse_type_record(compiler);
-			pop(compiler->owner->current_module_record); // type_record
+			pop(compiler->owner); // type_record
 			type_record->as.set_type.element_type = element_type;
 			consume(compiler, CRUX_TOKEN_RIGHT_SQUARE, "Expected ']' after set element type.");
 		} else {
-			pop(compiler->owner->current_module_record); // type_record
+			pop(compiler->owner); // type_record
 			type_record->as.set_type.element_type = T_ANY;
 		}
 	} else if (match(compiler, CRUX_TOKEN_RANDOM_TYPE)) {
@@ -585,14 +587,14 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 	}
 
 	if (type_record && match(compiler, CRUX_TOKEN_PIPE)) {
-		push(compiler->owner->current_module_record, OBJECT_VAL(type_record));
+		push(compiler->owner, OBJECT_VAL(type_record));
 		int capacity = 4;
 		int count = 1;
 		ObjectTypeRecord **variants = ALLOCATE(compiler->owner, ObjectTypeRecord *, capacity);
 
 		if (!variants) {
 			compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
-			pop(compiler->owner->current_module_record);
+			pop(compiler->owner);
 			return type_record;
 		}
 		variants[0] = type_record;
@@ -605,13 +607,13 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 					FREE_ARRAY(compiler->owner, ObjectTypeRecord *, variants, count);
 					compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
 					for (int i = 0; i < count; i++)
-						pop(compiler->owner->current_module_record);
+						pop(compiler->owner);
 					return type_record;
 				}
 				variants = grown;
 			}
 			ObjectTypeRecord *variant = parse_type_record(compiler);
-			push(compiler->owner->current_module_record, OBJECT_VAL(variant));
+			push(compiler->owner, OBJECT_VAL(variant));
 			variants[count++] = variant;
 		} while (match(compiler, CRUX_TOKEN_PIPE));
 
@@ -622,7 +624,7 @@ ObjectTypeRecord *parse_type_record(Compiler *compiler)
 		type_record = new_union_type_rec(compiler->owner, variants, NULL, count);
 
 		for (int i = 0; i < count; i++) {
-			pop(compiler->owner->current_module_record);
+			pop(compiler->owner);
 		}
 	}
 
@@ -674,11 +676,14 @@ bool init_compiler(VM *vm, Compiler *compiler, Compiler *enclosing, const Functi
 	compiler->type_stack_count = 0;
 	compiler->type = type;
 	compiler->local_count = 0;
+	compiler->capture_site_count = 0;
 	compiler->scope_depth = 0;
 	compiler->match_depth = 0;
 	compiler->loop_depth = 0;
 	compiler->owner = vm;
 	compiler->has_return = false;
+	compiler->temporary_end = -1;
+	compiler->call_end = -1;
 	compiler->return_type = NULL;
 	compiler->last_give_type = NULL;
 
@@ -765,6 +770,7 @@ bool init_compiler(VM *vm, Compiler *compiler, Compiler *enclosing, const Functi
 	local->name.start = "";
 	local->name.length = 0;
 	local->is_captured = false;
+	local->capture_by_reference = false;
 	local->type = T_ANY;
 
 	if (type == TYPE_METHOD) {
@@ -796,7 +802,7 @@ bool init_compiler(VM *vm, Compiler *compiler, Compiler *enclosing, const Functi
 static void named_variable(Compiler *compiler, Token name, const bool can_assign)
 {
 	ObjectString *name_str = copy_string(compiler->owner, name.start, name.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(name_str));
+	push(compiler->owner, OBJECT_VAL(name_str));
 
 	uint16_t getOp, setOp;
 	int arg = resolve_local(compiler, &name);
@@ -843,7 +849,7 @@ static void named_variable(Compiler *compiler, Token name, const bool can_assign
 			compiler_panicf(compiler->parser, TYPE, "Failed to get index for global variable '%s'.", name_str->chars);
 		}
 	}
-	push(compiler->owner->current_module_record, OBJECT_VAL(var_type));
+	push(compiler->owner, OBJECT_VAL(var_type));
 
 	if (can_assign) {
 		if (match(compiler, CRUX_TOKEN_EQUAL)) {
@@ -859,10 +865,11 @@ static void named_variable(Compiler *compiler, Token name, const bool can_assign
 				}
 			}
 			emit_words(compiler, setOp, arg);
+			mark_assigned(compiler, setOp, arg);
 			push_type_record(compiler, T_NIL);
 
-			pop(compiler->owner->current_module_record); // var_type
-			pop(compiler->owner->current_module_record); // name_str
+			pop(compiler->owner); // var_type
+			pop(compiler->owner); // name_str
 			return;
 		}
 
@@ -873,10 +880,11 @@ static void named_variable(Compiler *compiler, Token name, const bool can_assign
 			check_compound_type_math(compiler, var_type, rhs_type, op);
 
 			emit_words(compiler, get_compound_opcode(compiler, setOp, op), arg);
+			mark_assigned(compiler, setOp, arg);
 			push_type_record(compiler, T_NIL);
 
-			pop(compiler->owner->current_module_record); // var_type
-			pop(compiler->owner->current_module_record); // name_str
+			pop(compiler->owner); // var_type
+			pop(compiler->owner); // name_str
 			return;
 		}
 	}
@@ -895,8 +903,8 @@ static void named_variable(Compiler *compiler, Token name, const bool can_assign
 	emit_words(compiler, getOp, arg);
 	push_type_record(compiler, var_type);
 
-	pop(compiler->owner->current_module_record); // var_type
-	pop(compiler->owner->current_module_record); // name_str
+	pop(compiler->owner); // var_type
+	pop(compiler->owner); // name_str
 }
 
 static void and_(Compiler *compiler, const bool can_assign)
@@ -904,7 +912,7 @@ static void and_(Compiler *compiler, const bool can_assign)
 	(void)can_assign;
 
 	const ObjectTypeRecord *left_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(left_type));
+	push(compiler->owner, OBJECT_VAL(left_type));
 
 	if (left_type && left_type->base_type != BOOL_TYPE && left_type->base_type != ANY_TYPE) {
 		char got[128];
@@ -939,11 +947,11 @@ static void and_(Compiler *compiler, const bool can_assign)
 		}
 	}
 
-	push(compiler->owner->current_module_record, original_type ? OBJECT_VAL(original_type) : NIL_VAL);
+	push(compiler->owner, original_type ? OBJECT_VAL(original_type) : NIL_VAL);
 
 	parse_precedence(compiler, PREC_AND);
 
-	pop(compiler->owner->current_module_record); // original_type
+	pop(compiler->owner); // original_type
 
 	// Restore original type if temporarily narrowed it
 	if (left_narrowing.narrowed_to) {
@@ -955,7 +963,7 @@ static void and_(Compiler *compiler, const bool can_assign)
 	}
 
 	const ObjectTypeRecord *right_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(right_type));
+	push(compiler->owner, OBJECT_VAL(right_type));
 
 	if (right_type && right_type->base_type != BOOL_TYPE && right_type->base_type != ANY_TYPE) {
 		char got[128];
@@ -972,8 +980,8 @@ static void and_(Compiler *compiler, const bool can_assign)
 		compiler->current_narrowing = left_narrowing;
 	}
 
-	pop(compiler->owner->current_module_record); // right_type
-	pop(compiler->owner->current_module_record); // left_type
+	pop(compiler->owner); // right_type
+	pop(compiler->owner); // left_type
 }
 
 static void or_(Compiler *compiler, const bool can_assign)
@@ -981,7 +989,7 @@ static void or_(Compiler *compiler, const bool can_assign)
 	(void)can_assign;
 
 	const ObjectTypeRecord *left_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(left_type));
+	push(compiler->owner, OBJECT_VAL(left_type));
 
 	if (left_type && left_type->base_type != BOOL_TYPE && left_type->base_type != ANY_TYPE) {
 		char got[128];
@@ -1006,7 +1014,7 @@ static void or_(Compiler *compiler, const bool can_assign)
 	parse_precedence(compiler, PREC_OR);
 
 	ObjectTypeRecord *right_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(right_type));
+	push(compiler->owner, OBJECT_VAL(right_type));
 
 	if (right_type && right_type->base_type != BOOL_TYPE && right_type->base_type != ANY_TYPE) {
 		char got[128];
@@ -1028,8 +1036,8 @@ static void or_(Compiler *compiler, const bool can_assign)
 
 	push_type_record(compiler, T_BOOL);
 
-	pop(compiler->owner->current_module_record); // right_type
-	pop(compiler->owner->current_module_record); // left_type
+	pop(compiler->owner); // right_type
+	pop(compiler->owner); // left_type
 }
 
 /**
@@ -1040,6 +1048,7 @@ static void or_(Compiler *compiler, const bool can_assign)
  */
 static ObjectFunction *end_compiler(Compiler *compiler)
 {
+	resolve_capture_sites(compiler, 0);
 	emit_return(compiler);
 	push_type_record(compiler, compiler->return_type);
 	ObjectFunction *function = compiler->function;
@@ -1109,21 +1118,39 @@ static ObjectTypeRecord *matrix_multiply_result_type(Compiler *compiler, const O
 	return new_matrix_type_rec(compiler->owner, left_rows, right_cols);
 }
 
+static bool is_unshared_temporary(const Compiler *compiler)
+{
+	return compiler->temporary_end == current_chunk(compiler)->count;
+}
+
+/**
+ * Emits a typed Vector or Complex operation. An operand is an unshared temporary when the instruction that created it
+ * was the last one emitted before the operand was consumed: it was never stored, captured or passed anywhere, so the
+ * operation may overwrite it with its result.
+ */
+static void emit_temporary_operation(Compiler *compiler, const OpCode op, const bool reuse_left, const bool reuse_right)
+{
+	emit_words(compiler, op, (reuse_left ? REUSE_LEFT_OPERAND : 0) | (reuse_right ? REUSE_RIGHT_OPERAND : 0));
+	compiler->temporary_end = current_chunk(compiler)->count;
+}
+
 static void binary(Compiler *compiler, bool can_assign)
 {
 	(void)can_assign;
 	const CruxTokenType operatorType = compiler->parser->previous.type;
 	const ParseRule *rule = get_rule(operatorType);
+	const bool left_temporary = is_unshared_temporary(compiler);
 	parse_precedence(compiler, rule->precedence + 1);
+	const bool right_temporary = is_unshared_temporary(compiler);
 
 	ObjectTypeRecord *right_type = pop_type_record(compiler);
 	ObjectTypeRecord *left_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(left_type));
-	push(compiler->owner->current_module_record, OBJECT_VAL(right_type));
+	push(compiler->owner, OBJECT_VAL(left_type));
+	push(compiler->owner, OBJECT_VAL(right_type));
 
 	ObjectTypeRecord *result_type = NULL;
-	push(compiler->owner->current_module_record, NIL_VAL);
-	Value *result_slot = compiler->owner->current_module_record->stack_top - 1;
+	push(compiler->owner, NIL_VAL);
+	Value *result_slot = compiler->owner->stack_top - 1;
 
 	const bool either_any = (left_type && left_type->base_type == ANY_TYPE) ||
 							(right_type && right_type->base_type == ANY_TYPE) || !left_type || !right_type;
@@ -1230,14 +1257,14 @@ static void binary(Compiler *compiler, bool can_assign)
 		}
 
 		if (left_type->base_type == VECTOR_TYPE && right_type->base_type == VECTOR_TYPE) {
-			emit_word(compiler, OP_ADD_VECTOR_VECTOR);
+			emit_temporary_operation(compiler, OP_ADD_VECTOR_VECTOR, left_temporary, right_temporary);
 			result_type = new_vector_type_rec(compiler->owner,
 											  merge_vector_dimensions(compiler, left_type, right_type, "addition"));
 			break;
 		}
 
 		if (left_type->base_type == COMPLEX_TYPE && right_type->base_type == COMPLEX_TYPE) {
-			emit_word(compiler, OP_ADD_COMPLEX_COMPLEX);
+			emit_temporary_operation(compiler, OP_ADD_COMPLEX_COMPLEX, left_temporary, right_temporary);
 			result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 			break;
 		}
@@ -1291,13 +1318,13 @@ static void binary(Compiler *compiler, bool can_assign)
 
 		if (operatorType == CRUX_TOKEN_MINUS) {
 			if (left_type->base_type == VECTOR_TYPE && right_type->base_type == VECTOR_TYPE) {
-				emit_word(compiler, OP_SUBTRACT_VECTOR_VECTOR);
+				emit_temporary_operation(compiler, OP_SUBTRACT_VECTOR_VECTOR, left_temporary, right_temporary);
 				result_type = new_vector_type_rec(compiler->owner, merge_vector_dimensions(compiler, left_type,
 																						   right_type, "subtraction"));
 				break;
 			}
 			if (left_type->base_type == COMPLEX_TYPE && right_type->base_type == COMPLEX_TYPE) {
-				emit_word(compiler, OP_SUBTRACT_COMPLEX_COMPLEX);
+				emit_temporary_operation(compiler, OP_SUBTRACT_COMPLEX_COMPLEX, left_temporary, right_temporary);
 				result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 				break;
 			}
@@ -1325,32 +1352,32 @@ static void binary(Compiler *compiler, bool can_assign)
 				if ((left_dim != -1 && left_dim != 3) || (right_dim != -1 && right_dim != 3)) {
 					compiler_panic(compiler->parser, "Vector cross product requires 3D vectors.", TYPE);
 				}
-				emit_word(compiler, OP_MULTIPLY_VECTOR_VECTOR);
+				emit_temporary_operation(compiler, OP_MULTIPLY_VECTOR_VECTOR, left_temporary, right_temporary);
 				result_type = new_vector_type_rec(compiler->owner, 3);
 				break;
 			}
 			if (left_type->base_type == VECTOR_TYPE && is_primitive_numeric_type(right_type)) {
-				emit_word(compiler, OP_MULTIPLY_VECTOR_SCALAR);
+				emit_temporary_operation(compiler, OP_MULTIPLY_VECTOR_SCALAR, left_temporary, false);
 				result_type = new_vector_type_rec(compiler->owner, left_type->as.vector_type.dimensions);
 				break;
 			}
 			if (is_primitive_numeric_type(left_type) && right_type->base_type == VECTOR_TYPE) {
-				emit_word(compiler, OP_MULTIPLY_SCALAR_VECTOR);
+				emit_temporary_operation(compiler, OP_MULTIPLY_SCALAR_VECTOR, false, right_temporary);
 				result_type = new_vector_type_rec(compiler->owner, right_type->as.vector_type.dimensions);
 				break;
 			}
 			if (left_type->base_type == COMPLEX_TYPE && right_type->base_type == COMPLEX_TYPE) {
-				emit_word(compiler, OP_MULTIPLY_COMPLEX_COMPLEX);
+				emit_temporary_operation(compiler, OP_MULTIPLY_COMPLEX_COMPLEX, left_temporary, right_temporary);
 				result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 				break;
 			}
 			if (left_type->base_type == COMPLEX_TYPE && is_primitive_numeric_type(right_type)) {
-				emit_word(compiler, OP_MULTIPLY_COMPLEX_SCALAR);
+				emit_temporary_operation(compiler, OP_MULTIPLY_COMPLEX_SCALAR, left_temporary, false);
 				result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 				break;
 			}
 			if (is_primitive_numeric_type(left_type) && right_type->base_type == COMPLEX_TYPE) {
-				emit_word(compiler, OP_MULTIPLY_SCALAR_COMPLEX);
+				emit_temporary_operation(compiler, OP_MULTIPLY_SCALAR_COMPLEX, false, right_temporary);
 				result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 				break;
 			}
@@ -1397,23 +1424,23 @@ static void binary(Compiler *compiler, bool can_assign)
 			break;
 		}
 		if (left_type->base_type == VECTOR_TYPE && right_type->base_type == VECTOR_TYPE) {
-			emit_word(compiler, OP_DIVIDE_VECTOR_VECTOR);
+			emit_temporary_operation(compiler, OP_DIVIDE_VECTOR_VECTOR, left_temporary, right_temporary);
 			result_type = new_vector_type_rec(compiler->owner,
 											  merge_vector_dimensions(compiler, left_type, right_type, "division"));
 			break;
 		}
 		if (left_type->base_type == VECTOR_TYPE && is_primitive_numeric_type(right_type)) {
-			emit_word(compiler, OP_DIVIDE_VECTOR_SCALAR);
+			emit_temporary_operation(compiler, OP_DIVIDE_VECTOR_SCALAR, left_temporary, false);
 			result_type = new_vector_type_rec(compiler->owner, left_type->as.vector_type.dimensions);
 			break;
 		}
 		if (left_type->base_type == COMPLEX_TYPE && right_type->base_type == COMPLEX_TYPE) {
-			emit_word(compiler, OP_DIVIDE_COMPLEX_COMPLEX);
+			emit_temporary_operation(compiler, OP_DIVIDE_COMPLEX_COMPLEX, left_temporary, right_temporary);
 			result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 			break;
 		}
 		if (left_type->base_type == COMPLEX_TYPE && is_primitive_numeric_type(right_type)) {
-			emit_word(compiler, OP_DIVIDE_COMPLEX_SCALAR);
+			emit_temporary_operation(compiler, OP_DIVIDE_COMPLEX_SCALAR, left_temporary, false);
 			result_type = new_type_rec(compiler->owner, COMPLEX_TYPE);
 			break;
 		}
@@ -1533,9 +1560,9 @@ static void binary(Compiler *compiler, bool can_assign)
 	*result_slot = result_type ? OBJECT_VAL(result_type) : NIL_VAL;
 	push_type_record(compiler, result_type);
 
-	pop(compiler->owner->current_module_record); // result_slot
-	pop(compiler->owner->current_module_record); // right_type
-	pop(compiler->owner->current_module_record); // left_type
+	pop(compiler->owner); // result_slot
+	pop(compiler->owner); // right_type
+	pop(compiler->owner); // left_type
 }
 
 static void infix_call(Compiler *compiler, const bool can_assign)
@@ -1551,19 +1578,20 @@ static void infix_call(Compiler *compiler, const bool can_assign)
 			if (arg_count == UINT16_MAX) {
 				// Prevent stack leak if we panic inside this loop
 				for (int i = 0; i < arg_count; i++)
-					pop(compiler->owner->current_module_record);
+					pop(compiler->owner);
 				compiler_panic(compiler->parser, "Cannot have more than 65535 arguments.", ARGUMENT_EXTENT);
 				return;
 			}
 			expression(compiler);
 			arg_types[arg_count] = pop_type_record(compiler);
-			push(compiler->owner->current_module_record, OBJECT_VAL(arg_types[arg_count]));
+			push(compiler->owner, OBJECT_VAL(arg_types[arg_count]));
 			arg_count++;
 		} while (match(compiler, CRUX_TOKEN_COMMA));
 	}
 	consume(compiler, CRUX_TOKEN_RIGHT_PAREN, "Expected ')' after argument list.");
 
 	emit_words(compiler, OP_CALL, arg_count);
+	compiler->call_end = current_chunk(compiler)->count;
 
 	// Type-check when the callee is statically known.
 	if (func_type && func_type->base_type == FUNCTION_TYPE) {
@@ -1597,7 +1625,7 @@ static void infix_call(Compiler *compiler, const bool can_assign)
 		push_type_record(compiler, T_ANY);
 	}
 	for (int i = 0; i < arg_count; i++) {
-		pop(compiler->owner->current_module_record);
+		pop(compiler->owner);
 	}
 }
 
@@ -1638,7 +1666,7 @@ static void dot(Compiler *compiler, const bool can_assign)
 	if (!object_type) {
 		object_type = T_ANY;
 	}
-	push(compiler->owner->current_module_record, OBJECT_VAL(object_type));
+	push(compiler->owner, OBJECT_VAL(object_type));
 
 	// Determine if we can use indexed access
 	int field_index = -1;
@@ -1654,7 +1682,7 @@ static void dot(Compiler *compiler, const bool can_assign)
 	if (can_assign) {
 		const ObjectString *field_name = copy_string(compiler->owner, method_name_token.start,
 													 method_name_token.length);
-		push(compiler->owner->current_module_record, OBJECT_VAL(field_name));
+		push(compiler->owner, OBJECT_VAL(field_name));
 		ObjectTypeRecord *field_type = NULL;
 
 		if (object_type->base_type == STRUCT_TYPE) {
@@ -1688,8 +1716,8 @@ static void dot(Compiler *compiler, const bool can_assign)
 			push_type_record(compiler, T_NIL);
 			pop_type_record(compiler);
 
-			pop(compiler->owner->current_module_record); // field_name
-			pop(compiler->owner->current_module_record); // object_type
+			pop(compiler->owner); // field_name
+			pop(compiler->owner); // object_type
 			return;
 		}
 
@@ -1713,11 +1741,11 @@ static void dot(Compiler *compiler, const bool can_assign)
 			pop_type_record(compiler);
 			push_type_record(compiler, rhs_type); // assignment leaves the value on the stack
 
-			pop(compiler->owner->current_module_record); // field_name
-			pop(compiler->owner->current_module_record); // object_type
+			pop(compiler->owner); // field_name
+			pop(compiler->owner); // object_type
 			return;
 		}
-		pop(compiler->owner->current_module_record); // field_name
+		pop(compiler->owner); // field_name
 	}
 
 	// OP_INVOKE
@@ -1730,15 +1758,15 @@ static void dot(Compiler *compiler, const bool can_assign)
 			do {
 				if (arg_count >= UINT8_COUNT) {
 					for (int i = 0; i < arg_count; i++)
-						pop(compiler->owner->current_module_record);
-					pop(compiler->owner->current_module_record); // object_type
+						pop(compiler->owner);
+					pop(compiler->owner); // object_type
 					compiler_panic(compiler->parser, "Cannot have more than 255 arguments.", ARGUMENT_EXTENT);
 					return;
 				}
 
 				expression(compiler);
 				arg_types[arg_count] = pop_type_record(compiler);
-				push(compiler->owner->current_module_record, OBJECT_VAL(arg_types[arg_count]));
+				push(compiler->owner, OBJECT_VAL(arg_types[arg_count]));
 				arg_count++;
 			} while (match(compiler, CRUX_TOKEN_COMMA));
 		}
@@ -1814,6 +1842,9 @@ static void dot(Compiler *compiler, const bool can_assign)
 			case BUFFER_TYPE:
 				type_table = &vm->buffer_type;
 				break;
+			case ITERATOR_TYPE:
+				type_table = &vm->iterator_type;
+				break;
 			default:
 				break;
 			}
@@ -1872,9 +1903,9 @@ static void dot(Compiler *compiler, const bool can_assign)
 		push_type_record(compiler, method_return ? method_return : T_ANY);
 
 		for (int i = 0; i < (int)arg_count; i++) {
-			pop(compiler->owner->current_module_record);
+			pop(compiler->owner);
 		}
-		pop(compiler->owner->current_module_record); // object_type
+		pop(compiler->owner); // object_type
 		return;
 	}
 
@@ -1902,7 +1933,79 @@ static void dot(Compiler *compiler, const bool can_assign)
 	pop_type_record(compiler);
 	push_type_record(compiler, result_type ? result_type : T_ANY);
 
-	pop(compiler->owner->current_module_record); // object_type
+	pop(compiler->owner); // object_type
+}
+
+static int struct_field_slot(const ObjectStruct *definition, const Token *name)
+{
+	for (int i = 0; i < definition->fields.capacity; i++) {
+		const Entry *entry = &definition->fields.entries[i];
+		if (entry->key != NULL && entry->key->byte_length == (uint32_t)name->length &&
+			memcmp(entry->key->chars, name->start, name->length) == 0) {
+			return AS_INT(entry->value);
+		}
+	}
+	return -1;
+}
+
+/**
+ * Scans ahead over a struct initializer whose '{' was just consumed and checks that it names every field of
+ * <definition> exactly once, in slot order. Such initializers leave their values on the stack in slot order, so the
+ * instance can be built by a single OP_NEW_STRUCT.
+ */
+static bool initializer_in_slot_order(const Compiler *compiler, const ObjectStruct *definition, const int field_count)
+{
+	Scanner scanner = *compiler->parser->scanner;
+	Token token = compiler->parser->current;
+	if (token.type == CRUX_TOKEN_RIGHT_BRACE) {
+		return field_count == 0;
+	}
+
+	for (int slot = 0;; slot++) {
+		if (token.type != CRUX_TOKEN_IDENTIFIER || slot >= field_count ||
+			struct_field_slot(definition, &token) != slot || scan_token(&scanner).type != CRUX_TOKEN_EQUAL) {
+			return false;
+		}
+		// skip the field's value
+		int depth = 0;
+		for (;;) {
+			token = scan_token(&scanner);
+			switch (token.type) {
+			case CRUX_TOKEN_LEFT_PAREN:
+			case CRUX_TOKEN_LEFT_BRACE:
+			case CRUX_TOKEN_LEFT_SQUARE:
+			case CRUX_TOKEN_DOLLAR_LEFT_BRACE:
+			case CRUX_TOKEN_DOLLAR_LEFT_SQUARE:
+				depth++;
+				continue;
+			case CRUX_TOKEN_RIGHT_PAREN:
+			case CRUX_TOKEN_RIGHT_SQUARE:
+				if (depth == 0) {
+					return false;
+				}
+				depth--;
+				continue;
+			case CRUX_TOKEN_RIGHT_BRACE:
+				if (depth == 0) {
+					return slot + 1 == field_count;
+				}
+				depth--;
+				continue;
+			case CRUX_TOKEN_COMMA:
+				if (depth > 0) {
+					continue;
+				}
+				break;
+			case CRUX_TOKEN_EOF:
+			case CRUX_TOKEN_ERROR:
+				return false;
+			default:
+				continue;
+			}
+			break;
+		}
+		token = scan_token(&scanner);
+	}
 }
 
 void struct_instance(Compiler *compiler, const bool can_assign)
@@ -1939,8 +2042,15 @@ void struct_instance(Compiler *compiler, const bool can_assign)
 		}
 	}
 
+	// with a known layout, values stay on the stack and OP_NEW_STRUCT fills the instance at once; otherwise each field
+	// is looked up by name as it is set
+	const bool in_slot_order = type_known &&
+							   initializer_in_slot_order(compiler, struct_type->as.struct_type.definition,
+														 declared_field_count);
 	uint16_t fieldCount = 0;
-	emit_word(compiler, OP_STRUCT_INSTANCE_START);
+	if (!in_slot_order) {
+		emit_word(compiler, OP_STRUCT_INSTANCE_START);
+	}
 
 	if (!match(compiler, CRUX_TOKEN_RIGHT_BRACE)) {
 		do {
@@ -1957,7 +2067,7 @@ void struct_instance(Compiler *compiler, const bool can_assign)
 					"Expected field name. Trailing commas after final field are not allowed.");
 			ObjectString *fieldName = copy_string(compiler->owner, compiler->parser->previous.start,
 												  compiler->parser->previous.length);
-			push(compiler->owner->current_module_record, OBJECT_VAL(fieldName));
+			push(compiler->owner, OBJECT_VAL(fieldName));
 
 			consume(compiler, CRUX_TOKEN_EQUAL, "Expected '=' after struct field name.");
 
@@ -2001,10 +2111,12 @@ void struct_instance(Compiler *compiler, const bool can_assign)
 				}
 			}
 
-			const uint16_t fieldNameConstant = make_constant(compiler, OBJECT_VAL(fieldName));
-			emit_words(compiler, OP_STRUCT_NAMED_FIELD, fieldNameConstant);
+			if (!in_slot_order) {
+				const uint16_t fieldNameConstant = make_constant(compiler, OBJECT_VAL(fieldName));
+				emit_words(compiler, OP_STRUCT_NAMED_FIELD, fieldNameConstant);
+			}
 
-			pop(compiler->owner->current_module_record); // unroot fieldName
+			pop(compiler->owner); // unroot fieldName
 			fieldCount++;
 		} while (match(compiler, CRUX_TOKEN_COMMA));
 	}
@@ -2037,7 +2149,11 @@ void struct_instance(Compiler *compiler, const bool can_assign)
 		consume(compiler, CRUX_TOKEN_RIGHT_BRACE, "Expected '}' after struct field list.");
 	}
 
-	emit_word(compiler, OP_STRUCT_INSTANCE_END);
+	if (in_slot_order) {
+		emit_words(compiler, OP_NEW_STRUCT, fieldCount);
+	} else {
+		emit_word(compiler, OP_STRUCT_INSTANCE_END);
+	}
 
 	pop_type_record(compiler);
 	push_type_record(compiler, struct_type ? struct_type : T_ANY);
@@ -2066,14 +2182,31 @@ static void block(Compiler *compiler)
 	consume(compiler, CRUX_TOKEN_RIGHT_BRACE, "Expected '}' after block");
 }
 
+/**
+ * Emits the capture operands of OP_CLOSURE or OP_ANON_FUNCTION for the upvalues of <function_compiler>. Captured
+ * locals start out captured by reference and are turned into copies when their scope ends without an assignment.
+ */
+static void emit_captures(Compiler *compiler, const Compiler *function_compiler)
+{
+	for (int i = 0; i < function_compiler->function->upvalue_count; i++) {
+		const Upvalue *upvalue = &function_compiler->upvalues[i];
+		if (upvalue->is_local) {
+			record_capture_site(compiler, current_chunk(compiler)->count, upvalue->index);
+		}
+		emit_word(compiler, upvalue->is_local ? CAPTURE_LOCAL : CAPTURE_UPVALUE);
+		emit_word(compiler, upvalue->index);
+	}
+}
+
 static void function(Compiler *compiler, const FunctionType type, ObjectTypeRecord *self_type,
-					 ObjectString *recursive_name, int recursive_global_index)
+					 ObjectString *recursive_name, int recursive_global_index, const bool is_generator)
 {
 	Compiler function_compiler = {0};
 	if (!init_compiler(compiler->owner, &function_compiler, compiler, type)) {
 		compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
 		return;
 	}
+	function_compiler.function->is_generator = is_generator;
 	if (type == TYPE_METHOD && self_type) {
 		function_compiler.locals[0].type = self_type;
 	}
@@ -2143,8 +2276,8 @@ static void function(Compiler *compiler, const FunctionType type, ObjectTypeReco
 	consume(&function_compiler, CRUX_TOKEN_LEFT_BRACE, "Expect '{' before function body.");
 	block(&function_compiler);
 
-	if (!function_compiler.has_return && annotated_return_type && annotated_return_type->base_type != NIL_TYPE &&
-		annotated_return_type->base_type != ANY_TYPE) {
+	if (!is_generator && !function_compiler.has_return && annotated_return_type &&
+		annotated_return_type->base_type != NIL_TYPE && annotated_return_type->base_type != ANY_TYPE) {
 		char expected[128];
 		type_record_name(annotated_return_type, expected, sizeof(expected));
 		compiler_panicf(compiler->parser, TYPE, "Function expects to return '%s' but has no return statement.",
@@ -2153,38 +2286,39 @@ static void function(Compiler *compiler, const FunctionType type, ObjectTypeReco
 
 	ObjectFunction *fn = end_compiler(&function_compiler);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(fn));
-	push(compiler->owner->current_module_record, OBJECT_VAL(annotated_return_type));
+	push(compiler->owner, OBJECT_VAL(fn));
+	push(compiler->owner, OBJECT_VAL(annotated_return_type));
 	for (int i = 0; i < param_count; i++) {
-		push(compiler->owner->current_module_record, OBJECT_VAL(param_types[i]));
+		push(compiler->owner, OBJECT_VAL(param_types[i]));
 	}
 
 	emit_words(compiler, OP_CLOSURE, make_constant(compiler, OBJECT_VAL(fn)));
 
-	for (int i = 0; i < fn->upvalue_count; i++) {
-		emit_word(compiler, function_compiler.upvalues[i].is_local ? 1 : 0);
-		emit_word(compiler, function_compiler.upvalues[i].index);
-	}
+	emit_captures(compiler, &function_compiler);
 
-	ObjectTypeRecord *func_type = new_function_type_rec(compiler->owner, param_types, param_count,
-														annotated_return_type);
+	ObjectTypeRecord *call_return_type = is_generator ? new_iterator_type_rec(compiler->owner, annotated_return_type)
+													  : annotated_return_type;
+	push(compiler->owner, OBJECT_VAL(call_return_type));
+	ObjectTypeRecord *func_type = new_function_type_rec(compiler->owner, param_types, param_count, call_return_type);
 	push_type_record(compiler, func_type);
 
+	pop(compiler->owner); // call_return_type
 	for (int i = 0; i < param_count; i++) {
-		pop(compiler->owner->current_module_record); // param_types[i]
+		pop(compiler->owner); // param_types[i]
 	}
-	pop(compiler->owner->current_module_record); // annotated_return_type
-	pop(compiler->owner->current_module_record); // fn
+	pop(compiler->owner); // annotated_return_type
+	pop(compiler->owner); // fn
 }
 
 static void fn_declaration(Compiler *compiler, const bool is_public)
 {
+	const bool is_generator = match(compiler, CRUX_TOKEN_STAR);
 	const uint16_t global = parse_variable(compiler, "Expected function name.");
 
 	const Token fn_name_token = compiler->parser->previous;
 	ObjectString *name_str = copy_string(compiler->owner, fn_name_token.start, fn_name_token.length);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(name_str));
+	push(compiler->owner, OBJECT_VAL(name_str));
 
 	const int local_index = (compiler->scope_depth > 0) ? compiler->local_count - 1 : -1;
 	int reserved_global_index = -1;
@@ -2199,11 +2333,11 @@ static void fn_declaration(Compiler *compiler, const bool is_public)
 	}
 
 	mark_initialized(compiler);
-	function(compiler, TYPE_FUNCTION, NULL, name_str, reserved_global_index);
+	function(compiler, TYPE_FUNCTION, NULL, name_str, reserved_global_index, is_generator);
 
 	ObjectTypeRecord *fn_type = pop_type_record(compiler);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(fn_type));
+	push(compiler->owner, OBJECT_VAL(fn_type));
 
 	if (is_public || (compiler->owner->current_module_record && compiler->owner->current_module_record->is_repl)) {
 		type_table_set(compiler->owner->current_module_record->types, name_str, fn_type);
@@ -2228,18 +2362,20 @@ static void fn_declaration(Compiler *compiler, const bool is_public)
 		define_variable(compiler, global, is_public);
 	}
 
-	pop(compiler->owner->current_module_record); // fn_type
-	pop(compiler->owner->current_module_record); // name_str
+	pop(compiler->owner); // fn_type
+	pop(compiler->owner); // name_str
 }
 
 static void anonymous_function(Compiler *compiler, const bool can_assign)
 {
 	(void)can_assign;
+	const bool is_generator = match(compiler, CRUX_TOKEN_STAR);
 	Compiler function_compiler = {0};
 	if (!init_compiler(compiler->owner, &function_compiler, compiler, TYPE_ANONYMOUS)) {
 		compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
 		return;
 	}
+	function_compiler.function->is_generator = is_generator;
 
 	int param_capacity = 4;
 	int param_count = 0;
@@ -2305,8 +2441,8 @@ static void anonymous_function(Compiler *compiler, const bool can_assign)
 	consume(&function_compiler, CRUX_TOKEN_LEFT_BRACE, "Expected '{' before function body.");
 	block(&function_compiler);
 
-	if (!function_compiler.has_return && annotated_return_type && annotated_return_type->base_type != NIL_TYPE &&
-		annotated_return_type->base_type != ANY_TYPE) {
+	if (!is_generator && !function_compiler.has_return && annotated_return_type &&
+		annotated_return_type->base_type != NIL_TYPE && annotated_return_type->base_type != ANY_TYPE) {
 		char expected[128];
 		type_record_name(annotated_return_type, expected, sizeof(expected));
 		compiler_panicf(function_compiler.parser, TYPE, "Function expects to return '%s' but has no return statement.",
@@ -2315,31 +2451,31 @@ static void anonymous_function(Compiler *compiler, const bool can_assign)
 
 	ObjectFunction *fn = end_compiler(&function_compiler);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(fn));
-	push(compiler->owner->current_module_record, OBJECT_VAL(annotated_return_type));
+	push(compiler->owner, OBJECT_VAL(fn));
+	push(compiler->owner, OBJECT_VAL(annotated_return_type));
 	for (int i = 0; i < param_count; i++) {
-		push(compiler->owner->current_module_record, OBJECT_VAL(param_types[i]));
+		push(compiler->owner, OBJECT_VAL(param_types[i]));
 	}
 
 	const uint16_t constantIndex = make_constant(compiler, OBJECT_VAL(fn));
 	emit_words(compiler, OP_ANON_FUNCTION, constantIndex);
 
-	for (int i = 0; i < fn->upvalue_count; i++) {
-		emit_word(compiler, function_compiler.upvalues[i].is_local ? 1 : 0);
-		emit_word(compiler, function_compiler.upvalues[i].index);
-	}
+	emit_captures(compiler, &function_compiler);
 
 	param_types = GROW_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, param_capacity, param_count);
 
-	ObjectTypeRecord *func_type = new_function_type_rec(compiler->owner, param_types, param_count,
-														annotated_return_type);
+	ObjectTypeRecord *call_return_type = is_generator ? new_iterator_type_rec(compiler->owner, annotated_return_type)
+													  : annotated_return_type;
+	push(compiler->owner, OBJECT_VAL(call_return_type));
+	ObjectTypeRecord *func_type = new_function_type_rec(compiler->owner, param_types, param_count, call_return_type);
 	push_type_record(compiler, func_type);
 
+	pop(compiler->owner); // call_return_type
 	for (int i = 0; i < param_count; i++) {
-		pop(compiler->owner->current_module_record); // param_types[i]
+		pop(compiler->owner); // param_types[i]
 	}
-	pop(compiler->owner->current_module_record); // annotated_return_type
-	pop(compiler->owner->current_module_record); // fn
+	pop(compiler->owner); // annotated_return_type
+	pop(compiler->owner); // fn
 }
 
 static void array_literal(Compiler *compiler, const bool can_assign)
@@ -2348,9 +2484,9 @@ static void array_literal(Compiler *compiler, const bool can_assign)
 	uint16_t elementCount = 0;
 	ObjectTypeRecord *element_type = NULL;
 
-	push(compiler->owner->current_module_record, NIL_VAL);
-	const int type_root_stack_index = (int)(compiler->owner->current_module_record->stack_top -
-											compiler->owner->current_module_record->stack - 1);
+	push(compiler->owner, NIL_VAL);
+	const int type_root_stack_index = (int)(compiler->owner->stack_top -
+											compiler->owner->stack - 1);
 
 	if (!match(compiler, CRUX_TOKEN_RIGHT_SQUARE)) {
 		do {
@@ -2370,7 +2506,7 @@ static void array_literal(Compiler *compiler, const bool can_assign)
 				}
 			}
 
-			compiler->owner->current_module_record->stack[type_root_stack_index] = element_type
+			compiler->owner->stack[type_root_stack_index] = element_type
 																					   ? OBJECT_VAL(element_type)
 																					   : NIL_VAL;
 
@@ -2384,7 +2520,7 @@ static void array_literal(Compiler *compiler, const bool can_assign)
 
 	if (!element_type) {
 		element_type = T_ANY;
-		compiler->owner->current_module_record->stack[type_root_stack_index] = OBJECT_VAL(element_type);
+		compiler->owner->stack[type_root_stack_index] = OBJECT_VAL(element_type);
 	}
 
 	emit_word(compiler, OP_ARRAY);
@@ -2393,7 +2529,7 @@ static void array_literal(Compiler *compiler, const bool can_assign)
 	ObjectTypeRecord *array_type = new_array_type_rec(compiler->owner, element_type);
 	push_type_record(compiler, array_type);
 
-	pop(compiler->owner->current_module_record); // element_type
+	pop(compiler->owner); // element_type
 }
 
 static void set_literal(Compiler *compiler, const bool can_assign)
@@ -2402,9 +2538,9 @@ static void set_literal(Compiler *compiler, const bool can_assign)
 	uint16_t elementCount = 0;
 	ObjectTypeRecord *element_type = NULL;
 
-	push(compiler->owner->current_module_record, NIL_VAL);
-	const int type_root_stack_index = (int)(compiler->owner->current_module_record->stack_top -
-											compiler->owner->current_module_record->stack - 1);
+	push(compiler->owner, NIL_VAL);
+	const int type_root_stack_index = (int)(compiler->owner->stack_top -
+											compiler->owner->stack - 1);
 
 	if (!match(compiler, CRUX_TOKEN_RIGHT_BRACE)) {
 		do {
@@ -2430,7 +2566,7 @@ static void set_literal(Compiler *compiler, const bool can_assign)
 				}
 			}
 
-			compiler->owner->current_module_record->stack[type_root_stack_index] = element_type
+			compiler->owner->stack[type_root_stack_index] = element_type
 																					   ? OBJECT_VAL(element_type)
 																					   : NIL_VAL;
 
@@ -2444,7 +2580,7 @@ static void set_literal(Compiler *compiler, const bool can_assign)
 
 	if (!element_type) {
 		element_type = T_ANY;
-		compiler->owner->current_module_record->stack[type_root_stack_index] = OBJECT_VAL(element_type);
+		compiler->owner->stack[type_root_stack_index] = OBJECT_VAL(element_type);
 	}
 
 	emit_word(compiler, OP_SET);
@@ -2453,7 +2589,7 @@ static void set_literal(Compiler *compiler, const bool can_assign)
 	ObjectTypeRecord *set_type = new_set_type_rec(compiler->owner, element_type);
 	push_type_record(compiler, set_type);
 
-	pop(compiler->owner->current_module_record); // element_type
+	pop(compiler->owner); // element_type
 }
 
 static void tuple_literal(Compiler *compiler, const bool can_assign)
@@ -2473,7 +2609,7 @@ static void tuple_literal(Compiler *compiler, const bool can_assign)
 		do {
 			expression(compiler);
 			ObjectTypeRecord *value_type = pop_type_record(compiler);
-			push(compiler->owner->current_module_record, value_type ? OBJECT_VAL(value_type) : NIL_VAL);
+			push(compiler->owner, value_type ? OBJECT_VAL(value_type) : NIL_VAL);
 
 			if (elementCount == element_capacity) {
 				const int old_capacity = element_capacity;
@@ -2483,7 +2619,7 @@ static void tuple_literal(Compiler *compiler, const bool can_assign)
 				if (grown == NULL) {
 					FREE_ARRAY(compiler->owner, ObjectTypeRecord *, element_types, old_capacity);
 					for (uint16_t i = 0; i < elementCount; i++) {
-						pop(compiler->owner->current_module_record);
+						pop(compiler->owner);
 					}
 					compiler_panic(compiler->parser, "Memory allocation failed.", MEMORY);
 					push_type_record(compiler, T_ANY);
@@ -2516,7 +2652,7 @@ static void tuple_literal(Compiler *compiler, const bool can_assign)
 	push_type_record(compiler, tuple_type);
 
 	for (uint16_t i = 0; i < elementCount; i++) {
-		pop(compiler->owner->current_module_record);
+		pop(compiler->owner);
 	}
 }
 
@@ -2527,10 +2663,10 @@ static void table_literal(Compiler *compiler, const bool can_assign)
 	ObjectTypeRecord *table_key_type = NULL;
 	ObjectTypeRecord *table_value_type = NULL;
 
-	push(compiler->owner->current_module_record, NIL_VAL); // key
-	push(compiler->owner->current_module_record, NIL_VAL); // val
-	const int val_idx = (int)(compiler->owner->current_module_record->stack_top -
-							  compiler->owner->current_module_record->stack - 1);
+	push(compiler->owner, NIL_VAL); // key
+	push(compiler->owner, NIL_VAL); // val
+	const int val_idx = (int)(compiler->owner->stack_top -
+							  compiler->owner->stack - 1);
 	const int key_idx = val_idx - 1;
 
 	if (!match(compiler, CRUX_TOKEN_RIGHT_BRACE)) {
@@ -2539,10 +2675,10 @@ static void table_literal(Compiler *compiler, const bool can_assign)
 			ObjectTypeRecord *key_type = pop_type_record(compiler);
 			consume(compiler, CRUX_TOKEN_COLON, "Expected ':' after table key.");
 
-			push(compiler->owner->current_module_record, OBJECT_VAL(key_type));
+			push(compiler->owner, OBJECT_VAL(key_type));
 			expression(compiler);
 			ObjectTypeRecord *value_type = pop_type_record(compiler);
-			pop(compiler->owner->current_module_record);
+			pop(compiler->owner);
 
 			if (!table_key_type) {
 				table_key_type = key_type;
@@ -2570,9 +2706,9 @@ static void table_literal(Compiler *compiler, const bool can_assign)
 			}
 
 			// update roots
-			compiler->owner->current_module_record->stack[key_idx] = table_key_type ? OBJECT_VAL(table_key_type)
+			compiler->owner->stack[key_idx] = table_key_type ? OBJECT_VAL(table_key_type)
 																					: NIL_VAL;
-			compiler->owner->current_module_record->stack[val_idx] = table_value_type ? OBJECT_VAL(table_value_type)
+			compiler->owner->stack[val_idx] = table_value_type ? OBJECT_VAL(table_value_type)
 																					  : NIL_VAL;
 
 			if (elementCount >= UINT16_MAX) {
@@ -2587,8 +2723,8 @@ static void table_literal(Compiler *compiler, const bool can_assign)
 		table_key_type = T_ANY;
 	if (!table_value_type)
 		table_value_type = T_ANY;
-	compiler->owner->current_module_record->stack[key_idx] = OBJECT_VAL(table_key_type);
-	compiler->owner->current_module_record->stack[val_idx] = OBJECT_VAL(table_value_type);
+	compiler->owner->stack[key_idx] = OBJECT_VAL(table_key_type);
+	compiler->owner->stack[val_idx] = OBJECT_VAL(table_value_type);
 
 	emit_word(compiler, OP_TABLE);
 	emit_word(compiler, elementCount);
@@ -2596,18 +2732,18 @@ static void table_literal(Compiler *compiler, const bool can_assign)
 	ObjectTypeRecord *table_type = new_table_type_rec(compiler->owner, table_key_type, table_value_type);
 	push_type_record(compiler, table_type);
 
-	pop(compiler->owner->current_module_record); // val
-	pop(compiler->owner->current_module_record); // key
+	pop(compiler->owner); // val
+	pop(compiler->owner); // key
 }
 
 static void collection_index(Compiler *compiler, const bool can_assign)
 {
 	ObjectTypeRecord *collection_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(collection_type));
+	push(compiler->owner, OBJECT_VAL(collection_type));
 
 	expression(compiler);
 	ObjectTypeRecord *index_type = pop_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(index_type));
+	push(compiler->owner, OBJECT_VAL(index_type));
 
 	if (collection_type && index_type && index_type->base_type != ANY_TYPE && collection_type->base_type != ANY_TYPE) {
 		if (collection_type->base_type == ARRAY_TYPE || collection_type->base_type == STRING_TYPE ||
@@ -2686,9 +2822,9 @@ static void collection_index(Compiler *compiler, const bool can_assign)
 				}
 				case BUFFER_TYPE: {
 					ObjectTypeRecord *element_type = T_INT;
-					push(compiler->owner->current_module_record, OBJECT_VAL(element_type));
+					push(compiler->owner, OBJECT_VAL(element_type));
 					result_type = new_array_type_rec(compiler->owner, element_type);
-					pop(compiler->owner->current_module_record);
+					pop(compiler->owner);
 					break;
 				}
 				default: {
@@ -2717,8 +2853,8 @@ static void collection_index(Compiler *compiler, const bool can_assign)
 		}
 	}
 
-	pop(compiler->owner->current_module_record); // index_type
-	pop(compiler->owner->current_module_record); // collection_type
+	pop(compiler->owner); // index_type
+	pop(compiler->owner); // collection_type
 }
 
 static void var_declaration(Compiler *compiler, const bool is_public)
@@ -2727,14 +2863,14 @@ static void var_declaration(Compiler *compiler, const bool is_public)
 	const Token var_name = compiler->parser->previous;
 	ObjectString *name_str = copy_string(compiler->owner, var_name.start, var_name.length);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(name_str));
+	push(compiler->owner, OBJECT_VAL(name_str));
 
 	ObjectTypeRecord *annotated_type = NULL;
 	if (match(compiler, CRUX_TOKEN_COLON)) {
 		annotated_type = parse_type_record(compiler);
 	}
 
-	push(compiler->owner->current_module_record, annotated_type ? OBJECT_VAL(annotated_type) : NIL_VAL);
+	push(compiler->owner, annotated_type ? OBJECT_VAL(annotated_type) : NIL_VAL);
 
 	ObjectTypeRecord *value_type = NULL;
 	if (match(compiler, CRUX_TOKEN_EQUAL)) {
@@ -2782,8 +2918,8 @@ static void var_declaration(Compiler *compiler, const bool is_public)
 	}
 	define_variable(compiler, global, is_public);
 
-	pop(compiler->owner->current_module_record); // annotated_type
-	pop(compiler->owner->current_module_record); // name_str
+	pop(compiler->owner); // annotated_type
+	pop(compiler->owner); // name_str
 }
 
 static void expression_statement(Compiler *compiler)
@@ -2891,7 +3027,7 @@ static void if_statement(Compiler *compiler)
 		}
 	}
 
-	push(compiler->owner->current_module_record, original_type ? OBJECT_VAL(original_type) : NIL_VAL);
+	push(compiler->owner, original_type ? OBJECT_VAL(original_type) : NIL_VAL);
 
 	statement(compiler);
 
@@ -2920,7 +3056,7 @@ static void if_statement(Compiler *compiler)
 
 	patch_jump(compiler, elseJump);
 
-	pop(compiler->owner->current_module_record); // original_type
+	pop(compiler->owner); // original_type
 
 	// restore original type
 	if (narrow_state.local_index != -1) {
@@ -2938,6 +3074,13 @@ static void return_statement(Compiler *compiler)
 
 	compiler->has_return = true;
 
+	if (compiler->function->is_generator) {
+		consume(compiler, CRUX_TOKEN_SEMICOLON, "Generators cannot return a value, use <yield> instead.");
+		emit_return(compiler);
+		compiler->last_give_type = new_type_rec(compiler->owner, NEVER_TYPE);
+		return;
+	}
+
 	if (match(compiler, CRUX_TOKEN_SEMICOLON)) {
 		// check that the function expects Nil
 		if (compiler->return_type && compiler->return_type->base_type != NIL_TYPE &&
@@ -2963,11 +3106,39 @@ static void return_statement(Compiler *compiler)
 								got);
 			}
 		}
+		// a call that produced the returned value is in tail position and may reuse this function's frame
+		if (compiler->call_end == current_chunk(compiler)->count) {
+			current_chunk(compiler)->code[compiler->call_end - 2] = OP_TAIL_CALL;
+		}
 		emit_word(compiler, OP_RETURN);
 	}
 	compiler->last_give_type = new_type_rec(compiler->owner, NEVER_TYPE);
 }
 
+static void yield_statement(Compiler *compiler)
+{
+	if (!compiler->function->is_generator) {
+		compiler_panic(compiler->parser, "Cannot use <yield> outside of a generator function.", SYNTAX);
+	}
+
+	expression(compiler);
+	consume(compiler, CRUX_TOKEN_SEMICOLON, "Expected ';' after yield value.");
+
+	ObjectTypeRecord *value_type = pop_type_record(compiler);
+	if (value_type && compiler->return_type && compiler->return_type->base_type != ANY_TYPE &&
+		value_type->base_type != ANY_TYPE && !types_compatible(compiler->return_type, value_type)) {
+		char expected[128];
+		char got[128];
+		type_record_name(compiler->return_type, expected, sizeof(expected));
+		type_record_name(value_type, got, sizeof(got));
+		compiler_panicf(compiler->parser, TYPE, "Yield type mismatch: expected '%s', got '%s'.", expected, got);
+	}
+
+	// the yielded value's slot receives the resume value, which a statement discards
+	emit_word(compiler, OP_YIELD);
+	emit_word(compiler, OP_POP);
+}
+
 static void use_statement(Compiler *compiler)
 {
 	bool hasParen = false;
@@ -3072,7 +3243,7 @@ static void use_statement(Compiler *compiler)
 		ObjectString *raw_path_str = copy_string(compiler->owner, compiler->parser->previous.start + 1,
 												 compiler->parser->previous.length - 2);
 
-		push(compiler->owner->current_module_record, OBJECT_VAL(raw_path_str));
+		push(compiler->owner, OBJECT_VAL(raw_path_str));
 
 		const char *base_path = compiler->owner->current_module_record && compiler->owner->current_module_record->path
 									? compiler->owner->current_module_record->path->chars
@@ -3081,22 +3252,22 @@ static void use_statement(Compiler *compiler)
 		char *resolved_chars = resolve_path(base_path, raw_path_str->chars);
 		if (resolved_chars == NULL) {
 			compiler_panicf(compiler->parser, IMPORT, "Failed to resolve import path: '%s'", raw_path_str->chars);
-			pop(compiler->owner->current_module_record);
+			pop(compiler->owner);
 			return;
 		}
 
 		ObjectString *path_str = copy_string(compiler->owner, resolved_chars, strlen(resolved_chars));
 		free(resolved_chars);
 
-		pop(compiler->owner->current_module_record); // raw_path_str
-		push(compiler->owner->current_module_record, OBJECT_VAL(path_str));
+		pop(compiler->owner); // raw_path_str
+		push(compiler->owner, OBJECT_VAL(path_str));
 
 		ObjectModuleRecord *statically_imported_mod = NULL;
 
 		statically_imported_mod = compile_module_statically(compiler, path_str);
 		if (!statically_imported_mod || statically_imported_mod->state == STATE_ERROR) {
 			compiler_panicf(compiler->parser, IMPORT, "Failed to compile module '%s'.", path_str->chars);
-			pop(compiler->owner->current_module_record); // path_str
+			pop(compiler->owner); // path_str
 			return;
 		}
 
@@ -3140,7 +3311,7 @@ static void use_statement(Compiler *compiler)
 			}
 		}
 
-		pop(compiler->owner->current_module_record); // path_str
+		pop(compiler->owner); // path_str
 	}
 
 	consume(compiler, CRUX_TOKEN_SEMICOLON, "Expected ';' after import statement.");
@@ -3152,11 +3323,11 @@ static void struct_declaration(Compiler *compiler, bool is_public)
 	const Token structName = compiler->parser->previous;
 
 	ObjectString *struct_name_str = copy_string(compiler->owner, structName.start, structName.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(struct_name_str));
+	push(compiler->owner, OBJECT_VAL(struct_name_str));
 
 	const uint16_t nameConstant = identifier_constant(compiler, &structName);
 	ObjectStruct *structObject = new_struct_type(compiler->owner, struct_name_str);
-	push(compiler->owner->current_module_record, OBJECT_VAL(structObject));
+	push(compiler->owner, OBJECT_VAL(structObject));
 
 	declare_variable(compiler);
 
@@ -3169,7 +3340,7 @@ static void struct_declaration(Compiler *compiler, bool is_public)
 	consume(compiler, CRUX_TOKEN_LEFT_BRACE, "Expected '{' before struct body.");
 
 	ObjectTypeTable *field_types = new_type_table(compiler->owner, INITIAL_TYPE_TABLE_SIZE);
-	push(compiler->owner->current_module_record, OBJECT_VAL(field_types));
+	push(compiler->owner, OBJECT_VAL(field_types));
 	int fieldCount = 0;
 
 	if (!match(compiler, CRUX_TOKEN_RIGHT_BRACE)) {
@@ -3183,7 +3354,7 @@ static void struct_declaration(Compiler *compiler, bool is_public)
 					"Expected field name. Trailing comma after last field is not allowed.");
 			ObjectString *fieldName = copy_string(compiler->owner, compiler->parser->previous.start,
 												  compiler->parser->previous.length);
-			push(compiler->owner->current_module_record, OBJECT_VAL(fieldName));
+			push(compiler->owner, OBJECT_VAL(fieldName));
 
 			Value fieldNameCheck;
 			if (table_get(&structObject->fields, fieldName, &fieldNameCheck)) {
@@ -3201,7 +3372,7 @@ static void struct_declaration(Compiler *compiler, bool is_public)
 			} else {
 				field_type = T_ANY;
 			}
-			push(compiler->owner->current_module_record, OBJECT_VAL(field_type));
+			push(compiler->owner, OBJECT_VAL(field_type));
 
 			type_table_set(field_types, fieldName, field_type);
 
@@ -3215,7 +3386,7 @@ static void struct_declaration(Compiler *compiler, bool is_public)
 	}
 
 	ObjectTypeRecord *struct_type = new_struct_type_rec(compiler->owner, structObject, field_types, fieldCount);
-	push(compiler->owner->current_module_record, OBJECT_VAL(struct_type));
+	push(compiler->owner, OBJECT_VAL(struct_type));
 
 	// type registration
 	if (compiler->scope_depth == 0) {
@@ -3227,14 +3398,14 @@ static void struct_declaration(Compiler *compiler, bool is_public)
 		type_table_set(compiler->owner->current_module_record->types, struct_name_str, struct_type);
 	}
 
-	pop(compiler->owner->current_module_record); // struct_type
+	pop(compiler->owner); // struct_type
 	for (int i = 0; i < fieldCount; i++) {
-		pop(compiler->owner->current_module_record); // field_type
-		pop(compiler->owner->current_module_record); // fieldName
+		pop(compiler->owner); // field_type
+		pop(compiler->owner); // fieldName
 	}
-	pop(compiler->owner->current_module_record); // field_types
-	pop(compiler->owner->current_module_record); // structObject
-	pop(compiler->owner->current_module_record); // struct_name_str
+	pop(compiler->owner); // field_types
+	pop(compiler->owner); // structObject
+	pop(compiler->owner); // struct_name_str
 }
 
 static void impl_declaration(Compiler *compiler)
@@ -3268,19 +3439,19 @@ static void impl_declaration(Compiler *compiler)
 
 		const Token method_name_tok = compiler->parser->previous;
 		ObjectString *method_name_str = copy_string(compiler->owner, method_name_tok.start, method_name_tok.length);
-		push(compiler->owner->current_module_record, OBJECT_VAL(method_name_str));
+		push(compiler->owner, OBJECT_VAL(method_name_str));
 		const uint16_t method_name_const = make_constant(compiler, OBJECT_VAL(method_name_str));
 
 		// slot 0 is preserved for self
-		function(compiler, TYPE_METHOD, struct_type, NULL, -1);
+		function(compiler, TYPE_METHOD, struct_type, NULL, -1, false);
 
 		ObjectTypeRecord *method_type = pop_type_record(compiler);
-		push(compiler->owner->current_module_record, OBJECT_VAL(method_type));
+		push(compiler->owner, OBJECT_VAL(method_type));
 		type_table_set(struct_type->as.struct_type.field_types, method_name_str, method_type);
 
 		emit_words(compiler, OP_METHOD, method_name_const);
-		pop(compiler->owner->current_module_record); // method_type
-		pop(compiler->owner->current_module_record); // method_name_str
+		pop(compiler->owner); // method_type
+		pop(compiler->owner); // method_name_str
 	}
 
 	consume(compiler, CRUX_TOKEN_RIGHT_BRACE, "Expected '}' after impl body.");
@@ -3830,11 +4001,11 @@ static void type_declaration(Compiler *compiler, bool is_public)
 
 	const Token type_name_token = compiler->parser->previous;
 	ObjectString *type_name_str = copy_string(compiler->owner, type_name_token.start, type_name_token.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(type_name_str));
+	push(compiler->owner, OBJECT_VAL(type_name_str));
 	consume(compiler, CRUX_TOKEN_EQUAL, "Expected '=' after type name.");
 
 	ObjectTypeRecord *aliased_type = parse_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(aliased_type));
+	push(compiler->owner, OBJECT_VAL(aliased_type));
 	consume(compiler, CRUX_TOKEN_SEMICOLON, "Expected ';' after type declaration.");
 
 	if (compiler->scope_depth == 0) {
@@ -3849,8 +4020,8 @@ static void type_declaration(Compiler *compiler, bool is_public)
 	if (is_public || (compiler->owner->current_module_record && compiler->owner->current_module_record->is_repl)) {
 		type_table_set(compiler->owner->current_module_record->types, type_name_str, aliased_type);
 	}
-	pop(compiler->owner->current_module_record);
-	pop(compiler->owner->current_module_record);
+	pop(compiler->owner);
+	pop(compiler->owner);
 }
 
 static void public_declaration(Compiler *compiler)
@@ -3908,6 +4079,8 @@ static void statement(Compiler *compiler)
 		for_statement(compiler);
 	} else if (match(compiler, CRUX_TOKEN_RETURN)) {
 		return_statement(compiler);
+	} else if (match(compiler, CRUX_TOKEN_YIELD)) {
+		yield_statement(compiler);
 	} else if (match(compiler, CRUX_TOKEN_USE)) {
 		use_statement(compiler);
 	} else if (match(compiler, CRUX_TOKEN_GIVE)) {
@@ -4255,10 +4428,10 @@ static void err_expression(Compiler *compiler, const bool can_assign)
 	pop_type_record(compiler); // discard the type
 	emit_word(compiler, OP_ERR);
 	ObjectTypeRecord *any = T_ANY;
-	push(compiler->owner->current_module_record, OBJECT_VAL(any));
+	push(compiler->owner, OBJECT_VAL(any));
 	ObjectTypeRecord *type = new_type_rec(compiler->owner, RESULT_TYPE);
 	type->as.result_type.ok_type = any;
-	pop(compiler->owner->current_module_record);
+	pop(compiler->owner);
 	push_type_record(compiler, type);
 }
 
@@ -4321,12 +4494,16 @@ static ObjectModuleRecord *compile_module_statically(Compiler *compiler, ObjectS
 		return mod;
 	}
 
-	const FileResult result = read_file(path->chars);
-	if (result.error) {
-		compiler_panicf(compiler->parser, IMPORT, "Could not read file '%s': %s", path->chars, result.error);
-		return NULL;
+	// sources of the import graph are usually read ahead of time by preload_import_graph
+	char *source = take_preloaded_source(compiler->owner, path->chars);
+	if (source == NULL) {
+		const FileResult result = read_file(path->chars);
+		if (result.error) {
+			compiler_panicf(compiler->parser, IMPORT, "Could not read file '%s': %s", path->chars, result.error);
+			return NULL;
+		}
+		source = result.content;
 	}
-	char *source = result.content;
 
 	ObjectModuleRecord *new_module = new_object_module_record(compiler->owner, path, false, false);
 	table_set(compiler->owner, &compiler->owner->module_cache, path, OBJECT_VAL(new_module));
@@ -4336,7 +4513,7 @@ static ObjectModuleRecord *compile_module_statically(Compiler *compiler, ObjectS
 
 	Compiler imported_compiler = {0};
 	ObjectFunction *module_func = compile(compiler->owner, &imported_compiler, compiler, source);
-	free(result.content);
+	free(source);
 	source = NULL;
 
 	if (module_func != NULL) {
@@ -4422,6 +4599,7 @@ ParseRule rules[] = {
 	[CRUX_TOKEN_AS] = {NULL, type_coerce, NULL, PREC_COERCE},
 	[CRUX_TOKEN_TILDE] = {unary, NULL, NULL, PREC_NONE},
 	[CRUX_TOKEN_IN] = {NULL, binary, NULL, PREC_IN},
+	[CRUX_TOKEN_YIELD] = {NULL, NULL, NULL, PREC_NONE},
 	[CRUX_TOKEN_PANIC] = {NULL, NULL, NULL, PREC_NONE},
 	[CRUX_TOKEN_NIL_TYPE] = {NULL, NULL, NULL, PREC_NONE},
 	[CRUX_TOKEN_BOOL_TYPE] = {NULL, NULL, NULL, PREC_NONE},
@@ -4610,17 +4788,17 @@ static void pre_collect_type(Compiler *compiler)
 
 	// parse_type_record uses the global current compiler and parser.
 	ObjectTypeRecord *resolved_type = parse_type_record(compiler);
-	push(compiler->owner->current_module_record, OBJECT_VAL(resolved_type));
+	push(compiler->owner, OBJECT_VAL(resolved_type));
 
 	// consume ';'
 	if (compiler->parser->current.type == CRUX_TOKEN_SEMICOLON)
 		pre_advance(compiler);
 
 	ObjectString *type_name = copy_string(compiler->owner, name_token.start, name_token.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(type_name));
+	push(compiler->owner, OBJECT_VAL(type_name));
 	type_table_set(compiler->type_table, type_name, resolved_type);
-	pop(compiler->owner->current_module_record); // type_name
-	pop(compiler->owner->current_module_record); // resolved_type
+	pop(compiler->owner); // type_name
+	pop(compiler->owner); // resolved_type
 }
 
 // Collect a single top-level struct declaration into pre_compiler's type_table.
@@ -4639,18 +4817,18 @@ static void pre_collect_struct(Compiler *compiler)
 	pre_advance(compiler); // consume '{'
 
 	ObjectTypeTable *field_types = new_type_table(compiler->owner, INITIAL_TYPE_TABLE_SIZE);
-	push(compiler->owner->current_module_record, OBJECT_VAL(field_types));
+	push(compiler->owner, OBJECT_VAL(field_types));
 	int field_count = 0;
 
 	ObjectString *struct_name = copy_string(compiler->owner, name_token.start, name_token.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(struct_name));
+	push(compiler->owner, OBJECT_VAL(struct_name));
 
 	ObjectStruct *struct_obj = new_struct_type(compiler->owner, struct_name);
-	push(compiler->owner->current_module_record, OBJECT_VAL(struct_obj));
+	push(compiler->owner, OBJECT_VAL(struct_obj));
 
 	// Register the struct type before parsing fields so self-referential fields can resolve during the pre-pass.
 	ObjectTypeRecord *struct_type = new_struct_type_rec(compiler->owner, struct_obj, field_types, 0);
-	push(compiler->owner->current_module_record, OBJECT_VAL(struct_type));
+	push(compiler->owner, OBJECT_VAL(struct_type));
 	type_table_set(compiler->type_table, struct_name, struct_type);
 
 	while (compiler->parser->current.type != CRUX_TOKEN_RIGHT_BRACE &&
@@ -4660,7 +4838,7 @@ static void pre_collect_struct(Compiler *compiler)
 			break;
 		const Token field_tok = compiler->parser->current;
 		ObjectString *field_name = copy_string(compiler->owner, field_tok.start, field_tok.length);
-		push(compiler->owner->current_module_record, OBJECT_VAL(field_name));
+		push(compiler->owner, OBJECT_VAL(field_name));
 		pre_advance(compiler);
 
 		ObjectTypeRecord *field_type = NULL;
@@ -4670,7 +4848,7 @@ static void pre_collect_struct(Compiler *compiler)
 		} else {
 			field_type = T_ANY;
 		}
-		push(compiler->owner->current_module_record, OBJECT_VAL(field_type));
+		push(compiler->owner, OBJECT_VAL(field_type));
 		type_table_set(field_types, field_name, field_type);
 		table_set(compiler->owner, &struct_obj->fields, field_name, INT_VAL(field_count));
 		field_count++;
@@ -4686,19 +4864,22 @@ static void pre_collect_struct(Compiler *compiler)
 
 	struct_type->as.struct_type.field_count = field_count;
 
-	pop(compiler->owner->current_module_record); // struct type
+	pop(compiler->owner); // struct type
 	for (int i = 0; i < field_count; i++) {
-		pop(compiler->owner->current_module_record); // field type
-		pop(compiler->owner->current_module_record); // field name
+		pop(compiler->owner); // field type
+		pop(compiler->owner); // field name
 	}
-	pop(compiler->owner->current_module_record); // struct name
-	pop(compiler->owner->current_module_record); // struct_obj
-	pop(compiler->owner->current_module_record); // field_types
+	pop(compiler->owner); // struct name
+	pop(compiler->owner); // struct_obj
+	pop(compiler->owner); // field_types
 }
 
 // Collect a single top-level function signature into pre_compiler's type_table.
 static void pre_collect_function(Compiler *compiler)
 {
+	const bool is_generator = compiler->parser->current.type == CRUX_TOKEN_STAR;
+	if (is_generator)
+		pre_advance(compiler); // consume '*'
 	if (compiler->parser->current.type != CRUX_TOKEN_IDENTIFIER)
 		return;
 	const Token fn_name_token = compiler->parser->current;
@@ -4731,14 +4912,14 @@ static void pre_collect_function(Compiler *compiler)
 		} else {
 			param_type = T_ANY;
 		}
-		push(compiler->owner->current_module_record, OBJECT_VAL(param_type));
+		push(compiler->owner, OBJECT_VAL(param_type));
 
 		if (param_count == param_cap) {
 			const int old_cap = param_cap;
 			param_cap = GROW_CAPACITY(param_cap);
 			ObjectTypeRecord **grown = GROW_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, old_cap, param_cap);
 			if (!grown) {
-				pop(compiler->owner->current_module_record);
+				pop(compiler->owner);
 				FREE_ARRAY(compiler->owner, ObjectTypeRecord *, param_types, old_cap);
 				return;
 			}
@@ -4763,21 +4944,26 @@ static void pre_collect_function(Compiler *compiler)
 	} else {
 		return_type = T_ANY;
 	}
-	push(compiler->owner->current_module_record, OBJECT_VAL(return_type));
+	if (is_generator) {
+		push(compiler->owner, OBJECT_VAL(return_type));
+		return_type = new_iterator_type_rec(compiler->owner, return_type);
+		pop(compiler->owner);
+	}
+	push(compiler->owner, OBJECT_VAL(return_type));
 
 	ObjectTypeRecord *fn_type = new_function_type_rec(compiler->owner, param_types, param_count, return_type);
-	push(compiler->owner->current_module_record, OBJECT_VAL(fn_type));
+	push(compiler->owner, OBJECT_VAL(fn_type));
 	ObjectString *fn_name = copy_string(compiler->owner, fn_name_token.start, fn_name_token.length);
-	push(compiler->owner->current_module_record, OBJECT_VAL(fn_name));
+	push(compiler->owner, OBJECT_VAL(fn_name));
 	type_table_set(compiler->type_table, fn_name, fn_type);
 
 	// Skip the function body
 	pre_skip_block(compiler);
-	pop(compiler->owner->current_module_record); // fn_name
-	pop(compiler->owner->current_module_record); // fn_type
-	pop(compiler->owner->current_module_record); // return type
+	pop(compiler->owner); // fn_name
+	pop(compiler->owner); // fn_type
+	pop(compiler->owner); // return type
 	for (int i = 0; i < param_count; i++) {
-		pop(compiler->owner->current_module_record); // param_type
+		pop(compiler->owner); // param_type
 	}
 }
 
@@ -4827,7 +5013,9 @@ static void pre_scan_pass(Compiler *compiler, const bool collect_structs)
 			if (!collect_structs) {
 				pre_collect_function(compiler);
 			} else {
-				// Skip: name + parens + optional ->T + block
+				// Skip: optional '*' + name + parens + optional ->T + block
+				if (compiler->parser->current.type == CRUX_TOKEN_STAR)
+					pre_advance(compiler);
 				if (compiler->parser->current.type == CRUX_TOKEN_IDENTIFIER)
 					pre_advance(compiler);
 				pre_skip_parens(compiler);
@@ -4846,6 +5034,8 @@ static void pre_scan_pass(Compiler *compiler, const bool collect_structs)
 				if (!collect_structs) {
 					pre_collect_function(compiler);
 				} else {
+					if (compiler->parser->current.type == CRUX_TOKEN_STAR)
+						pre_advance(compiler);
 					if (compiler->parser->current.type == CRUX_TOKEN_IDENTIFIER)
 						pre_advance(compiler);
 					pre_skip_parens(compiler);
@@ -4903,7 +5093,7 @@ static void pre_scan(Compiler *compiler, char *source, ObjectTypeTable *dest)
 
 	pre_scan_pass(&pre_compiler_structs, true);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(pre_compiler_structs.type_table));
+	push(compiler->owner, OBJECT_VAL(pre_compiler_structs.type_table));
 	compiler->enclosed = NULL;
 	free(pre_compiler_structs.parser->scanner);
 	free(pre_compiler_structs.parser);
@@ -4919,7 +5109,7 @@ static void pre_scan(Compiler *compiler, char *source, ObjectTypeTable *dest)
 
 	pre_scan_pass(&pre_compiler_fns, false);
 
-	push(compiler->owner->current_module_record, OBJECT_VAL(pre_compiler_fns.type_table));
+	push(compiler->owner, OBJECT_VAL(pre_compiler_fns.type_table));
 	compiler->enclosed = NULL;
 	free(pre_compiler_fns.parser->scanner);
 	free(pre_compiler_fns.parser);
@@ -4927,8 +5117,8 @@ static void pre_scan(Compiler *compiler, char *source, ObjectTypeTable *dest)
 	type_table_add_all(pre_compiler_structs.type_table, dest);
 	type_table_add_all(pre_compiler_fns.type_table, dest);
 
-	pop(compiler->owner->current_module_record); // pre_compiler_fns.type_table
-	pop(compiler->owner->current_module_record); // pre_compiler_structs.type_table
+	pop(compiler->owner); // pre_compiler_fns.type_table
+	pop(compiler->owner); // pre_compiler_structs.type_table
 }
 
 /**
@@ -4961,7 +5151,7 @@ ObjectFunction *compile(VM *vm, Compiler *compiler, Compiler *enclosing, char *s
 
 	// Run pre-scan, merging into a temporary staging table.
 	ObjectTypeTable *staging = new_type_table(vm, INITIAL_TYPE_TABLE_SIZE);
-	push(vm->current_module_record, OBJECT_VAL(staging));
+	push(vm, OBJECT_VAL(staging));
 	pre_scan(compiler, source, staging);
 
 	for (int i = 0; i < staging->capacity; i++) {
@@ -4970,7 +5160,7 @@ ObjectFunction *compile(VM *vm, Compiler *compiler, Compiler *enclosing, char *s
 			continue;
 		type_table_set(compiler->type_table, entry->key, entry->value);
 	}
-	pop(vm->current_module_record); // staging table
+	pop(vm); // staging table
 
 	// Main compiler pass
 	init_scanner(compiler->parser->scanner, source);
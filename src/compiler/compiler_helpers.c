@@ -248,8 +248,11 @@ int emit_jump(const Compiler *compiler, const uint16_t instruction)
 	return current_chunk(compiler)->count - 1;
 }
 
-void patch_jump(const Compiler *compiler, const int offset)
+void patch_jump(Compiler *compiler, const int offset)
 {
+	// the value reaching a jump target may come from another branch, so it can no longer be reused in place
+	compiler->temporary_end = -1;
+
 	// -1 to adjust for the bytecode for the jump offset itself
 	const int jump = current_chunk(compiler)->count - offset - 1;
 	if (jump > UINT16_MAX) {
@@ -361,9 +364,17 @@ void begin_scope(Compiler *compiler)
 
 void cleanupLocalsToDepth(Compiler *compiler, const int targetDepth)
 {
+	int first_slot = compiler->local_count;
+	while (first_slot > 0 && compiler->locals[first_slot - 1].depth > targetDepth) {
+		first_slot--;
+	}
+	resolve_capture_sites(compiler, first_slot);
+
 	uint16_t to_pop_count = 0;
 	while (compiler->local_count > 0 && compiler->locals[compiler->local_count - 1].depth > targetDepth) {
-		if (compiler->locals[compiler->local_count - 1].is_captured) {
+		const Local *local = &compiler->locals[compiler->local_count - 1];
+		// locals that were only copied into closures have no open upvalue to close
+		if (local->is_captured && local->capture_by_reference) {
 			if (to_pop_count > 0) {
 				if (to_pop_count == 1) {
 					emit_word(compiler, OP_POP);
@@ -371,6 +382,7 @@ void cleanupLocalsToDepth(Compiler *compiler, const int targetDepth)
 					emit_words(compiler, OP_POP_N, to_pop_count);
 				}
 			}
+			to_pop_count = 0;
 			emit_word(compiler, OP_CLOSE_UPVALUE);
 		} else {
 			to_pop_count++;
@@ -498,6 +510,49 @@ int resolve_upvalue(Compiler *compiler, Token *name)
 	return -1;
 }
 
+void mark_assigned(Compiler *compiler, const uint16_t set_op, const int arg)
+{
+	if (set_op == OP_SET_LOCAL) {
+		compiler->locals[arg].capture_by_reference = true;
+		return;
+	}
+	if (set_op != OP_SET_UPVALUE) {
+		return;
+	}
+	// follow the upvalue to the function that owns the local
+	const Upvalue *upvalue = &compiler->upvalues[arg];
+	while (!upvalue->is_local) {
+		compiler = compiler->enclosing;
+		upvalue = &compiler->upvalues[upvalue->index];
+	}
+	compiler->enclosing->locals[upvalue->index].capture_by_reference = true;
+}
+
+void record_capture_site(Compiler *compiler, const int offset, const int slot)
+{
+	if (compiler->capture_site_count == UINT8_COUNT) {
+		compiler->locals[slot].capture_by_reference = true;
+		return;
+	}
+	compiler->capture_sites[compiler->capture_site_count++] = offset;
+}
+
+void resolve_capture_sites(Compiler *compiler, const int first_slot)
+{
+	uint16_t *code = current_chunk(compiler)->code;
+	int kept = 0;
+	for (int i = 0; i < compiler->capture_site_count; i++) {
+		const int offset = compiler->capture_sites[i];
+		const uint16_t slot = code[offset + 1];
+		if (slot < first_slot) {
+			compiler->capture_sites[kept++] = offset;
+		} else if (!compiler->locals[slot].capture_by_reference) {
+			code[offset] = CAPTURE_LOCAL_VALUE;
+		}
+	}
+	compiler->capture_site_count = kept;
+}
+
 void add_local(Compiler *compiler, const Token name, ObjectTypeRecord *type)
 {
 	if (compiler->local_count == UINT16_MAX) {
@@ -509,6 +564,7 @@ void add_local(Compiler *compiler, const Token name, ObjectTypeRecord *type)
 	local->name = name;
 	local->depth = -1;
 	local->is_captured = false;
+	local->capture_by_reference = false;
 	local->type = type; // NULL until the initializer is complete
 }
 
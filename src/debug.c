@@ -7,6 +7,181 @@
 
 #include "object.h"
 
+static const char *opcode_names[] = {
+	[OP_RETURN] = "OP_RETURN",
+	[OP_CONSTANT] = "OP_CONSTANT",
+	[OP_NIL] = "OP_NIL",
+	[OP_TRUE] = "OP_TRUE",
+	[OP_FALSE] = "OP_FALSE",
+	[OP_NEGATE] = "OP_NEGATE",
+	[OP_EQUAL] = "OP_EQUAL",
+	[OP_GREATER] = "OP_GREATER",
+	[OP_LESS] = "OP_LESS",
+	[OP_LESS_EQUAL] = "OP_LESS_EQUAL",
+	[OP_GREATER_EQUAL] = "OP_GREATER_EQUAL",
+	[OP_NOT_EQUAL] = "OP_NOT_EQUAL",
+	[OP_ADD] = "OP_ADD",
+	[OP_NOT] = "OP_NOT",
+	[OP_SUBTRACT] = "OP_SUBTRACT",
+	[OP_MULTIPLY] = "OP_MULTIPLY",
+	[OP_DIVIDE] = "OP_DIVIDE",
+	[OP_POP] = "OP_POP",
+	[OP_DEFINE_GLOBAL] = "OP_DEFINE_GLOBAL",
+	[OP_GET_GLOBAL] = "OP_GET_GLOBAL",
+	[OP_SET_GLOBAL] = "OP_SET_GLOBAL",
+	[OP_GET_LOCAL] = "OP_GET_LOCAL",
+	[OP_SET_LOCAL] = "OP_SET_LOCAL",
+	[OP_JUMP_IF_FALSE] = "OP_JUMP_IF_FALSE",
+	[OP_JUMP] = "OP_JUMP",
+	[OP_LOOP] = "OP_LOOP",
+	[OP_CALL] = "OP_CALL",
+	[OP_CLOSURE] = "OP_CLOSURE",
+	[OP_GET_UPVALUE] = "OP_GET_UPVALUE",
+	[OP_SET_UPVALUE] = "OP_SET_UPVALUE",
+	[OP_CLOSE_UPVALUE] = "OP_CLOSE_UPVALUE",
+	[OP_GET_PROPERTY] = "OP_GET_PROPERTY",
+	[OP_SET_PROPERTY] = "OP_SET_PROPERTY",
+	[OP_INVOKE] = "OP_INVOKE",
+	[OP_ARRAY] = "OP_ARRAY",
+	[OP_GET_COLLECTION] = "OP_GET_COLLECTION",
+	[OP_SET_COLLECTION] = "OP_SET_COLLECTION",
+	[OP_MODULUS] = "OP_MODULUS",
+	[OP_LEFT_SHIFT] = "OP_LEFT_SHIFT",
+	[OP_RIGHT_SHIFT] = "OP_RIGHT_SHIFT",
+	[OP_SET_LOCAL_SLASH] = "OP_SET_LOCAL_SLASH",
+	[OP_SET_LOCAL_STAR] = "OP_SET_LOCAL_STAR",
+	[OP_SET_LOCAL_PLUS] = "OP_SET_LOCAL_PLUS",
+	[OP_SET_LOCAL_MINUS] = "OP_SET_LOCAL_MINUS",
+	[OP_SET_UPVALUE_SLASH] = "OP_SET_UPVALUE_SLASH",
+	[OP_SET_UPVALUE_STAR] = "OP_SET_UPVALUE_STAR",
+	[OP_SET_UPVALUE_PLUS] = "OP_SET_UPVALUE_PLUS",
+	[OP_SET_UPVALUE_MINUS] = "OP_SET_UPVALUE_MINUS",
+	[OP_SET_GLOBAL_SLASH] = "OP_SET_GLOBAL_SLASH",
+	[OP_SET_GLOBAL_STAR] = "OP_SET_GLOBAL_STAR",
+	[OP_SET_GLOBAL_PLUS] = "OP_SET_GLOBAL_PLUS",
+	[OP_SET_GLOBAL_MINUS] = "OP_SET_GLOBAL_MINUS",
+	[OP_TABLE] = "OP_TABLE",
+	[OP_SET] = "OP_SET",
+	[OP_TUPLE] = "OP_TUPLE",
+	[OP_RANGE] = "OP_RANGE",
+	[OP_ANON_FUNCTION] = "OP_ANON_FUNCTION",
+	[OP_PUB] = "OP_PUB",
+	[OP_MATCH] = "OP_MATCH",
+	[OP_MATCH_JUMP] = "OP_MATCH_JUMP",
+	[OP_MATCH_END] = "OP_MATCH_END",
+	[OP_RESULT_MATCH_OK] = "OP_RESULT_MATCH_OK",
+	[OP_RESULT_MATCH_ERR] = "OP_RESULT_MATCH_ERR",
+	[OP_RESULT_BIND] = "OP_RESULT_BIND",
+	[OP_GIVE] = "OP_GIVE",
+	[OP_INT_DIVIDE] = "OP_INT_DIVIDE",
+	[OP_POWER] = "OP_POWER",
+	[OP_SET_GLOBAL_INT_DIVIDE] = "OP_SET_GLOBAL_INT_DIVIDE",
+	[OP_SET_GLOBAL_MODULUS] = "OP_SET_GLOBAL_MODULUS",
+	[OP_SET_LOCAL_INT_DIVIDE] = "OP_SET_LOCAL_INT_DIVIDE",
+	[OP_SET_LOCAL_MODULUS] = "OP_SET_LOCAL_MODULUS",
+	[OP_SET_UPVALUE_INT_DIVIDE] = "OP_SET_UPVALUE_INT_DIVIDE",
+	[OP_SET_UPVALUE_MODULUS] = "OP_SET_UPVALUE_MODULUS",
+	[OP_USE_MODULE] = "OP_USE_MODULE",
+	[OP_FINISH_USE] = "OP_FINISH_USE",
+	[OP_TYPEOF] = "OP_TYPEOF",
+	[OP_STRUCT] = "OP_STRUCT",
+	[OP_STRUCT_INSTANCE_START] = "OP_STRUCT_INSTANCE_START",
+	[OP_STRUCT_NAMED_FIELD] = "OP_STRUCT_NAMED_FIELD",
+	[OP_STRUCT_INSTANCE_END] = "OP_STRUCT_INSTANCE_END",
+	[OP_NIL_RETURN] = "OP_NIL_RETURN",
+	[OP_UNWRAP] = "OP_UNWRAP",
+	[OP_PANIC] = "OP_PANIC",
+	[OP_BITWISE_AND] = "OP_BITWISE_AND",
+	[OP_BITWISE_XOR] = "OP_BITWISE_XOR",
+	[OP_BITWISE_OR] = "OP_BITWISE_OR",
+	[OP_METHOD] = "OP_METHOD",
+	[OP_SET_PROPERTY_PLUS] = "OP_SET_PROPERTY_PLUS",
+	[OP_SET_PROPERTY_MINUS] = "OP_SET_PROPERTY_MINUS",
+	[OP_SET_PROPERTY_STAR] = "OP_SET_PROPERTY_STAR",
+	[OP_SET_PROPERTY_SLASH] = "OP_SET_PROPERTY_SLASH",
+	[OP_SET_PROPERTY_INT_DIVIDE] = "OP_SET_PROPERTY_INT_DIVIDE",
+	[OP_SET_PROPERTY_MODULUS] = "OP_SET_PROPERTY_MODULUS",
+	[OP_GET_PROPERTY_INDEX] = "OP_GET_PROPERTY_INDEX",
+	[OP_SET_PROPERTY_INDEX] = "OP_SET_PROPERTY_INDEX",
+	[OP_SET_PROPERTY_PLUS_INDEX] = "OP_SET_PROPERTY_PLUS_INDEX",
+	[OP_SET_PROPERTY_MINUS_INDEX] = "OP_SET_PROPERTY_MINUS_INDEX",
+	[OP_SET_PROPERTY_STAR_INDEX] = "OP_SET_PROPERTY_STAR_INDEX",
+	[OP_SET_PROPERTY_SLASH_INDEX] = "OP_SET_PROPERTY_SLASH_INDEX",
+	[OP_SET_PROPERTY_INT_DIVIDE_INDEX] = "OP_SET_PROPERTY_INT_DIVIDE_INDEX",
+	[OP_SET_PROPERTY_MODULUS_INDEX] = "OP_SET_PROPERTY_MODULUS_INDEX",
+	[OP_BITWISE_NOT] = "OP_BITWISE_NOT",
+	[OP_TYPE_COERCE] = "OP_TYPE_COERCE",
+	[OP_GET_SLICE] = "OP_GET_SLICE",
+	[OP_IN] = "OP_IN",
+	[OP_ITER_INIT] = "OP_ITER_INIT",
+	[OP_ITER_NEXT] = "OP_ITER_NEXT",
+	[OP_OK] = "OP_OK",
+	[OP_ERR] = "OP_ERR",
+	[OP_SOME] = "OP_SOME",
+	[OP_NONE] = "OP_NONE",
+	[OP_OPTION_MATCH_SOME] = "OP_OPTION_MATCH_SOME",
+	[OP_OPTION_MATCH_NONE] = "OP_OPTION_MATCH_NONE",
+	[OP_TYPE_MATCH] = "OP_TYPE_MATCH",
+	[OP_ADD_INT] = "OP_ADD_INT",
+	[OP_ADD_NUM] = "OP_ADD_NUM",
+	[OP_SUBTRACT_INT] = "OP_SUBTRACT_INT",
+	[OP_SUBTRACT_NUM] = "OP_SUBTRACT_NUM",
+	[OP_MULTIPLY_INT] = "OP_MULTIPLY_INT",
+	[OP_MULTIPLY_NUM] = "OP_MULTIPLY_NUM",
+	[OP_DIVIDE_NUM] = "OP_DIVIDE_NUM",
+	[OP_INT_DIVIDE_INT] = "OP_INT_DIVIDE_INT",
+	[OP_MODULUS_INT] = "OP_MODULUS_INT",
+	[OP_POWER_INT] = "OP_POWER_INT",
+	[OP_POWER_NUM] = "OP_POWER_NUM",
+	[OP_ADD_VECTOR_VECTOR] = "OP_ADD_VECTOR_VECTOR",
+	[OP_SUBTRACT_VECTOR_VECTOR] = "OP_SUBTRACT_VECTOR_VECTOR",
+	[OP_MULTIPLY_VECTOR_VECTOR] = "OP_MULTIPLY_VECTOR_VECTOR",
+	[OP_DIVIDE_VECTOR_VECTOR] = "OP_DIVIDE_VECTOR_VECTOR",
+	[OP_MULTIPLY_VECTOR_SCALAR] = "OP_MULTIPLY_VECTOR_SCALAR",
+	[OP_MULTIPLY_SCALAR_VECTOR] = "OP_MULTIPLY_SCALAR_VECTOR",
+	[OP_DIVIDE_VECTOR_SCALAR] = "OP_DIVIDE_VECTOR_SCALAR",
+	[OP_ADD_COMPLEX_COMPLEX] = "OP_ADD_COMPLEX_COMPLEX",
+	[OP_SUBTRACT_COMPLEX_COMPLEX] = "OP_SUBTRACT_COMPLEX_COMPLEX",
+	[OP_MULTIPLY_COMPLEX_COMPLEX] = "OP_MULTIPLY_COMPLEX_COMPLEX",
+	[OP_DIVIDE_COMPLEX_COMPLEX] = "OP_DIVIDE_COMPLEX_COMPLEX",
+	[OP_MULTIPLY_COMPLEX_SCALAR] = "OP_MULTIPLY_COMPLEX_SCALAR",
+	[OP_MULTIPLY_SCALAR_COMPLEX] = "OP_MULTIPLY_SCALAR_COMPLEX",
+	[OP_DIVIDE_COMPLEX_SCALAR] = "OP_DIVIDE_COMPLEX_SCALAR",
+	[OP_ADD_MATRIX_MATRIX] = "OP_ADD_MATRIX_MATRIX",
+	[OP_SUBTRACT_MATRIX_MATRIX] = "OP_SUBTRACT_MATRIX_MATRIX",
+	[OP_ADD_MATRIX_SCALAR] = "OP_ADD_MATRIX_SCALAR",
+	[OP_ADD_SCALAR_MATRIX] = "OP_ADD_SCALAR_MATRIX",
+	[OP_SUBTRACT_MATRIX_SCALAR] = "OP_SUBTRACT_MATRIX_SCALAR",
+	[OP_SUBTRACT_SCALAR_MATRIX] = "OP_SUBTRACT_SCALAR_MATRIX",
+	[OP_MULTIPLY_MATRIX_MATRIX] = "OP_MULTIPLY_MATRIX_MATRIX",
+	[OP_MULTIPLY_MATRIX_SCALAR] = "OP_MULTIPLY_MATRIX_SCALAR",
+	[OP_MULTIPLY_SCALAR_MATRIX] = "OP_MULTIPLY_SCALAR_MATRIX",
+	[OP_DIVIDE_MATRIX_SCALAR] = "OP_DIVIDE_MATRIX_SCALAR",
+	[OP_INVOKE_STDLIB] = "OP_INVOKE_STDLIB",
+	[OP_INVOKE_STDLIB_UNWRAP] = "OP_INVOKE_STDLIB_UNWRAP",
+	[OP_POP_N] = "OP_POP_N",
+	[OP_DEFINE_PUB_GLOBAL] = "OP_DEFINE_PUB_GLOBAL",
+	[OP_0_INT] = "OP_0_INT",
+	[OP_1_INT] = "OP_1_INT",
+	[OP_2_INT] = "OP_2_INT",
+	[OP_0_FLOAT] = "OP_0_FLOAT",
+	[OP_1_FLOAT] = "OP_1_FLOAT",
+	[OP_2_FLOAT] = "OP_2_FLOAT",
+	[OP_YIELD] = "OP_YIELD",
+	[OP_NEW_STRUCT] = "OP_NEW_STRUCT",
+	[OP_TAIL_CALL] = "OP_TAIL_CALL",
+};
+
+_Static_assert(sizeof(opcode_names) / sizeof(opcode_names[0]) == OP_COUNT, "every opcode needs a name");
+
+const char *opcode_name(const int opcode)
+{
+	if (opcode < 0 || opcode >= OP_COUNT || opcode_names[opcode] == NULL) {
+		return "OP_UNKNOWN";
+	}
+	return opcode_names[opcode];
+}
+
 void disassemble_chunk(const Chunk *chunk, const char *name)
 {
 	printf("======= %s =======\n", name);
@@ -91,6 +266,28 @@ static int constant_instruction(const char *name, const Chunk *chunk, const int
 	return offset + 2; // +2 because OP_CONSTANT is two bytes
 }
 
+/**
+ * @brief Prints an instruction that creates a closure, followed by one line per captured variable
+ * @return The offset after the capture operands
+ */
+static int closure_instruction(const char *name, const Chunk *chunk, int offset)
+{
+	offset++;
+	const uint16_t constant = chunk->code[offset++];
+	printf("%-16s %4d ", name, constant);
+	print_value(chunk->constants.values[constant], false);
+	printf("\n");
+
+	const ObjectFunction *function = AS_CRUX_FUNCTION(chunk->constants.values[constant]);
+	for (int j = 0; j < function->upvalue_count; j++) {
+		const int capture = chunk->code[offset++];
+		const int index = chunk->code[offset++];
+		const char *kind = capture == CAPTURE_LOCAL ? "local" : capture == CAPTURE_LOCAL_VALUE ? "value" : "upvalue";
+		printf("%04d      |                     %s %d\n", offset - 2, kind, index);
+	}
+	return offset;
+}
+
 static int inline_arg_instruction(const char *name, const Chunk *chunk, const int offset)
 {
 	const uint16_t arg = chunk->code[offset + 1];
@@ -198,25 +395,14 @@ int disassemble_instruction(const Chunk *chunk, int offset)
 		return jump_instruction("OP_LOOP", -1, chunk, offset);
 	case OP_CALL:
 		return byte_instruction("OP_CALL", chunk, offset);
+	case OP_TAIL_CALL:
+		return byte_instruction("OP_TAIL_CALL", chunk, offset);
 	case OP_GET_UPVALUE:
 		return byte_instruction("OP_GET_UPVALUE", chunk, offset);
 	case OP_SET_UPVALUE:
 		return byte_instruction("OP_SET_UPVALUE", chunk, offset);
-	case OP_CLOSURE: {
-		offset++;
-		const uint16_t constant = chunk->code[offset++];
-		printf("%-16s %4d ", "OP_CLOSURE", constant);
-		print_value(chunk->constants.values[constant], false);
-		printf("\n");
-
-		const ObjectFunction *function = AS_CRUX_FUNCTION(chunk->constants.values[constant]);
-		for (int j = 0; j < function->upvalue_count; j++) {
-			const int isLocal = chunk->code[offset++];
-			const int index = chunk->code[offset++];
-			printf("%04d      |                     %s %d\n", offset - 2, isLocal ? "local" : "upvalue", index);
-		}
-		return offset;
-	}
+	case OP_CLOSURE:
+		return closure_instruction("OP_CLOSURE", chunk, offset);
 	case OP_CLOSE_UPVALUE:
 		return simple_instruction("OP_CLOSE_UPVALUE", offset);
 	case OP_GET_PROPERTY:
@@ -294,7 +480,7 @@ int disassemble_instruction(const Chunk *chunk, int offset)
 		return inline_arg_instruction("OP_SET_UPVALUE_MODULUS", chunk, offset);
 	}
 	case OP_ANON_FUNCTION: {
-		return constant_instruction("OP_ANON_FUNCTION", chunk, offset);
+		return closure_instruction("OP_ANON_FUNCTION", chunk, offset);
 	}
 	case OP_USE_MODULE: {
 		return constant_instruction("OP_USE_MODULE", chunk, offset);
@@ -485,46 +671,46 @@ int disassemble_instruction(const Chunk *chunk, int offset)
 		return simple_instruction("OP_POWER_NUM", offset);
 	}
 	case OP_ADD_VECTOR_VECTOR: {
-		return simple_instruction("OP_ADD_VECTOR_VECTOR", offset);
+		return inline_arg_instruction("OP_ADD_VECTOR_VECTOR", chunk, offset);
 	}
 	case OP_SUBTRACT_VECTOR_VECTOR: {
-		return simple_instruction("OP_SUBTRACT_VECTOR_VECTOR", offset);
+		return inline_arg_instruction("OP_SUBTRACT_VECTOR_VECTOR", chunk, offset);
 	}
 	case OP_MULTIPLY_VECTOR_VECTOR: {
-		return simple_instruction("OP_MULTIPLY_VECTOR_VECTOR", offset);
+		return inline_arg_instruction("OP_MULTIPLY_VECTOR_VECTOR", chunk, offset);
 	}
 	case OP_DIVIDE_VECTOR_VECTOR: {
-		return simple_instruction("OP_DIVIDE_VECTOR_VECTOR", offset);
+		return inline_arg_instruction("OP_DIVIDE_VECTOR_VECTOR", chunk, offset);
 	}
 	case OP_MULTIPLY_VECTOR_SCALAR: {
-		return simple_instruction("OP_MULTIPLY_VECTOR_SCALAR", offset);
+		return inline_arg_instruction("OP_MULTIPLY_VECTOR_SCALAR", chunk, offset);
 	}
 	case OP_MULTIPLY_SCALAR_VECTOR: {
-		return simple_instruction("OP_MULTIPLY_SCALAR_VECTOR", offset);
+		return inline_arg_instruction("OP_MULTIPLY_SCALAR_VECTOR", chunk, offset);
 	}
 	case OP_DIVIDE_VECTOR_SCALAR: {
-		return simple_instruction("OP_DIVIDE_VECTOR_SCALAR", offset);
+		return inline_arg_instruction("OP_DIVIDE_VECTOR_SCALAR", chunk, offset);
 	}
 	case OP_ADD_COMPLEX_COMPLEX: {
-		return simple_instruction("OP_ADD_COMPLEX_COMPLEX", offset);
+		return inline_arg_instruction("OP_ADD_COMPLEX_COMPLEX", chunk, offset);
 	}
 	case OP_SUBTRACT_COMPLEX_COMPLEX: {
-		return simple_instruction("OP_SUBTRACT_COMPLEX_COMPLEX", offset);
+		return inline_arg_instruction("OP_SUBTRACT_COMPLEX_COMPLEX", chunk, offset);
 	}
 	case OP_MULTIPLY_COMPLEX_COMPLEX: {
-		return simple_instruction("OP_MULTIPLY_COMPLEX_COMPLEX", offset);
+		return inline_arg_instruction("OP_MULTIPLY_COMPLEX_COMPLEX", chunk, offset);
 	}
 	case OP_DIVIDE_COMPLEX_COMPLEX: {
-		return simple_instruction("OP_DIVIDE_COMPLEX_COMPLEX", offset);
+		return inline_arg_instruction("OP_DIVIDE_COMPLEX_COMPLEX", chunk, offset);
 	}
 	case OP_MULTIPLY_COMPLEX_SCALAR: {
-		return simple_instruction("OP_MULTIPLY_COMPLEX_SCALAR", offset);
+		return inline_arg_instruction("OP_MULTIPLY_COMPLEX_SCALAR", chunk, offset);
 	}
 	case OP_MULTIPLY_SCALAR_COMPLEX: {
-		return simple_instruction("OP_MULTIPLY_SCALAR_COMPLEX", offset);
+		return inline_arg_instruction("OP_MULTIPLY_SCALAR_COMPLEX", chunk, offset);
 	}
 	case OP_DIVIDE_COMPLEX_SCALAR: {
-		return simple_instruction("OP_DIVIDE_COMPLEX_SCALAR", offset);
+		return inline_arg_instruction("OP_DIVIDE_COMPLEX_SCALAR", chunk, offset);
 	}
 	case OP_ADD_MATRIX_MATRIX: {
 		return simple_instruction("OP_ADD_MATRIX_MATRIX", offset);
@@ -591,6 +777,11 @@ int disassemble_instruction(const Chunk *chunk, int offset)
 	case OP_2_FLOAT: {
 		return simple_instruction("OP_2_FLOAT", offset);
 	}
+	case OP_YIELD: {
+		return simple_instruction("OP_YIELD", offset);
+	}
+	case OP_NEW_STRUCT:
+		return inline_arg_instruction("OP_NEW_STRUCT", chunk, offset);
 	default:
 		printf("Unknown opcode %d\n", instruction);
 		return offset + 1;
@@ -7,6 +7,8 @@
 #ifndef _WIN32
 #include "linenoise.h"
 #endif
+#include "heap_profiler.h"
+#include "profiler.h"
 #include "vm.h"
 
 static int repl(VM *vm)
@@ -84,15 +86,88 @@ static int runFile(VM *vm, const char *path)
 	return 0;
 }
 
+/**
+ * Runs the file under the sampling profiler and writes <prefix>.folded and <prefix>.pprof once it finishes.
+ */
+static int profileFile(VM *vm, const char *path, const char *prefix)
+{
+	const char *error = NULL;
+	if (!profiler_start(vm, PROFILER_DEFAULT_HZ, &error)) {
+		fprintf(stderr, "Error starting profiler: %s\n", error);
+		return 1;
+	}
+	const int exit_code = runFile(vm, path);
+	if (!profiler_stop(vm, prefix, &error)) {
+		fprintf(stderr, "Error writing profile: %s\n", error);
+		return exit_code != 0 ? exit_code : 1;
+	}
+	fprintf(stderr, "Profile written to %s.folded and %s.pprof\n", prefix, prefix);
+	return exit_code;
+}
+
+/**
+ * Runs the file under the heap profiler and writes <prefix>.folded and <prefix>.census once it finishes.
+ */
+static int heapProfileFile(VM *vm, const char *path, const char *prefix)
+{
+	const char *error = NULL;
+	if (!heap_profiler_start(vm, HEAP_PROFILER_DEFAULT_SAMPLE_BYTES, &error)) {
+		fprintf(stderr, "Error starting heap profiler: %s\n", error);
+		return 1;
+	}
+	const int exit_code = runFile(vm, path);
+	if (!heap_profiler_stop(vm, prefix, &error)) {
+		fprintf(stderr, "Error writing heap profile: %s\n", error);
+		return exit_code != 0 ? exit_code : 1;
+	}
+	fprintf(stderr, "Heap profile written to %s.folded and %s.census\n", prefix, prefix);
+	return exit_code;
+}
+
+/**
+ * Returns the output prefix of a "<flag>[=prefix]" argument, <default_prefix> when none is given, or NULL if <arg>
+ * is a different argument.
+ */
+static const char *profileFlagPrefix(const char *arg, const char *flag, const char *default_prefix)
+{
+	const size_t length = strlen(flag);
+	if (strncmp(arg, flag, length) != 0) {
+		return NULL;
+	}
+	if (arg[length] == '\0') {
+		return default_prefix;
+	}
+	return arg[length] == '=' ? arg + length + 1 : NULL;
+}
+
 /**
  * Initializes the virtual machine and either:
  * - Starts a REPL session if no arguments are provided
  * - Executes a source file if one argument (file path) is provided
+ * - Executes a source file under the sampling profiler with --profile[=prefix] <path>
+ * - Executes a source file under the heap profiler with --heap-profile[=prefix] <path>
  * - Displays usage information otherwise
  *
  */
 int main(const int argc, const char *argv[])
 {
+	if (argc == 3) {
+		const char *cpu_prefix = profileFlagPrefix(argv[1], "--profile", "crux-profile");
+		const char *heap_prefix = profileFlagPrefix(argv[1], "--heap-profile", "crux-heap-profile");
+		if (cpu_prefix != NULL || heap_prefix != NULL) {
+			// the script sees the same arguments as an unprofiled run
+			const char *script_argv[] = {argv[0], argv[2]};
+			VM *vm = new_vm(2, script_argv);
+			if (vm == NULL) {
+				return 1;
+			}
+			const int exit_code = cpu_prefix != NULL ? profileFile(vm, argv[2], cpu_prefix)
+													 : heapProfileFile(vm, argv[2], heap_prefix);
+			free_vm(vm);
+			return exit_code;
+		}
+	}
+
 	VM *vm = new_vm(argc, argv);
 	if (vm == NULL) {
 		return 1;
@@ -115,9 +190,9 @@ int main(const int argc, const char *argv[])
 		}
 	} else {
 #ifdef _WIN32
-		fprintf(stderr, "Usage: & .\\[crux.exe] [path]\n");
+		fprintf(stderr, "Usage: & .\\[crux.exe] [--profile[=prefix] | --heap-profile[=prefix]] [path]\n");
 #else
-		fprintf(stderr, "Usage: ./[crux] [path]\n");
+		fprintf(stderr, "Usage: ./[crux] [--profile[=prefix] | --heap-profile[=prefix]] [path]\n");
 #endif
 		exit_code = 64;
 	}
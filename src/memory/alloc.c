@@ -2,12 +2,63 @@
 #include <stdlib.h>
 
 #include "alloc.h"
+#include "function_stats.h"
 #include "garbage_collector.h"
+#include "heap_profiler.h"
 #include "object.h"
 #include "panic.h"
 #include "slab_allocator.h"
 #include "vm.h"
 
+// set on the background sweeper thread while it frees dead objects
+static _Thread_local SweptMemory *swept_memory = NULL;
+
+void collect_frees_into(SweptMemory *swept)
+{
+	swept_memory = swept;
+}
+
+static void free_swept_memory(void *ptr, const size_t size)
+{
+	swept_memory->bytes_freed += size;
+
+	int slab = -1;
+	if (size <= 24) {
+		slab = 0;
+	} else if (size <= 32) {
+		slab = 1;
+	} else if (size <= 48) {
+		slab = 2;
+	} else if (size <= 64) {
+		slab = 3;
+	}
+	if (slab < 0) {
+		free(ptr);
+		return;
+	}
+
+	*(void **)ptr = swept_memory->slab_heads[slab];
+	swept_memory->slab_heads[slab] = ptr;
+	if (swept_memory->slab_tails[slab] == NULL) {
+		swept_memory->slab_tails[slab] = ptr;
+	}
+}
+
+void return_swept_memory(VM *vm, SweptMemory *swept)
+{
+	SlabAllocator *slabs[SWEPT_SLAB_COUNT] = {vm->slab_24, vm->slab_32, vm->slab_48, vm->slab_64};
+	for (int i = 0; i < SWEPT_SLAB_COUNT; i++) {
+		if (swept->slab_heads[i] != NULL) {
+			*(void **)swept->slab_tails[i] = slabs[i]->free_list;
+			slabs[i]->free_list = swept->slab_heads[i];
+		}
+		swept->slab_heads[i] = NULL;
+		swept->slab_tails[i] = NULL;
+	}
+	vm->bytes_allocated -= swept->bytes_freed;
+	swept->bytes_freed = 0;
+}
+
 void *alloc_memory(VM *vm, size_t size)
 {
 	if (size == 0)
@@ -31,6 +82,10 @@ void free_memory(VM *vm, void *ptr, const size_t size)
 		fprintf(stderr, "Error: NULL pointer given for memory to free.\n");
 		return;
 	}
+	if (__builtin_expect(swept_memory != NULL, 0)) {
+		free_swept_memory(ptr, size);
+		return;
+	}
 
 	vm->bytes_allocated -= size;
 
@@ -50,16 +105,22 @@ void free_memory(VM *vm, void *ptr, const size_t size)
 void *allocate_object_with_gc(VM *vm, const size_t size)
 {
 	vm->bytes_allocated += size;
+	if (__builtin_expect(vm->function_stats.enabled, 0)) {
+		record_function_allocation(vm, size);
+	}
+	if (__builtin_expect(vm->gc_sweep_pending, 0)) {
+		poll_background_sweep(vm);
+	}
 	if (vm->bytes_allocated > vm->next_gc) {
-		collect_garbage(vm);
+		collect_garbage(vm, GC_TRIGGER_THRESHOLD);
 	}
 	void *result = alloc_memory(vm, size);
 	if (result == NULL) {
-		collect_garbage(vm);
+		collect_garbage(vm, GC_TRIGGER_ALLOCATION_FAILURE);
 		result = alloc_memory(vm, size);
 		if (result == NULL) {
 			if (vm->current_module_record) {
-				runtime_panic(vm->current_module_record, MEMORY, "Failed to allocate %zu bytes.", size);
+				runtime_panic(vm, MEMORY, "Failed to allocate %zu bytes.", size);
 			} else {
 				fprintf(stderr, "Fatal error - Out of Memory: Failed to allocate %zu bytes.\n", size);
 				longjmp(vm->jump_buffer, INTERPRET_RUNTIME_ERROR);
@@ -71,13 +132,24 @@ void *allocate_object_with_gc(VM *vm, const size_t size)
 
 void *reallocate(VM *vm, void *pointer, const size_t oldSize, const size_t newSize)
 {
+	if (newSize == 0 && __builtin_expect(swept_memory != NULL, 0)) {
+		swept_memory->bytes_freed += oldSize;
+		free(pointer);
+		return NULL;
+	}
 	vm->bytes_allocated += newSize - oldSize;
 	if (newSize > oldSize) {
+		if (__builtin_expect(vm->function_stats.enabled, 0)) {
+			record_function_allocation(vm, newSize - oldSize);
+		}
+		if (__builtin_expect(vm->heap_profiler != NULL, 0)) {
+			record_heap_allocation(vm, HEAP_PROFILE_STORAGE, newSize - oldSize);
+		}
 #ifdef DEBUG_STRESS_GC
-		collect_garbage(vm);
+		collect_garbage(vm, GC_TRIGGER_STRESS);
 #endif
 		if (vm->bytes_allocated > vm->next_gc) {
-			collect_garbage(vm);
+			collect_garbage(vm, GC_TRIGGER_THRESHOLD);
 		}
 	}
 
@@ -88,7 +160,7 @@ void *reallocate(VM *vm, void *pointer, const size_t oldSize, const size_t newSi
 
 	void *result = realloc(pointer, newSize);
 	if (result == NULL) {
-		collect_garbage(vm);
+		collect_garbage(vm, GC_TRIGGER_ALLOCATION_FAILURE);
 		result = realloc(pointer, newSize);
 		if (result == NULL) {
 			if (oldSize > 0)
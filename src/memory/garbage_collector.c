@@ -5,9 +5,13 @@
 #include "alloc.h"
 #include "common.h"
 #include "compiler.h"
+#include "function_stats.h"
 #include "garbage_collector.h"
 #include "object.h"
 #include "panic.h"
+#include "gc_events.h"
+#include "heap_profiler.h"
+#include "profiler.h"
 #include "slab_allocator.h"
 #include "table.h"
 #include "value.h"
@@ -20,6 +24,9 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
 #endif
 
 static uint64_t gc_now_ns(void)
@@ -83,16 +90,14 @@ static size_t compute_next_gc_threshold(const VM *vm)
 	return next_gc;
 }
 
-void mark_object_internal(VM *vm, CruxObject *object)
+static void push_gray(VM *vm, CruxObject *object)
 {
-	object_set_marked(object, true);
-
 	if (vm->gray_capacity < vm->gray_count + 1) {
 		vm->gray_capacity = GROW_CAPACITY(vm->gray_capacity);
 		CruxObject **new_objects = realloc(vm->gray_stack, vm->gray_capacity * sizeof(CruxObject *));
 		if (new_objects == NULL) {
 			if (vm->current_module_record)
-				runtime_panic(vm->current_module_record, MEMORY, "Failed to grow gray stack.");
+				runtime_panic(vm, MEMORY, "Failed to grow gray stack.");
 			else
 				longjmp(vm->jump_buffer, 1);
 		}
@@ -107,6 +112,23 @@ void mark_object_internal(VM *vm, CruxObject *object)
 		vm->gc_max_gray_peak = (uint32_t)vm->gray_count;
 }
 
+void mark_object_internal(VM *vm, CruxObject *object)
+{
+	object_set_marked(object, true);
+	push_gray(vm, object);
+}
+
+void defer_mark(VM *vm, CruxObject *object)
+{
+	poll_background_sweep(vm);
+	if (!vm->gc_sweep_pending) {
+		mark_object(vm, object);
+		return;
+	}
+	// the gray stack is empty after tracing, so everything on it now waits for apply_deferred_marks()
+	push_gray(vm, object);
+}
+
 void mark_value(VM *vm, const Value value)
 {
 	if (IS_CRUX_OBJECT(value)) {
@@ -204,6 +226,7 @@ static void blacken_matrix(VM *vm, CruxObject *object);
 static void blacken_type_record(VM *vm, CruxObject *object);
 static void blacken_type_table(VM *vm, CruxObject *object);
 static void blacken_option(VM *vm, CruxObject *object);
+static void blacken_coroutine(VM *vm, CruxObject *object);
 
 static const BlackenFunction blacken_dispatch[] = {
 	[OBJECT_STRING] = blacken_string,
@@ -231,6 +254,7 @@ static const BlackenFunction blacken_dispatch[] = {
 	[OBJECT_MATRIX] = blacken_matrix,
 	[OBJECT_TYPE_RECORD] = blacken_type_record,
 	[OBJECT_TYPE_TABLE] = blacken_type_table,
+	[OBJECT_COROUTINE] = blacken_coroutine,
 };
 
 static void blacken_object(VM *vm, CruxObject *object)
@@ -261,6 +285,7 @@ static void blacken_function(VM *vm, CruxObject *object)
 	const ObjectFunction *function = (ObjectFunction *)object;
 	mark_object(vm, (CruxObject *)function->name);
 	mark_object(vm, (CruxObject *)function->module_record);
+	mark_object(vm, (CruxObject *)function->shared_closure);
 	mark_array(vm, &function->chunk.constants);
 }
 
@@ -303,6 +328,7 @@ static void blacken_iterator(VM *vm, CruxObject *object)
 {
 	const ObjectIterator *iterator = (ObjectIterator *)object;
 	mark_value(vm, iterator->iterable);
+	mark_value(vm, iterator->operand);
 }
 
 static void blacken_result(VM *vm, CruxObject *object)
@@ -321,6 +347,23 @@ static void blacken_option(VM *vm, CruxObject *object)
 	mark_value(vm, option->value);
 }
 
+static void blacken_coroutine(VM *vm, CruxObject *object)
+{
+	const ObjectCoroutine *coroutine = (ObjectCoroutine *)object;
+	mark_object(vm, (CruxObject *)coroutine->closure);
+	mark_object(vm, (CruxObject *)coroutine->resumer);
+	mark_value(vm, coroutine->transfer);
+	for (const Value *slot = coroutine->stack; slot < coroutine->stack_top; slot++) {
+		mark_value(vm, *slot);
+	}
+	for (uint32_t i = 0; i < coroutine->frame_count; i++) {
+		mark_object(vm, (CruxObject *)coroutine->frames[i].closure);
+	}
+	for (ObjectUpvalue *upvalue = coroutine->open_upvalues; upvalue != NULL; upvalue = upvalue->next) {
+		mark_object(vm, (CruxObject *)upvalue);
+	}
+}
+
 static void blacken_random(VM *vm, CruxObject *object)
 {
 	(void)vm;
@@ -342,19 +385,11 @@ static void blacken_module_record(VM *vm, CruxObject *object)
 	mark_table(vm, &module->publics);
 	mark_type_table(vm, module->types);
 	mark_object(vm, (CruxObject *)module->module_closure);
-	mark_object(vm, (CruxObject *)module->enclosing_module);
-	for (uint32_t i = 0; i < module->global_count; i++) {
-		mark_value(vm, module->globals[i]);
-	}
-
-	for (const Value *slot = module->stack; slot < module->stack_top; slot++) {
-		mark_value(vm, *slot);
-	}
-	for (int i = 0; i < module->frame_count; i++) {
-		mark_object(vm, (CruxObject *)module->frames[i].closure);
-	}
-	for (ObjectUpvalue *upvalue = module->open_upvalues; upvalue != NULL; upvalue = upvalue->next) {
-		mark_object(vm, (CruxObject *)upvalue);
+	// statically imported modules know their global count before they first run and allocate the globals
+	if (module->globals != NULL) {
+		for (uint32_t i = 0; i < module->global_count; i++) {
+			mark_value(vm, module->globals[i]);
+		}
 	}
 }
 
@@ -520,6 +555,7 @@ static void free_object_tuple(VM *vm, CruxObject *object);
 static void free_object_matrix(VM *vm, CruxObject *object);
 static void free_object_type_record(VM *vm, CruxObject *object);
 static void free_object_type_table(VM *vm, CruxObject *object);
+static void free_object_coroutine(VM *vm, CruxObject *object);
 
 static const FreeFunction free_dispatch[] = {
 	[OBJECT_STRING] = free_object_string,
@@ -547,6 +583,7 @@ static const FreeFunction free_dispatch[] = {
 	[OBJECT_MATRIX] = free_object_matrix,
 	[OBJECT_TYPE_RECORD] = free_object_type_record,
 	[OBJECT_TYPE_TABLE] = free_object_type_table,
+	[OBJECT_COROUTINE] = free_object_coroutine,
 };
 
 static void free_object_string(VM *vm, CruxObject *object)
@@ -645,8 +682,7 @@ static void free_object_struct(VM *vm, CruxObject *object)
 static void free_object_struct_instance(VM *vm, CruxObject *object)
 {
 	const ObjectStructInstance *instance = (ObjectStructInstance *)object;
-	FREE_ARRAY(vm, Value, instance->fields, instance->field_count);
-	FREE_OBJECT(vm, ObjectStructInstance, object);
+	free_memory(vm, object, STRUCT_INSTANCE_SIZE(instance->field_count));
 }
 
 static void free_object_vector(VM *vm, CruxObject *object)
@@ -735,35 +771,34 @@ static void free_object_type_table(VM *vm, CruxObject *object)
 	FREE_OBJECT(vm, ObjectTypeTable, object);
 }
 
-void mark_module_roots(VM *vm, ObjectModuleRecord *moduleRecord)
+static void free_object_coroutine(VM *vm, CruxObject *object)
 {
-	if (moduleRecord->enclosing_module != NULL) {
-		mark_module_roots(vm, moduleRecord->enclosing_module);
+	const ObjectCoroutine *coroutine = (ObjectCoroutine *)object;
+	if (coroutine->stack != NULL) {
+		FREE_ARRAY(vm, Value, coroutine->stack, coroutine->stack_limit - coroutine->stack);
 	}
-
-	mark_object(vm, (CruxObject *)moduleRecord->path);
-	mark_table(vm, &moduleRecord->global_names);
-	mark_table(vm, &moduleRecord->publics);
-	mark_type_table(vm, moduleRecord->types);
-	mark_object(vm, (CruxObject *)moduleRecord->module_closure);
-	mark_object(vm, (CruxObject *)moduleRecord->enclosing_module);
-	for (uint32_t i = 0; i < moduleRecord->global_count; i++) {
-		mark_value(vm, moduleRecord->globals[i]);
+	if (coroutine->frames != NULL) {
+		FREE_ARRAY(vm, CallFrame, coroutine->frames, coroutine->frame_capacity);
 	}
+	FREE_OBJECT(vm, ObjectCoroutine, object);
+}
 
-	for (const Value *slot = moduleRecord->stack; slot < moduleRecord->stack_top; slot++) {
+/**
+ * Marks the running execution context: the VM stack, or the stack of the coroutine swapped into it.
+ */
+static void mark_stack_roots(VM *vm)
+{
+	for (const Value *slot = vm->stack; slot < vm->stack_top; slot++) {
 		mark_value(vm, *slot);
 	}
 
-	for (int i = 0; i < moduleRecord->frame_count; i++) {
-		mark_object(vm, (CruxObject *)moduleRecord->frames[i].closure);
+	for (uint32_t i = 0; i < vm->frame_count; i++) {
+		mark_object(vm, (CruxObject *)vm->frames[i].closure);
 	}
 
-	for (ObjectUpvalue *upvalue = moduleRecord->open_upvalues; upvalue != NULL; upvalue = upvalue->next) {
+	for (ObjectUpvalue *upvalue = vm->open_upvalues; upvalue != NULL; upvalue = upvalue->next) {
 		mark_object(vm, (CruxObject *)upvalue);
 	}
-
-	mark_object(vm, (CruxObject *)moduleRecord);
 }
 
 void mark_struct_instance_stack(VM *vm, const StructInstanceStack *stack)
@@ -777,9 +812,8 @@ void mark_struct_instance_stack(VM *vm, const StructInstanceStack *stack)
 
 void mark_roots(VM *vm)
 {
-	if (vm->current_module_record) {
-		mark_module_roots(vm, vm->current_module_record);
-	}
+	mark_stack_roots(vm);
+	mark_object(vm, (CruxObject *)vm->current_module_record);
 
 	for (uint32_t i = 0; i < vm->import_stack.count; i++) {
 		mark_object(vm, (CruxObject *)vm->import_stack.paths[i]);
@@ -793,6 +827,11 @@ void mark_roots(VM *vm)
 
 	mark_struct_instance_stack(vm, &vm->struct_instance_stack);
 
+	mark_object(vm, (CruxObject *)vm->current_coroutine);
+	for (uint32_t i = 0; i < vm->event_loop.count; i++) {
+		mark_object(vm, (CruxObject *)vm->event_loop.tasks[i]);
+	}
+
 	if (vm->main_compiler) {
 		mark_compiler_roots(vm, vm->main_compiler);
 	}
@@ -801,6 +840,10 @@ void mark_roots(VM *vm)
 		mark_value(vm, vm->match_handler_stack.handlers[i].match_bind);
 		mark_value(vm, vm->match_handler_stack.handlers[i].match_target);
 	}
+
+	mark_profiler_roots(vm);
+	mark_heap_profiler_roots(vm);
+	mark_function_stats_roots(vm);
 }
 
 static void trace_references(VM *vm)
@@ -811,6 +854,38 @@ static void trace_references(VM *vm)
 	}
 }
 
+/**
+ * Closures may still reference upvalues that point into the stack of a coroutine that is about to be swept. Those
+ * upvalues are closed here, while the marks are still valid, and the coroutine is dropped from the live list.
+ */
+static void close_unreachable_coroutines(VM *vm)
+{
+	bool marked_new_values = false;
+	ObjectCoroutine **link = &vm->coroutines;
+	while (*link != NULL) {
+		ObjectCoroutine *coroutine = *link;
+		if (object_is_marked(&coroutine->object)) {
+			link = &coroutine->next_live;
+			continue;
+		}
+
+		for (ObjectUpvalue *upvalue = coroutine->open_upvalues; upvalue != NULL; upvalue = upvalue->next) {
+			if (object_is_marked(&upvalue->object)) {
+				upvalue->closed = *upvalue->location;
+				upvalue->location = &upvalue->closed;
+				mark_value(vm, upvalue->closed);
+				marked_new_values = true;
+			}
+		}
+		coroutine->open_upvalues = NULL;
+		*link = coroutine->next_live;
+	}
+
+	if (marked_new_values) {
+		trace_references(vm);
+	}
+}
+
 static void free_object(VM *vm, CruxObject *object, bool free_all)
 {
 #ifdef DEBUG_LOG_GC
@@ -824,42 +899,297 @@ static void free_object(VM *vm, CruxObject *object, bool free_all)
 	}
 }
 
-static void sweep(VM *vm)
+typedef struct {
+	CruxObject *survivors; // the marked objects, unmarked again and in their original order
+	CruxObject *survivors_tail;
+	size_t objects_freed;
+	size_t slots_scanned;
+} SweepResult;
+
+/**
+ * Frees the unmarked objects of the list starting at <objects>. Survivors and freed objects are counted by type into
+ * <live_counts> and <freed_counts> unless they are NULL.
+ */
+static void sweep(VM *vm, CruxObject *objects, SweepResult *result, uint32_t *live_counts, uint32_t *freed_counts)
 {
-	size_t slots_scanned = 0;
-	CruxObject *prev = NULL;
-	CruxObject *current = vm->objects;
+	result->survivors = NULL;
+	result->survivors_tail = NULL;
+	result->objects_freed = 0;
+	result->slots_scanned = 0;
 
+	CruxObject *current = objects;
 	while (current != NULL) {
-		slots_scanned++;
+		result->slots_scanned++;
 		CruxObject *next = object_get_next(current);
 
 		if (!object_is_marked(current)) {
-			// Unlink dead object
-			if (prev == NULL)
-				vm->objects = next;
-			else
-				object_set_next(prev, next);
-
+			if (freed_counts != NULL && !object_is_immortal(current)) {
+				freed_counts[object_get_type(current)]++;
+			}
 			free_object(vm, current, false);
-			vm->object_count--;
+			result->objects_freed++;
 		} else {
-			// Unmark and advance
+			// Unmark and relink
 			object_set_marked(current, false);
-			prev = current;
+			if (live_counts != NULL) {
+				live_counts[object_get_type(current)]++;
+			}
+			if (result->survivors_tail == NULL) {
+				result->survivors = current;
+			} else {
+				object_set_next(result->survivors_tail, current);
+			}
+			result->survivors_tail = current;
 		}
 		current = next;
 	}
+	if (result->survivors_tail != NULL) {
+		object_set_next(result->survivors_tail, NULL);
+	}
+}
+
+/**
+ * Puts the survivors of a sweep back in front of the object list and fills in the statistics of the sweep.
+ */
+static void finish_sweep(VM *vm, const SweepResult *result, const size_t bytes_freed, const uint64_t sweep_ns)
+{
+	if (result->survivors_tail != NULL) {
+		object_set_next(result->survivors_tail, vm->objects);
+		vm->objects = result->survivors;
+	}
+	vm->object_count -= result->objects_freed;
 
-	vm->gc_last_sweep_slots_scanned = slots_scanned;
+	vm->gc_last_sweep_slots_scanned = result->slots_scanned;
 	if (vm->gc_last_sweep_slots_scanned > vm->gc_last_objects_before_sweep) {
 		vm->gc_last_sweep_slots_scanned = vm->gc_last_objects_before_sweep;
 	}
-	vm->gc_sweep_slots_scanned += slots_scanned;
+	vm->gc_sweep_slots_scanned += result->slots_scanned;
+	vm->gc_last_objects_after_sweep = vm->gc_last_objects_before_sweep - result->objects_freed;
+	vm->gc_last_objects_freed = result->objects_freed;
+	vm->gc_last_live_objects = vm->gc_last_objects_after_sweep;
+	vm->gc_last_bytes_freed = bytes_freed;
+	vm->gc_last_bytes_after = vm->gc_last_bytes_before - bytes_freed;
+	vm->next_gc = compute_next_gc_threshold(vm);
+	vm->gc_last_next_gc = vm->next_gc;
+	vm->gc_last_pool_capacity = slab_pool_capacity(vm->slab_24) + slab_pool_capacity(vm->slab_32) +
+								slab_pool_capacity(vm->slab_48) + slab_pool_capacity(vm->slab_64);
+	if (vm->gc_last_pool_capacity < vm->gc_last_live_objects) {
+		vm->gc_last_pool_capacity = vm->gc_last_live_objects;
+	}
+	vm->gc_last_sweep_ns = sweep_ns;
+	vm->gc_sweep_ns += sweep_ns;
+}
+
+#ifdef _WIN32
+
+bool set_background_sweep(VM *vm, const bool enabled, const char **error_out)
+{
+	vm->gc_background_sweep = false;
+	if (enabled) {
+		*error_out = "Background sweeping is not supported on Windows.";
+		return false;
+	}
+	return true;
+}
+
+static bool start_background_sweep(VM *vm)
+{
+	(void)vm;
+	return false;
 }
 
+void finish_background_sweep(VM *vm)
+{
+	(void)vm;
+}
+
+void poll_background_sweep(VM *vm)
+{
+	(void)vm;
+}
+
+void free_background_sweeper(VM *vm)
+{
+	(void)vm;
+}
+
+#else
+
+struct BackgroundSweeper {
+	VM *vm;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t work_ready;
+	pthread_cond_t work_done;
+	bool shutting_down;
+
+	// written by the program before it signals work_ready
+	CruxObject *objects; // the list to sweep, NULL once the sweeper took it
+
+	// written by the sweeper before it sets done
+	SweepResult result;
+	SweptMemory swept;
+	uint64_t sweep_ns;
+	_Atomic bool done;
+};
+
+static void *background_sweeper_main(void *arg)
+{
+	BackgroundSweeper *sweeper = arg;
+
+	pthread_mutex_lock(&sweeper->lock);
+	for (;;) {
+		while (sweeper->objects == NULL && !sweeper->shutting_down) {
+			pthread_cond_wait(&sweeper->work_ready, &sweeper->lock);
+		}
+		if (sweeper->objects == NULL) {
+			break;
+		}
+		CruxObject *objects = sweeper->objects;
+		sweeper->objects = NULL;
+		pthread_mutex_unlock(&sweeper->lock);
+
+		// the dead objects are unreachable and the survivors' headers are only read by the collector, so the program
+		// can keep running while this thread walks the list
+		const uint64_t start_ns = gc_now_ns();
+		collect_frees_into(&sweeper->swept);
+		sweep(sweeper->vm, objects, &sweeper->result, NULL, NULL);
+		collect_frees_into(NULL);
+		sweeper->sweep_ns = gc_now_ns() - start_ns;
+
+		pthread_mutex_lock(&sweeper->lock);
+		atomic_store_explicit(&sweeper->done, true, memory_order_release);
+		pthread_cond_signal(&sweeper->work_done);
+	}
+	pthread_mutex_unlock(&sweeper->lock);
+	return NULL;
+}
+
+static BackgroundSweeper *new_background_sweeper(VM *vm)
+{
+	BackgroundSweeper *sweeper = calloc(1, sizeof(BackgroundSweeper));
+	if (sweeper == NULL) {
+		return NULL;
+	}
+	sweeper->vm = vm;
+	pthread_mutex_init(&sweeper->lock, NULL);
+	pthread_cond_init(&sweeper->work_ready, NULL);
+	pthread_cond_init(&sweeper->work_done, NULL);
+	if (pthread_create(&sweeper->thread, NULL, background_sweeper_main, sweeper) != 0) {
+		pthread_cond_destroy(&sweeper->work_done);
+		pthread_cond_destroy(&sweeper->work_ready);
+		pthread_mutex_destroy(&sweeper->lock);
+		free(sweeper);
+		return NULL;
+	}
+	return sweeper;
+}
+
+bool set_background_sweep(VM *vm, const bool enabled, const char **error_out)
+{
+	(void)error_out;
+	vm->gc_background_sweep = enabled;
+	return true;
+}
+
+/**
+ * Hands the whole object list to the sweeper thread. The program starts a new list with the objects it allocates
+ * meanwhile; the survivors are put back in front of it when the sweep is finished.
+ */
+static bool start_background_sweep(VM *vm)
+{
+	if (!vm->gc_background_sweep || vm->objects == NULL) {
+		return false;
+	}
+	if (vm->background_sweeper == NULL) {
+		vm->background_sweeper = new_background_sweeper(vm);
+		if (vm->background_sweeper == NULL) {
+			return false;
+		}
+	}
+	BackgroundSweeper *sweeper = vm->background_sweeper;
+
+	atomic_store_explicit(&sweeper->done, false, memory_order_relaxed);
+	pthread_mutex_lock(&sweeper->lock);
+	sweeper->objects = vm->objects;
+	pthread_cond_signal(&sweeper->work_ready);
+	pthread_mutex_unlock(&sweeper->lock);
+
+	vm->objects = NULL;
+	vm->gc_sweep_pending = true;
+	return true;
+}
+
+/**
+ * Sets the marks that were requested while the sweeper owned the object headers. The objects stay on the gray stack
+ * and are traced by the next collection, as if they had been marked right away.
+ */
+static void apply_deferred_marks(VM *vm)
+{
+	int kept = 0;
+	for (int i = 0; i < vm->gray_count; i++) {
+		CruxObject *object = vm->gray_stack[i];
+		if (object_is_marked(object) || object_is_immortal(object)) {
+			continue;
+		}
+		object_set_marked(object, true);
+		vm->gray_stack[kept++] = object;
+	}
+	vm->gray_count = kept;
+}
+
+void finish_background_sweep(VM *vm)
+{
+	if (!vm->gc_sweep_pending) {
+		return;
+	}
+	BackgroundSweeper *sweeper = vm->background_sweeper;
+	pthread_mutex_lock(&sweeper->lock);
+	while (!atomic_load_explicit(&sweeper->done, memory_order_acquire)) {
+		pthread_cond_wait(&sweeper->work_done, &sweeper->lock);
+	}
+	pthread_mutex_unlock(&sweeper->lock);
+
+	const size_t bytes_freed = sweeper->swept.bytes_freed;
+	return_swept_memory(vm, &sweeper->swept);
+	vm->gc_sweep_pending = false;
+	apply_deferred_marks(vm);
+	finish_sweep(vm, &sweeper->result, bytes_freed, sweeper->sweep_ns);
+}
+
+void poll_background_sweep(VM *vm)
+{
+	if (atomic_load_explicit(&vm->background_sweeper->done, memory_order_acquire)) {
+		finish_background_sweep(vm);
+	}
+}
+
+void free_background_sweeper(VM *vm)
+{
+	BackgroundSweeper *sweeper = vm->background_sweeper;
+	if (sweeper == NULL) {
+		return;
+	}
+	finish_background_sweep(vm);
+
+	pthread_mutex_lock(&sweeper->lock);
+	sweeper->shutting_down = true;
+	pthread_cond_signal(&sweeper->work_ready);
+	pthread_mutex_unlock(&sweeper->lock);
+	pthread_join(sweeper->thread, NULL);
+
+	pthread_cond_destroy(&sweeper->work_done);
+	pthread_cond_destroy(&sweeper->work_ready);
+	pthread_mutex_destroy(&sweeper->lock);
+	free(sweeper);
+	vm->background_sweeper = NULL;
+}
+
+#endif
+
 void free_objects(VM *vm, bool free_all)
 {
+	finish_background_sweep(vm);
 	CruxObject *object = vm->objects;
 	while (object != NULL) {
 		CruxObject *next = object_get_next(object);
@@ -871,11 +1201,14 @@ void free_objects(VM *vm, bool free_all)
 	vm->object_count = 0;
 }
 
-void collect_garbage(VM *vm)
+void collect_garbage(VM *vm, const GcTrigger trigger)
 {
 	if (vm->gc_status == PAUSED)
 		return;
 
+	// the previous sweep has to clear its marks before this collection sets new ones
+	finish_background_sweep(vm);
+
 	const uint64_t gc_start_ns = gc_now_ns();
 	uint64_t phase_start_ns = gc_start_ns;
 	vm->gc_last_gray_peak = 0;
@@ -889,38 +1222,53 @@ void collect_garbage(VM *vm)
 	mark_roots(vm);
 	const uint64_t mark_roots_end_ns = gc_now_ns();
 	trace_references(vm);
+	close_unreachable_coroutines(vm);
 	const uint64_t trace_end_ns = gc_now_ns();
 	table_remove_white(vm, &vm->strings); // Clean up string table
 	const uint64_t remove_white_end_ns = gc_now_ns();
 	vm->gc_last_objects_before_sweep = vm->object_count;
-	sweep(vm);
-	const uint64_t sweep_end_ns = gc_now_ns();
-	vm->gc_last_objects_after_sweep = vm->object_count;
-	vm->next_gc = compute_next_gc_threshold(vm);
-	vm->gc_last_bytes_after = vm->bytes_allocated;
-	vm->gc_last_bytes_freed = vm->gc_last_bytes_before - vm->gc_last_bytes_after;
-	vm->gc_last_next_gc = vm->next_gc;
-	vm->gc_last_objects_freed = vm->gc_last_objects_before_sweep - vm->gc_last_objects_after_sweep;
-	vm->gc_last_live_objects = vm->object_count;
-	vm->gc_last_pool_capacity = slab_pool_capacity(vm->slab_24) + slab_pool_capacity(vm->slab_32) +
-								slab_pool_capacity(vm->slab_48) + slab_pool_capacity(vm->slab_64);
-	if (vm->gc_last_pool_capacity < vm->gc_last_live_objects) {
-		vm->gc_last_pool_capacity = vm->gc_last_live_objects;
-	}
 	vm->gc_last_strings_count = vm->strings.count;
 	vm->gc_last_strings_capacity = vm->strings.capacity;
 	vm->gc_last_strings_tombstones = table_tombstone_count(&vm->strings);
 	vm->gc_last_mark_roots_ns = mark_roots_end_ns - phase_start_ns;
 	vm->gc_last_trace_ns = trace_end_ns - mark_roots_end_ns;
 	vm->gc_last_remove_white_ns = remove_white_end_ns - trace_end_ns;
-	vm->gc_last_sweep_ns = sweep_end_ns - remove_white_end_ns;
-	vm->gc_last_total_ns = sweep_end_ns - gc_start_ns;
 	vm->gc_collections++;
 	vm->gc_mark_roots_ns += vm->gc_last_mark_roots_ns;
 	vm->gc_trace_ns += vm->gc_last_trace_ns;
 	vm->gc_remove_white_ns += vm->gc_last_remove_white_ns;
-	vm->gc_sweep_ns += vm->gc_last_sweep_ns;
+
+	// the per-type counts of the heap profiler and the event log are only known once the sweep is done
+	const bool needs_counts = vm->heap_profiler != NULL || vm->gc_event_log != NULL;
+	if (trigger != GC_TRIGGER_EXPLICIT && !needs_counts && start_background_sweep(vm)) {
+		// the sweep statistics are filled in by finish_background_sweep(); until then the threshold still counts
+		// the garbage being freed
+		vm->next_gc = compute_next_gc_threshold(vm);
+		vm->gc_last_total_ns = remove_white_end_ns - gc_start_ns;
+		vm->gc_total_ns += vm->gc_last_total_ns;
+		record_gc_pause(&vm->gc_pauses, vm->gc_last_total_ns);
+		return;
+	}
+
+	uint32_t live_counts[SENTINEL_OBJECT_COUNT] = {0};
+	uint32_t freed_counts[SENTINEL_OBJECT_COUNT] = {0};
+	SweepResult result;
+	const size_t bytes_before_sweep = vm->bytes_allocated;
+	CruxObject *objects = vm->objects;
+	vm->objects = NULL;
+	sweep(vm, objects, &result, vm->heap_profiler != NULL ? live_counts : NULL,
+		  vm->gc_event_log != NULL ? freed_counts : NULL);
+	const uint64_t sweep_end_ns = gc_now_ns();
+	finish_sweep(vm, &result, bytes_before_sweep - vm->bytes_allocated, sweep_end_ns - remove_white_end_ns);
+	vm->gc_last_total_ns = sweep_end_ns - gc_start_ns;
 	vm->gc_total_ns += vm->gc_last_total_ns;
+	record_gc_pause(&vm->gc_pauses, vm->gc_last_total_ns);
+	if (vm->heap_profiler != NULL) {
+		record_heap_census(vm, live_counts);
+	}
+	if (vm->gc_event_log != NULL) {
+		write_gc_event(vm, trigger, gc_start_ns, freed_counts);
+	}
 
 #ifdef DEBUG_LOG_GC
 	printf("--- gc end ---\n");
@@ -0,0 +1,114 @@
+#include <math.h>
+
+#include "gc_events.h"
+#include "object.h"
+
+static const char *trigger_name(const GcTrigger trigger)
+{
+	switch (trigger) {
+	case GC_TRIGGER_THRESHOLD:
+		return "threshold";
+	case GC_TRIGGER_ALLOCATION_FAILURE:
+		return "allocation_failure";
+	case GC_TRIGGER_STRESS:
+		return "stress";
+	case GC_TRIGGER_EXPLICIT:
+		return "explicit";
+	}
+	return "unknown";
+}
+
+bool open_gc_event_log(VM *vm, const char *path, const char **error_out)
+{
+	FILE *file = fopen(path, "a");
+	if (file == NULL) {
+		*error_out = "Failed to open the GC event log.";
+		return false;
+	}
+	close_gc_event_log(vm);
+	vm->gc_event_log = file;
+	return true;
+}
+
+void close_gc_event_log(VM *vm)
+{
+	if (vm->gc_event_log != NULL) {
+		fclose(vm->gc_event_log);
+		vm->gc_event_log = NULL;
+	}
+}
+
+void write_gc_event(VM *vm, const GcTrigger trigger, const uint64_t start_ns, const uint32_t *freed_counts)
+{
+	FILE *file = vm->gc_event_log;
+	fprintf(file,
+			"{\"cycle\": %llu, \"trigger\": \"%s\", \"start_ns\": %llu, \"total_ns\": %llu, \"mark_roots_ns\": %llu, "
+			"\"trace_ns\": %llu, \"remove_white_ns\": %llu, \"sweep_ns\": %llu, \"bytes_before\": %zu, "
+			"\"bytes_after\": %zu, \"next_gc\": %zu, \"objects_before\": %zu, \"objects_after\": %zu, "
+			"\"gray_peak\": %u, \"freed\": {",
+			(unsigned long long)vm->gc_collections, trigger_name(trigger), (unsigned long long)start_ns,
+			(unsigned long long)vm->gc_last_total_ns, (unsigned long long)vm->gc_last_mark_roots_ns,
+			(unsigned long long)vm->gc_last_trace_ns, (unsigned long long)vm->gc_last_remove_white_ns,
+			(unsigned long long)vm->gc_last_sweep_ns, vm->gc_last_bytes_before, vm->gc_last_bytes_after,
+			vm->gc_last_next_gc, vm->gc_last_objects_before_sweep, vm->gc_last_objects_after_sweep,
+			vm->gc_last_gray_peak);
+	bool first = true;
+	for (uint32_t type = 0; type < SENTINEL_OBJECT_COUNT; type++) {
+		if (freed_counts[type] == 0) {
+			continue;
+		}
+		fprintf(file, "%s\"%s\": %u", first ? "" : ", ", object_type_name((ObjectType)type), freed_counts[type]);
+		first = false;
+	}
+	fprintf(file, "}}\n");
+	fflush(file);
+}
+
+static uint32_t pause_bucket(const uint64_t pause_ns)
+{
+	if (pause_ns < GC_PAUSE_SUB_BUCKETS) {
+		return (uint32_t)pause_ns;
+	}
+	const uint32_t exponent = 63 - (uint32_t)__builtin_clzll(pause_ns);
+	const uint32_t sub_bucket = (uint32_t)(pause_ns >> (exponent - 4)) & (GC_PAUSE_SUB_BUCKETS - 1);
+	return (exponent - 3) * GC_PAUSE_SUB_BUCKETS + sub_bucket;
+}
+
+static uint64_t bucket_upper_bound(const uint32_t bucket)
+{
+	if (bucket < GC_PAUSE_SUB_BUCKETS) {
+		return bucket;
+	}
+	const uint32_t exponent = bucket / GC_PAUSE_SUB_BUCKETS + 3;
+	const uint64_t sub_bucket = bucket % GC_PAUSE_SUB_BUCKETS;
+	return ((GC_PAUSE_SUB_BUCKETS + sub_bucket + 1) << (exponent - 4)) - 1;
+}
+
+void record_gc_pause(GcPauseHistogram *histogram, const uint64_t pause_ns)
+{
+	histogram->counts[pause_bucket(pause_ns)]++;
+	histogram->total++;
+	if (pause_ns > histogram->max_ns) {
+		histogram->max_ns = pause_ns;
+	}
+}
+
+uint64_t gc_pause_percentile(const GcPauseHistogram *histogram, const double percentile)
+{
+	if (histogram->total == 0) {
+		return 0;
+	}
+	uint64_t rank = (uint64_t)ceil(percentile / 100.0 * (double)histogram->total);
+	if (rank < 1) {
+		rank = 1;
+	}
+	uint64_t seen = 0;
+	for (uint32_t bucket = 0; bucket < GC_PAUSE_BUCKETS; bucket++) {
+		seen += histogram->counts[bucket];
+		if (seen >= rank) {
+			const uint64_t upper = bucket_upper_bound(bucket);
+			return upper < histogram->max_ns ? upper : histogram->max_ns;
+		}
+	}
+	return histogram->max_ns;
+}
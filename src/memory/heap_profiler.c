@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "garbage_collector.h"
+#include "heap_profiler.h"
+#include "object.h"
+#include "profiler.h"
+
+/**
+ * Sampled bytes of one object type allocated at one source line.
+ */
+typedef struct {
+	ObjectFunction *function; // NULL for allocations made while no frame was running
+	int line;
+	uint32_t type;
+	uint32_t hash;
+	uint64_t samples;
+	uint64_t bytes;
+} HeapSite;
+
+typedef struct {
+	uint64_t collection;
+	size_t heap_bytes;
+	uint32_t live_counts[SENTINEL_OBJECT_COUNT];
+} HeapCensus;
+
+struct HeapProfiler {
+	uint64_t sample_bytes;
+	uint64_t bytes_until_sample;
+
+	HeapSite *sites;
+	uint32_t site_count;
+	uint32_t site_capacity;
+	uint32_t *site_index; // 1-based positions in sites, 0 marks an empty slot
+	uint32_t site_index_capacity;
+
+	HeapCensus *censuses;
+	uint32_t census_count;
+	uint32_t census_capacity;
+};
+
+const char *heap_profile_type_name(const uint32_t type)
+{
+	return type == HEAP_PROFILE_STORAGE ? "Storage" : object_type_name((ObjectType)type);
+}
+
+static uint32_t hash_site(const ObjectFunction *function, const int line, const uint32_t type)
+{
+	uint64_t key = (uint64_t)(uintptr_t)function ^ ((uint64_t)(uint32_t)line << 8 | type) * 0x9E3779B97F4A7C15ULL;
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return (uint32_t)key;
+}
+
+static bool grow_site_index(HeapProfiler *profiler)
+{
+	if ((profiler->site_count + 1) * 2 <= profiler->site_index_capacity) {
+		return true;
+	}
+	const uint32_t new_capacity = profiler->site_index_capacity < 64 ? 64 : profiler->site_index_capacity * 2;
+	uint32_t *slots = calloc(new_capacity, sizeof(uint32_t));
+	if (slots == NULL) {
+		return false;
+	}
+	for (uint32_t i = 0; i < profiler->site_count; i++) {
+		uint32_t slot = profiler->sites[i].hash & (new_capacity - 1);
+		while (slots[slot] != 0) {
+			slot = (slot + 1) & (new_capacity - 1);
+		}
+		slots[slot] = i + 1;
+	}
+	free(profiler->site_index);
+	profiler->site_index = slots;
+	profiler->site_index_capacity = new_capacity;
+	return true;
+}
+
+static HeapSite *find_site(HeapProfiler *profiler, ObjectFunction *function, const int line, const uint32_t type)
+{
+	if (!grow_site_index(profiler)) {
+		return NULL;
+	}
+	const uint32_t hash = hash_site(function, line, type);
+	const uint32_t mask = profiler->site_index_capacity - 1;
+	uint32_t slot = hash & mask;
+	for (;;) {
+		const uint32_t id = profiler->site_index[slot];
+		if (id == 0) {
+			break;
+		}
+		HeapSite *site = &profiler->sites[id - 1];
+		if (site->function == function && site->line == line && site->type == type) {
+			return site;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (profiler->site_count == profiler->site_capacity) {
+		const uint32_t new_capacity = profiler->site_capacity < 64 ? 64 : profiler->site_capacity * 2;
+		HeapSite *sites = realloc(profiler->sites, sizeof(HeapSite) * new_capacity);
+		if (sites == NULL) {
+			return NULL;
+		}
+		profiler->sites = sites;
+		profiler->site_capacity = new_capacity;
+	}
+	profiler->sites[profiler->site_count++] =
+		(HeapSite){.function = function, .line = line, .type = type, .hash = hash};
+	profiler->site_index[slot] = profiler->site_count;
+	return &profiler->sites[profiler->site_count - 1];
+}
+
+void record_heap_allocation(VM *vm, const uint32_t type, const size_t size)
+{
+	HeapProfiler *profiler = vm->heap_profiler;
+	if (size < profiler->bytes_until_sample) {
+		profiler->bytes_until_sample -= size;
+		return;
+	}
+
+	// a large allocation can cover several sampled bytes
+	const uint64_t overshoot = size - profiler->bytes_until_sample;
+	const uint64_t samples = 1 + overshoot / profiler->sample_bytes;
+	profiler->bytes_until_sample = profiler->sample_bytes - overshoot % profiler->sample_bytes;
+
+	ObjectFunction *function = NULL;
+	int line = 0;
+	if (vm->frame_count > 0) {
+		const CallFrame *frame = &vm->frames[vm->frame_count - 1];
+		function = frame->closure->function;
+		line = call_frame_line(frame);
+	}
+
+	HeapSite *site = find_site(profiler, function, line, type);
+	if (site != NULL) {
+		site->samples += samples;
+		site->bytes += samples * profiler->sample_bytes;
+	}
+}
+
+void record_heap_census(VM *vm, const uint32_t *live_counts)
+{
+	HeapProfiler *profiler = vm->heap_profiler;
+	if (profiler->census_count == profiler->census_capacity) {
+		const uint32_t new_capacity = profiler->census_capacity < 16 ? 16 : profiler->census_capacity * 2;
+		HeapCensus *censuses = realloc(profiler->censuses, sizeof(HeapCensus) * new_capacity);
+		if (censuses == NULL) {
+			return;
+		}
+		profiler->censuses = censuses;
+		profiler->census_capacity = new_capacity;
+	}
+	HeapCensus *census = &profiler->censuses[profiler->census_count++];
+	census->collection = vm->gc_collections;
+	census->heap_bytes = vm->bytes_allocated;
+	memcpy(census->live_counts, live_counts, sizeof(census->live_counts));
+}
+
+void count_heap_objects(const VM *vm, uint32_t counts[SENTINEL_OBJECT_COUNT])
+{
+	memset(counts, 0, sizeof(uint32_t) * SENTINEL_OBJECT_COUNT);
+	for (CruxObject *object = vm->objects; object != NULL; object = object_get_next(object)) {
+		counts[object_get_type(object)]++;
+	}
+}
+
+void mark_heap_profiler_roots(VM *vm)
+{
+	const HeapProfiler *profiler = vm->heap_profiler;
+	if (profiler == NULL) {
+		return;
+	}
+	for (uint32_t i = 0; i < profiler->site_count; i++) {
+		if (profiler->sites[i].function != NULL) {
+			mark_object(vm, (CruxObject *)profiler->sites[i].function);
+		}
+	}
+}
+
+static void free_heap_profiler(HeapProfiler *profiler)
+{
+	free(profiler->sites);
+	free(profiler->site_index);
+	free(profiler->censuses);
+	free(profiler);
+}
+
+static bool write_folded(const HeapProfiler *profiler, const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	for (uint32_t i = 0; i < profiler->site_count; i++) {
+		const HeapSite *site = &profiler->sites[i];
+		const ObjectFunction *function = site->function;
+		if (function == NULL) {
+			fprintf(file, "<runtime>");
+		} else {
+			const char *name = function->name != NULL && function->name->byte_length > 0 ? function->name->chars
+																						   : "<script>";
+			const char *file_name = function->module_record != NULL && function->module_record->path != NULL
+										? function->module_record->path->chars
+										: "<unknown>";
+			fprintf(file, "%s (%s:%d)", name, file_name, site->line);
+		}
+		fprintf(file, ";%s %llu\n", heap_profile_type_name(site->type), (unsigned long long)site->bytes);
+	}
+	return fclose(file) == 0;
+}
+
+static bool write_census(const HeapProfiler *profiler, const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "collection,heap_bytes");
+	for (uint32_t type = 0; type < SENTINEL_OBJECT_COUNT; type++) {
+		fprintf(file, ",%s", heap_profile_type_name(type));
+	}
+	fprintf(file, "\n");
+	for (uint32_t i = 0; i < profiler->census_count; i++) {
+		const HeapCensus *census = &profiler->censuses[i];
+		fprintf(file, "%llu,%zu", (unsigned long long)census->collection, census->heap_bytes);
+		for (uint32_t type = 0; type < SENTINEL_OBJECT_COUNT; type++) {
+			fprintf(file, ",%u", census->live_counts[type]);
+		}
+		fprintf(file, "\n");
+	}
+	return fclose(file) == 0;
+}
+
+bool heap_profiler_start(VM *vm, const int64_t sample_bytes, const char **error_out)
+{
+	if (vm->heap_profiler != NULL) {
+		*error_out = "The heap profiler is already running.";
+		return false;
+	}
+	if (sample_bytes <= 0) {
+		*error_out = "Sampling interval must be a positive number of bytes.";
+		return false;
+	}
+
+	HeapProfiler *profiler = calloc(1, sizeof(HeapProfiler));
+	if (profiler == NULL) {
+		*error_out = "Failed to allocate memory for the heap profiler.";
+		return false;
+	}
+	profiler->sample_bytes = (uint64_t)sample_bytes;
+	profiler->bytes_until_sample = profiler->sample_bytes;
+	vm->heap_profiler = profiler;
+	return true;
+}
+
+bool heap_profiler_stop(VM *vm, const char *prefix, const char **error_out)
+{
+	HeapProfiler *profiler = vm->heap_profiler;
+	if (profiler == NULL) {
+		*error_out = "The heap profiler is not running.";
+		return false;
+	}
+	vm->heap_profiler = NULL;
+
+	bool written = true;
+	if (prefix != NULL) {
+		const size_t prefix_length = strlen(prefix);
+		char *path = malloc(prefix_length + sizeof(".folded"));
+		if (path == NULL) {
+			*error_out = "Failed to allocate memory for the heap profile path.";
+			written = false;
+		} else {
+			memcpy(path, prefix, prefix_length);
+			memcpy(path + prefix_length, ".folded", sizeof(".folded"));
+			if (!write_folded(profiler, path)) {
+				*error_out = "Failed to write the heap profile.";
+				written = false;
+			}
+			memcpy(path + prefix_length, ".census", sizeof(".census"));
+			if (written && !write_census(profiler, path)) {
+				*error_out = "Failed to write the heap census.";
+				written = false;
+			}
+			free(path);
+		}
+	}
+
+	free_heap_profiler(profiler);
+	return written;
+}
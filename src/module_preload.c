@@ -0,0 +1,309 @@
+#include "module_preload.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "file_handler.h"
+#include "scanner.h"
+
+#define PRELOAD_MAX_WORKERS 8
+
+/**
+ * A file to read, and the resolved paths of the files it imports once it has been scanned.
+ */
+typedef struct {
+	char *path;
+	FileResult file;
+	char **imports;
+	uint32_t import_count;
+	uint32_t import_capacity;
+} PreloadJob;
+
+typedef struct {
+	PreloadJob *jobs;
+	uint32_t count;
+	uint32_t capacity;
+	atomic_uint next;
+} PreloadWave;
+
+static uint32_t hash_path(const char *path)
+{
+	uint32_t hash = 2166136261u;
+	for (const char *c = path; *c != '\0'; c++) {
+		hash ^= (uint8_t)*c;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+void init_module_preload(ModulePreload *preload)
+{
+	preload->modules = NULL;
+	preload->count = 0;
+	preload->capacity = 0;
+}
+
+void release_preloaded_sources(ModulePreload *preload)
+{
+	for (uint32_t i = 0; i < preload->count; i++) {
+		free(preload->modules[i].path);
+		free(preload->modules[i].source);
+	}
+	free(preload->modules);
+	init_module_preload(preload);
+}
+
+static PreloadedModule *find_preloaded(const ModulePreload *preload, const char *path, const uint32_t hash)
+{
+	for (uint32_t i = 0; i < preload->count; i++) {
+		PreloadedModule *module = &preload->modules[i];
+		if (module->hash == hash && strcmp(module->path, path) == 0) {
+			return module;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Takes ownership of <path> and <source>. Both are freed if the entry cannot be stored.
+ */
+static bool add_preloaded(ModulePreload *preload, char *path, char *source, const uint32_t hash)
+{
+	if (preload->count == preload->capacity) {
+		const uint32_t new_capacity = preload->capacity < 8 ? 8 : preload->capacity * 2;
+		PreloadedModule *modules = realloc(preload->modules, sizeof(PreloadedModule) * new_capacity);
+		if (modules == NULL) {
+			free(path);
+			free(source);
+			return false;
+		}
+		preload->modules = modules;
+		preload->capacity = new_capacity;
+	}
+	preload->modules[preload->count++] = (PreloadedModule){.path = path, .source = source, .hash = hash};
+	return true;
+}
+
+static void add_import(PreloadJob *job, char *path)
+{
+	if (job->import_count == job->import_capacity) {
+		const uint32_t new_capacity = job->import_capacity < 4 ? 4 : job->import_capacity * 2;
+		char **imports = realloc(job->imports, sizeof(char *) * new_capacity);
+		if (imports == NULL) {
+			free(path);
+			return;
+		}
+		job->imports = imports;
+		job->import_capacity = new_capacity;
+	}
+	job->imports[job->import_count++] = path;
+}
+
+/**
+ * Finds the file imports of <source> with the scanner alone. Native modules ("crux:...") are skipped.
+ * This only has to find paths, so malformed statements are ignored and left for the compiler to report.
+ */
+static void collect_imports(PreloadJob *job, const char *source)
+{
+	Scanner scanner;
+	init_scanner(&scanner, source);
+
+	for (;;) {
+		Token token = scan_token(&scanner);
+		if (token.type == CRUX_TOKEN_EOF) {
+			return;
+		}
+		if (token.type != CRUX_TOKEN_USE) {
+			continue;
+		}
+
+		do {
+			token = scan_token(&scanner);
+		} while (token.type != CRUX_TOKEN_FROM && token.type != CRUX_TOKEN_SEMICOLON && token.type != CRUX_TOKEN_EOF);
+
+		if (token.type == CRUX_TOKEN_EOF) {
+			return;
+		}
+		if (token.type != CRUX_TOKEN_FROM) {
+			continue;
+		}
+
+		token = scan_token(&scanner);
+		if (token.type != CRUX_TOKEN_STRING || token.length < 2) {
+			continue;
+		}
+		if (token.length >= 6 && memcmp(token.start, "\"crux:", 6) == 0) {
+			continue;
+		}
+
+		const size_t raw_length = (size_t)token.length - 2;
+		char *raw_path = malloc(raw_length + 1);
+		if (raw_path == NULL) {
+			return;
+		}
+		memcpy(raw_path, token.start + 1, raw_length);
+		raw_path[raw_length] = '\0';
+
+		char *resolved = resolve_path(job->path, raw_path);
+		free(raw_path);
+		if (resolved != NULL) {
+			add_import(job, resolved);
+		}
+	}
+}
+
+static void *preload_worker(void *arg)
+{
+	PreloadWave *wave = arg;
+	for (;;) {
+		const uint32_t index = atomic_fetch_add(&wave->next, 1);
+		if (index >= wave->count) {
+			return NULL;
+		}
+		PreloadJob *job = &wave->jobs[index];
+		job->file = read_file(job->path);
+		if (job->file.error == NULL) {
+			collect_imports(job, job->file.content);
+		}
+	}
+}
+
+static uint32_t preload_worker_count(const uint32_t job_count)
+{
+#ifdef _WIN32
+	(void)job_count;
+	return 1;
+#else
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t workers = online > 0 ? (uint32_t)online : 1;
+	if (workers > PRELOAD_MAX_WORKERS) {
+		workers = PRELOAD_MAX_WORKERS;
+	}
+	return workers < job_count ? workers : job_count;
+#endif
+}
+
+/**
+ * Reads and scans every job of the wave. The calling thread works alongside the pool and stays the only one
+ * that touches the VM.
+ */
+static void run_wave(PreloadWave *wave)
+{
+	atomic_store(&wave->next, 0);
+	const uint32_t workers = preload_worker_count(wave->count);
+
+#ifndef _WIN32
+	pthread_t threads[PRELOAD_MAX_WORKERS];
+	uint32_t started = 0;
+	while (started + 1 < workers) {
+		if (pthread_create(&threads[started], NULL, preload_worker, wave) != 0) {
+			break;
+		}
+		started++;
+	}
+	preload_worker(wave);
+	for (uint32_t i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+#else
+	(void)workers;
+	preload_worker(wave);
+#endif
+}
+
+/**
+ * Queues <path> on <wave> unless it has already been seen. Takes ownership of <path>.
+ */
+static void enqueue_path(ModulePreload *preload, PreloadWave *wave, char *path)
+{
+	const uint32_t hash = hash_path(path);
+	if (find_preloaded(preload, path, hash) != NULL) {
+		free(path);
+		return;
+	}
+	for (uint32_t i = 0; i < wave->count; i++) {
+		if (strcmp(wave->jobs[i].path, path) == 0) {
+			free(path);
+			return;
+		}
+	}
+
+	if (wave->count == wave->capacity) {
+		const uint32_t new_capacity = wave->capacity < 8 ? 8 : wave->capacity * 2;
+		PreloadJob *jobs = realloc(wave->jobs, sizeof(PreloadJob) * new_capacity);
+		if (jobs == NULL) {
+			free(path);
+			return;
+		}
+		wave->jobs = jobs;
+		wave->capacity = new_capacity;
+	}
+	wave->jobs[wave->count++] = (PreloadJob){.path = path};
+}
+
+void preload_import_graph(VM *vm, const char *entry_path, const char *entry_source)
+{
+	ModulePreload *preload = &vm->module_preload;
+	release_preloaded_sources(preload);
+
+	// the entry file is already being compiled, it only has to be marked as seen
+	char *resolved_entry = resolve_path(NULL, entry_path);
+	if (resolved_entry != NULL) {
+		add_preloaded(preload, resolved_entry, NULL, hash_path(resolved_entry));
+	}
+
+	PreloadJob entry = {.path = (char *)entry_path};
+	collect_imports(&entry, entry_source);
+
+	PreloadWave waves[2] = {0};
+	PreloadWave *current = &waves[0];
+	PreloadWave *next = &waves[1];
+	for (uint32_t i = 0; i < entry.import_count; i++) {
+		enqueue_path(preload, current, entry.imports[i]);
+	}
+	free(entry.imports);
+
+	while (current->count > 0) {
+		run_wave(current);
+
+		// record the whole wave before queueing its imports so files in the same wave are not read twice
+		for (uint32_t i = 0; i < current->count; i++) {
+			PreloadJob *job = &current->jobs[i];
+			free(job->file.error);
+			add_preloaded(preload, job->path, job->file.content, hash_path(job->path));
+		}
+		for (uint32_t i = 0; i < current->count; i++) {
+			PreloadJob *job = &current->jobs[i];
+			for (uint32_t j = 0; j < job->import_count; j++) {
+				enqueue_path(preload, next, job->imports[j]);
+			}
+			free(job->imports);
+		}
+
+		PreloadWave *done = current;
+		current = next;
+		next = done;
+		next->count = 0;
+	}
+
+	free(waves[0].jobs);
+	free(waves[1].jobs);
+}
+
+char *take_preloaded_source(VM *vm, const char *path)
+{
+	PreloadedModule *module = find_preloaded(&vm->module_preload, path, hash_path(path));
+	if (module == NULL) {
+		return NULL;
+	}
+	char *source = module->source;
+	module->source = NULL;
+	return source;
+}
@@ -16,9 +16,48 @@
 #endif
 
 #include "garbage_collector.h"
+#include "heap_profiler.h"
 #include "object.h"
 #include "panic.h"
 
+static const char *const object_type_names[SENTINEL_OBJECT_COUNT] = {
+	[OBJECT_STRING] = "String",
+	[OBJECT_FUNCTION] = "Function",
+	[OBJECT_NATIVE_CALLABLE] = "NativeCallable",
+	[OBJECT_CLOSURE] = "Closure",
+	[OBJECT_UPVALUE] = "Upvalue",
+	[OBJECT_ARRAY] = "Array",
+	[OBJECT_TABLE] = "Table",
+	[OBJECT_ERROR] = "Error",
+	[OBJECT_RESULT] = "Result",
+	[OBJECT_RANDOM] = "Random",
+	[OBJECT_FILE] = "File",
+	[OBJECT_MODULE_RECORD] = "ModuleRecord",
+	[OBJECT_STRUCT] = "Struct",
+	[OBJECT_STRUCT_INSTANCE] = "StructInstance",
+	[OBJECT_VECTOR] = "Vector",
+	[OBJECT_COMPLEX] = "Complex",
+	[OBJECT_MATRIX] = "Matrix",
+	[OBJECT_BUFFER] = "Buffer",
+	[OBJECT_SET] = "Set",
+	[OBJECT_TUPLE] = "Tuple",
+	[OBJECT_RANGE] = "Range",
+	[OBJECT_ITERATOR] = "Iterator",
+	[OBJECT_TYPE_RECORD] = "TypeRecord",
+	[OBJECT_TYPE_TABLE] = "TypeTable",
+	[OBJECT_OPTION] = "Option",
+	[OBJECT_ENUM] = "Enum",
+	[OBJECT_COROUTINE] = "Coroutine",
+};
+
+const char *object_type_name(const ObjectType type)
+{
+	if ((uint32_t)type >= SENTINEL_OBJECT_COUNT || object_type_names[type] == NULL) {
+		return "<unknown>";
+	}
+	return object_type_names[type];
+}
+
 /**
  * @brief Allocates a new object of the specified type.
  *
@@ -35,6 +74,9 @@ CruxObject *allocate_pooled_object(VM *vm, const size_t size, const ObjectType t
 	object_init(object, vm->objects, type, false, false);
 	vm->object_count++;
 	vm->objects = object;
+	if (__builtin_expect(vm->heap_profiler != NULL, 0)) {
+		record_heap_allocation(vm, type, size);
+	}
 
 #ifdef DEBUG_LOG_GC
 	printf("%p allocate %zu for %d\n", (void *)object, size, type);
@@ -265,18 +307,26 @@ ObjectUpvalue *new_upvalue(VM *vm, Value *slot)
 	return upvalue;
 }
 
+ObjectUpvalue *new_closed_upvalue(VM *vm, const Value value)
+{
+	ObjectUpvalue *upvalue = new_upvalue(vm, NULL);
+	upvalue->closed = value;
+	upvalue->location = &upvalue->closed;
+	return upvalue;
+}
+
 ObjectClosure *new_closure(VM *vm, ObjectFunction *function)
 {
-	push(vm->current_module_record, OBJECT_VAL(function));
+	push(vm, OBJECT_VAL(function));
 	ObjectUpvalue **upvalues = ALLOCATE(vm, ObjectUpvalue *, function->upvalue_count);
-	push(vm->current_module_record, OBJECT_VAL(upvalues));
+	push(vm, OBJECT_VAL(upvalues));
 	for (int i = 0; i < function->upvalue_count; i++) {
 		upvalues[i] = NULL;
 	}
 
 	ObjectClosure *closure = ALLOCATE_OBJECT(vm, ObjectClosure, OBJECT_CLOSURE);
-	pop(vm->current_module_record);
-	pop(vm->current_module_record);
+	pop(vm);
+	pop(vm);
 	closure->function = function;
 	closure->upvalues = upvalues;
 	closure->upvalue_count = function->upvalue_count;
@@ -303,9 +353,9 @@ static ObjectString *allocate_string(VM *vm, utf8_int8_t *chars, const uint32_t
 	string->chars = chars;
 	string->hash = hash;
 	// intern the string
-	push(vm->current_module_record, OBJECT_VAL(string));
+	push(vm, OBJECT_VAL(string));
 	table_set(vm, &vm->strings, string, NIL_VAL);
-	pop(vm->current_module_record);
+	pop(vm);
 	return string;
 }
 
@@ -495,7 +545,7 @@ static void print_struct_instance_to(FILE *stream, const ObjectStructInstance *i
 	fprintf(stream, "{");
 	int printed = 0;
 	const ObjectStruct *type = instance->struct_type;
-	if (instance->fields == NULL) {
+	if (instance->field_count == 0) {
 		fprintf(stream, "}");
 		return;
 	}
@@ -953,6 +1003,9 @@ ObjectFunction *new_function(VM *vm)
 	function->arity = 0;
 	function->name = NULL;
 	function->upvalue_count = 0;
+	function->is_generator = false;
+	function->stats_slot = 0;
+	function->shared_closure = NULL;
 	init_chunk(&function->chunk);
 	function->module_record = vm->current_module_record;
 	return function;
@@ -972,11 +1025,12 @@ ObjectFunction *new_function(VM *vm)
 ObjectNativeCallable *new_native_callable(VM *vm, const CruxCallable function, const int arity, ObjectString *name,
 										  ObjectTypeRecord **arg_types, ObjectTypeRecord *return_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(name));
+	push(vm, OBJECT_VAL(name));
 	ObjectNativeCallable *native = ALLOCATE_OBJECT(vm, ObjectNativeCallable, OBJECT_NATIVE_CALLABLE);
-	pop(vm->current_module_record);
+	pop(vm);
 	native->function = function;
 	native->arity = arity;
+	native->is_pure = false;
 	native->name = name;
 	if (arg_types != NULL && arity > 0) {
 		native->arg_types = arg_types;
@@ -990,7 +1044,7 @@ ObjectNativeCallable *new_native_callable(VM *vm, const CruxCallable function, c
 ObjectTable *new_object_table(VM *vm, const int element_count)
 {
 	ObjectTable *table = ALLOCATE_OBJECT(vm, ObjectTable, OBJECT_TABLE);
-	push(vm->current_module_record, OBJECT_VAL(table));
+	push(vm, OBJECT_VAL(table));
 	table->size = 0;
 	table->entries = NULL;
 	const uint32_t newCapacity = element_count < 16 ? 16 : calculateCollectionCapacity(element_count);
@@ -1001,7 +1055,7 @@ ObjectTable *new_object_table(VM *vm, const int element_count)
 		table->entries[i].key = NIL_VAL;
 		table->entries[i].is_occupied = false;
 	}
-	pop(vm->current_module_record);
+	pop(vm);
 	return table;
 }
 
@@ -1016,11 +1070,11 @@ void free_object_table(VM *vm, ObjectTable *table)
 ObjectFile *new_object_file(VM *vm, ObjectString *path, ObjectString *mode)
 {
 	// TODO: Make this open files in non existent directories
-	push(vm->current_module_record, OBJECT_VAL(path));
-	push(vm->current_module_record, OBJECT_VAL(mode));
+	push(vm, OBJECT_VAL(path));
+	push(vm, OBJECT_VAL(mode));
 	ObjectFile *file = ALLOCATE_OBJECT(vm, ObjectFile, OBJECT_FILE);
-	pop(vm->current_module_record);
-	pop(vm->current_module_record);
+	pop(vm);
+	pop(vm);
 	file->path = path;
 	file->mode = mode;
 
@@ -1049,7 +1103,7 @@ ObjectFile *new_object_file(VM *vm, ObjectString *path, ObjectString *mode)
  * @return A pointer to the ObjectTableEntry for the key, or a pointer to an
  * empty entry (possibly a tombstone) if the key is not found.
  */
-static ObjectTableEntry *find_entry(ObjectTableEntry *entries, const uint16_t capacity, const Value key)
+static ObjectTableEntry *find_entry(ObjectTableEntry *entries, const uint32_t capacity, const Value key)
 {
 	const uint32_t hash = hashValue(key);
 	uint32_t index = hash & (capacity - 1);
@@ -1083,9 +1137,9 @@ static ObjectTableEntry *find_entry(ObjectTableEntry *entries, const uint16_t ca
  */
 static bool adjust_capacity(VM *vm, ObjectTable *table, const int capacity)
 {
-	push(vm->current_module_record, OBJECT_VAL(table));
+	push(vm, OBJECT_VAL(table));
 	ObjectTableEntry *entries = ALLOCATE(vm, ObjectTableEntry, capacity);
-	pop(vm->current_module_record);
+	pop(vm);
 	if (entries == NULL) {
 		return false;
 	}
@@ -1199,14 +1253,14 @@ bool object_table_get(ObjectTableEntry *entries, const uint32_t size, const uint
 ObjectArray *new_array(VM *vm, const uint32_t element_count)
 {
 	ObjectArray *array = ALLOCATE_OBJECT(vm, ObjectArray, OBJECT_ARRAY);
-	push(vm->current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 	array->capacity = calculateCollectionCapacity(element_count);
 	array->size = 0;
 	array->values = ALLOCATE(vm, Value, array->capacity);
 	for (uint32_t i = 0; i < array->capacity; i++) {
 		array->values[i] = NIL_VAL;
 	}
-	pop(vm->current_module_record);
+	pop(vm);
 	return array;
 }
 
@@ -1222,9 +1276,9 @@ bool ensure_capacity(VM *vm, ObjectArray *array, const uint32_t capacity_needed)
 		}
 		newCapacity *= 2;
 	}
-	push(vm->current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 	Value *newArray = GROW_ARRAY(vm, Value, array->values, array->capacity, newCapacity);
-	pop(vm->current_module_record);
+	pop(vm);
 	if (newArray == NULL) {
 		return false;
 	}
@@ -1273,9 +1327,9 @@ bool array_add_back(VM *vm, ObjectArray *array, const Value value)
 
 ObjectError *new_error(VM *vm, ObjectString *message, const ErrorType type, const bool is_panic)
 {
-	push(vm->current_module_record, OBJECT_VAL(message));
+	push(vm, OBJECT_VAL(message));
 	ObjectError *error = ALLOCATE_OBJECT(vm, ObjectError, OBJECT_ERROR);
-	pop(vm->current_module_record);
+	pop(vm);
 	error->message = message;
 	error->type = type;
 	error->is_panic = is_panic;
@@ -1284,24 +1338,147 @@ ObjectError *new_error(VM *vm, ObjectString *message, const ErrorType type, cons
 
 ObjectResult *new_ok_result(VM *vm, const Value value)
 {
-	push(vm->current_module_record, value);
+	if (IS_NIL(value) && vm->ok_nil_result != NULL) {
+		return vm->ok_nil_result;
+	}
+	if (IS_BOOL(value) && vm->ok_bool_results[AS_BOOL(value)] != NULL) {
+		return vm->ok_bool_results[AS_BOOL(value)];
+	}
+	push(vm, value);
 	ObjectResult *result = ALLOCATE_OBJECT(vm, ObjectResult, OBJECT_RESULT);
-	pop(vm->current_module_record);
+	pop(vm);
 	result->is_ok = true;
 	result->as.value = value;
 	return result;
 }
 
+Value native_ok(VM *vm, const Value value)
+{
+	if (vm->unwrap_native_result) {
+		vm->native_result_unboxed = true;
+		return value;
+	}
+	return OBJECT_VAL(new_ok_result(vm, value));
+}
+
 ObjectResult *new_error_result(VM *vm, ObjectError *error)
 {
-	push(vm->current_module_record, OBJECT_VAL(error));
+	push(vm, OBJECT_VAL(error));
 	ObjectResult *result = ALLOCATE_OBJECT(vm, ObjectResult, OBJECT_RESULT);
-	pop(vm->current_module_record);
+	pop(vm);
 	result->is_ok = false;
 	result->as.error = error;
 	return result;
 }
 
+Value make_error_result(VM *vm, const char *message, const ErrorType type)
+{
+	ObjectString *message_string = copy_string(vm, message, strlen(message));
+	push(vm, OBJECT_VAL(message_string));
+	ObjectError *error = new_error(vm, message_string, type, false);
+	push(vm, OBJECT_VAL(error));
+	ObjectResult *result = new_error_result(vm, error);
+	pop(vm);
+	pop(vm);
+	return OBJECT_VAL(result);
+}
+
+static uint32_t static_error_slot(const char *message, const int type, const uint32_t capacity)
+{
+	const uint64_t key = (uint64_t)(uintptr_t)message ^ (uint64_t)type;
+	return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+static bool grow_static_errors(StaticErrorCache *cache)
+{
+	const uint32_t capacity = cache->capacity == 0 ? 64 : cache->capacity * 2;
+	StaticError *entries = calloc(capacity, sizeof(StaticError));
+	if (entries == NULL) {
+		return false;
+	}
+	for (uint32_t i = 0; i < cache->capacity; i++) {
+		const StaticError *entry = &cache->entries[i];
+		if (entry->message == NULL) {
+			continue;
+		}
+		uint32_t slot = static_error_slot(entry->message, entry->type, capacity);
+		while (entries[slot].message != NULL) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		entries[slot] = *entry;
+	}
+	free(cache->entries);
+	cache->entries = entries;
+	cache->capacity = capacity;
+	return true;
+}
+
+ObjectResult *static_error_result(VM *vm, const char *message, const uint32_t length, const ErrorType type)
+{
+	StaticErrorCache *cache = &vm->static_errors;
+	if (cache->capacity > 0) {
+		uint32_t slot = static_error_slot(message, (int)type, cache->capacity);
+		while (cache->entries[slot].message != NULL) {
+			const StaticError *entry = &cache->entries[slot];
+			if (entry->message == message && entry->type == (int)type) {
+				return entry->result;
+			}
+			slot = (slot + 1) & (cache->capacity - 1);
+		}
+	}
+
+	ObjectString *string = copy_string(vm, message, length);
+	push(vm, OBJECT_VAL(string));
+	ObjectError *error = new_error(vm, string, type, false);
+	push(vm, OBJECT_VAL(error));
+	ObjectResult *result = new_error_result(vm, error);
+	pop(vm);
+	pop(vm);
+
+	if ((cache->count + 1) * 4 > cache->capacity * 3 && !grow_static_errors(cache)) {
+		return result; // not cached, so it stays collectable
+	}
+	// the message may be an older string, whose header the background sweeper can still own
+	finish_background_sweep(vm);
+	object_set_immortal(&string->object, true);
+	object_set_immortal(&error->object, true);
+	object_set_immortal(&result->object, true);
+
+	uint32_t slot = static_error_slot(message, (int)type, cache->capacity);
+	while (cache->entries[slot].message != NULL) {
+		slot = (slot + 1) & (cache->capacity - 1);
+	}
+	cache->entries[slot] = (StaticError){.message = message, .type = (int)type, .result = result};
+	cache->count++;
+	return result;
+}
+
+void free_static_errors(VM *vm)
+{
+	free(vm->static_errors.entries);
+	vm->static_errors.entries = NULL;
+	vm->static_errors.count = 0;
+	vm->static_errors.capacity = 0;
+}
+
+static ObjectResult *new_immortal_ok_result(VM *vm, const Value value)
+{
+	ObjectResult *result = ALLOCATE_OBJECT(vm, ObjectResult, OBJECT_RESULT);
+	result->is_ok = true;
+	result->as.value = value;
+	object_set_immortal(&result->object, true);
+	return result;
+}
+
+void init_immortal_values(VM *vm)
+{
+	vm->none_option = new_option(vm, NIL_VAL, false);
+	object_set_immortal(&vm->none_option->object, true);
+	vm->ok_nil_result = new_immortal_ok_result(vm, NIL_VAL);
+	vm->ok_bool_results[false] = new_immortal_ok_result(vm, BOOL_VAL(false));
+	vm->ok_bool_results[true] = new_immortal_ok_result(vm, BOOL_VAL(true));
+}
+
 ObjectRandom *new_random(VM *vm)
 {
 	ObjectRandom *random = ALLOCATE_OBJECT(vm, ObjectRandom, OBJECT_RANDOM);
@@ -1336,20 +1513,10 @@ ObjectModuleRecord *new_object_module_record(VM *vm, ObjectString *path, const b
 	module_record->types = new_type_table(vm, INITIAL_TYPE_TABLE_SIZE);
 	module_record->state = STATE_LOADING;
 	module_record->module_closure = NULL;
-	module_record->enclosing_module = NULL;
-
-	module_record->stack = (Value *)malloc(STACK_MAX * sizeof(Value));
-	module_record->stack_top = module_record->stack;
-	module_record->stack_limit = module_record->stack + STACK_MAX;
-	module_record->open_upvalues = NULL;
 
 	module_record->globals = NULL;
 	module_record->global_count = 0;
 
-	module_record->frames = (CallFrame *)malloc(FRAMES_MAX * sizeof(CallFrame));
-	module_record->frame_count = 0;
-	module_record->frame_capacity = FRAMES_MAX;
-
 	module_record->is_main = is_main;
 	module_record->is_repl = is_repl;
 
@@ -1367,10 +1534,6 @@ ObjectModuleRecord *new_object_module_record(VM *vm, ObjectString *path, const b
  */
 void free_object_module_record(VM *vm, ObjectModuleRecord *record)
 {
-	free(record->frames);
-	record->frames = NULL;
-	free(record->stack);
-	record->stack = NULL;
 	free(record->globals);
 	record->globals = NULL;
 	record->global_count = 0;
@@ -1381,9 +1544,9 @@ void free_object_module_record(VM *vm, ObjectModuleRecord *record)
 
 ObjectStruct *new_struct_type(VM *vm, ObjectString *name)
 {
-	push(vm->current_module_record, OBJECT_VAL(name));
+	push(vm, OBJECT_VAL(name));
 	ObjectStruct *structObject = ALLOCATE_OBJECT(vm, ObjectStruct, OBJECT_STRUCT);
-	pop(vm->current_module_record);
+	pop(vm);
 	structObject->name = name;
 	init_table(&structObject->fields);
 	init_table(&structObject->methods);
@@ -1392,31 +1555,27 @@ ObjectStruct *new_struct_type(VM *vm, ObjectString *name)
 
 ObjectStructInstance *new_struct_instance(VM *vm, ObjectStruct *struct_type, const uint16_t field_count)
 {
-	push(vm->current_module_record, OBJECT_VAL(struct_type));
-	ObjectStructInstance *struct_instance = ALLOCATE_OBJECT(vm, ObjectStructInstance, OBJECT_STRUCT_INSTANCE);
-	push(vm->current_module_record, OBJECT_VAL(struct_instance));
+	push(vm, OBJECT_VAL(struct_type));
+	ObjectStructInstance *struct_instance = (ObjectStructInstance *)
+		allocate_pooled_object(vm, STRUCT_INSTANCE_SIZE(field_count), OBJECT_STRUCT_INSTANCE);
 	struct_instance->struct_type = struct_type;
-	struct_instance->fields = NULL;
-	struct_instance->field_count = 0;
-	struct_instance->fields = ALLOCATE(vm, Value, field_count);
+	struct_instance->field_count = field_count;
 	for (int i = 0; i < field_count; i++) {
 		struct_instance->fields[i] = NIL_VAL;
 	}
-	struct_instance->field_count = field_count;
-	pop(vm->current_module_record);
-	pop(vm->current_module_record);
+	pop(vm);
 	return struct_instance;
 }
 
 ObjectVector *new_vector(VM *vm, const uint32_t dimensions)
 {
 	ObjectVector *vector = ALLOCATE_OBJECT(vm, ObjectVector, OBJECT_VECTOR);
-	push(vm->current_module_record, OBJECT_VAL(vector));
+	push(vm, OBJECT_VAL(vector));
 	vector->dimensions = dimensions;
 	if (vector->dimensions > 4) {
 		vector->as.h_components = ALLOCATE(vm, double, dimensions);
 	}
-	pop(vm->current_module_record);
+	pop(vm);
 	return vector;
 }
 
@@ -1433,9 +1592,9 @@ ObjectMatrix *new_matrix(VM *vm, const uint16_t row_dim, const uint16_t col_dim)
 	ObjectMatrix *matrix = ALLOCATE_OBJECT(vm, ObjectMatrix, OBJECT_MATRIX);
 	matrix->row_dim = row_dim;
 	matrix->col_dim = col_dim;
-	push(vm->current_module_record, OBJECT_VAL(matrix));
+	push(vm, OBJECT_VAL(matrix));
 	matrix->data = ALLOCATE(vm, double, row_dim *col_dim);
-	pop(vm->current_module_record);
+	pop(vm);
 	return matrix;
 }
 
@@ -1452,16 +1611,18 @@ ObjectIterator *new_iterator(VM *vm, Value iterable)
 {
 	ObjectIterator *iterator = ALLOCATE_OBJECT(vm, ObjectIterator, OBJECT_ITERATOR);
 	iterator->iterable = iterable;
+	iterator->operand = NIL_VAL;
 	iterator->index = 0;
+	iterator->kind = ITERATOR_SEQUENCE;
 	return iterator;
 }
 
 ObjectSet *new_set(VM *vm, uint32_t element_count)
 {
 	ObjectSet *set = ALLOCATE_OBJECT(vm, ObjectSet, OBJECT_SET);
-	push(vm->current_module_record, OBJECT_VAL(set));
+	push(vm, OBJECT_VAL(set));
 	set->entries = new_object_table(vm, element_count);
-	pop(vm->current_module_record);
+	pop(vm);
 	return set;
 }
 
@@ -1472,9 +1633,9 @@ ObjectBuffer *new_buffer(VM *vm, uint32_t buffer_size)
 	buffer->read_pos = 0;
 	buffer->write_pos = 0;
 	buffer->data = NULL;
-	push(vm->current_module_record, OBJECT_VAL(buffer));
+	push(vm, OBJECT_VAL(buffer));
 	buffer->data = ALLOCATE(vm, uint8_t, buffer->capacity);
-	pop(vm->current_module_record);
+	pop(vm);
 	return buffer;
 }
 
@@ -1483,9 +1644,9 @@ ObjectTuple *new_tuple(VM *vm, uint32_t size)
 	ObjectTuple *tuple = ALLOCATE_OBJECT(vm, ObjectTuple, OBJECT_TUPLE);
 	tuple->elements = NULL;
 	tuple->size = size;
-	push(vm->current_module_record, OBJECT_VAL(tuple));
+	push(vm, OBJECT_VAL(tuple));
 	tuple->elements = ALLOCATE(vm, Value, size);
-	pop(vm->current_module_record);
+	pop(vm);
 	return tuple;
 }
 
@@ -1573,12 +1734,12 @@ bool range_contains(const ObjectRange *range, int32_t value)
  * Returns true if there is a next value, false otherwise.
  * result is set to the next value if there is one.
  */
-bool iterate_next(ObjectModuleRecord *module_record, ObjectIterator *iterator, Value *result)
+bool iterate_next(VM *vm, ObjectIterator *iterator, Value *result)
 {
 	const Value iterable = iterator->iterable;
 
 	if (!IS_CRUX_OBJECT(iterable)) {
-		runtime_panic(module_record, TYPE, "Cannot iterate over a non-iterable value");
+		runtime_panic(vm, TYPE, "Cannot iterate over a non-iterable value");
 		return false;
 	}
 
@@ -1615,16 +1776,16 @@ bool iterate_next(ObjectModuleRecord *module_record, ObjectIterator *iterator, V
 			return false;
 		}
 		const utf8_int8_t **starts = NULL;
-		if (!collect_string_codepoint_starts(module_record->owner, string, &starts)) {
-			runtime_panic(module_record, MEMORY, "Failed to iterate string.");
+		if (!collect_string_codepoint_starts(vm, string, &starts)) {
+			runtime_panic(vm, MEMORY, "Failed to iterate string.");
 			return false;
 		}
 
 		const utf8_int8_t *start = starts[iterator->index];
 		const utf8_int8_t *end = starts[iterator->index + 1];
 		const int length = (int)(end - start);
-		ObjectString *element = copy_string(module_record->owner, (const char *)start, length);
-		FREE(module_record->owner, const utf8_int8_t *, starts);
+		ObjectString *element = copy_string(vm, (const char *)start, length);
+		FREE(vm, const utf8_int8_t *, starts);
 		*result = OBJECT_VAL(element);
 		iterator->index++;
 		return true;
@@ -1665,7 +1826,7 @@ bool iterate_next(ObjectModuleRecord *module_record, ObjectIterator *iterator, V
 		return false;
 	}
 	default:
-		runtime_panic(module_record, TYPE,
+		runtime_panic(vm, TYPE,
 					  "Cannot iterate over this value. Supported iterables are Array | Set | Tuple | String | Buffer | "
 					  "Range | Vector | Matrix | Iterator.");
 		return false;
@@ -1674,8 +1835,45 @@ bool iterate_next(ObjectModuleRecord *module_record, ObjectIterator *iterator, V
 
 ObjectOption *new_option(VM *vm, Value value, bool is_some)
 {
+	if (!is_some && vm->none_option != NULL) {
+		return vm->none_option;
+	}
 	ObjectOption *option = ALLOCATE_OBJECT(vm, ObjectOption, OBJECT_OPTION);
 	option->value = value;
 	option->is_some = is_some;
 	return option;
 }
+
+ObjectCoroutine *new_coroutine(VM *vm, ObjectClosure *closure)
+{
+	ObjectCoroutine *coroutine = ALLOCATE_OBJECT(vm, ObjectCoroutine, OBJECT_COROUTINE);
+	coroutine->closure = closure;
+	coroutine->resumer = NULL;
+	coroutine->transfer = NIL_VAL;
+	coroutine->stack = NULL;
+	coroutine->stack_top = NULL;
+	coroutine->stack_limit = NULL;
+	coroutine->frames = NULL;
+	coroutine->open_upvalues = NULL;
+	coroutine->wake_at_ms = 0;
+	coroutine->wait_fd = -1;
+	coroutine->state = COROUTINE_CREATED;
+	coroutine->wait = COROUTINE_WAIT_NONE;
+	coroutine->frame_count = 0;
+	coroutine->frame_capacity = 0;
+	coroutine->is_scheduled = false;
+	coroutine->next_live = vm->coroutines;
+	vm->coroutines = coroutine;
+
+	push(vm, OBJECT_VAL(coroutine));
+	// room for the first frame, like reserve_frame_stack() makes for later calls
+	const size_t first_frame = (size_t)closure->function->arity + 1 + closure->function->chunk.count + STACK_RESERVE;
+	const size_t stack_capacity = first_frame > COROUTINE_STACK_INITIAL ? first_frame : COROUTINE_STACK_INITIAL;
+	coroutine->stack = ALLOCATE(vm, Value, stack_capacity);
+	coroutine->stack_top = coroutine->stack;
+	coroutine->stack_limit = coroutine->stack + stack_capacity;
+	coroutine->frames = ALLOCATE(vm, CallFrame, COROUTINE_FRAMES_INITIAL);
+	coroutine->frame_capacity = COROUTINE_FRAMES_INITIAL;
+	pop(vm);
+	return coroutine;
+}
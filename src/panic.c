@@ -6,9 +6,11 @@
 #include "panic.h"
 #include "vm.h"
 
+#define STACK_TRACE_EDGE_FRAMES 16 // frames shown at each end of a long stack trace
+
 char *repeat(const char c, const int count)
 {
-	static char buffer[256];
+	static _Thread_local char buffer[256];
 	int i;
 	for (i = 0; i < count && i < (int)sizeof(buffer) - 1; i++) {
 		buffer[i] = c;
@@ -265,7 +267,7 @@ void compiler_panicf_at_current(Parser *parser, ErrorType error_type, const char
 	va_end(args);
 }
 
-void runtime_panic(ObjectModuleRecord *module_record, const ErrorType type, const char *format, ...)
+void runtime_panic(VM *vm, const ErrorType type, const char *format, ...)
 {
 	const ErrorDetails details = getErrorDetails(type);
 
@@ -278,83 +280,84 @@ void runtime_panic(ObjectModuleRecord *module_record, const ErrorType type, cons
 	fprintf(stderr, "%s\n", RESET);
 	va_end(args);
 
-	if (module_record == NULL) {
+	if (vm == NULL) {
 		return;
 	}
 
 	fprintf(stderr, "\n%sStack trace (most recent call last):%s", CYAN, RESET);
 
-	const ObjectModuleRecord *traceModule = module_record;
+	// imported modules run on the VM stack too, so their frames sit above those of the scripts importing them
+	const ObjectModuleRecord *traceModule = vm->current_module_record;
 	int globalFrameNumber = 0;
 
-	while (traceModule != NULL) {
-		if (!traceModule->is_main) {
-			fprintf(stderr, "\n  %s--- imported from module \"%s\" ---%s", MAGENTA,
-					traceModule->enclosing_module->path ? traceModule->enclosing_module->path->chars : "<unknown>",
-					RESET);
+	const int frame_count = (int)vm->frame_count;
+	for (int i = frame_count - 1; i >= 0; i--) {
+		// deep recursion would bury the error, so only both ends of a long trace are shown
+		if (frame_count > 2 * STACK_TRACE_EDGE_FRAMES && i == frame_count - 1 - STACK_TRACE_EDGE_FRAMES) {
+			const int omitted = frame_count - 2 * STACK_TRACE_EDGE_FRAMES;
+			fprintf(stderr, "\n  %s... %d frames omitted ...%s", CYAN, omitted, RESET);
+			globalFrameNumber += omitted;
+			i = STACK_TRACE_EDGE_FRAMES - 1;
 		}
-
-		for (int i = (int)traceModule->frame_count - 1; i >= 0; i--) {
-			const CallFrame *frame = &traceModule->frames[i];
-			const ObjectFunction *function = frame->closure->function;
-			size_t instruction = 0;
-
-			if (function->chunk.code != NULL && frame->ip >= function->chunk.code) {
-				instruction = frame->ip - function->chunk.code - 1;
-				if (instruction >= (size_t)function->chunk.count) {
-					instruction = function->chunk.count > 0 ? function->chunk.count - 1 : 0;
-				}
-			} else if (function->chunk.count > 0) {
-				instruction = function->chunk.count - 1;
+		const CallFrame *frame = &vm->frames[i];
+		const ObjectFunction *function = frame->closure->function;
+		size_t instruction = 0;
+
+		if (function->chunk.threaded != NULL && frame->ip >= function->chunk.threaded) {
+			instruction = frame->ip - function->chunk.threaded - 1;
+			if (instruction >= (size_t)function->chunk.count) {
+				instruction = function->chunk.count > 0 ? function->chunk.count - 1 : 0;
 			}
+		} else if (function->chunk.count > 0) {
+			instruction = function->chunk.count - 1;
+		}
 
-			fprintf(stderr, "\n  %s[frame %d]%s ", CYAN, globalFrameNumber++, RESET);
-
-			int line = 0;
-			if (function->chunk.lines != NULL && instruction < (size_t)function->chunk.capacity) {
-				line = function->chunk.lines[instruction];
-			} else if (function->chunk.lines != NULL && function->chunk.capacity > 0) {
-				line = function->chunk.lines[0]; // Fallback
-			}
-			fprintf(stderr, "line %d in ", line);
+		fprintf(stderr, "\n  %s[frame %d]%s ", CYAN, globalFrameNumber++, RESET);
 
-			const ObjectString *funcModulePath = NULL;
-			if (function->module_record != NULL && function->module_record->path != NULL) {
-				funcModulePath = function->module_record->path;
-			} else if (traceModule->path != NULL) {
-				funcModulePath = traceModule->path;
-			}
+		int line = 0;
+		if (function->chunk.lines != NULL && instruction < (size_t)function->chunk.capacity) {
+			line = function->chunk.lines[instruction];
+		} else if (function->chunk.lines != NULL && function->chunk.capacity > 0) {
+			line = function->chunk.lines[0]; // Fallback
+		}
+		fprintf(stderr, "line %d in ", line);
+
+		const ObjectModuleRecord *frameModule = function->module_record != NULL ? function->module_record : traceModule;
+		const ObjectString *funcModulePath = NULL;
+		if (frameModule->path != NULL) {
+			funcModulePath = frameModule->path;
+		} else if (traceModule->path != NULL) {
+			funcModulePath = traceModule->path;
+		}
 
-			if (function->name == NULL || function->name->byte_length == 0) {
-				if (funcModulePath != NULL) {
-					if (traceModule->is_repl) {
-						fprintf(stderr,
-								"%sscript from "
-								"\"repl\" %s",
-								CYAN, RESET);
-					} else {
-						fprintf(stderr,
-								"%sscript from \"%s\" "
-								"%s",
-								CYAN, funcModulePath->chars, RESET);
-					}
+		if (function->name == NULL || function->name->byte_length == 0) {
+			if (funcModulePath != NULL) {
+				if (frameModule->is_repl) {
+					fprintf(stderr,
+							"%sscript from "
+							"\"repl\" %s",
+							CYAN, RESET);
 				} else {
-					fprintf(stderr, "%s<script>%s", CYAN, RESET);
+					fprintf(stderr,
+							"%sscript from \"%s\" "
+							"%s",
+							CYAN, funcModulePath->chars, RESET);
 				}
 			} else {
-				if (funcModulePath != NULL) {
-					fprintf(stderr, "%s%s() from \"%s\"%s", CYAN, function->name->chars, funcModulePath->chars, RESET);
-				} else {
-					fprintf(stderr, "%s%s()%s", CYAN, function->name->chars, RESET);
-				}
+				fprintf(stderr, "%s<script>%s", CYAN, RESET);
+			}
+		} else {
+			if (funcModulePath != NULL) {
+				fprintf(stderr, "%s%s() from \"%s\"%s", CYAN, function->name->chars, funcModulePath->chars, RESET);
+			} else {
+				fprintf(stderr, "%s%s()%s", CYAN, function->name->chars, RESET);
 			}
 		}
-		traceModule = traceModule->enclosing_module;
 	}
 	fprintf(stderr, "\n%s%s%s\n\n", RED, repeat('=', 60), RESET);
 
-	reset_stack(module_record);
-	longjmp(module_record->owner->jump_buffer, INTERPRET_RUNTIME_ERROR);
+	reset_stack(vm);
+	longjmp(vm->jump_buffer, INTERPRET_RUNTIME_ERROR);
 }
 
 /**
@@ -363,7 +366,7 @@ void runtime_panic(ObjectModuleRecord *module_record, const ErrorType type, cons
  */
 char *type_error_message(VM *vm, const Value value, const char *expected_type)
 {
-	static char buffer[1024];
+	static _Thread_local char buffer[1024];
 
 	const Value typeValue = typeof_value(vm, value);
 	char *actualType = AS_C_STRING(typeValue);
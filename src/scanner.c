@@ -319,6 +319,8 @@ static CruxTokenType identifier_type(Scanner *scanner)
 	}
 	case 'w':
 		return check_keyword(scanner, 1, 4, "hile", CRUX_TOKEN_WHILE);
+	case 'y':
+		return check_keyword(scanner, 1, 4, "ield", CRUX_TOKEN_YIELD);
 	case 'f': {
 		if (scanner->current - scanner->start > 1) {
 			switch (scanner->start[1]) {
@@ -22,7 +22,7 @@ Value array_push_method(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to add element to array.", RUNTIME);
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+	return native_ok(vm, NIL_VAL);
 }
 
 /**
@@ -42,7 +42,7 @@ Value array_pop_method(VM *vm, const Value *args)
 	array->values[array->size - 1] = NIL_VAL;
 	array->size--;
 
-	return OBJECT_VAL(new_ok_result(vm, popped));
+	return native_ok(vm, popped);
 }
 
 /**
@@ -66,7 +66,7 @@ Value array_insert_method(VM *vm, const Value *args)
 	if (!array_add(vm, array, toInsert, insert_at)) {
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to allocate enough memory for new array.", MEMORY);
 	}
-	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+	return native_ok(vm, NIL_VAL);
 }
 
 /**
@@ -92,7 +92,7 @@ Value array_remove_at_method(VM *vm, const Value *args)
 	}
 
 	array->size--;
-	return OBJECT_VAL(new_ok_result(vm, removed_element));
+	return native_ok(vm, removed_element);
 }
 
 /**
@@ -112,7 +112,7 @@ Value array_concat_method(VM *vm, const Value *args)
 	}
 
 	ObjectArray *resultArray = new_array(vm, combined_size);
-	push(vm->current_module_record, OBJECT_VAL(resultArray));
+	push(vm, OBJECT_VAL(resultArray));
 
 	for (uint32_t i = 0; i < combined_size; i++) {
 		resultArray->values[i] = i < array->size ? array->values[i] : targetArray->values[i - array->size];
@@ -120,9 +120,8 @@ Value array_concat_method(VM *vm, const Value *args)
 
 	resultArray->size = combined_size;
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(resultArray));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(resultArray));
 }
 
 /**
@@ -152,16 +151,15 @@ Value array_slice_method(VM *vm, const Value *args)
 
 	const size_t sliceSize = end_index - start_index;
 	ObjectArray *slicedArray = new_array(vm, sliceSize);
-	push(vm->current_module_record, OBJECT_VAL(slicedArray));
+	push(vm, OBJECT_VAL(slicedArray));
 
 	for (size_t i = 0; i < sliceSize; i++) {
 		slicedArray->values[i] = array->values[start_index + i];
 		slicedArray->size += 1;
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(slicedArray));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(slicedArray));
 }
 
 /**
@@ -189,7 +187,7 @@ Value array_reverse_method(VM *vm, const Value *args)
 
 	FREE(vm, Value, values);
 
-	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+	return native_ok(vm, NIL_VAL);
 }
 
 /**
@@ -205,7 +203,7 @@ Value array_index_of_method(VM *vm, const Value *args)
 
 	for (uint32_t i = 0; i < array->size; i++) {
 		if (values_equal(target, array->values[i])) {
-			return OBJECT_VAL(new_ok_result(vm, INT_VAL(i)));
+			return native_ok(vm, INT_VAL(i));
 		}
 	}
 	return MAKE_GC_SAFE_ERROR(vm, "Value could not be found in the array.", VALUE);
@@ -284,38 +282,28 @@ Value arrayEqualsMethod(VM *vm, const Value *args)
 Value array_map_method(VM *vm, const Value *args)
 {
 	const ObjectArray *array = AS_CRUX_ARRAY(args[0]);
-	ObjectModuleRecord *currentModuleRecord = vm->current_module_record;
 
 	const Value callable = args[1];
 
 	ObjectArray *resultArray = new_array(vm, array->size);
-	push(currentModuleRecord, OBJECT_VAL(resultArray));
+	push(vm, OBJECT_VAL(resultArray));
 
 	for (uint32_t i = 0; i < array->size; i++) {
-		const Value arrayValue = array->values[i];
-		push(currentModuleRecord, callable);
-		push(currentModuleRecord, arrayValue);
-		InterpretResult res;
-		ObjectResult *result = execute_callable(vm, callable, 1, &res);
-
-		if (res != INTERPRET_OK) {
-			if (!result->is_ok) {
-				pop(currentModuleRecord); // arrayValue
-				pop(currentModuleRecord); // closure
-				return OBJECT_VAL(result);
-			}
+		push(vm, callable);
+		push(vm, array->values[i]);
+		Value mapped;
+		if (call_from_native(vm, callable, 1, &mapped) != INTERPRET_OK) {
+			pop(vm); // resultArray
+			return MAKE_GC_SAFE_ERROR(vm, "Failed to call the map function.", RUNTIME);
 		}
 
-		if (result->is_ok) {
-			array_add_back(vm, resultArray, result->as.value);
-		} else {
-			array_add_back(vm, resultArray, OBJECT_VAL(result->as.error));
-		}
-		pop(currentModuleRecord); // arrayValue
+		push(vm, mapped);
+		array_add_back(vm, resultArray, mapped);
+		pop(vm); // mapped
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(resultArray));
-	pop(currentModuleRecord); // resultArray
+	pop(vm); // resultArray
 	return OBJECT_VAL(res);
 }
 
@@ -327,42 +315,34 @@ Value array_map_method(VM *vm, const Value *args)
  */
 Value array_filter_method(VM *vm, const Value *args)
 {
-	ObjectModuleRecord *currentModuleRecord = vm->current_module_record;
 	const ObjectArray *array = AS_CRUX_ARRAY(args[0]);
 
 	const Value callable = args[1];
 
 	ObjectArray *resultArray = new_array(vm, array->size);
-	push(currentModuleRecord, OBJECT_VAL(resultArray));
+	push(vm, OBJECT_VAL(resultArray));
 
-	uint32_t addCount = 0;
 	for (uint32_t i = 0; i < array->size; i++) {
 		const Value arrayValue = array->values[i];
-		push(currentModuleRecord, callable);
-		push(currentModuleRecord, arrayValue);
-		InterpretResult res;
-		ObjectResult *result = execute_callable(vm, callable, 1, &res);
-
-		if (res != INTERPRET_OK) {
-			if (!result->is_ok) {
-				pop(currentModuleRecord); // arrayValue
-				pop(currentModuleRecord); // closure
-				return OBJECT_VAL(result);
-			}
+		push(vm, arrayValue); // the predicate may remove it from the array
+		push(vm, callable);
+		push(vm, arrayValue);
+		Value keep;
+		if (call_from_native(vm, callable, 1, &keep) != INTERPRET_OK) {
+			pop(vm); // arrayValue
+			pop(vm); // resultArray
+			return MAKE_GC_SAFE_ERROR(vm, "Failed to call the filter function.", RUNTIME);
 		}
 
-		if (result->is_ok) {
-			if (!is_falsy(result->as.value)) {
-				array_add_back(vm, resultArray, arrayValue);
-				addCount++;
-			}
+		// an Error returned by the predicate rejects the element
+		if (!IS_CRUX_ERROR(keep) && !is_falsy(keep)) {
+			array_add_back(vm, resultArray, arrayValue);
 		}
-		pop(currentModuleRecord); // arrayValue
+		pop(vm); // arrayValue
 	}
 
-	resultArray->size = addCount;
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(resultArray));
-	pop(currentModuleRecord); // resultArray
+	pop(vm); // resultArray
 	return OBJECT_VAL(res);
 }
 
@@ -376,43 +356,32 @@ Value array_filter_method(VM *vm, const Value *args)
 Value array_reduce_method(VM *vm, const Value *args)
 {
 	const ObjectArray *array = AS_CRUX_ARRAY(args[0]);
-	ObjectModuleRecord *currentModuleRecord = vm->current_module_record;
 
 	const Value callable = args[1];
 
 	Value accumulator = args[2];
+	push(vm, accumulator);
 
 	for (uint32_t i = 0; i < array->size; i++) {
-		const Value arrayValue = array->values[i];
+		push(vm, callable);
+		push(vm, array->values[i]);
+		push(vm, accumulator);
 
-		push(currentModuleRecord, callable);
-		push(currentModuleRecord, arrayValue);
-		push(currentModuleRecord, accumulator);
-
-		InterpretResult res;
-
-		ObjectResult *result = execute_callable(vm, callable, 2, &res);
-
-		if (res != INTERPRET_OK) {
-			if (!result->is_ok) {
-				pop(currentModuleRecord); // accumulator
-				pop(currentModuleRecord); // arrayValue
-				pop(currentModuleRecord); // closure
-				return OBJECT_VAL(result);
-			}
+		if (call_from_native(vm, callable, 2, &accumulator) != INTERPRET_OK) {
+			pop(vm); // accumulator
+			return MAKE_GC_SAFE_ERROR(vm, "Failed to call the reduce function.", RUNTIME);
 		}
-
-		if (result->is_ok) {
-			accumulator = result->as.value;
-		} else {
-			pop(currentModuleRecord); // result
-			return OBJECT_VAL(result);
+		if (IS_CRUX_ERROR(accumulator)) {
+			ObjectResult *error = new_error_result(vm, AS_CRUX_ERROR(accumulator));
+			pop(vm); // accumulator
+			return OBJECT_VAL(error);
 		}
-
-		pop(currentModuleRecord); // result
+		vm->stack_top[-1] = accumulator; // keep the running value rooted
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, accumulator));
+	ObjectResult *result = new_ok_result(vm, accumulator);
+	pop(vm); // accumulator
+	return OBJECT_VAL(result);
 }
 
 static int compare_values(const Value a, const Value b)
@@ -522,7 +491,7 @@ Value array_sort_method(VM *vm, const Value *args)
 	const ObjectArray *array = AS_CRUX_ARRAY(args[0]);
 
 	if (array->size == 0) {
-		return OBJECT_VAL(new_ok_result(vm, args[0]));
+		return native_ok(vm, args[0]);
 	}
 
 	if (!all_elements_sortable(array)) {
@@ -530,8 +499,7 @@ Value array_sort_method(VM *vm, const Value *args)
 	}
 
 	ObjectArray *sortedArray = new_array(vm, array->size);
-	ObjectModuleRecord *currentModuleRecord = vm->current_module_record;
-	push(currentModuleRecord, OBJECT_VAL(sortedArray));
+	push(vm, OBJECT_VAL(sortedArray));
 
 	for (uint32_t i = 0; i < array->size; i++) {
 		sortedArray->values[i] = array->values[i];
@@ -540,9 +508,8 @@ Value array_sort_method(VM *vm, const Value *args)
 
 	quick_sort(sortedArray->values, 0, (int)sortedArray->size - 1);
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(sortedArray));
-	pop(currentModuleRecord);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(sortedArray));
 }
 
 /**
@@ -558,10 +525,7 @@ Value array_join_method(VM *vm, const Value *args)
 
 	if (array->size == 0) {
 		ObjectString *emptyResult = copy_string(vm, "", 0);
-		push(vm->current_module_record, OBJECT_VAL(emptyResult));
-		ObjectResult *res = new_ok_result(vm, OBJECT_VAL(emptyResult));
-		pop(vm->current_module_record);
-		return OBJECT_VAL(res);
+		return native_ok(vm, OBJECT_VAL(emptyResult));
 	}
 
 	// estimate: 3 chars per element + separators
@@ -575,7 +539,7 @@ Value array_join_method(VM *vm, const Value *args)
 
 	for (uint32_t i = 0; i < array->size; i++) {
 		ObjectString *element = to_string(vm, array->values[i]);
-		push(vm->current_module_record, OBJECT_VAL(element));
+		push(vm, OBJECT_VAL(element));
 
 		size_t neededSpace = element->byte_length;
 		if (i > 0) {
@@ -588,7 +552,7 @@ Value array_join_method(VM *vm, const Value *args)
 			char *newBuffer = realloc(buffer, newSize);
 			if (!newBuffer) {
 				free(buffer);
-				pop(vm->current_module_record); // element
+				pop(vm); // element
 				return MAKE_GC_SAFE_ERROR(vm, "Memory reallocation failed", MEMORY);
 			}
 			buffer = newBuffer;
@@ -603,7 +567,7 @@ Value array_join_method(VM *vm, const Value *args)
 		memcpy(buffer + actual_length, element->chars, element->byte_length);
 		actual_length += element->byte_length;
 
-		pop(vm->current_module_record); // element
+		pop(vm); // element
 	}
 
 	if (actual_length >= bufferSize) {
@@ -617,8 +581,5 @@ Value array_join_method(VM *vm, const Value *args)
 	buffer[actual_length] = '\0';
 
 	ObjectString *result = take_string(vm, buffer, (uint32_t)actual_length);
-	push(vm->current_module_record, OBJECT_VAL(result));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(result));
 }
@@ -88,9 +88,9 @@ Value write_byte_buffer_method(VM *vm, const Value *args)
 
 	buffer->data[buffer->write_pos++] = byte;
 
-	push(vm->current_module_record, OBJECT_VAL(buffer));
+	push(vm, OBJECT_VAL(buffer));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(buffer));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -295,9 +295,9 @@ Value write_string_buffer_method(VM *vm, const Value *args)
 	memcpy(buffer->data + buffer->write_pos, string->chars, string->byte_length);
 	buffer->write_pos += (uint32_t)string->byte_length;
 
-	push(vm->current_module_record, OBJECT_VAL(buffer));
+	push(vm, OBJECT_VAL(buffer));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(buffer));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -320,9 +320,9 @@ Value write_buffer_buffer_method(VM *vm, const Value *args)
 	memcpy(self->data + self->write_pos, other->data + other->read_pos, readable);
 	self->write_pos += readable;
 
-	push(vm->current_module_record, OBJECT_VAL(self));
+	push(vm, OBJECT_VAL(self));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(self));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -366,9 +366,9 @@ Value read_string_buffer_method(VM *vm, const Value *args)
 	ObjectString *string = copy_string(vm, (const char *)(buffer->data + buffer->read_pos), n);
 	buffer->read_pos += (uint32_t)n;
 
-	push(vm->current_module_record, OBJECT_VAL(string));
+	push(vm, OBJECT_VAL(string));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(string));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -398,9 +398,9 @@ Value read_line_buffer_method(VM *vm, const Value *args)
 	// advance past the newline if we found one
 	buffer->read_pos = (end < buffer->write_pos) ? end + 1 : end;
 
-	push(vm->current_module_record, OBJECT_VAL(string));
+	push(vm, OBJECT_VAL(string));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(string));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -420,9 +420,9 @@ Value read_all_buffer_method(VM *vm, const Value *args)
 	ObjectString *string = copy_string(vm, (const char *)(buffer->data + buffer->read_pos), (int)readable);
 	buffer->read_pos = buffer->write_pos;
 
-	push(vm->current_module_record, OBJECT_VAL(string));
+	push(vm, OBJECT_VAL(string));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(string));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -43,45 +43,52 @@ Value new_complex_function(VM *vm, const Value *args)
 	return OBJECT_VAL(comp);
 }
 
-Value complex_add_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs)
+static Value complex_value(VM *vm, ObjectComplex *target, const double real, const double imag)
 {
-	(void)vm;
-	return OBJECT_VAL(new_complex_number(vm, lhs->real + rhs->real, lhs->imag + rhs->imag));
+	if (target == NULL) {
+		return OBJECT_VAL(new_complex_number(vm, real, imag));
+	}
+	target->real = real;
+	target->imag = imag;
+	return OBJECT_VAL(target);
 }
 
-Value complex_subtract_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs)
+Value complex_add_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs, ObjectComplex *target)
 {
-	(void)vm;
-	return OBJECT_VAL(new_complex_number(vm, lhs->real - rhs->real, lhs->imag - rhs->imag));
+	return complex_value(vm, target, lhs->real + rhs->real, lhs->imag + rhs->imag);
+}
+
+Value complex_subtract_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs, ObjectComplex *target)
+{
+	return complex_value(vm, target, lhs->real - rhs->real, lhs->imag - rhs->imag);
 }
 
-Value complex_multiply_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs)
+Value complex_multiply_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs, ObjectComplex *target)
 {
 	const double real = lhs->real * rhs->real - lhs->imag * rhs->imag;
 	const double imag = lhs->real * rhs->imag + lhs->imag * rhs->real;
-	return OBJECT_VAL(new_complex_number(vm, real, imag));
+	return complex_value(vm, target, real, imag);
 }
 
-Value complex_divide_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs)
+Value complex_divide_value(VM *vm, const ObjectComplex *lhs, const ObjectComplex *rhs, ObjectComplex *target)
 {
 	const double c = rhs->real;
 	const double d = rhs->imag;
 	const double denom = c * c + d * d;
-	return OBJECT_VAL(new_complex_number(vm, (lhs->real * c + lhs->imag * d) / denom,
-										 (lhs->imag * c - lhs->real * d) / denom));
+	return complex_value(vm, target, (lhs->real * c + lhs->imag * d) / denom, (lhs->imag * c - lhs->real * d) / denom);
 }
 
-Value complex_scalar_multiply_value(VM *vm, const ObjectComplex *value, const double scalar)
+Value complex_scalar_multiply_value(VM *vm, const ObjectComplex *value, const double scalar, ObjectComplex *target)
 {
-	return OBJECT_VAL(new_complex_number(vm, value->real * scalar, value->imag * scalar));
+	return complex_value(vm, target, value->real * scalar, value->imag * scalar);
 }
 
-Value complex_scalar_divide_value(VM *vm, const ObjectComplex *value, const double scalar)
+Value complex_scalar_divide_value(VM *vm, const ObjectComplex *value, const double scalar, ObjectComplex *target)
 {
 	if (fabs(scalar) < 1e-10) {
 		return MAKE_GC_SAFE_ERROR(vm, "Division by zero.", MATH);
 	}
-	return OBJECT_VAL(new_complex_number(vm, value->real / scalar, value->imag / scalar));
+	return complex_value(vm, target, value->real / scalar, value->imag / scalar);
 }
 
 /**
@@ -92,7 +99,7 @@ Value complex_scalar_divide_value(VM *vm, const ObjectComplex *value, const doub
  */
 Value add_complex_number_method(VM *vm, const Value *args)
 {
-	return complex_add_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]));
+	return complex_add_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]), NULL);
 }
 
 /**
@@ -103,7 +110,7 @@ Value add_complex_number_method(VM *vm, const Value *args)
  */
 Value sub_complex_number_method(VM *vm, const Value *args)
 {
-	return complex_subtract_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]));
+	return complex_subtract_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]), NULL);
 }
 
 /**
@@ -114,7 +121,7 @@ Value sub_complex_number_method(VM *vm, const Value *args)
  */
 Value mul_complex_number_method(VM *vm, const Value *args)
 {
-	return complex_multiply_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]));
+	return complex_multiply_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]), NULL);
 }
 
 /**
@@ -125,7 +132,7 @@ Value mul_complex_number_method(VM *vm, const Value *args)
  */
 Value div_complex_number_method(VM *vm, const Value *args)
 {
-	return complex_divide_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]));
+	return complex_divide_value(vm, AS_CRUX_COMPLEX(args[0]), AS_CRUX_COMPLEX(args[1]), NULL);
 }
 
 /**
@@ -136,7 +143,7 @@ Value div_complex_number_method(VM *vm, const Value *args)
  */
 Value scale_complex_number_method(VM *vm, const Value *args)
 {
-	return complex_scalar_multiply_value(vm, AS_CRUX_COMPLEX(args[0]), TO_DOUBLE(args[1]));
+	return complex_scalar_multiply_value(vm, AS_CRUX_COMPLEX(args[0]), TO_DOUBLE(args[1]), NULL);
 }
 
 /**
@@ -68,7 +68,7 @@ static Value cast_array(VM *vm, const Value *args, bool *success)
 	if (IS_CRUX_STRING(value)) {
 		const ObjectString *string = AS_CRUX_STRING(value);
 		ObjectArray *array = new_array(vm, string->code_point_length);
-		push(vm->current_module_record, OBJECT_VAL(array));
+		push(vm, OBJECT_VAL(array));
 
 		const utf8_int8_t *cursor = string->chars;
 
@@ -76,27 +76,27 @@ static Value cast_array(VM *vm, const Value *args, bool *success)
 			size_t char_bytes = utf8codepointcalcsize(cursor);
 			ObjectString *char_str = copy_string(vm, cursor, char_bytes);
 
-			push(vm->current_module_record, OBJECT_VAL(char_str));
+			push(vm, OBJECT_VAL(char_str));
 
 			if (!array_add_back(vm, array, OBJECT_VAL(char_str))) {
-				pop(vm->current_module_record); // char_str
-				pop(vm->current_module_record); // array
+				pop(vm); // char_str
+				pop(vm); // array
 				*success = false;
 				return NIL_VAL;
 			}
-			pop(vm->current_module_record); // char_str
+			pop(vm); // char_str
 			cursor += char_bytes;
 		}
 
 		const Value result = OBJECT_VAL(array);
-		pop(vm->current_module_record); // array
+		pop(vm); // array
 		return result;
 	}
 
 	if (IS_CRUX_TABLE(value)) {
 		const ObjectTable *table = AS_CRUX_TABLE(value);
 		ObjectArray *array = new_array(vm, table->size * 2);
-		push(vm->current_module_record, OBJECT_VAL(array));
+		push(vm, OBJECT_VAL(array));
 
 		uint32_t index = 0;
 		for (uint32_t i = 0; i < table->capacity; i++) {
@@ -106,7 +106,7 @@ static Value cast_array(VM *vm, const Value *args, bool *success)
 			if (table->entries[i].is_occupied) {
 				if (!array_add_back(vm, array, table->entries[i].key) ||
 					!array_add_back(vm, array, table->entries[i].value)) {
-					pop(vm->current_module_record); // array
+					pop(vm); // array
 					*success = false;
 					return NIL_VAL;
 				}
@@ -115,21 +115,20 @@ static Value cast_array(VM *vm, const Value *args, bool *success)
 		}
 
 		const Value result = OBJECT_VAL(array);
-		pop(vm->current_module_record); // array
+		pop(vm); // array
 		return result;
 	}
 
 	ObjectArray *array = new_array(vm, 1);
-	push(vm->current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 	array_add(vm, array, value, 0);
 	const Value result = OBJECT_VAL(array);
-	pop(vm->current_module_record); // array
+	pop(vm); // array
 	return result;
 }
 
 static Value cast_table(VM *vm, const Value *args)
 {
-	ObjectModuleRecord *moduleRecord = vm->current_module_record;
 	const Value value = args[0];
 
 	if (IS_CRUX_TABLE(value)) {
@@ -139,7 +138,7 @@ static Value cast_table(VM *vm, const Value *args)
 	if (IS_CRUX_ARRAY(value)) {
 		const ObjectArray *array = AS_CRUX_ARRAY(value);
 		ObjectTable *table = new_object_table(vm, (int)array->size);
-		push(vm->current_module_record, OBJECT_VAL(table));
+		push(vm, OBJECT_VAL(table));
 
 		for (uint32_t i = 0; i < array->size; i++) {
 			const Value k = INT_VAL(i);
@@ -148,35 +147,35 @@ static Value cast_table(VM *vm, const Value *args)
 		}
 
 		const Value result = OBJECT_VAL(table);
-		pop(vm->current_module_record); // table
+		pop(vm); // table
 		return result;
 	}
 
 	if (IS_CRUX_STRING(value)) {
 		const ObjectString *string = AS_CRUX_STRING(value);
 		ObjectTable *table = new_object_table(vm, (int)string->code_point_length);
-		push(vm->current_module_record, OBJECT_VAL(table));
+		push(vm, OBJECT_VAL(table));
 
 		utf8_int8_t *cursor = string->chars;
 		for (uint32_t i = 0; i < string->code_point_length; i++) {
 			uint32_t char_bytes = utf8codepointcalcsize(cursor);
 			ObjectString *char_str = copy_string(vm, cursor, char_bytes);
-			push(vm->current_module_record, OBJECT_VAL(char_str));
+			push(vm, OBJECT_VAL(char_str));
 			object_table_set(vm, table, INT_VAL(i), OBJECT_VAL(char_str));
-			pop(vm->current_module_record); // char_str
+			pop(vm); // char_str
 			cursor += char_bytes;
 		}
 
 		const Value result = OBJECT_VAL(table);
-		pop(vm->current_module_record); // table
+		pop(vm); // table
 		return result;
 	}
 
 	ObjectTable *table = new_object_table(vm, 1);
-	push(vm->current_module_record, OBJECT_VAL(table));
+	push(vm, OBJECT_VAL(table));
 	object_table_set(vm, table, INT_VAL(0), value);
 	const Value result = OBJECT_VAL(table);
-	pop(vm->current_module_record); // table
+	pop(vm); // table
 	return result;
 }
 
@@ -269,7 +268,7 @@ Value int_function(VM *vm, const Value *args)
 	if (!success) {
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to convert value to integer.", RUNTIME);
 	}
-	return OBJECT_VAL(new_ok_result(vm, value));
+	return native_ok(vm, value);
 }
 
 /**
@@ -284,7 +283,7 @@ Value float_function(VM *vm, const Value *args)
 	if (!success) {
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to convert value to float.", RUNTIME);
 	}
-	return OBJECT_VAL(new_ok_result(vm, value));
+	return native_ok(vm, value);
 }
 
 /**
@@ -311,7 +310,7 @@ Value array_function(VM *vm, const Value *args)
 	if (!success) {
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to convert value to array.", RUNTIME);
 	}
-	return OBJECT_VAL(new_ok_result(vm, array));
+	return native_ok(vm, array);
 }
 
 /**
@@ -383,7 +382,7 @@ Value format_function(VM *vm, const Value *args)
 			const uint32_t key_byte_length = byte_i - token_start_offset - 1;
 			ObjectString *key = copy_string(vm, (const char *)(str->chars + token_start_offset + 1), key_byte_length);
 
-			push(vm->current_module_record, OBJECT_VAL(key));
+			push(vm, OBJECT_VAL(key));
 
 			Value val;
 			bool found = object_table_get(table->entries, table->size, table->capacity, OBJECT_VAL(key), &val);
@@ -424,11 +423,11 @@ Value format_function(VM *vm, const Value *args)
 	}
 
 	for (uint32_t i = 0; i < token_count; i++) {
-		pop(vm->current_module_record);
+		pop(vm);
 	}
 
 	free(tokens);
-	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+	return native_ok(vm, NIL_VAL);
 }
 
 Value iter_function(VM *vm, const Value *args)
@@ -437,7 +436,7 @@ Value iter_function(VM *vm, const Value *args)
 	if (!get_iterator_from_value(vm, args[0], &iterator)) {
 		return MAKE_GC_SAFE_ERROR(vm, "Expected an iterable object.", VALUE);
 	}
-	return OBJECT_VAL(new_ok_result(vm, iterator));
+	return native_ok(vm, iterator);
 }
 
 Value next_function(VM *vm, const Value *args)
@@ -0,0 +1,410 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#endif
+
+#include "garbage_collector.h"
+#include "panic.h"
+#include "stdlib/coroutine.h"
+#include "stdlib/io.h"
+
+#define EVENT_LOOP_BATCH 64
+#define INITIAL_EVENT_LOOP_CAPACITY 8
+
+static uint64_t loop_now_ms(void)
+{
+#ifdef _WIN32
+	return (uint64_t)GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#endif
+}
+
+static void sleep_for_ms(const int milliseconds)
+{
+	if (milliseconds <= 0)
+		return;
+#ifdef _WIN32
+	Sleep((DWORD)milliseconds);
+#else
+	usleep((useconds_t)milliseconds * 1000);
+#endif
+}
+
+void init_event_loop(EventLoop *loop)
+{
+	loop->tasks = NULL;
+	loop->count = 0;
+	loop->capacity = 0;
+	loop->poll_fd = -1;
+}
+
+void free_event_loop(EventLoop *loop)
+{
+	free(loop->tasks);
+#ifdef __linux__
+	if (loop->poll_fd >= 0) {
+		close(loop->poll_fd);
+	}
+#endif
+	init_event_loop(loop);
+}
+
+static bool schedule_task(EventLoop *loop, ObjectCoroutine *task)
+{
+	if (loop->count + 1 > loop->capacity) {
+		const uint32_t new_capacity = loop->capacity == 0 ? INITIAL_EVENT_LOOP_CAPACITY : loop->capacity * 2;
+		ObjectCoroutine **tasks = realloc(loop->tasks, new_capacity * sizeof(ObjectCoroutine *));
+		if (tasks == NULL) {
+			return false;
+		}
+		loop->tasks = tasks;
+		loop->capacity = new_capacity;
+	}
+	task->is_scheduled = true;
+	loop->tasks[loop->count++] = task;
+	return true;
+}
+
+/**
+ * Returns the running event loop task if it can be parked from the current native call, NULL otherwise.
+ */
+static ObjectCoroutine *parkable_task(const VM *vm)
+{
+	ObjectCoroutine *task = vm->current_coroutine;
+	if (task == NULL || !task->is_scheduled || vm->reentry_depth != 0) {
+		return NULL;
+	}
+	return task;
+}
+
+bool coroutine_park_timer(VM *vm, const double delay_ms)
+{
+	ObjectCoroutine *task = parkable_task(vm);
+	if (task == NULL) {
+		return false;
+	}
+	task->wait = COROUTINE_WAIT_TIMER;
+	task->wake_at_ms = loop_now_ms() + (uint64_t)(delay_ms > 0 ? delay_ms : 0);
+	return request_coroutine_yield(vm, NIL_VAL);
+}
+
+bool coroutine_park_fd(VM *vm, const int fd, const CoroutineWait wait)
+{
+	ObjectCoroutine *task = parkable_task(vm);
+	if (task == NULL) {
+		return false;
+	}
+#ifdef _WIN32
+	(void)fd;
+	(void)wait;
+	return false;
+#else
+	if (wait == COROUTINE_WAIT_READ_LINE) {
+		// Readiness comes from the kernel, so stdio must not hold lines back in its own buffer
+		static bool stdin_unbuffered = false;
+		if (!stdin_unbuffered) {
+			setvbuf(stdin, NULL, _IONBF, 0);
+			stdin_unbuffered = true;
+		}
+	}
+
+#ifdef __linux__
+	EventLoop *loop = &vm->event_loop;
+	if (loop->poll_fd < 0) {
+		loop->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (loop->poll_fd < 0) {
+			return false;
+		}
+	}
+	struct epoll_event event = {.events = EPOLLIN, .data.ptr = task};
+	// EPERM: regular files are always readable. EEXIST: another task already waits on this descriptor.
+	if (epoll_ctl(loop->poll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+		return false;
+	}
+#endif
+
+	task->wait = wait;
+	task->wait_fd = fd;
+	return request_coroutine_yield(vm, NIL_VAL);
+#endif
+}
+
+static void complete_wait(VM *vm, ObjectCoroutine *task)
+{
+	const CoroutineWait wait = task->wait;
+	task->wait = COROUTINE_WAIT_NONE;
+	task->wait_fd = -1;
+
+	if (wait == COROUTINE_WAIT_READ_LINE) {
+		task->transfer = io_scanln_function(vm, NULL);
+		return;
+	}
+	task->transfer = OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Completes timers that have expired and waits for descriptor readiness. With <block> set, sleeps until the
+ * earliest timer or the first ready descriptor.
+ */
+static void wait_for_events(VM *vm, EventLoop *loop, const bool block)
+{
+	const uint64_t now = loop_now_ms();
+	uint64_t timeout = UINT64_MAX;
+	bool has_fd_waits = false;
+
+	for (uint32_t i = 0; i < loop->count; i++) {
+		ObjectCoroutine *task = loop->tasks[i];
+		if (task->wait == COROUTINE_WAIT_TIMER) {
+			const uint64_t remaining = task->wake_at_ms > now ? task->wake_at_ms - now : 0;
+			if (remaining < timeout) {
+				timeout = remaining;
+			}
+		} else if (task->wait != COROUTINE_WAIT_NONE) {
+			has_fd_waits = true;
+		}
+	}
+
+	int timeout_ms = timeout == UINT64_MAX ? -1 : timeout > INT_MAX ? INT_MAX : (int)timeout;
+	if (!block) {
+		timeout_ms = 0;
+	}
+
+	if (!has_fd_waits) {
+		sleep_for_ms(timeout_ms);
+	} else {
+#ifdef __linux__
+		struct epoll_event events[EVENT_LOOP_BATCH];
+		const int ready = epoll_wait(loop->poll_fd, events, EVENT_LOOP_BATCH, timeout_ms);
+		for (int i = 0; i < ready; i++) {
+			ObjectCoroutine *task = events[i].data.ptr;
+			epoll_ctl(loop->poll_fd, EPOLL_CTL_DEL, task->wait_fd, NULL);
+			complete_wait(vm, task);
+		}
+#elif !defined(_WIN32)
+		struct pollfd fds[EVENT_LOOP_BATCH];
+		ObjectCoroutine *owners[EVENT_LOOP_BATCH];
+		nfds_t fd_count = 0;
+		for (uint32_t i = 0; i < loop->count && fd_count < EVENT_LOOP_BATCH; i++) {
+			ObjectCoroutine *task = loop->tasks[i];
+			if (task->wait == COROUTINE_WAIT_NONE || task->wait == COROUTINE_WAIT_TIMER) {
+				continue;
+			}
+			fds[fd_count] = (struct pollfd){.fd = task->wait_fd, .events = POLLIN, .revents = 0};
+			owners[fd_count++] = task;
+		}
+		if (poll(fds, fd_count, timeout_ms) > 0) {
+			for (nfds_t i = 0; i < fd_count; i++) {
+				if (fds[i].revents != 0) {
+					complete_wait(vm, owners[i]);
+				}
+			}
+		}
+#endif
+	}
+
+	const uint64_t after = loop_now_ms();
+	for (uint32_t i = 0; i < loop->count; i++) {
+		ObjectCoroutine *task = loop->tasks[i];
+		if (task->wait == COROUTINE_WAIT_TIMER && task->wake_at_ms <= after) {
+			complete_wait(vm, task);
+		}
+	}
+}
+
+static void remove_finished_tasks(EventLoop *loop)
+{
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < loop->count; i++) {
+		ObjectCoroutine *task = loop->tasks[i];
+		if (task->state == COROUTINE_DONE || task->state == COROUTINE_ERROR) {
+			task->is_scheduled = false;
+			continue;
+		}
+		loop->tasks[kept++] = task;
+	}
+	loop->count = kept;
+}
+
+static Value new_coroutine_from(VM *vm, const Value callable, ObjectCoroutine **coroutine_out)
+{
+	if (!IS_CRUX_CLOSURE(callable)) {
+		return MAKE_GC_SAFE_ERROR(vm, "Coroutine body must be a function.", TYPE);
+	}
+	ObjectClosure *closure = AS_CRUX_CLOSURE(callable);
+	if (closure->function->arity > 1) {
+		return MAKE_GC_SAFE_ERROR(vm, "Coroutine body must take at most one argument.", ARGUMENT_MISMATCH);
+	}
+	*coroutine_out = new_coroutine(vm, closure);
+	return NIL_VAL;
+}
+
+/**
+ * Creates a coroutine that runs the given function on its own stack when first resumed
+ * arg0 -> function: Function taking zero or one argument
+ * Returns Result<Coroutine>
+ */
+Value coroutine_create_function(VM *vm, const Value *args)
+{
+	ObjectCoroutine *coroutine = NULL;
+	const Value error = new_coroutine_from(vm, args[0], &coroutine);
+	if (coroutine == NULL) {
+		return error;
+	}
+	return MAKE_GC_SAFE_RESULT(vm, coroutine);
+}
+
+/**
+ * Runs a coroutine until it suspends or returns. The first resume passes <value> as the function's argument,
+ * later ones make the pending suspend() call return it.
+ * arg0 -> coroutine: Coroutine
+ * arg1 -> value: Any
+ * Returns Result<Any> holding the suspended or returned value
+ */
+Value coroutine_resume_function(VM *vm, const Value *args)
+{
+	if (!IS_CRUX_COROUTINE(args[0])) {
+		return MAKE_GC_SAFE_ERROR(vm, "Expected a coroutine.", TYPE);
+	}
+	ObjectCoroutine *coroutine = AS_CRUX_COROUTINE(args[0]);
+
+	switch (coroutine->state) {
+	case COROUTINE_RUNNING:
+		return MAKE_GC_SAFE_ERROR(vm, "Coroutine is already running.", RUNTIME);
+	case COROUTINE_DONE:
+	case COROUTINE_ERROR:
+		return MAKE_GC_SAFE_ERROR(vm, "Cannot resume a finished coroutine.", RUNTIME);
+	default:
+		break;
+	}
+	if (coroutine->is_scheduled) {
+		return MAKE_GC_SAFE_ERROR(vm, "Cannot resume a task owned by the event loop.", RUNTIME);
+	}
+
+	resume_coroutine(vm, coroutine, args[1]);
+
+	const Value transferred = coroutine->transfer;
+	coroutine->transfer = NIL_VAL;
+	push(vm, transferred);
+	ObjectResult *result = new_ok_result(vm, transferred);
+	pop(vm);
+	return OBJECT_VAL(result);
+}
+
+/**
+ * Suspends the running coroutine, handing <value> to its resumer
+ * arg0 -> value: Any
+ * Returns Any (the value passed to the next resume)
+ */
+Value coroutine_suspend_function(VM *vm, const Value *args)
+{
+	if (vm->current_coroutine == NULL) {
+		runtime_panic(vm, RUNTIME, "suspend() can only be called inside a coroutine.");
+	}
+	if (!request_coroutine_yield(vm, args[0])) {
+		runtime_panic(vm, RUNTIME, "Cannot suspend a coroutine from inside a native callback.");
+	}
+	return NIL_VAL;
+}
+
+/**
+ * Checks whether a coroutine has finished running
+ * arg0 -> coroutine: Coroutine
+ * Returns Bool
+ */
+Value coroutine_is_done_function(VM *vm, const Value *args)
+{
+	(void)vm;
+	if (!IS_CRUX_COROUTINE(args[0])) {
+		return BOOL_VAL(false);
+	}
+	const CoroutineState state = AS_CRUX_COROUTINE(args[0])->state;
+	return BOOL_VAL(state == COROUTINE_DONE || state == COROUTINE_ERROR);
+}
+
+/**
+ * Creates a coroutine and hands it to the event loop. Tasks start on the next run().
+ * arg0 -> function: Function taking zero or one argument
+ * Returns Result<Coroutine>
+ */
+Value coroutine_spawn_function(VM *vm, const Value *args)
+{
+	ObjectCoroutine *coroutine = NULL;
+	const Value error = new_coroutine_from(vm, args[0], &coroutine);
+	if (coroutine == NULL) {
+		return error;
+	}
+	if (!schedule_task(&vm->event_loop, coroutine)) {
+		return MAKE_GC_SAFE_ERROR(vm, "Failed to allocate memory for event loop task.", MEMORY);
+	}
+	return MAKE_GC_SAFE_RESULT(vm, coroutine);
+}
+
+/**
+ * Runs spawned tasks until all of them have finished. Tasks blocked on sleep_ms(), scanln() or
+ * wait_readable() are resumed when their timer expires or their descriptor becomes readable.
+ * Returns Result<Nil>
+ */
+Value coroutine_run_function(VM *vm, const Value *args)
+{
+	(void)args;
+	if (vm->current_coroutine != NULL && vm->current_coroutine->is_scheduled) {
+		return MAKE_GC_SAFE_ERROR(vm, "run() cannot be called from inside an event loop task.", RUNTIME);
+	}
+
+	EventLoop *loop = &vm->event_loop;
+	while (loop->count > 0) {
+		bool progressed = false;
+		for (uint32_t i = 0; i < loop->count; i++) {
+			ObjectCoroutine *task = loop->tasks[i];
+			if (task->wait != COROUTINE_WAIT_NONE || task->state == COROUTINE_DONE ||
+				task->state == COROUTINE_ERROR) {
+				continue;
+			}
+			const Value send = task->transfer;
+			task->transfer = NIL_VAL;
+			resume_coroutine(vm, task, send);
+			if (task->wait == COROUTINE_WAIT_NONE) {
+				task->transfer = NIL_VAL;
+			}
+			progressed = true;
+		}
+		remove_finished_tasks(loop);
+		if (loop->count > 0) {
+			wait_for_events(vm, loop, !progressed);
+		}
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Waits until a file can be read from without blocking. Outside an event loop task, or for regular files, this
+ * returns immediately.
+ * arg0 -> file: File
+ * Returns Result<Nil>
+ */
+Value coroutine_wait_readable_function(VM *vm, const Value *args)
+{
+	const ObjectFile *file = AS_CRUX_FILE(args[0]);
+	if (!file->is_open || file->file == NULL) {
+		return MAKE_GC_SAFE_ERROR(vm, "File is not open.", IO);
+	}
+#ifndef _WIN32
+	if (coroutine_park_fd(vm, fileno(file->file), COROUTINE_WAIT_READABLE)) {
+		return NIL_VAL;
+	}
+#endif
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
@@ -11,12 +11,11 @@
  */
 Value error_function(VM *vm, const Value *args)
 {
-	ObjectModuleRecord *module_record = vm->current_module_record;
 	const Value message = args[0];
 	ObjectString *errorMessage = to_string(vm, message);
-	push(module_record, OBJECT_VAL(errorMessage));
+	push(vm, OBJECT_VAL(errorMessage));
 	ObjectError *error = new_error(vm, errorMessage, RUNTIME, false);
-	pop(module_record);
+	pop(vm);
 	return OBJECT_VAL(error);
 }
 
@@ -32,7 +31,7 @@ Value assert_function(VM *vm, const Value *args)
 	ObjectString *message = AS_CRUX_STRING(args[1]);
 
 	if (result == false) {
-		runtime_panic(vm->current_module_record, ASSERT, message->chars);
+		runtime_panic(vm, ASSERT, message->chars);
 		return NIL_VAL;
 	}
 	return NIL_VAL;
@@ -140,20 +140,20 @@ Value fs_open_function(VM *vm, const Value *args)
 	}
 
 	ObjectString *full_path = take_string(vm, resolved, strlen(resolved));
-	push(vm->current_module_record, OBJECT_VAL(full_path));
+	push(vm, OBJECT_VAL(full_path));
 
 	ObjectFile *file = new_object_file(vm, full_path, mode_str);
-	push(vm->current_module_record, OBJECT_VAL(file));
+	push(vm, OBJECT_VAL(file));
 
 	if (file->file == NULL) {
-		pop(vm->current_module_record); /* file */
-		pop(vm->current_module_record); /* full_path */
+		pop(vm); /* file */
+		pop(vm); /* full_path */
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to open file.", IO);
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(file));
-	pop(vm->current_module_record); /* file */
-	pop(vm->current_module_record); /* full_path */
+	pop(vm); /* file */
+	pop(vm); /* full_path */
 	return OBJECT_VAL(res);
 }
 
@@ -235,9 +235,9 @@ Value fs_read_method(VM *vm, const Value *args)
 	}
 
 	ObjectString *s = take_string(vm, buffer, (uint32_t)actually_read);
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -286,9 +286,9 @@ Value fs_readln_method(VM *vm, const Value *args)
 	}
 
 	ObjectString *s = take_string(vm, buffer, count);
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -314,9 +314,9 @@ Value fs_read_all_method(VM *vm, const Value *args)
 
 	file->position += s->byte_length;
 
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -336,11 +336,11 @@ Value fs_read_lines_method(VM *vm, const Value *args)
 	}
 
 	ObjectArray *lines = new_array(vm, 2);
-	push(vm->current_module_record, OBJECT_VAL(lines));
+	push(vm, OBJECT_VAL(lines));
 
 	char *buffer = ALLOCATE(vm, char, READLN_BUFFER_SIZE + 1);
 	if (buffer == NULL) {
-		pop(vm->current_module_record); /* lines */
+		pop(vm); /* lines */
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to allocate read buffer.", MEMORY);
 	}
 
@@ -372,7 +372,7 @@ Value fs_read_lines_method(VM *vm, const Value *args)
 
 		if (ferror(file->file)) {
 			FREE_ARRAY(vm, char, buffer, READLN_BUFFER_SIZE + 1);
-			pop(vm->current_module_record); /* lines */
+			pop(vm); /* lines */
 			return MAKE_GC_SAFE_ERROR(vm, "Error reading from file.", IO);
 		}
 
@@ -382,9 +382,9 @@ Value fs_read_lines_method(VM *vm, const Value *args)
 			break;
 
 		ObjectString *line = copy_string(vm, buffer, count);
-		push(vm->current_module_record, OBJECT_VAL(line));
+		push(vm, OBJECT_VAL(line));
 		array_add_back(vm, lines, OBJECT_VAL(line));
-		pop(vm->current_module_record); /* line */
+		pop(vm); /* line */
 
 		if (at_eof)
 			break;
@@ -393,7 +393,7 @@ Value fs_read_lines_method(VM *vm, const Value *args)
 	FREE_ARRAY(vm, char, buffer, READLN_BUFFER_SIZE + 1);
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(lines));
-	pop(vm->current_module_record); /* lines */
+	pop(vm); /* lines */
 	return OBJECT_VAL(res);
 }
 
@@ -836,9 +836,9 @@ Value fs_read_file_function(VM *vm, const Value *args)
 
 	fclose(fp);
 
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
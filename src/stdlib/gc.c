@@ -3,6 +3,8 @@
 #include "stdlib/gc.h"
 #include "common.h"
 #include "garbage_collector.h"
+#include "gc_events.h"
+#include "heap_profiler.h"
 #include "panic.h"
 #include "value.h"
 
@@ -93,7 +95,7 @@ Value gc_set_min_growth_function(VM *vm, const Value *args)
 Value gc_collect_function(VM *vm, const Value *args)
 {
 	(void)args;
-	collect_garbage(vm);
+	collect_garbage(vm, GC_TRIGGER_EXPLICIT);
 	return NIL_VAL;
 }
 
@@ -132,7 +134,7 @@ Value gc_stats_function(VM *vm, const Value *args)
 	(void)args;
 
 	ObjectTable *stats = new_object_table(vm, 20);
-	push(vm->current_module_record, OBJECT_VAL(stats));
+	push(vm, OBJECT_VAL(stats));
 
 	add_gc_stat(vm, stats, "collections", FLOAT_VAL((double)vm->gc_collections));
 	add_gc_stat(vm, stats, "total_ns", FLOAT_VAL((double)vm->gc_total_ns));
@@ -163,7 +165,104 @@ Value gc_stats_function(VM *vm, const Value *args)
 	add_gc_stat(vm, stats, "last_strings_tombstones", FLOAT_VAL((double)vm->gc_last_strings_tombstones));
 	add_gc_stat(vm, stats, "last_sweep_slots_scanned", FLOAT_VAL((double)vm->gc_last_sweep_slots_scanned));
 	add_gc_stat(vm, stats, "sweep_slots_scanned", FLOAT_VAL((double)vm->gc_sweep_slots_scanned));
+	add_gc_stat(vm, stats, "pause_count", FLOAT_VAL((double)vm->gc_pauses.total));
+	add_gc_stat(vm, stats, "pause_p50_ns", FLOAT_VAL((double)gc_pause_percentile(&vm->gc_pauses, 50.0)));
+	add_gc_stat(vm, stats, "pause_p90_ns", FLOAT_VAL((double)gc_pause_percentile(&vm->gc_pauses, 90.0)));
+	add_gc_stat(vm, stats, "pause_p99_ns", FLOAT_VAL((double)gc_pause_percentile(&vm->gc_pauses, 99.0)));
+	add_gc_stat(vm, stats, "pause_p999_ns", FLOAT_VAL((double)gc_pause_percentile(&vm->gc_pauses, 99.9)));
+	add_gc_stat(vm, stats, "pause_max_ns", FLOAT_VAL((double)vm->gc_pauses.max_ns));
 
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(stats);
 }
+
+/**
+ * Starts attributing allocations to source lines and object types
+ * arg0 -> sample_bytes: Int (bytes allocated between two samples)
+ * Returns Result<Nil>
+ */
+Value gc_heap_profile_start_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	if (!heap_profiler_start(vm, AS_INT(args[0]), &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Stops the heap profiler and writes <path>.folded and <path>.census
+ * arg0 -> path: String
+ * Returns Result<Nil>
+ */
+Value gc_heap_profile_stop_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	if (!heap_profiler_stop(vm, AS_CRUX_STRING(args[0])->chars, &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Counts the objects on the heap by type. Unreachable objects are included until the next collection
+ * Returns Table
+ */
+Value gc_census_function(VM *vm, const Value *args)
+{
+	(void)args;
+
+	uint32_t counts[SENTINEL_OBJECT_COUNT];
+	finish_background_sweep(vm);
+	count_heap_objects(vm, counts);
+
+	ObjectTable *census = new_object_table(vm, SENTINEL_OBJECT_COUNT);
+	push(vm, OBJECT_VAL(census));
+	for (uint32_t type = 0; type < SENTINEL_OBJECT_COUNT; type++) {
+		if (counts[type] > 0) {
+			add_gc_stat(vm, census, object_type_name(type), FLOAT_VAL((double)counts[type]));
+		}
+	}
+	pop(vm);
+	return OBJECT_VAL(census);
+}
+
+/**
+ * Appends one JSON line per collection to a file
+ * arg0 -> path: String
+ * Returns Result<Nil>
+ */
+Value gc_start_event_log_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	if (!open_gc_event_log(vm, AS_CRUX_STRING(args[0])->chars, &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Stops writing the GC event log
+ * Returns Nil
+ */
+Value gc_stop_event_log_function(VM *vm, const Value *args)
+{
+	(void)args;
+	close_gc_event_log(vm);
+	return NIL_VAL;
+}
+
+/**
+ * Chooses whether collections free dead objects on a helper thread while the program continues. Marking still
+ * pauses the program, and collect() always finishes its sweep before returning
+ * arg0 -> enabled: Bool
+ * Returns Result<Nil>
+ */
+Value gc_set_background_sweep_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	if (!set_background_sweep(vm, AS_BOOL(args[0]), &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
@@ -5,6 +5,7 @@
 #include "garbage_collector.h"
 #include "object.h"
 #include "panic.h"
+#include "stdlib/coroutine.h"
 #include "vm.h"
 #ifdef _WIN32
 #include <fcntl.h>
@@ -209,20 +210,27 @@ Value io_scan_function(VM *vm, const Value *args)
 
 	const char str[2] = {(char)ch, '\0'};
 	ObjectString *s = copy_string(vm, str, 1);
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
 /**
- * Reads a line from stdin up to (and excluding) the newline character
+ * Reads a line from stdin up to (and excluding) the newline character. Inside an event loop task the task waits
+ * for input without blocking the other tasks.
  * Returns Result<String>
  */
 Value io_scanln_function(VM *vm, const Value *args)
 {
 	(void)args;
 
+#ifndef _WIN32
+	if (coroutine_park_fd(vm, STDIN_FILENO, COROUTINE_WAIT_READ_LINE)) {
+		return NIL_VAL;
+	}
+#endif
+
 	ObjectString *s = NULL;
 	if (!read_bounded_line(vm, stdin, SCANLN_BUFFER_SIZE, &s)) {
 		return MAKE_GC_SAFE_ERROR(vm, "Failed to allocate buffer for input.", MEMORY);
@@ -235,9 +243,9 @@ Value io_scanln_function(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Error reading from stdin.", IO);
 	}
 
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -262,9 +270,9 @@ Value io_nscan_function(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Error reading from stdin.", IO);
 	}
 
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -295,9 +303,9 @@ Value io_scan_from_function(VM *vm, const Value *args)
 
 	const char str[2] = {(char)ch, '\0'};
 	ObjectString *s = copy_string(vm, str, 1);
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -328,9 +336,9 @@ Value io_scanln_from_function(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Error reading from channel.", IO);
 	}
 
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -368,8 +376,8 @@ Value io_nscan_from_function(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Error reading from channel.", IO);
 	}
 
-	push(vm->current_module_record, OBJECT_VAL(s));
+	push(vm, OBJECT_VAL(s));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(s));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
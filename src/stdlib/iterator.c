@@ -0,0 +1,280 @@
+#include "stdlib/iterator.h"
+#include "object.h"
+#include "panic.h"
+#include "vm.h"
+
+static Value new_adapter(VM *vm, const Value upstream, const IteratorKind kind, const Value operand,
+						 const uint32_t index)
+{
+	ObjectIterator *adapter = new_iterator(vm, upstream);
+	adapter->kind = kind;
+	adapter->operand = operand;
+	adapter->index = index;
+	return OBJECT_VAL(adapter);
+}
+
+static ObjectTuple *new_pair(VM *vm, const Value first, const Value second)
+{
+	ObjectTuple *pair = new_tuple(vm, 2);
+	pair->elements[0] = first;
+	pair->elements[1] = second;
+	return pair;
+}
+
+/**
+ * Converts an argument that may be any iterable into an iterator, leaving it pushed so it stays reachable.
+ */
+static Value push_argument_iterator(VM *vm, const Value iterable)
+{
+	Value iterator;
+	if (!get_iterator_from_value(vm, iterable, &iterator)) {
+		return NIL_VAL;
+	}
+	push(vm, iterator);
+	return iterator;
+}
+
+bool iterator_adapter_next(VM *vm, ObjectIterator *iterator, Value *value_out)
+{
+
+	switch (iterator->kind) {
+	case ITERATOR_MAP: {
+		Value element;
+		if (!next_iterator_value(vm, iterator->iterable, &element)) {
+			return false;
+		}
+		push(vm, iterator->operand);
+		push(vm, element);
+		return call_from_native(vm, iterator->operand, 1, value_out) == INTERPRET_OK;
+	}
+	case ITERATOR_FILTER: {
+		Value element;
+		while (next_iterator_value(vm, iterator->iterable, &element)) {
+			push(vm, element); // keeps the element alive across the predicate call
+			push(vm, iterator->operand);
+			push(vm, element);
+			Value keep;
+			const InterpretResult result = call_from_native(vm, iterator->operand, 1, &keep);
+			pop(vm);
+			if (result != INTERPRET_OK) {
+				return false;
+			}
+			if (!is_falsy(keep)) {
+				*value_out = element;
+				return true;
+			}
+		}
+		return false;
+	}
+	case ITERATOR_TAKE: {
+		if (iterator->index == 0) {
+			return false;
+		}
+		iterator->index--;
+		return next_iterator_value(vm, iterator->iterable, value_out);
+	}
+	case ITERATOR_SKIP: {
+		while (iterator->index > 0) {
+			iterator->index--;
+			Value skipped;
+			if (!next_iterator_value(vm, iterator->iterable, &skipped)) {
+				return false;
+			}
+		}
+		return next_iterator_value(vm, iterator->iterable, value_out);
+	}
+	case ITERATOR_ZIP: {
+		Value left;
+		Value right;
+		if (!next_iterator_value(vm, iterator->iterable, &left)) {
+			return false;
+		}
+		push(vm, left);
+		if (!next_iterator_value(vm, iterator->operand, &right)) {
+			pop(vm);
+			return false;
+		}
+		push(vm, right);
+		const ObjectTuple *pair = new_pair(vm, left, right);
+		pop(vm);
+		pop(vm);
+		*value_out = OBJECT_VAL(pair);
+		return true;
+	}
+	case ITERATOR_ENUMERATE: {
+		Value element;
+		if (!next_iterator_value(vm, iterator->iterable, &element)) {
+			return false;
+		}
+		push(vm, element);
+		const ObjectTuple *pair = new_pair(vm, INT_VAL(iterator->index), element);
+		pop(vm);
+		iterator->index++;
+		*value_out = OBJECT_VAL(pair);
+		return true;
+	}
+	case ITERATOR_CHAIN: {
+		if (next_iterator_value(vm, iterator->iterable, value_out)) {
+			return true;
+		}
+		if (IS_NIL(iterator->operand)) {
+			return false;
+		}
+		// the first iterator is exhausted, continue with the second one
+		iterator->iterable = iterator->operand;
+		iterator->operand = NIL_VAL;
+		return next_iterator_value(vm, iterator->iterable, value_out);
+	}
+	case ITERATOR_SEQUENCE:
+		return iterate_next(vm, iterator, value_out);
+	}
+	return false;
+}
+
+/**
+ * Lazily applies a function to every element.
+ * arg0 -> iterator: Iterator
+ * arg1 -> function: Function
+ * Returns Iterator
+ */
+Value map_iterator_method(VM *vm, const Value *args)
+{
+	return new_adapter(vm, args[0], ITERATOR_MAP, args[1], 0);
+}
+
+/**
+ * Lazily keeps the elements for which the predicate returns a truthy value.
+ * arg0 -> iterator: Iterator
+ * arg1 -> predicate: Function
+ * Returns Iterator
+ */
+Value filter_iterator_method(VM *vm, const Value *args)
+{
+	return new_adapter(vm, args[0], ITERATOR_FILTER, args[1], 0);
+}
+
+/**
+ * Lazily yields at most <count> elements.
+ * arg0 -> iterator: Iterator
+ * arg1 -> count: Int
+ * Returns Iterator
+ */
+Value take_iterator_method(VM *vm, const Value *args)
+{
+	const int32_t count = AS_INT(args[1]);
+	if (count < 0) {
+		runtime_panic(vm, VALUE, "take() expects a non-negative count.");
+	}
+	return new_adapter(vm, args[0], ITERATOR_TAKE, NIL_VAL, (uint32_t)count);
+}
+
+/**
+ * Lazily drops the first <count> elements.
+ * arg0 -> iterator: Iterator
+ * arg1 -> count: Int
+ * Returns Iterator
+ */
+Value skip_iterator_method(VM *vm, const Value *args)
+{
+	const int32_t count = AS_INT(args[1]);
+	if (count < 0) {
+		runtime_panic(vm, VALUE, "skip() expects a non-negative count.");
+	}
+	return new_adapter(vm, args[0], ITERATOR_SKIP, NIL_VAL, (uint32_t)count);
+}
+
+/**
+ * Lazily pairs elements with those of another iterable, stopping at the shorter one.
+ * arg0 -> iterator: Iterator
+ * arg1 -> other: Any iterable
+ * Returns Iterator of (left, right) tuples
+ */
+Value zip_iterator_method(VM *vm, const Value *args)
+{
+	const Value other = push_argument_iterator(vm, args[1]);
+	const Value adapter = new_adapter(vm, args[0], ITERATOR_ZIP, other, 0);
+	pop(vm);
+	return adapter;
+}
+
+/**
+ * Lazily pairs every element with its position.
+ * arg0 -> iterator: Iterator
+ * Returns Iterator of (index, element) tuples
+ */
+Value enumerate_iterator_method(VM *vm, const Value *args)
+{
+	return new_adapter(vm, args[0], ITERATOR_ENUMERATE, NIL_VAL, 0);
+}
+
+/**
+ * Lazily continues with the elements of another iterable once this one is exhausted.
+ * arg0 -> iterator: Iterator
+ * arg1 -> other: Any iterable
+ * Returns Iterator
+ */
+Value chain_iterator_method(VM *vm, const Value *args)
+{
+	const Value other = push_argument_iterator(vm, args[1]);
+	const Value adapter = new_adapter(vm, args[0], ITERATOR_CHAIN, other, 0);
+	pop(vm);
+	return adapter;
+}
+
+/**
+ * Drains the iterator into a new array.
+ * arg0 -> iterator: Iterator
+ * Returns Array
+ */
+Value collect_iterator_method(VM *vm, const Value *args)
+{
+	// callbacks of the iterator may grow the stack and move <args>
+	const Value iterator = args[0];
+	ObjectArray *array = new_array(vm, 0);
+	push(vm, OBJECT_VAL(array));
+
+	Value element;
+	while (next_iterator_value(vm, iterator, &element)) {
+		push(vm, element);
+		array_add_back(vm, array, element);
+		pop(vm);
+	}
+
+	pop(vm);
+	return OBJECT_VAL(array);
+}
+
+/**
+ * Drains the iterator and adds up its elements. The sum stays an Int while every element is an Int and the total
+ * fits, and becomes a Float otherwise.
+ * arg0 -> iterator: Iterator
+ * Returns Result<Int | Float>
+ */
+Value sum_iterator_method(VM *vm, const Value *args)
+{
+	int64_t int_total = 0;
+	double float_total = 0.0;
+	bool is_float = false;
+
+	// callbacks of the iterator may grow the stack and move <args>
+	const Value iterator = args[0];
+	Value element;
+	while (next_iterator_value(vm, iterator, &element)) {
+		if (IS_INT(element)) {
+			int_total += AS_INT(element);
+		} else if (IS_FLOAT(element)) {
+			float_total += AS_FLOAT(element);
+			is_float = true;
+		} else {
+			return MAKE_GC_SAFE_ERROR(vm, "sum() expects every element to be an Int or Float.", TYPE);
+		}
+	}
+
+	Value total;
+	if (is_float || int_total > INT32_MAX || int_total < INT32_MIN) {
+		total = FLOAT_VAL(float_total + (double)int_total);
+	} else {
+		total = INT_VAL((int32_t)int_total);
+	}
+	return OBJECT_VAL(new_ok_result(vm, total));
+}
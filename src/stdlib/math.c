@@ -32,7 +32,7 @@ Value sqrt_function(VM *vm, const Value *args)
 			VALUE);
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(sqrt(number))));
+	return native_ok(vm, FLOAT_VAL(sqrt(number)));
 }
 
 static int32_t absolute_int(const int32_t x)
@@ -109,7 +109,7 @@ Value asin_function(VM *vm, const Value *args)
 					  VALUE);
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(asin(num))));
+	return native_ok(vm, FLOAT_VAL(asin(num)));
 }
 
 /**
@@ -124,7 +124,7 @@ Value acos_function(VM *vm, const Value *args)
 					  "Argument must be between -1 and 1.",
 					  VALUE);
 	}
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(acos(num))));
+	return native_ok(vm, FLOAT_VAL(acos(num)));
 }
 
 /**
@@ -162,7 +162,7 @@ Value ln_function(VM *vm, const Value *args)
 					  "of non positive number.",
 					  VALUE);
 	}
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(log(number))));
+	return native_ok(vm, FLOAT_VAL(log(number)));
 }
 
 /**
@@ -180,7 +180,7 @@ Value log10_function(VM *vm, const Value *args)
 					  VALUE);
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(log10(number))));
+	return native_ok(vm, FLOAT_VAL(log10(number)));
 }
 
 /**
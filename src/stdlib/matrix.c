@@ -100,13 +100,12 @@ Value new_matrix_function(VM *vm, const Value *args)
 	}
 
 	ObjectMatrix *mat = new_matrix(vm, (uint16_t)rows, (uint16_t)cols);
-	push(vm->current_module_record, OBJECT_VAL(mat));
+	push(vm, OBJECT_VAL(mat));
 
 	memset(mat->data, 0, sizeof(double) * rows * cols);
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(mat));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(mat));
 }
 
 /**
@@ -122,16 +121,15 @@ Value new_matrix_identity_function(VM *vm, const Value *args)
 	}
 
 	ObjectMatrix *mat = new_matrix(vm, (uint16_t)n, (uint16_t)n);
-	push(vm->current_module_record, OBJECT_VAL(mat));
+	push(vm, OBJECT_VAL(mat));
 
 	memset(mat->data, 0, sizeof(double) * n * n);
 	for (int32_t i = 0; i < n; i++) {
 		MATRIX_AT(mat, i, i) = 1.0;
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(mat));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(mat));
 }
 
 /**
@@ -163,7 +161,7 @@ Value new_matrix_from_array_function(VM *vm, const Value *args)
 	}
 
 	ObjectMatrix *mat = new_matrix(vm, (uint16_t)rows, (uint16_t)cols);
-	push(vm->current_module_record, OBJECT_VAL(mat));
+	push(vm, OBJECT_VAL(mat));
 
 	const uint32_t copy_count = arr->size < total ? arr->size : total;
 	for (uint32_t i = 0; i < copy_count; i++) {
@@ -173,9 +171,8 @@ Value new_matrix_from_array_function(VM *vm, const Value *args)
 		mat->data[i] = 0.0;
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(mat));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(mat));
 }
 
 /* ── Element access ──────────────────────────────────────────────────────────
@@ -198,7 +195,7 @@ Value matrix_get_method(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Matrix index out of bounds.", BOUNDS);
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(MATRIX_AT(mat, row, col))));
+	return native_ok(vm, FLOAT_VAL(MATRIX_AT(mat, row, col)));
 }
 
 /**
@@ -220,7 +217,7 @@ Value matrix_set_method(VM *vm, const Value *args)
 	}
 
 	MATRIX_AT(mat, row, col) = TO_DOUBLE(args[3]);
-	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+	return native_ok(vm, NIL_VAL);
 }
 
 /* ── Infallible property accessors ───────────────────────────────────────────
@@ -259,7 +256,7 @@ Value matrix_add_value(VM *vm, const ObjectMatrix *a, const ObjectMatrix *b)
 	REQUIRE_SAME_SHAPE(a, b, "addition");
 
 	ObjectMatrix *result = new_matrix(vm, a->row_dim, a->col_dim);
-	push(vm->current_module_record, OBJECT_VAL(result));
+	push(vm, OBJECT_VAL(result));
 
 	const uint32_t total = (uint32_t)a->row_dim * a->col_dim;
 	for (uint32_t i = 0; i < total; i++) {
@@ -267,7 +264,7 @@ Value matrix_add_value(VM *vm, const ObjectMatrix *a, const ObjectMatrix *b)
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -276,7 +273,7 @@ Value matrix_subtract_value(VM *vm, const ObjectMatrix *a, const ObjectMatrix *b
 	REQUIRE_SAME_SHAPE(a, b, "subtraction");
 
 	ObjectMatrix *result = new_matrix(vm, a->row_dim, a->col_dim);
-	push(vm->current_module_record, OBJECT_VAL(result));
+	push(vm, OBJECT_VAL(result));
 
 	const uint32_t total = (uint32_t)a->row_dim * a->col_dim;
 	for (uint32_t i = 0; i < total; i++) {
@@ -284,7 +281,7 @@ Value matrix_subtract_value(VM *vm, const ObjectMatrix *a, const ObjectMatrix *b
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -298,7 +295,7 @@ Value matrix_multiply_value(VM *vm, const ObjectMatrix *a, const ObjectMatrix *b
 	}
 
 	ObjectMatrix *result = new_matrix(vm, a->row_dim, b->col_dim);
-	push(vm->current_module_record, OBJECT_VAL(result));
+	push(vm, OBJECT_VAL(result));
 
 	memset(result->data, 0, sizeof(double) * a->row_dim * b->col_dim);
 
@@ -314,7 +311,7 @@ Value matrix_multiply_value(VM *vm, const ObjectMatrix *a, const ObjectMatrix *b
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -468,7 +465,7 @@ Value matrix_determinant_method(VM *vm, const Value *args)
 	FREE_ARRAY(vm, double, tmp, (uint32_t)n *n);
 	FREE_ARRAY(vm, uint16_t, perm, n);
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(det)));
+	return native_ok(vm, FLOAT_VAL(det));
 }
 
 /**
@@ -492,7 +489,7 @@ Value matrix_inverse_method(VM *vm, const Value *args)
 
 	/* Allocate result and initialise as identity */
 	ObjectMatrix *result = new_matrix(vm, n, n);
-	push(vm->current_module_record, OBJECT_VAL(result));
+	push(vm, OBJECT_VAL(result));
 	memset(result->data, 0, sizeof(double) * n2);
 	for (uint16_t i = 0; i < n; i++) {
 		MATRIX_AT(result, i, i) = 1.0;
@@ -513,7 +510,7 @@ Value matrix_inverse_method(VM *vm, const Value *args)
 
 		if (max_val < EPSILON) {
 			FREE_ARRAY(vm, double, aug, n2);
-			pop(vm->current_module_record); /* result */
+			pop(vm); /* result */
 			return MAKE_GC_SAFE_ERROR(vm, "Matrix is singular and cannot be inverted.", MATH);
 		}
 
@@ -548,9 +545,8 @@ Value matrix_inverse_method(VM *vm, const Value *args)
 
 	FREE_ARRAY(vm, double, aug, n2);
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(result));
 }
 
 /**
@@ -570,7 +566,7 @@ Value matrix_trace_method(VM *vm, const Value *args)
 		trace += MATRIX_AT(mat, i, i);
 	}
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(trace)));
+	return native_ok(vm, FLOAT_VAL(trace));
 }
 
 /**
@@ -627,7 +623,7 @@ Value matrix_rank_method(VM *vm, const Value *args)
 	}
 
 	FREE_ARRAY(vm, double, tmp, total);
-	return OBJECT_VAL(new_ok_result(vm, INT_VAL((int32_t)rank)));
+	return native_ok(vm, INT_VAL((int32_t)rank));
 }
 
 /* ── Row / column extraction ─────────────────────────────────────────────────
@@ -649,16 +645,15 @@ Value matrix_row_method(VM *vm, const Value *args)
 	}
 
 	ObjectArray *arr = new_array(vm, row);
-	push(vm->current_module_record, OBJECT_VAL(arr));
+	push(vm, OBJECT_VAL(arr));
 
 	for (uint16_t j = 0; j < mat->col_dim; j++) {
 		const Value v = FLOAT_VAL(MATRIX_AT(mat, row, j));
 		array_add_back(vm, arr, v);
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(arr));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(arr));
 }
 
 /**
@@ -677,16 +672,15 @@ Value matrix_col_method(VM *vm, const Value *args)
 	}
 
 	ObjectArray *arr = new_array(vm, col);
-	push(vm->current_module_record, OBJECT_VAL(arr));
+	push(vm, OBJECT_VAL(arr));
 
 	for (uint16_t i = 0; i < mat->row_dim; i++) {
 		Value v = FLOAT_VAL(MATRIX_AT(mat, i, col));
 		array_add_back(vm, arr, v);
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(arr));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(arr));
 }
 
 /* ── Utilities ───────────────────────────────────────────────────────────────
@@ -738,27 +732,27 @@ Value matrix_to_array_method(VM *vm, const Value *args)
 	const ObjectMatrix *mat = AS_CRUX_MATRIX(args[0]);
 
 	ObjectArray *outer = new_array(vm, mat->row_dim);
-	push(vm->current_module_record, OBJECT_VAL(outer));
+	push(vm, OBJECT_VAL(outer));
 
 	for (uint16_t i = 0; i < mat->row_dim; i++) {
 		ObjectArray *row_arr = new_array(vm, mat->col_dim);
-		push(vm->current_module_record, OBJECT_VAL(row_arr));
+		push(vm, OBJECT_VAL(row_arr));
 
 		for (uint16_t j = 0; j < mat->col_dim; j++) {
 			bool success = array_add_back(vm, row_arr, FLOAT_VAL(MATRIX_AT(mat, i, j)));
 			if (!success) {
-				pop(vm->current_module_record); /* row_arr */
-				pop(vm->current_module_record); /* outer */
+				pop(vm); /* row_arr */
+				pop(vm); /* outer */
 				return MAKE_GC_SAFE_ERROR(vm, "Failed to add element to row array", MEMORY);
 			}
 		}
 
 		array_add_back(vm, outer, OBJECT_VAL(row_arr));
-		pop(vm->current_module_record); /* row_arr */
+		pop(vm); /* row_arr */
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(outer));
-	pop(vm->current_module_record); /* outer */
+	pop(vm); /* outer */
 	return OBJECT_VAL(res);
 }
 
@@ -783,7 +777,7 @@ Value matrix_multiply_vector_method(VM *vm, const Value *args)
 	}
 
 	ObjectVector *result_vec = new_vector(vm, mat->row_dim);
-	push(vm->current_module_record, OBJECT_VAL(result_vec));
+	push(vm, OBJECT_VAL(result_vec));
 
 	const double *v_comp = VECTOR_COMPONENTS(vec);
 	double *r_comp = VECTOR_COMPONENTS(result_vec);
@@ -796,7 +790,6 @@ Value matrix_multiply_vector_method(VM *vm, const Value *args)
 		r_comp[i] = sum;
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vec));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(result_vec));
 }
@@ -0,0 +1,443 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "stdlib/parallel.h"
+#include "panic.h"
+#include "stdlib/array.h"
+#include "thread_pool.h"
+#include "type_system.h"
+#include "worker.h"
+
+// Chunk boundaries depend only on the number of elements, never on the number of threads, so reductions combine the
+// same partial results in the same order on every machine. Threads steal chunks from each other, so a few hundred
+// chunks keep every core busy.
+#define PARALLEL_MAX_CHUNKS 256
+#define PARALLEL_NATIVE_MIN_CHUNK 1024
+#define PARALLEL_ISOLATE_MIN_CHUNK 16
+
+typedef enum { PARALLEL_MAP, PARALLEL_REDUCE } ParallelOperation;
+
+typedef struct {
+	VM *vm;
+	ParallelOperation operation;
+	const Value *inputs; // NULL when mapping over a range
+	int32_t range_start;
+	uint32_t count;
+	uint32_t chunk_size;
+	uint32_t chunk_count;
+
+	// a pure native kernel runs directly on the pool threads
+	const ObjectNativeCallable *native;
+	Value *native_results; // map: one per element, reduce: one per chunk
+
+	// a Crux function runs in one isolate per pool thread, which loads the module defining it
+	const char *isolate_argv[2];
+	const char *function_name;
+	int arity;
+	VM *isolates[THREAD_POOL_MAX_THREADS];
+	Value isolate_functions[THREAD_POOL_MAX_THREADS];
+	const char *isolate_errors[THREAD_POOL_MAX_THREADS]; // set once a thread's isolate can no longer be used
+	WorkerMessage **isolate_results; // one per chunk
+
+	const char **chunk_errors; // one per chunk, NULL when the chunk succeeded
+} ParallelJob;
+
+static Value job_input(const ParallelJob *job, const uint32_t index)
+{
+	return job->inputs != NULL ? job->inputs[index] : INT_VAL(job->range_start + (int32_t)index);
+}
+
+static const char *run_native_chunk(ParallelJob *job, const uint32_t start, const uint32_t end, const uint32_t chunk)
+{
+	const ObjectNativeCallable *native = job->native;
+	const TypeMask element_type = native->arg_types[0]->base_type;
+
+	if (job->operation == PARALLEL_MAP) {
+		for (uint32_t i = start; i < end; i++) {
+			const Value element = job_input(job, i);
+			if (!runtime_types_compatible(element_type, element)) {
+				return "The native function does not accept every element.";
+			}
+			job->native_results[i] = native->function(job->vm, &element);
+		}
+		return NULL;
+	}
+
+	Value accumulator = job_input(job, start);
+	if (!runtime_types_compatible(native->arg_types[1]->base_type, accumulator)) {
+		return "The native function does not accept every element.";
+	}
+	for (uint32_t i = start + 1; i < end; i++) {
+		const Value args[2] = {job_input(job, i), accumulator};
+		if (!runtime_types_compatible(element_type, args[0])) {
+			return "The native function does not accept every element.";
+		}
+		accumulator = native->function(job->vm, args);
+	}
+	job->native_results[chunk] = accumulator;
+	return NULL;
+}
+
+static VM *job_isolate(ParallelJob *job, const uint32_t thread, const char **error_out)
+{
+	if (job->isolates[thread] != NULL || job->isolate_errors[thread] != NULL) {
+		*error_out = job->isolate_errors[thread];
+		return job->isolates[thread];
+	}
+	VM *isolate = new_vm(2, job->isolate_argv);
+	if (isolate == NULL) {
+		job->isolate_errors[thread] = "Failed to create an isolate for the parallel function.";
+		*error_out = job->isolate_errors[thread];
+		return NULL;
+	}
+	const char *error = NULL;
+	if (!load_isolate(isolate, job->isolate_argv[1], job->function_name, job->arity, &job->isolate_functions[thread],
+					  &error)) {
+		free_vm(isolate);
+		job->isolate_errors[thread] = error;
+		*error_out = error;
+		return NULL;
+	}
+	job->isolates[thread] = isolate;
+	return isolate;
+}
+
+static const char *run_isolate_chunk(ParallelJob *job, const uint32_t start, const uint32_t end, const uint32_t chunk,
+									 const uint32_t thread)
+{
+	const char *error = NULL;
+	VM *isolate = job_isolate(job, thread, &error);
+	if (error != NULL) {
+		return error;
+	}
+	const Value function = job->isolate_functions[thread];
+	// calls may grow the isolate's stack and move it
+	const ptrdiff_t stack_depth = isolate->stack_top - isolate->stack;
+
+	// the caller waits until every chunk is done, so its array can be read but not changed meanwhile
+	const ObjectArray *chunk_inputs = NULL;
+	if (job->inputs != NULL) {
+		WorkerMessage *message = encode_worker_values(job->inputs + start, end - start, &error);
+		if (message == NULL) {
+			return error;
+		}
+		Value copied;
+		const bool decoded = decode_worker_message(isolate, message, &copied);
+		free_worker_message(message);
+		if (!decoded) {
+			return "Failed to copy the array into an isolate.";
+		}
+		chunk_inputs = AS_CRUX_ARRAY(copied);
+		push(isolate, copied);
+	}
+#define CHUNK_INPUT(index) (chunk_inputs != NULL ? chunk_inputs->values[(index) - start] : job_input(job, (index)))
+
+	Value result;
+	if (job->operation == PARALLEL_MAP) {
+		ObjectArray *results = new_array(isolate, end - start);
+		push(isolate, OBJECT_VAL(results));
+		for (uint32_t i = start; i < end; i++) {
+			const Value element = CHUNK_INPUT(i);
+			Value mapped;
+			if (!call_isolate_function(isolate, function, &element, 1, &mapped)) {
+				job->isolate_errors[thread] = "The parallel function panicked.";
+				return job->isolate_errors[thread];
+			}
+			push(isolate, mapped);
+			array_add_back(isolate, results, mapped);
+			pop(isolate);
+		}
+		result = OBJECT_VAL(results);
+	} else {
+		result = CHUNK_INPUT(start);
+		for (uint32_t i = start + 1; i < end; i++) {
+			const Value args[2] = {CHUNK_INPUT(i), result};
+			if (!call_isolate_function(isolate, function, args, 2, &result)) {
+				job->isolate_errors[thread] = "The parallel function panicked.";
+				return job->isolate_errors[thread];
+			}
+		}
+	}
+#undef CHUNK_INPUT
+
+	job->isolate_results[chunk] = encode_worker_message(result, &error);
+	isolate->stack_top = isolate->stack + stack_depth;
+	return error;
+}
+
+static void run_parallel_chunk(void *context, const uint32_t chunk, const uint32_t thread)
+{
+	ParallelJob *job = context;
+	const uint32_t start = chunk * job->chunk_size;
+	const uint32_t end = job->count - start < job->chunk_size ? job->count : start + job->chunk_size;
+	job->chunk_errors[chunk] = job->native != NULL ? run_native_chunk(job, start, end, chunk)
+												   : run_isolate_chunk(job, start, end, chunk, thread);
+}
+
+/**
+ * Decides how <callable> can run in parallel. Returns false when it has to run on the calling VM instead: closures
+ * with upvalues and functions of the main script cannot be loaded into an isolate.
+ */
+static bool prepare_job(ParallelJob *job, const Value callable, const int arity)
+{
+	if (IS_CRUX_NATIVE_CALLABLE(callable)) {
+		const ObjectNativeCallable *native = AS_CRUX_NATIVE_CALLABLE(callable);
+		if (!native->is_pure || native->arity != arity) {
+			return false;
+		}
+		job->native = native;
+		return true;
+	}
+	if (!IS_CRUX_CLOSURE(callable)) {
+		return false;
+	}
+
+	const ObjectClosure *closure = AS_CRUX_CLOSURE(callable);
+	const ObjectFunction *function = closure->function;
+	const ObjectModuleRecord *module_record = function->module_record;
+	if (closure->upvalue_count != 0 || function->arity != arity || function->is_generator || function->name == NULL ||
+		module_record == NULL ||
+		module_record->is_main || module_record->path == NULL) {
+		return false;
+	}
+	// the isolate finds the function by name, so it has to be the module's global of that name
+	uint32_t index;
+	if (!get_module_global_index(module_record, function->name, &index) || module_record->globals[index] != callable) {
+		return false;
+	}
+	job->isolate_argv[0] = "crux";
+	job->isolate_argv[1] = module_record->path->chars;
+	job->function_name = function->name->chars;
+	job->arity = arity;
+	return true;
+}
+
+static void free_job(ParallelJob *job)
+{
+	for (uint32_t i = 0; i < THREAD_POOL_MAX_THREADS; i++) {
+		if (job->isolates[i] != NULL) {
+			free_vm(job->isolates[i]);
+		}
+	}
+	if (job->isolate_results != NULL) {
+		for (uint32_t i = 0; i < job->chunk_count; i++) {
+			free_worker_message(job->isolate_results[i]);
+		}
+	}
+	free(job->isolate_results);
+	free(job->native_results);
+	free(job->chunk_errors);
+}
+
+/**
+ * Runs every chunk of <job>. Returns NULL on success or the error of the first chunk that failed.
+ */
+static const char *run_job(VM *vm, ParallelJob *job, const uint32_t count)
+{
+	const uint32_t min_chunk = job->native != NULL ? PARALLEL_NATIVE_MIN_CHUNK : PARALLEL_ISOLATE_MIN_CHUNK;
+	const uint32_t even_chunk = (uint32_t)(((uint64_t)count + PARALLEL_MAX_CHUNKS - 1) / PARALLEL_MAX_CHUNKS);
+	job->vm = vm;
+	job->count = count;
+	job->chunk_size = even_chunk > min_chunk ? even_chunk : min_chunk;
+	job->chunk_count = (count + job->chunk_size - 1) / job->chunk_size;
+
+	job->chunk_errors = calloc(job->chunk_count, sizeof(const char *));
+	if (job->native != NULL) {
+		const uint32_t result_count = job->operation == PARALLEL_MAP ? count : job->chunk_count;
+		job->native_results = malloc(sizeof(Value) * result_count);
+	} else {
+		job->isolate_results = calloc(job->chunk_count, sizeof(WorkerMessage *));
+	}
+	if (job->chunk_errors == NULL || (job->native_results == NULL && job->isolate_results == NULL)) {
+		return "Failed to allocate memory for the parallel operation.";
+	}
+
+	run_parallel(vm, job->chunk_count, run_parallel_chunk, job);
+
+	for (uint32_t i = 0; i < job->chunk_count; i++) {
+		if (job->chunk_errors[i] != NULL) {
+			return job->chunk_errors[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Collects the mapped values of a finished job into a new array, in element order.
+ */
+static Value collect_map_results(VM *vm, ParallelJob *job)
+{
+	ObjectArray *results = new_array(vm, job->count);
+	push(vm, OBJECT_VAL(results));
+	if (job->native != NULL) {
+		for (uint32_t i = 0; i < job->count; i++) {
+			array_add_back(vm, results, job->native_results[i]);
+		}
+	} else {
+		for (uint32_t i = 0; i < job->chunk_count; i++) {
+			Value chunk;
+			if (!decode_worker_message(vm, job->isolate_results[i], &chunk)) {
+				pop(vm);
+				return make_error_result(vm, "Failed to copy the results out of an isolate.", RUNTIME);
+			}
+			const ObjectArray *chunk_results = AS_CRUX_ARRAY(chunk);
+			push(vm, chunk);
+			for (uint32_t j = 0; j < chunk_results->size; j++) {
+				array_add_back(vm, results, chunk_results->values[j]);
+			}
+			pop(vm);
+		}
+	}
+	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(results));
+	pop(vm);
+	return OBJECT_VAL(result);
+}
+
+static Value parallel_map(VM *vm, const Value *inputs, const int32_t range_start, const uint32_t count,
+						  const Value callable)
+{
+	ParallelJob job;
+	memset(&job, 0, sizeof(job));
+	job.operation = PARALLEL_MAP;
+	job.inputs = inputs;
+	job.range_start = range_start;
+	if (count == 0) {
+		return OBJECT_VAL(new_ok_result(vm, OBJECT_VAL(new_array(vm, 0))));
+	}
+	if (!prepare_job(&job, callable, 1)) {
+		return NIL_VAL;
+	}
+
+	const char *error = run_job(vm, &job, count);
+	const Value result = error != NULL ? make_error_result(vm, error, RUNTIME) : collect_map_results(vm, &job);
+	free_job(&job);
+	return result;
+}
+
+/**
+ * Like Array.map(), but the function runs on several threads. Pure native functions are called directly; Crux
+ * functions run in isolates that each load the function's module, so they must be global functions of an imported
+ * module and only see copies of the elements. Other functions are mapped on this thread.
+ * arg0 -> array: Array
+ * arg1 -> func: Function (takes 1 argument)
+ * Returns Result<Array>
+ */
+Value array_par_map_method(VM *vm, const Value *args)
+{
+	const ObjectArray *array = AS_CRUX_ARRAY(args[0]);
+	const Value result = parallel_map(vm, array->values, 0, array->size, args[1]);
+	return IS_NIL(result) ? array_map_method(vm, args) : result;
+}
+
+/**
+ * Like Array.reduce(), but chunks of the array are reduced on several threads before their results are folded into
+ * <initial> in order. The function must be associative. Which functions run in parallel is the same as for
+ * par_map().
+ * arg0 -> array: Array
+ * arg1 -> func: Function (takes 2 arguments: element, accumulator)
+ * arg2 -> initial: Any
+ * Returns Result<Any>
+ */
+Value array_par_reduce_method(VM *vm, const Value *args)
+{
+	const ObjectArray *array = AS_CRUX_ARRAY(args[0]);
+	const Value callable = args[1];
+
+	ParallelJob job;
+	memset(&job, 0, sizeof(job));
+	job.operation = PARALLEL_REDUCE;
+	job.inputs = array->values;
+	if (array->size == 0 || !prepare_job(&job, callable, 2)) {
+		return array_reduce_method(vm, args);
+	}
+	if (job.native != NULL && !runtime_types_compatible(job.native->arg_types[1]->base_type, args[2])) {
+		return make_error_result(vm, "The native function does not accept the initial value.", RUNTIME);
+	}
+
+	const char *error = run_job(vm, &job, array->size);
+	if (error != NULL) {
+		free_job(&job);
+		return make_error_result(vm, error, RUNTIME);
+	}
+
+	Value accumulator = args[2];
+	push(vm, accumulator);
+	for (uint32_t i = 0; i < job.chunk_count; i++) {
+		if (job.native != NULL) {
+			const Value kernel_args[2] = {job.native_results[i], accumulator};
+			accumulator = job.native->function(vm, kernel_args);
+			vm->stack_top[-1] = accumulator;
+			continue;
+		}
+
+		Value chunk;
+		if (!decode_worker_message(vm, job.isolate_results[i], &chunk)) {
+			pop(vm);
+			free_job(&job);
+			return make_error_result(vm, "Failed to copy a partial result out of an isolate.", RUNTIME);
+		}
+		push(vm, callable);
+		push(vm, chunk);
+		push(vm, accumulator);
+		if (call_from_native(vm, callable, 2, &accumulator) != INTERPRET_OK) {
+			pop(vm);
+			free_job(&job);
+			return make_error_result(vm, "Failed to call the reduce function.", RUNTIME);
+		}
+		vm->stack_top[-1] = accumulator;
+	}
+	free_job(&job);
+
+	ObjectResult *result = new_ok_result(vm, accumulator);
+	pop(vm);
+	return OBJECT_VAL(result);
+}
+
+/**
+ * Calls <func> with every Int from <start> up to, but not including, <end> on several threads and returns the results
+ * in order. Which functions run in parallel is the same as for Array.par_map()
+ * arg0 -> start: Int
+ * arg1 -> end: Int
+ * arg2 -> func: Function (takes 1 argument)
+ * Returns Result<Array>
+ */
+Value parallel_for_range_function(VM *vm, const Value *args)
+{
+	const int32_t start = AS_INT(args[0]);
+	const int32_t end = AS_INT(args[1]);
+	const uint32_t count = end > start ? (uint32_t)((int64_t)end - start) : 0;
+	const Value callable = args[2];
+
+	const Value result = parallel_map(vm, NULL, start, count, callable);
+	if (!IS_NIL(result)) {
+		return result;
+	}
+
+	ObjectArray *results = new_array(vm, count);
+	push(vm, OBJECT_VAL(results));
+	for (uint32_t i = 0; i < count; i++) {
+		push(vm, callable);
+		push(vm, INT_VAL(start + (int32_t)i));
+		Value mapped;
+		if (call_from_native(vm, callable, 1, &mapped) != INTERPRET_OK) {
+			pop(vm);
+			return make_error_result(vm, "Failed to call the range function.", RUNTIME);
+		}
+		push(vm, mapped);
+		array_add_back(vm, results, mapped);
+		pop(vm);
+	}
+	ObjectResult *ok = new_ok_result(vm, OBJECT_VAL(results));
+	pop(vm);
+	return OBJECT_VAL(ok);
+}
+
+/**
+ * Returns how many threads parallel operations use, including the calling one
+ * Returns Int
+ */
+Value parallel_threads_function(VM *vm, const Value *args)
+{
+	(void)args;
+	return INT_VAL((int32_t)thread_pool_size(vm));
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "stdlib/profile.h"
+#include "function_stats.h"
+#include "garbage_collector.h"
+#include "value.h"
+
+/**
+ * Starts counting calls, time and allocations per function
+ * Returns Nil
+ */
+Value profile_start_stats_function(VM *vm, const Value *args)
+{
+	(void)args;
+	set_function_stats_enabled(vm, true);
+	return NIL_VAL;
+}
+
+/**
+ * Stops measuring. What was measured stays available to report()
+ * Returns Nil
+ */
+Value profile_stop_stats_function(VM *vm, const Value *args)
+{
+	(void)args;
+	set_function_stats_enabled(vm, false);
+	return NIL_VAL;
+}
+
+/**
+ * Forgets everything measured so far
+ * Returns Nil
+ */
+Value profile_reset_function(VM *vm, const Value *args)
+{
+	(void)args;
+	reset_function_stats(vm);
+	return NIL_VAL;
+}
+
+static void add_profile_stat(VM *vm, ObjectTable *table, const char *name, const uint64_t value)
+{
+	ObjectString *key = copy_string(vm, name, (uint32_t)strlen(name));
+	push(vm, OBJECT_VAL(key));
+	object_table_set(vm, table, OBJECT_VAL(key), FLOAT_VAL((double)value));
+	pop(vm);
+}
+
+/**
+ * Returns a table keyed by "name (module path)", whose values are tables with calls, inclusive_ns, exclusive_ns and
+ * alloc_bytes. Functions sharing a name inside one module are added together.
+ * Returns Table
+ */
+Value profile_report_function(VM *vm, const Value *args)
+{
+	(void)args;
+	const FunctionStats *stats = &vm->function_stats;
+
+	ObjectTable *report = new_object_table(vm, (int)stats->count);
+	push(vm, OBJECT_VAL(report));
+
+	// the allocations below are charged to the caller and may grow the entries, so copy each one first
+	for (uint32_t i = 0; i < stats->count; i++) {
+		const FunctionStatsEntry entry = stats->entries[i];
+		const ObjectFunction *function = entry.function;
+		const char *name = function->name != NULL && function->name->byte_length > 0 ? function->name->chars
+																					   : "<script>";
+		const char *path = function->module_record != NULL && function->module_record->path != NULL
+							   ? function->module_record->path->chars
+							   : "<unknown>";
+
+		const size_t key_length = strlen(name) + strlen(path) + 3;
+		char *key_chars = ALLOCATE(vm, char, key_length + 1);
+		snprintf(key_chars, key_length + 1, "%s (%s)", name, path);
+		ObjectString *key = take_string(vm, key_chars, (uint32_t)key_length);
+		push(vm, OBJECT_VAL(key));
+
+		// functions sharing a key are summed, the last of them writes the total
+		uint64_t calls = entry.calls;
+		uint64_t inclusive_ns = entry.inclusive_ns;
+		uint64_t exclusive_ns = entry.exclusive_ns;
+		uint64_t alloc_bytes = entry.alloc_bytes;
+		for (uint32_t j = 0; j < i; j++) {
+			const FunctionStatsEntry *other = &stats->entries[j];
+			if (other->function->name != function->name || other->function->module_record != function->module_record) {
+				continue;
+			}
+			calls += other->calls;
+			inclusive_ns += other->inclusive_ns;
+			exclusive_ns += other->exclusive_ns;
+			alloc_bytes += other->alloc_bytes;
+		}
+
+		ObjectTable *row = new_object_table(vm, 4);
+		push(vm, OBJECT_VAL(row));
+		add_profile_stat(vm, row, "calls", calls);
+		add_profile_stat(vm, row, "inclusive_ns", inclusive_ns);
+		add_profile_stat(vm, row, "exclusive_ns", exclusive_ns);
+		add_profile_stat(vm, row, "alloc_bytes", alloc_bytes);
+		object_table_set(vm, report, OBJECT_VAL(key), OBJECT_VAL(row));
+		pop(vm); // row
+		pop(vm); // key
+	}
+
+	pop(vm);
+	return OBJECT_VAL(report);
+}
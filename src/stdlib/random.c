@@ -88,7 +88,7 @@ Value random_int_method(VM *vm, const Value *args)
 	const uint64_t range = (uint64_t)maxInt - (uint64_t)minInt + 1;
 	const int32_t result = minInt + (int32_t)(r * range);
 
-	return OBJECT_VAL(new_ok_result(vm, INT_VAL(result)));
+	return native_ok(vm, INT_VAL(result));
 }
 
 /**
@@ -119,7 +119,7 @@ Value random_float_method(VM *vm, const Value *args)
 	const double r = get_next(random);
 	const double result = minDouble + r * (maxDouble - minDouble);
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(result)));
+	return native_ok(vm, FLOAT_VAL(result));
 }
 
 // Returns true with probability p (0 <= p <= 1)
@@ -142,7 +142,7 @@ Value random_bool_method(VM *vm, const Value *args)
 	ObjectRandom *random = AS_CRUX_RANDOM(args[0]);
 	const double r = get_next(random);
 
-	return OBJECT_VAL(new_ok_result(vm, BOOL_VAL(r < prob)));
+	return native_ok(vm, BOOL_VAL(r < prob));
 }
 
 // Returns a random element from the array
@@ -163,5 +163,5 @@ Value random_choice_method(VM *vm, const Value *args)
 	const double r = get_next(random);
 	const uint32_t index = (uint32_t)(r * arr->size);
 
-	return OBJECT_VAL(new_ok_result(vm, arr->values[index]));
+	return native_ok(vm, arr->values[index]);
 }
@@ -27,9 +27,9 @@ Value new_range_function(VM *vm, const Value *args)
 	}
 
 	ObjectRange *range = new_range(vm, start, end, step);
-	push(vm->current_module_record, OBJECT_VAL(range));
+	push(vm, OBJECT_VAL(range));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(range));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -58,17 +58,17 @@ Value to_array_range_method(VM *vm, const Value *args)
 	int32_t len = range_len(range);
 
 	ObjectArray *array = new_array(vm, len);
-	push(vm->current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 
 	int32_t i = range->start;
 	for (int32_t n = 0; n < len; n++, i += range->step) {
 		if (!array_add_back(vm, array, INT_VAL(i))) {
-			pop(vm->current_module_record);
+			pop(vm);
 			return MAKE_GC_SAFE_ERROR(vm, "Failed to add element to array.", VALUE);
 		}
 	}
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(array));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
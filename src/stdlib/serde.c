@@ -0,0 +1,750 @@
+#include <string.h>
+
+#include "stdlib/serde.h"
+#include "garbage_collector.h"
+#include "panic.h"
+#include "table.h"
+#include "value.h"
+
+// Values are written as MessagePack. Crux types without a MessagePack equivalent use extension types whose payload
+// is itself MessagePack, except for the numeric payloads of vectors and matrices.
+#define SERDE_EXT_TUPLE 1 // payload: array of the elements
+#define SERDE_EXT_STRUCT 2 // payload: struct name, then map of field name to value
+#define SERDE_EXT_VECTOR 3 // payload: float64 components
+#define SERDE_EXT_MATRIX 4 // payload: uint16 rows, uint16 columns, float64 elements in row-major order
+
+// deeper values are almost certainly cyclic
+#define SERDE_MAX_DEPTH 128
+
+typedef struct {
+	VM *vm;
+	ObjectBuffer *buffer;
+	const char *error;
+} Packer;
+
+typedef struct {
+	VM *vm;
+	const uint8_t *data;
+	uint32_t position;
+	uint32_t end;
+	const char *error;
+} Unpacker;
+
+static bool reserve(Packer *packer, const uint32_t count)
+{
+	ObjectBuffer *buffer = packer->buffer;
+	const uint64_t required = (uint64_t)buffer->write_pos + count;
+	if (required <= buffer->capacity) {
+		return true;
+	}
+	uint64_t new_capacity = buffer->capacity;
+	while (new_capacity < required) {
+		new_capacity = new_capacity < 8 ? 8 : new_capacity * 2;
+	}
+	if (new_capacity > UINT32_MAX) {
+		packer->error = "Failed to grow buffer - buffer is at maximum capacity.";
+		return false;
+	}
+	buffer->data = GROW_ARRAY(packer->vm, uint8_t, buffer->data, buffer->capacity, (uint32_t)new_capacity);
+	buffer->capacity = (uint32_t)new_capacity;
+	return true;
+}
+
+static bool put_byte(Packer *packer, const uint8_t byte)
+{
+	if (!reserve(packer, 1)) {
+		return false;
+	}
+	packer->buffer->data[packer->buffer->write_pos++] = byte;
+	return true;
+}
+
+/**
+ * Writes <marker> followed by the low <size> bytes of <value> in big-endian order.
+ */
+static bool put_sized(Packer *packer, const uint8_t marker, const uint64_t value, const uint32_t size)
+{
+	if (!reserve(packer, 1 + size)) {
+		return false;
+	}
+	uint8_t *out = packer->buffer->data + packer->buffer->write_pos;
+	out[0] = marker;
+	for (uint32_t i = 0; i < size; i++) {
+		out[1 + i] = (uint8_t)(value >> (8 * (size - 1 - i)));
+	}
+	packer->buffer->write_pos += 1 + size;
+	return true;
+}
+
+static bool put_float64(Packer *packer, const double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return put_sized(packer, 0xcb, bits, 8);
+}
+
+/**
+ * Writes a header whose size field grows with <length>: the fix form when <length> fits <fix_limit>, then the 8-,
+ * 16- and 32-bit forms. Types without an 8-bit form pass 0 as <marker8>.
+ */
+static bool put_header(Packer *packer, const uint32_t length, const uint8_t fix_marker, const uint32_t fix_limit,
+					   const uint8_t marker8, const uint8_t marker16, const uint8_t marker32)
+{
+	if (length < fix_limit) {
+		return put_byte(packer, (uint8_t)(fix_marker | length));
+	}
+	if (marker8 != 0 && length <= UINT8_MAX) {
+		return put_sized(packer, marker8, length, 1);
+	}
+	if (length <= UINT16_MAX) {
+		return put_sized(packer, marker16, length, 2);
+	}
+	return put_sized(packer, marker32, length, 4);
+}
+
+static bool put_int(Packer *packer, const int32_t value)
+{
+	if (value >= 0 && value <= 0x7f) {
+		return put_byte(packer, (uint8_t)value);
+	}
+	if (value < 0 && value >= -32) {
+		return put_byte(packer, (uint8_t)(int8_t)value);
+	}
+	if (value >= INT8_MIN && value <= INT8_MAX) {
+		return put_sized(packer, 0xd0, (uint8_t)(int8_t)value, 1);
+	}
+	if (value >= INT16_MIN && value <= INT16_MAX) {
+		return put_sized(packer, 0xd1, (uint16_t)(int16_t)value, 2);
+	}
+	return put_sized(packer, 0xd2, (uint32_t)value, 4);
+}
+
+static bool put_string(Packer *packer, const ObjectString *string)
+{
+	if (!put_header(packer, string->byte_length, 0xa0, 32, 0xd9, 0xda, 0xdb) ||
+		!reserve(packer, string->byte_length)) {
+		return false;
+	}
+	memcpy(packer->buffer->data + packer->buffer->write_pos, string->chars, string->byte_length);
+	packer->buffer->write_pos += string->byte_length;
+	return true;
+}
+
+/**
+ * Writes an ext32 header with a length to be filled in by end_ext(), since the payload size of compound values is
+ * only known once they are written. Returns the position of the length.
+ */
+static bool begin_ext(Packer *packer, const int8_t type, uint32_t *length_position)
+{
+	if (!put_sized(packer, 0xc9, 0, 4) || !put_byte(packer, (uint8_t)type)) {
+		return false;
+	}
+	*length_position = packer->buffer->write_pos - 5;
+	return true;
+}
+
+static void end_ext(const Packer *packer, const uint32_t length_position)
+{
+	const uint32_t length = packer->buffer->write_pos - length_position - 5;
+	uint8_t *out = packer->buffer->data + length_position;
+	out[0] = (uint8_t)(length >> 24);
+	out[1] = (uint8_t)(length >> 16);
+	out[2] = (uint8_t)(length >> 8);
+	out[3] = (uint8_t)length;
+}
+
+static bool put_ext_header(Packer *packer, const int8_t type, const uint32_t length)
+{
+	bool written;
+	switch (length) {
+	case 1:
+	case 2:
+	case 4:
+	case 8:
+	case 16: {
+		const uint8_t fixext_markers[] = {[1] = 0xd4, [2] = 0xd5, [4] = 0xd6, [8] = 0xd7, [16] = 0xd8};
+		written = put_byte(packer, fixext_markers[length]);
+		break;
+	}
+	default:
+		written = put_header(packer, length, 0, 0, 0xc7, 0xc8, 0xc9);
+		break;
+	}
+	return written && put_byte(packer, (uint8_t)type);
+}
+
+static bool pack_value(Packer *packer, Value value, int depth);
+
+static bool pack_values(Packer *packer, const Value *values, const uint32_t count, const int depth)
+{
+	if (!put_header(packer, count, 0x90, 16, 0, 0xdc, 0xdd)) {
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (!pack_value(packer, values[i], depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool pack_table(Packer *packer, const ObjectTable *table, const int depth)
+{
+	if (!put_header(packer, table->size, 0x80, 16, 0, 0xde, 0xdf)) {
+		return false;
+	}
+	for (uint32_t i = 0; i < table->capacity; i++) {
+		const ObjectTableEntry *entry = &table->entries[i];
+		if (entry->is_occupied &&
+			(!pack_value(packer, entry->key, depth + 1) || !pack_value(packer, entry->value, depth + 1))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool pack_struct_instance(Packer *packer, const ObjectStructInstance *instance, const int depth)
+{
+	const ObjectStruct *struct_type = instance->struct_type;
+	uint32_t length_position;
+	if (!begin_ext(packer, SERDE_EXT_STRUCT, &length_position) || !put_string(packer, struct_type->name) ||
+		!put_header(packer, (uint32_t)struct_type->fields.count, 0x80, 16, 0, 0xde, 0xdf)) {
+		return false;
+	}
+	for (int i = 0; i < struct_type->fields.capacity; i++) {
+		const Entry *field = &struct_type->fields.entries[i];
+		if (field->key == NULL) {
+			continue;
+		}
+		if (!put_string(packer, field->key) ||
+			!pack_value(packer, instance->fields[(uint16_t)AS_INT(field->value)], depth + 1)) {
+			return false;
+		}
+	}
+	end_ext(packer, length_position);
+	return true;
+}
+
+static bool pack_doubles(Packer *packer, const double *values, const uint32_t count)
+{
+	if (!reserve(packer, count * 8)) {
+		return false;
+	}
+	uint8_t *out = packer->buffer->data + packer->buffer->write_pos;
+	for (uint32_t i = 0; i < count; i++) {
+		uint64_t bits;
+		memcpy(&bits, &values[i], sizeof(bits));
+		for (int byte = 0; byte < 8; byte++) {
+			*out++ = (uint8_t)(bits >> (56 - 8 * byte));
+		}
+	}
+	packer->buffer->write_pos += count * 8;
+	return true;
+}
+
+static bool pack_value(Packer *packer, const Value value, const int depth)
+{
+	if (depth > SERDE_MAX_DEPTH) {
+		packer->error = "Value is nested too deeply to pack.";
+		return false;
+	}
+	if (IS_NIL(value)) {
+		return put_byte(packer, 0xc0);
+	}
+	if (IS_BOOL(value)) {
+		return put_byte(packer, AS_BOOL(value) ? 0xc3 : 0xc2);
+	}
+	if (IS_INT(value)) {
+		return put_int(packer, AS_INT(value));
+	}
+	if (IS_FLOAT(value)) {
+		return put_float64(packer, AS_FLOAT(value));
+	}
+
+	if (IS_CRUX_STRING(value)) {
+		return put_string(packer, AS_CRUX_STRING(value));
+	}
+	if (IS_CRUX_ARRAY(value)) {
+		const ObjectArray *array = AS_CRUX_ARRAY(value);
+		return pack_values(packer, array->values, array->size, depth);
+	}
+	if (IS_CRUX_TABLE(value)) {
+		return pack_table(packer, AS_CRUX_TABLE(value), depth);
+	}
+	if (IS_CRUX_TUPLE(value)) {
+		const ObjectTuple *tuple = AS_CRUX_TUPLE(value);
+		uint32_t length_position;
+		if (!begin_ext(packer, SERDE_EXT_TUPLE, &length_position) ||
+			!pack_values(packer, tuple->elements, tuple->size, depth)) {
+			return false;
+		}
+		end_ext(packer, length_position);
+		return true;
+	}
+	if (IS_CRUX_STRUCT_INSTANCE(value)) {
+		return pack_struct_instance(packer, AS_CRUX_STRUCT_INSTANCE(value), depth);
+	}
+	if (IS_CRUX_VECTOR(value)) {
+		const ObjectVector *vector = AS_CRUX_VECTOR(value);
+		if (vector->dimensions > UINT32_MAX / 8) {
+			packer->error = "Vector is too large to pack.";
+			return false;
+		}
+		return put_ext_header(packer, SERDE_EXT_VECTOR, vector->dimensions * 8) &&
+			   pack_doubles(packer, VECTOR_COMPONENTS(vector), vector->dimensions);
+	}
+	if (IS_CRUX_MATRIX(value)) {
+		const ObjectMatrix *matrix = AS_CRUX_MATRIX(value);
+		const uint32_t count = (uint32_t)matrix->row_dim * matrix->col_dim;
+		if (count > (UINT32_MAX - 4) / 8) {
+			packer->error = "Matrix is too large to pack.";
+			return false;
+		}
+		if (!put_ext_header(packer, SERDE_EXT_MATRIX, 4 + count * 8) || !reserve(packer, 4)) {
+			return false;
+		}
+		uint8_t *out = packer->buffer->data + packer->buffer->write_pos;
+		out[0] = (uint8_t)(matrix->row_dim >> 8);
+		out[1] = (uint8_t)matrix->row_dim;
+		out[2] = (uint8_t)(matrix->col_dim >> 8);
+		out[3] = (uint8_t)matrix->col_dim;
+		packer->buffer->write_pos += 4;
+		return pack_doubles(packer, matrix->data, count);
+	}
+	if (IS_CRUX_BUFFER(value)) {
+		const ObjectBuffer *source = AS_CRUX_BUFFER(value);
+		const uint32_t length = source->write_pos - source->read_pos;
+		if (source == packer->buffer) {
+			packer->error = "Cannot pack a buffer into itself.";
+			return false;
+		}
+		if (!put_header(packer, length, 0, 0, 0xc4, 0xc5, 0xc6) || !reserve(packer, length)) {
+			return false;
+		}
+		memcpy(packer->buffer->data + packer->buffer->write_pos, source->data + source->read_pos, length);
+		packer->buffer->write_pos += length;
+		return true;
+	}
+
+	packer->error = "Only Nil, Bool, Int, Float, String, Array, Table, Tuple, struct, Vector, Matrix and Buffer values "
+					"can be packed.";
+	return false;
+}
+
+static bool take(Unpacker *unpacker, const uint32_t count, const uint8_t **bytes_out)
+{
+	if (unpacker->end - unpacker->position < count) {
+		unpacker->error = "Unexpected end of packed data.";
+		return false;
+	}
+	*bytes_out = unpacker->data + unpacker->position;
+	unpacker->position += count;
+	return true;
+}
+
+static bool take_uint(Unpacker *unpacker, const uint32_t size, uint64_t *value_out)
+{
+	const uint8_t *bytes;
+	if (!take(unpacker, size, &bytes)) {
+		return false;
+	}
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		value = value << 8 | bytes[i];
+	}
+	*value_out = value;
+	return true;
+}
+
+static double read_float64(const uint8_t *bytes)
+{
+	uint64_t bits = 0;
+	for (int i = 0; i < 8; i++) {
+		bits = bits << 8 | bytes[i];
+	}
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/**
+ * Crux integers are 32-bit, larger ones become Floats like the results of overflowing arithmetic.
+ */
+static Value integer_value(const int64_t value)
+{
+	if (value >= INT32_MIN && value <= INT32_MAX) {
+		return INT_VAL((int32_t)value);
+	}
+	return FLOAT_VAL((double)value);
+}
+
+static bool unpack_value(Unpacker *unpacker, Value *value_out, int depth);
+
+static bool unpack_string(Unpacker *unpacker, const uint32_t length, Value *value_out)
+{
+	const uint8_t *bytes;
+	if (!take(unpacker, length, &bytes)) {
+		return false;
+	}
+	*value_out = OBJECT_VAL(copy_string(unpacker->vm, (const char *)bytes, length));
+	return true;
+}
+
+static bool unpack_array(Unpacker *unpacker, const uint32_t count, Value *value_out, const int depth)
+{
+	if (count > unpacker->end - unpacker->position) {
+		unpacker->error = "Unexpected end of packed data.";
+		return false;
+	}
+	ObjectArray *array = new_array(unpacker->vm, count);
+	push(unpacker->vm, OBJECT_VAL(array));
+	for (uint32_t i = 0; i < count; i++) {
+		Value element;
+		if (!unpack_value(unpacker, &element, depth + 1)) {
+			return false;
+		}
+		array->values[array->size++] = element;
+	}
+	*value_out = pop(unpacker->vm);
+	return true;
+}
+
+static bool unpack_map(Unpacker *unpacker, const uint32_t count, Value *value_out, const int depth)
+{
+	if (count > (unpacker->end - unpacker->position) / 2) {
+		unpacker->error = "Unexpected end of packed data.";
+		return false;
+	}
+	VM *vm = unpacker->vm;
+	ObjectTable *table = new_object_table(vm, (int)count);
+	push(vm, OBJECT_VAL(table));
+	for (uint32_t i = 0; i < count; i++) {
+		Value key;
+		Value value;
+		if (!unpack_value(unpacker, &key, depth + 1)) {
+			return false;
+		}
+		push(vm, key);
+		if (!unpack_value(unpacker, &value, depth + 1)) {
+			return false;
+		}
+		push(vm, value);
+		if (!object_table_set(vm, table, key, value)) {
+			unpacker->error = "Failed to allocate memory for an unpacked table.";
+			return false;
+		}
+		pop_two(vm);
+	}
+	*value_out = pop(vm);
+	return true;
+}
+
+/**
+ * Rebuilds a struct instance. The struct has to be visible as a global of the calling module and have every packed
+ * field; fields that were not packed stay nil.
+ */
+static bool unpack_struct(Unpacker *unpacker, Value *value_out, const int depth)
+{
+	VM *vm = unpacker->vm;
+	// the struct is looked up in the module of the function calling unpack(), which is not always the running script
+	const ObjectModuleRecord *module_record = vm->frames[vm->frame_count - 1].closure->function->module_record;
+
+	Value name;
+	if (!unpack_value(unpacker, &name, depth + 1)) {
+		return false;
+	}
+	uint32_t global_index;
+	if (!IS_CRUX_STRING(name) || !get_module_global_index(module_record, AS_CRUX_STRING(name), &global_index) ||
+		module_record->globals == NULL || !IS_CRUX_STRUCT(module_record->globals[global_index])) {
+		unpacker->error = "Packed struct is not defined in this module.";
+		return false;
+	}
+	ObjectStruct *struct_type = AS_CRUX_STRUCT(module_record->globals[global_index]);
+
+	const uint8_t *marker;
+	if (!take(unpacker, 1, &marker)) {
+		return false;
+	}
+	uint64_t field_count;
+	if ((*marker & 0xf0) == 0x80) {
+		field_count = *marker & 0x0f;
+	} else if (*marker == 0xde || *marker == 0xdf) {
+		if (!take_uint(unpacker, *marker == 0xde ? 2 : 4, &field_count)) {
+			return false;
+		}
+	} else {
+		unpacker->error = "Packed struct has malformed fields.";
+		return false;
+	}
+
+	ObjectStructInstance *instance = new_struct_instance(vm, struct_type, (uint16_t)struct_type->fields.count);
+	push(vm, OBJECT_VAL(instance));
+	for (uint64_t i = 0; i < field_count; i++) {
+		Value field_name;
+		if (!unpack_value(unpacker, &field_name, depth + 1)) {
+			return false;
+		}
+		Value field_index;
+		if (!IS_CRUX_STRING(field_name) || !table_get(&struct_type->fields, AS_CRUX_STRING(field_name), &field_index)) {
+			unpacker->error = "Packed struct has a field its definition does not have.";
+			return false;
+		}
+		Value field_value;
+		if (!unpack_value(unpacker, &field_value, depth + 1)) {
+			return false;
+		}
+		instance->fields[(uint16_t)AS_INT(field_index)] = field_value;
+	}
+	*value_out = pop(vm);
+	return true;
+}
+
+static bool unpack_ext(Unpacker *unpacker, const uint32_t length, Value *value_out, const int depth)
+{
+	const uint8_t *type;
+	if (!take(unpacker, 1, &type)) {
+		return false;
+	}
+	if (unpacker->end - unpacker->position < length) {
+		unpacker->error = "Unexpected end of packed data.";
+		return false;
+	}
+	const uint32_t payload_end = unpacker->position + length;
+
+	switch ((int8_t)*type) {
+	case SERDE_EXT_TUPLE: {
+		Value elements;
+		if (!unpack_value(unpacker, &elements, depth + 1)) {
+			return false;
+		}
+		if (!IS_CRUX_ARRAY(elements)) {
+			unpacker->error = "Packed tuple has malformed elements.";
+			return false;
+		}
+		push(unpacker->vm, elements);
+		const ObjectArray *array = AS_CRUX_ARRAY(elements);
+		ObjectTuple *tuple = new_tuple(unpacker->vm, array->size);
+		memcpy(tuple->elements, array->values, sizeof(Value) * array->size);
+		pop(unpacker->vm);
+		*value_out = OBJECT_VAL(tuple);
+		break;
+	}
+	case SERDE_EXT_STRUCT:
+		if (!unpack_struct(unpacker, value_out, depth)) {
+			return false;
+		}
+		break;
+	case SERDE_EXT_VECTOR: {
+		if (length % 8 != 0) {
+			unpacker->error = "Packed vector has a malformed length.";
+			return false;
+		}
+		ObjectVector *vector = new_vector(unpacker->vm, length / 8);
+		double *components = VECTOR_COMPONENTS(vector);
+		for (uint32_t i = 0; i < vector->dimensions; i++) {
+			components[i] = read_float64(unpacker->data + unpacker->position + i * 8);
+		}
+		unpacker->position += length;
+		*value_out = OBJECT_VAL(vector);
+		break;
+	}
+	case SERDE_EXT_MATRIX: {
+		uint64_t rows;
+		uint64_t columns;
+		if (length < 4 || !take_uint(unpacker, 2, &rows) || !take_uint(unpacker, 2, &columns) ||
+			length - 4 != rows * columns * 8) {
+			unpacker->error = "Packed matrix has a malformed length.";
+			return false;
+		}
+		ObjectMatrix *matrix = new_matrix(unpacker->vm, (uint16_t)rows, (uint16_t)columns);
+		for (uint32_t i = 0; i < rows * columns; i++) {
+			matrix->data[i] = read_float64(unpacker->data + unpacker->position + i * 8);
+		}
+		unpacker->position += length - 4;
+		*value_out = OBJECT_VAL(matrix);
+		break;
+	}
+	default:
+		unpacker->error = "Packed data has an unknown extension type.";
+		return false;
+	}
+
+	if (unpacker->position != payload_end) {
+		unpacker->error = "Packed extension value has a malformed length.";
+		return false;
+	}
+	return true;
+}
+
+static bool unpack_bin(Unpacker *unpacker, const uint32_t length, Value *value_out)
+{
+	const uint8_t *bytes;
+	if (!take(unpacker, length, &bytes)) {
+		return false;
+	}
+	ObjectBuffer *buffer = new_buffer(unpacker->vm, length > 0 ? length : INITIAL_BUFFER_CAPACITY);
+	memcpy(buffer->data, bytes, length);
+	buffer->write_pos = length;
+	*value_out = OBJECT_VAL(buffer);
+	return true;
+}
+
+static bool unpack_value(Unpacker *unpacker, Value *value_out, const int depth)
+{
+	if (depth > SERDE_MAX_DEPTH) {
+		unpacker->error = "Packed value is nested too deeply.";
+		return false;
+	}
+	const uint8_t *marker_byte;
+	if (!take(unpacker, 1, &marker_byte)) {
+		return false;
+	}
+	const uint8_t marker = *marker_byte;
+
+	if (marker <= 0x7f) {
+		*value_out = INT_VAL(marker);
+		return true;
+	}
+	if (marker >= 0xe0) {
+		*value_out = INT_VAL((int8_t)marker);
+		return true;
+	}
+	if ((marker & 0xe0) == 0xa0) {
+		return unpack_string(unpacker, marker & 0x1f, value_out);
+	}
+	if ((marker & 0xf0) == 0x90) {
+		return unpack_array(unpacker, marker & 0x0f, value_out, depth);
+	}
+	if ((marker & 0xf0) == 0x80) {
+		return unpack_map(unpacker, marker & 0x0f, value_out, depth);
+	}
+
+	uint64_t raw;
+	switch (marker) {
+	case 0xc0:
+		*value_out = NIL_VAL;
+		return true;
+	case 0xc2:
+	case 0xc3:
+		*value_out = BOOL_VAL(marker == 0xc3);
+		return true;
+	case 0xc4:
+	case 0xc5:
+	case 0xc6:
+		return take_uint(unpacker, 1u << (marker - 0xc4), &raw) && unpack_bin(unpacker, (uint32_t)raw, value_out);
+	case 0xc7:
+	case 0xc8:
+	case 0xc9:
+		return take_uint(unpacker, 1u << (marker - 0xc7), &raw) &&
+			   unpack_ext(unpacker, (uint32_t)raw, value_out, depth);
+	case 0xca: {
+		if (!take_uint(unpacker, 4, &raw)) {
+			return false;
+		}
+		const uint32_t bits = (uint32_t)raw;
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		*value_out = FLOAT_VAL((double)value);
+		return true;
+	}
+	case 0xcb: {
+		const uint8_t *bytes;
+		if (!take(unpacker, 8, &bytes)) {
+			return false;
+		}
+		*value_out = FLOAT_VAL(read_float64(bytes));
+		return true;
+	}
+	case 0xcc:
+	case 0xcd:
+	case 0xce:
+		if (!take_uint(unpacker, 1u << (marker - 0xcc), &raw)) {
+			return false;
+		}
+		*value_out = integer_value((int64_t)raw);
+		return true;
+	case 0xcf:
+		if (!take_uint(unpacker, 8, &raw)) {
+			return false;
+		}
+		*value_out = raw <= INT32_MAX ? INT_VAL((int32_t)raw) : FLOAT_VAL((double)raw);
+		return true;
+	case 0xd0:
+	case 0xd1:
+	case 0xd2:
+	case 0xd3: {
+		const uint32_t size = 1u << (marker - 0xd0);
+		if (!take_uint(unpacker, size, &raw)) {
+			return false;
+		}
+		// sign-extend from the packed width
+		const uint32_t shift = 64 - 8 * size;
+		*value_out = integer_value((int64_t)(raw << shift) >> shift);
+		return true;
+	}
+	case 0xd4:
+	case 0xd5:
+	case 0xd6:
+	case 0xd7:
+	case 0xd8:
+		return unpack_ext(unpacker, 1u << (marker - 0xd4), value_out, depth);
+	case 0xd9:
+	case 0xda:
+	case 0xdb:
+		return take_uint(unpacker, 1u << (marker - 0xd9), &raw) && unpack_string(unpacker, (uint32_t)raw, value_out);
+	case 0xdc:
+	case 0xdd:
+		return take_uint(unpacker, marker == 0xdc ? 2 : 4, &raw) &&
+			   unpack_array(unpacker, (uint32_t)raw, value_out, depth);
+	case 0xde:
+	case 0xdf:
+		return take_uint(unpacker, marker == 0xde ? 2 : 4, &raw) &&
+			   unpack_map(unpacker, (uint32_t)raw, value_out, depth);
+	default:
+		unpacker->error = "Packed data has an unknown type marker.";
+		return false;
+	}
+}
+
+/**
+ * Appends <value> to the buffer in MessagePack format. Nothing is written if the value cannot be packed
+ * arg0 -> buffer: Buffer
+ * arg1 -> value: Any
+ * Returns Result<Int> (the number of bytes written)
+ */
+Value serde_pack_function(VM *vm, const Value *args)
+{
+	ObjectBuffer *buffer = AS_CRUX_BUFFER(args[0]);
+	const uint32_t start = buffer->write_pos;
+	Packer packer = {.vm = vm, .buffer = buffer, .error = NULL};
+	if (!pack_value(&packer, args[1], 0)) {
+		buffer->write_pos = start;
+		return make_error_result(vm, packer.error, VALUE);
+	}
+	return OBJECT_VAL(new_ok_result(vm, INT_VAL((int32_t)(buffer->write_pos - start))));
+}
+
+/**
+ * Reads the next packed value from the buffer. On error the buffer's read position does not move
+ * arg0 -> buffer: Buffer
+ * Returns Result<Any>
+ */
+Value serde_unpack_function(VM *vm, const Value *args)
+{
+	ObjectBuffer *buffer = AS_CRUX_BUFFER(args[0]);
+	Value *stack_top = vm->stack_top;
+
+	// values are rebuilt straight from the buffer's bytes; nothing writes to the buffer until decoding is done
+	Unpacker unpacker = {
+		.vm = vm, .data = buffer->data, .position = buffer->read_pos, .end = buffer->write_pos, .error = NULL};
+	Value value;
+	if (!unpack_value(&unpacker, &value, 0)) {
+		vm->stack_top = stack_top;
+		return make_error_result(vm, unpacker.error, VALUE);
+	}
+	buffer->read_pos = unpacker.position;
+	push(vm, value);
+	ObjectResult *result = new_ok_result(vm, value);
+	vm->stack_top = stack_top;
+	return OBJECT_VAL(result);
+}
@@ -20,9 +20,9 @@ Value new_set_function(VM *vm, const Value *args)
 			return MAKE_GC_SAFE_ERROR(vm, "All set elements must be hashable.", TYPE);
 		}
 	}
-	push(vm->current_module_record, OBJECT_VAL(set));
+	push(vm, OBJECT_VAL(set));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(set));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
@@ -104,9 +104,9 @@ Value union_set_method(VM *vm, const Value *args)
 			object_table_set(vm, result_set->entries, set2->entries->entries[i].key, NIL_VAL);
 		}
 	}
-	push(vm->current_module_record, OBJECT_VAL(result_set));
+	push(vm, OBJECT_VAL(result_set));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(result_set));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
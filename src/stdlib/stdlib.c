@@ -7,10 +7,13 @@
 #include "stdlib/buffer.h"
 #include "stdlib/complex.h"
 #include "stdlib/core.h"
+#include "stdlib/coroutine.h"
 #include "stdlib/error.h"
 #include "stdlib/fs.h"
 #include "stdlib/gc.h"
+#include "stdlib/profile.h"
 #include "stdlib/io.h"
+#include "stdlib/iterator.h"
 #include "stdlib/math.h"
 #include "stdlib/matrix.h"
 #include "stdlib/option.h"
@@ -25,6 +28,9 @@
 #include "stdlib/time.h"
 #include "stdlib/tuple.h"
 #include "stdlib/vectors.h"
+#include "stdlib/parallel.h"
+#include "stdlib/serde.h"
+#include "stdlib/worker.h"
 #include "type_system.h"
 #include "value.h"
 
@@ -174,7 +180,6 @@ static bool register_native_function(VM *vm, Table *function_table, const char *
 									 const CruxCallable function, const int arity, ObjectTypeRecord **arg_types,
 									 ObjectTypeRecord *return_type)
 {
-	ObjectModuleRecord *module_record = vm->current_module_record;
 	ObjectString *name = copy_string(vm, function_name, (int)strlen(function_name));
 	if (!name) {
 		if (arg_types && arity > 0)
@@ -182,7 +187,7 @@ static bool register_native_function(VM *vm, Table *function_table, const char *
 		return false;
 	}
 	object_set_immortal(&name->object, true); // function names are immortal
-	push(module_record, OBJECT_VAL(name));
+	push(vm, OBJECT_VAL(name));
 	ObjectNativeCallable *callable = new_native_callable(vm, function, arity, name, arg_types, return_type);
 	if (!callable) {
 		if (arg_types && arity > 0)
@@ -198,10 +203,10 @@ static bool register_native_function(VM *vm, Table *function_table, const char *
 	object_set_immortal(&return_type->object, true); // return type is immortal
 
 	const Value func = OBJECT_VAL(callable);
-	push(module_record, func);
+	push(vm, func);
 	const bool ok = table_set(vm, function_table, name, func);
-	pop(module_record);
-	pop(module_record);
+	pop(vm);
+	pop(vm);
 	return ok;
 }
 
@@ -248,6 +253,22 @@ static bool init_module(VM *vm, const char *module_name, const Callable *functio
 	return true;
 }
 
+/**
+ * Flags functions of the most recently initialized module as pure, so parallel array operations may call them from
+ * several threads at once. Pure functions compute their result from their arguments alone and never allocate.
+ */
+static void mark_pure_functions(VM *vm, const char **function_names, const int count)
+{
+	const Table *module_table = vm->native_modules.modules[vm->native_modules.count - 1].names;
+	for (int i = 0; i < count; i++) {
+		const ObjectString *name = copy_string(vm, function_names[i], (int)strlen(function_names[i]));
+		Value callable;
+		if (table_get(module_table, name, &callable) && IS_CRUX_NATIVE_CALLABLE(callable)) {
+			AS_CRUX_NATIVE_CALLABLE(callable)->is_pure = true;
+		}
+	}
+}
+
 static bool init_type_method_table(VM *vm, Table *method_table, const Callable *methods, int count)
 {
 	return methods ? register_native_methods(vm, method_table, methods, count) : true;
@@ -270,7 +291,7 @@ bool initialize_std_lib(VM *vm)
 								{"array", array_function, 1, ARGS(t_any), RES(arr_any)},
 								{"format", format_function, 2, ARGS(t_str, TBL(t_str, t_any)), res_nil},
 								{"println", io_println_function, 1, ARGS(t_any), t_nil},
-								{"iter", iter_function, 1, ARGS(t_any), res_any},
+								{"iter", iter_function, 1, ARGS(t_any), RES(iter_any)},
 								{"next", next_function, 1, ARGS(t_any), opt_any}};
 
 		if (!register_native_functions(vm, &vm->core_fns, fns, ARRAY_COUNT(fns))) {
@@ -328,6 +349,9 @@ bool initialize_std_lib(VM *vm)
 			{"map", array_map_method, 2, ARGS(arr_any, FUNC(ARGS(t_any), 1, t_any)), RES(arr_any)},
 			{"filter", array_filter_method, 2, ARGS(arr_any, FUNC(ARGS(t_any), 1, t_any)), RES(arr_any)},
 			{"reduce", array_reduce_method, 3, ARGS(arr_any, FUNC(ARGS(t_any, t_any), 2, t_any), t_any), res_any},
+			{"par_map", array_par_map_method, 2, ARGS(arr_any, FUNC(ARGS(t_any), 1, t_any)), RES(arr_any)},
+			{"par_reduce", array_par_reduce_method, 3, ARGS(arr_any, FUNC(ARGS(t_any, t_any), 2, t_any), t_any),
+			 res_any},
 			{"sort", array_sort_method, 1, ARGS(arr_any), RES(arr_any)},
 			{"join", array_join_method, 2, ARGS(arr_any, t_str), res_str},
 			{"contains", array_contains_method, 2, ARGS(arr_any, t_any), t_bool},
@@ -434,6 +458,12 @@ bool initialize_std_lib(VM *vm)
 			{"heap_capacity", gc_heap_capacity_function, 0, ARGS0, t_flt},
 			{"is_on", gc_is_on_function, 0, ARGS0, t_bool},
 			{"stats", gc_stats_function, 0, ARGS0, t_tbl},
+			{"heap_profile_start", gc_heap_profile_start_function, 1, ARGS(t_int), res_nil},
+			{"heap_profile_stop", gc_heap_profile_stop_function, 1, ARGS(t_str), res_nil},
+			{"census", gc_census_function, 0, ARGS0, t_tbl},
+			{"start_event_log", gc_start_event_log_function, 1, ARGS(t_str), res_nil},
+			{"stop_event_log", gc_stop_event_log_function, 0, ARGS0, t_nil},
+			{"set_background_sweep", gc_set_background_sweep_function, 1, ARGS(t_bool), res_nil},
 		};
 		if (!init_module(vm, "gc", fns, ARRAY_COUNT(fns))) {
 			vm->gc_status = prev_status;
@@ -441,6 +471,61 @@ bool initialize_std_lib(VM *vm)
 		}
 	}
 
+	// Profile module
+	{
+		const Callable fns[] = {
+			{"start", profile_start_stats_function, 0, ARGS0, t_nil},
+			{"stop", profile_stop_stats_function, 0, ARGS0, t_nil},
+			{"reset", profile_reset_function, 0, ARGS0, t_nil},
+			{"report", profile_report_function, 0, ARGS0, t_tbl},
+		};
+		if (!init_module(vm, "profile", fns, ARRAY_COUNT(fns))) {
+			vm->gc_status = prev_status;
+			return false;
+		}
+	}
+
+	// Worker module
+	{
+		const Callable fns[] = {
+			{"spawn", worker_spawn_function, 3, ARGS(t_str, t_str, t_any), res_int},
+			{"send", worker_send_function, 2, ARGS(t_int, t_any), res_nil},
+			{"receive", worker_receive_function, 1, ARGS(t_int), res_any},
+			{"join", worker_join_function, 1, ARGS(t_int), res_any},
+			{"send_parent", worker_send_parent_function, 1, ARGS(t_any), res_nil},
+			{"receive_parent", worker_receive_parent_function, 0, ARGS0, res_any},
+		};
+		if (!init_module(vm, "worker", fns, ARRAY_COUNT(fns))) {
+			vm->gc_status = prev_status;
+			return false;
+		}
+	}
+
+	// Parallel module
+	{
+		const Callable fns[] = {
+			{"par_for_range", parallel_for_range_function, 3, ARGS(t_int, t_int, FUNC(ARGS(t_int), 1, t_any)),
+			 RES(arr_any)},
+			{"threads", parallel_threads_function, 0, ARGS0, t_int},
+		};
+		if (!init_module(vm, "parallel", fns, ARRAY_COUNT(fns))) {
+			vm->gc_status = prev_status;
+			return false;
+		}
+	}
+
+	// Serde module
+	{
+		const Callable fns[] = {
+			{"pack", serde_pack_function, 2, ARGS(t_buf, t_any), res_int},
+			{"unpack", serde_unpack_function, 1, ARGS(t_buf), res_any},
+		};
+		if (!init_module(vm, "serde", fns, ARRAY_COUNT(fns))) {
+			vm->gc_status = prev_status;
+			return false;
+		}
+	}
+
 	// Vector methods  +  module constructor
 	{
 		const Callable methods[] = {
@@ -557,6 +642,22 @@ bool initialize_std_lib(VM *vm)
 		}
 	}
 
+	// Iterator methods, shared by builtin iterators, lazy adapters and generators
+	{
+		const Callable methods[] = {
+			{"map", map_iterator_method, 2, ARGS(iter_any, FUNC(ARGS(t_any), 1, t_any)), iter_any},
+			{"filter", filter_iterator_method, 2, ARGS(iter_any, FUNC(ARGS(t_any), 1, t_any)), iter_any},
+			{"take", take_iterator_method, 2, ARGS(iter_any, t_int), iter_any},
+			{"skip", skip_iterator_method, 2, ARGS(iter_any, t_int), iter_any},
+			{"zip", zip_iterator_method, 2, ARGS(iter_any, t_any), iter_any},
+			{"enumerate", enumerate_iterator_method, 1, ARGS(iter_any), iter_any},
+			{"chain", chain_iterator_method, 2, ARGS(iter_any, t_any), iter_any},
+			{"collect", collect_iterator_method, 1, ARGS(iter_any), arr_any},
+			{"sum", sum_iterator_method, 1, ARGS(iter_any), res_any},
+		};
+		init_type_method_table(vm, &vm->iterator_type, methods, ARRAY_COUNT(methods));
+	}
+
 	// Tuple methods  +  module constructor
 	{
 		const Callable methods[] = {
@@ -684,6 +785,10 @@ bool initialize_std_lib(VM *vm)
 			vm->gc_status = prev_status;
 			return false;
 		}
+
+		const char *pure_fns[] = {"pow", "ceil", "floor", "abs", "sin", "cos",
+								  "tan", "atan", "exp", "round", "min", "max"};
+		mark_pure_functions(vm, pure_fns, ARRAY_COUNT(pure_fns));
 	}
 
 	// IO module
@@ -734,6 +839,8 @@ bool initialize_std_lib(VM *vm)
 			{"sleep", sleep_function, 1, ARGS(t_int), t_nil}, {"platform", platform_function, 0, ARGS0, t_str},
 			{"arch", arch_function, 0, ARGS0, t_str},		  {"pid", pid_function, 0, ARGS0, t_int},
 			{"exit", exit_function, 1, ARGS(t_int), t_never},
+			{"profile_start", profile_start_function, 1, ARGS(t_int), res_nil},
+			{"profile_stop", profile_stop_function, 1, ARGS(t_str), res_nil},
 		};
 		if (!init_module(vm, "sys", fns, ARRAY_COUNT(fns))) {
 			vm->gc_status = prev_status;
@@ -765,6 +872,25 @@ bool initialize_std_lib(VM *vm)
 		}
 	}
 
+	// Coroutine module
+	{
+		ObjectTypeRecord *t_coro = REC(COROUTINE_TYPE);
+
+		const Callable fns[] = {
+			{"create", coroutine_create_function, 1, ARGS(t_any), RES(t_coro)},
+			{"resume", coroutine_resume_function, 2, ARGS(t_coro, t_any), res_any},
+			{"suspend", coroutine_suspend_function, 1, ARGS(t_any), t_any},
+			{"is_done", coroutine_is_done_function, 1, ARGS(t_coro), t_bool},
+			{"spawn", coroutine_spawn_function, 1, ARGS(t_any), RES(t_coro)},
+			{"run", coroutine_run_function, 0, ARGS0, res_nil},
+			{"wait_readable", coroutine_wait_readable_function, 1, ARGS(t_file), res_nil},
+		};
+		if (!init_module(vm, "coroutine", fns, ARRAY_COUNT(fns))) {
+			vm->gc_status = prev_status;
+			return false;
+		}
+	}
+
 	{
 		vm->gc_status = prev_status;
 		return true;
@@ -84,10 +84,7 @@ Value string_get_method(VM *vm, const Value *args)
 	uint32_t char_bytes = (uint32_t)utf8codepointcalcsize(start);
 
 	ObjectString *res_str = copy_string(vm, (const char *)start, char_bytes);
-	push(vm->current_module_record, OBJECT_VAL(res_str));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(res_str));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(res_str));
 }
 
 /**
@@ -173,7 +170,7 @@ Value string_strip_method(VM *vm, const Value *args)
 {
 	const ObjectString *string = AS_CRUX_STRING(args[0]);
 	if (string->byte_length == 0)
-		return OBJECT_VAL(new_ok_result(vm, OBJECT_VAL(copy_string(vm, "", 0))));
+		return native_ok(vm, OBJECT_VAL(copy_string(vm, "", 0)));
 
 	const utf8_int8_t *start = string->chars;
 	const utf8_int8_t *end = string->chars + string->byte_length;
@@ -201,10 +198,7 @@ Value string_strip_method(VM *vm, const Value *args)
 	}
 
 	ObjectString *res_str = copy_string(vm, (const char *)start, (uint32_t)(end - start));
-	push(vm->current_module_record, OBJECT_VAL(res_str));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(res_str));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(res_str));
 }
 
 /**
@@ -231,10 +225,7 @@ Value string_substring_method(VM *vm, const Value *args)
 	}
 
 	ObjectString *res_str = copy_string(vm, (const char *)start_ptr, (uint32_t)(end_ptr - start_ptr));
-	push(vm->current_module_record, OBJECT_VAL(res_str));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(res_str));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(res_str));
 }
 
 /**
@@ -251,16 +242,16 @@ Value string_split_method(VM *vm, const Value *args)
 		return MAKE_GC_SAFE_ERROR(vm, "Delimiter cannot be empty.", VALUE);
 
 	ObjectArray *array = new_array(vm, 0);
-	push(vm->current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 
 	const utf8_int8_t *cursor = string->chars;
 	const utf8_int8_t *last_match = cursor;
 
 	while ((cursor = (utf8_int8_t *)utf8str(cursor, delim->chars)) != NULL) {
 		ObjectString *sub = copy_string(vm, (const char *)last_match, (uint32_t)(cursor - last_match));
-		push(vm->current_module_record, OBJECT_VAL(sub));
+		push(vm, OBJECT_VAL(sub));
 		array_add_back(vm, array, OBJECT_VAL(sub));
-		pop(vm->current_module_record);
+		pop(vm);
 
 		cursor += delim->byte_length;
 		last_match = cursor;
@@ -268,13 +259,12 @@ Value string_split_method(VM *vm, const Value *args)
 
 	ObjectString *sub = copy_string(vm, (const char *)last_match,
 									(uint32_t)((string->chars + string->byte_length) - last_match));
-	push(vm->current_module_record, OBJECT_VAL(sub));
+	push(vm, OBJECT_VAL(sub));
 	array_add_back(vm, array, OBJECT_VAL(sub));
-	pop(vm->current_module_record);
+	pop(vm);
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(array));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(array));
 }
 
 /**
@@ -306,10 +296,10 @@ Value string_starts_with_method(VM *vm, const Value *args)
 	const ObjectString *prefix = AS_CRUX_STRING(args[1]);
 
 	if (prefix->byte_length > str->byte_length)
-		return OBJECT_VAL(new_ok_result(vm, BOOL_VAL(false)));
+		return native_ok(vm, BOOL_VAL(false));
 
 	bool match = memcmp(str->chars, prefix->chars, prefix->byte_length) == 0;
-	return OBJECT_VAL(new_ok_result(vm, BOOL_VAL(match)));
+	return native_ok(vm, BOOL_VAL(match));
 }
 
 /**
@@ -323,11 +313,11 @@ Value string_ends_with_method(VM *vm, const Value *args)
 	const ObjectString *suffix = AS_CRUX_STRING(args[1]);
 
 	if (suffix->byte_length > str->byte_length)
-		return OBJECT_VAL(new_ok_result(vm, BOOL_VAL(false)));
+		return native_ok(vm, BOOL_VAL(false));
 
 	const utf8_int8_t *start_pos = str->chars + (str->byte_length - suffix->byte_length);
 	bool match = memcmp(start_pos, suffix->chars, suffix->byte_length) == 0;
-	return OBJECT_VAL(new_ok_result(vm, BOOL_VAL(match)));
+	return native_ok(vm, BOOL_VAL(match));
 }
 
 /**
@@ -389,10 +379,7 @@ Value string_concat_method(VM *vm, const Value *args)
 	buf[total_bytes] = '\0';
 
 	ObjectString *res_str = take_string(vm, buf, total_bytes);
-	push(vm->current_module_record, OBJECT_VAL(res_str));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(res_str));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(res_str));
 }
 
 /**
@@ -422,11 +409,7 @@ Value string_reverse_method(VM *vm, const Value *args)
 	*write_cursor = '\0';
 
 	ObjectString *res_str = take_string(vm, (char *)buf, str->byte_length);
-	push(vm->current_module_record, OBJECT_VAL(res_str));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(res_str));
-	pop(vm->current_module_record);
-
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(res_str));
 }
 
 /**
@@ -488,11 +471,7 @@ Value string_repeat_method(VM *vm, const Value *args)
 	buffer[new_size] = '\0';
 
 	ObjectString *res_str = take_string(vm, buffer, (uint32_t)new_size);
-	push(vm->current_module_record, OBJECT_VAL(res_str));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(res_str));
-	pop(vm->current_module_record);
-
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(res_str));
 }
 
 /**
@@ -746,10 +725,5 @@ Value string_replace_method(VM *vm, const Value *args)
 	*write_ptr = '\0';
 
 	ObjectString *result_string = take_string(vm, new_chars, (uint32_t)new_byte_len);
-
-	push(vm->current_module_record, OBJECT_VAL(result_string));
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_string));
-	pop(vm->current_module_record);
-
-	return OBJECT_VAL(res);
+	return native_ok(vm, OBJECT_VAL(result_string));
 }
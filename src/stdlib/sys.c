@@ -9,6 +9,7 @@
 #endif
 
 #include "panic.h"
+#include "profiler.h"
 #include "stdlib/sys.h"
 #include "vm.h"
 
@@ -20,31 +21,30 @@
 Value args_function(VM *vm, const Value *args)
 {
 	(void)args;
-	ObjectModuleRecord *module_record = vm->current_module_record;
 	ObjectArray *resultArray = new_array(vm, 2);
 	ObjectArray *argvArray = new_array(vm, vm->args.argc);
-	push(module_record, OBJECT_VAL(resultArray));
-	push(module_record, OBJECT_VAL(argvArray));
+	push(vm, OBJECT_VAL(resultArray));
+	push(vm, OBJECT_VAL(argvArray));
 
 	for (int i = 0; i < vm->args.argc; i++) {
 		char *arg = strdup(vm->args.argv[i]);
 		if (arg == NULL) {
 			Value error_result = MAKE_GC_SAFE_ERROR(vm, "Failed to allocate memory for argument.", MEMORY);
-			pop(module_record);
-			pop(module_record);
+			pop(vm);
+			pop(vm);
 			return error_result;
 		}
 		ObjectString *argv_string = take_string(vm, arg, strlen(arg));
-		push(module_record, OBJECT_VAL(argv_string));
+		push(vm, OBJECT_VAL(argv_string));
 		array_add_back(vm, argvArray, OBJECT_VAL(argv_string));
-		pop(module_record);
+		pop(vm);
 	}
 
 	array_add_back(vm, resultArray, INT_VAL(vm->args.argc));
 	array_add_back(vm, resultArray, OBJECT_VAL(argvArray));
 
-	pop(module_record);
-	pop(module_record);
+	pop(vm);
+	pop(vm);
 
 	return OBJECT_VAL(new_ok_result(vm, OBJECT_VAL(resultArray)));
 }
@@ -138,9 +138,9 @@ Value get_env_function(VM *vm, const Value *args)
 	}
 
 	ObjectString *valueString = take_string(vm, newValue, strlen(value));
-	push(vm->current_module_record, OBJECT_VAL(valueString));
+	push(vm, OBJECT_VAL(valueString));
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(valueString));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -176,3 +176,31 @@ Value exit_function(VM *vm, const Value *args)
 	longjmp(vm->jump_buffer, INTERPRET_EXIT);
 	return NIL_VAL;
 }
+
+/**
+ * Starts the sampling profiler
+ * arg0 -> hz: Int (samples per second of CPU time)
+ * Returns Result<Nil>
+ */
+Value profile_start_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	if (!profiler_start(vm, AS_INT(args[0]), &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Stops the sampling profiler and writes <path>.folded and <path>.pprof
+ * arg0 -> path: String
+ * Returns Result<Nil>
+ */
+Value profile_stop_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	if (!profiler_stop(vm, AS_CRUX_STRING(args[0])->chars, &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
@@ -31,7 +31,7 @@ Value table_values_method(VM *vm, const Value *args)
 
 	values->size = lastInsert;
 
-	return OBJECT_VAL(new_ok_result(vm, OBJECT_VAL(values)));
+	return native_ok(vm, OBJECT_VAL(values));
 }
 
 /**
@@ -64,7 +64,7 @@ Value table_keys_method(VM *vm, const Value *args)
 
 	keys->size = lastInsert;
 
-	return OBJECT_VAL(new_ok_result(vm, OBJECT_VAL(keys)));
+	return native_ok(vm, OBJECT_VAL(keys));
 }
 
 /**
@@ -74,18 +74,17 @@ Value table_keys_method(VM *vm, const Value *args)
  */
 Value table_pairs_method(VM *vm, const Value *args)
 {
-	ObjectModuleRecord *module_record = vm->current_module_record;
 	const ObjectTable *table = AS_CRUX_TABLE(args[0]);
 
 	ObjectArray *pairs = new_array(vm, table->size);
-	push(module_record, OBJECT_VAL(pairs));
+	push(vm, OBJECT_VAL(pairs));
 
 	if (pairs == NULL) {
 		const Value res = MAKE_GC_SAFE_ERROR(
 			vm,
 			"Failed to allocate enough memory for <pairs> array.",
 			MEMORY);
-		pop(vm->current_module_record); // pop the array
+		pop(vm); // pop the array
 		return res;
 	}
 
@@ -95,14 +94,14 @@ Value table_pairs_method(VM *vm, const Value *args)
 		const ObjectTableEntry entry = table->entries[i];
 		if (entry.is_occupied) {
 			ObjectArray *pair = new_array(vm, 2);
-			push(module_record, OBJECT_VAL(pair));
+			push(vm, OBJECT_VAL(pair));
 			if (pair == NULL) {
 				Value res = MAKE_GC_SAFE_ERROR(
 					vm,
 					"Failed to allocate enough memory for "
 					"pair array",
 					MEMORY);
-				pop(module_record);
+				pop(vm);
 				return res;
 			}
 
@@ -112,15 +111,14 @@ Value table_pairs_method(VM *vm, const Value *args)
 
 			pairs->values[lastInsert] = OBJECT_VAL(pair);
 			lastInsert++;
-			pop(module_record);
+			pop(vm);
 		}
 	}
 
 	pairs->size = lastInsert;
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(pairs));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(pairs));
 }
 
 /**
@@ -141,7 +139,7 @@ Value table_remove_method(VM *vm, const Value *args)
 				"Failed to remove key: value pair from table.",
 				VALUE);
 		}
-		return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+		return native_ok(vm, NIL_VAL);
 	}
 	return MAKE_GC_SAFE_ERROR(vm, "Unhashable type given as table key.",
 				  TYPE);
@@ -167,7 +165,7 @@ Value table_get_method(VM *vm, const Value *args)
 			return MAKE_GC_SAFE_ERROR(
 				vm, "Failed to get value from table.", VALUE);
 		}
-		return OBJECT_VAL(new_ok_result(vm, value));
+		return native_ok(vm, value);
 	}
 	return MAKE_GC_SAFE_ERROR(vm, "Unhashable type given as table key.",
 				  TYPE);
@@ -7,6 +7,7 @@
 
 #include "garbage_collector.h"
 #include "panic.h"
+#include "stdlib/coroutine.h"
 #include "stdlib/time.h"
 
 /**
@@ -47,7 +48,7 @@ Value time_milliseconds_function_(VM *vm, const Value *args)
 }
 
 /**
- * Pauses execution for the specified number of seconds
+ * Pauses execution for the specified number of seconds. Inside an event loop task only the task is paused.
  * arg0 -> seconds: Float
  * Returns Result<Nil>
  */
@@ -60,6 +61,10 @@ Value sleep_seconds_function(VM *vm, const Value *args)
 					  VALUE);
 	}
 
+	if (coroutine_park_timer(vm, seconds * 1000)) {
+		return NIL_VAL;
+	}
+
 #ifdef _WIN32
 	Sleep((DWORD)(seconds * 1000));
 #else
@@ -69,7 +74,7 @@ Value sleep_seconds_function(VM *vm, const Value *args)
 }
 
 /**
- * Pauses execution for the specified number of milliseconds
+ * Pauses execution for the specified number of milliseconds. Inside an event loop task only the task is paused.
  * arg0 -> milliseconds: Float
  * Returns Result<Nil>
  */
@@ -82,6 +87,10 @@ Value sleep_milliseconds_function(VM *vm, const Value *args)
 					  VALUE);
 	}
 
+	if (coroutine_park_timer(vm, milliseconds)) {
+		return NIL_VAL;
+	}
+
 #ifdef _WIN32
 	Sleep((DWORD)milliseconds);
 #else
@@ -96,6 +105,18 @@ static time_t get_current_time(void)
 	return time(NULL);
 }
 
+/**
+ * localtime() shares one buffer between threads, workers each fill their own
+ */
+static const struct tm *local_time(const time_t *t, struct tm *storage)
+{
+#ifdef _WIN32
+	return localtime_s(storage, t) == 0 ? storage : NULL;
+#else
+	return localtime_r(t, storage);
+#endif
+}
+
 /**
  * Returns the current year
  * Returns Int
@@ -105,7 +126,8 @@ Value year_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_year + 1900);
 }
 
@@ -118,7 +140,8 @@ Value month_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_mon + 1);
 }
 
@@ -131,7 +154,8 @@ Value day_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_mday);
 }
 
@@ -144,7 +168,8 @@ Value hour_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_hour);
 }
 
@@ -157,7 +182,8 @@ Value minute_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_min);
 }
 
@@ -170,7 +196,8 @@ Value second_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_sec);
 }
 
@@ -183,7 +210,8 @@ Value weekday_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	// 1 (Monday) - 7 (Sunday)
 	const int weekday = timeInfo->tm_wday == 0 ? 7 : timeInfo->tm_wday;
 	return INT_VAL(weekday);
@@ -198,6 +226,7 @@ Value day_of_year_function_(VM *vm, const Value *args)
 	(void)args;
 	(void)vm;
 	const time_t t = get_current_time();
-	const struct tm *timeInfo = localtime(&t);
+	struct tm local;
+	const struct tm *timeInfo = local_time(&t, &local);
 	return INT_VAL(timeInfo->tm_yday + 1);
 }
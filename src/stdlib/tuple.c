@@ -155,9 +155,9 @@ Value slice_tuple_method(VM *vm, const Value *args)
 		array->values[i - start] = tuple->elements[i];
 	}
 	array->size = end - start;
-	push(vm->current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 	ObjectResult *result = new_ok_result(vm, OBJECT_VAL(array));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(result);
 }
 
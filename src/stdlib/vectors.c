@@ -157,7 +157,7 @@ Value new_vector_function(VM *vm, const Value *args)
 							       : dimensions;
 
 	ObjectVector *vector = new_vector(vm, dimensions);
-	push(vm->current_module_record, OBJECT_VAL(vector));
+	push(vm, OBJECT_VAL(vector));
 
 	double *components = VECTOR_COMPONENTS(vector);
 	const Value *array_values = array->values;
@@ -170,9 +170,8 @@ Value new_vector_function(VM *vm, const Value *args)
 		components[i] = 0.0;
 	}
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(vector));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(vector));
 }
 
 /**
@@ -197,7 +196,7 @@ Value vector_dot_method(VM *vm, const Value *args)
 	const double result = compute_dot_product(comp1, comp2,
 						  vec1->dimensions);
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(result)));
+	return native_ok(vm, FLOAT_VAL(result));
 }
 
 Value vector_add_value(VM *vm, const ObjectVector *vec1, const ObjectVector *vec2)
@@ -207,7 +206,7 @@ Value vector_add_value(VM *vm, const ObjectVector *vec1, const ObjectVector *vec
 	}
 
 	ObjectVector *result_vector = new_vector(vm, vec1->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *comp1 = VECTOR_COMPONENTS(vec1);
 	const double *comp2 = VECTOR_COMPONENTS(vec2);
@@ -215,7 +214,7 @@ Value vector_add_value(VM *vm, const ObjectVector *vec1, const ObjectVector *vec
 	compute_vector_add(result_comp, comp1, comp2, vec1->dimensions);
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -226,7 +225,7 @@ Value vector_subtract_value(VM *vm, const ObjectVector *vec1, const ObjectVector
 	}
 
 	ObjectVector *result_vector = new_vector(vm, vec1->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *comp1 = VECTOR_COMPONENTS(vec1);
 	const double *comp2 = VECTOR_COMPONENTS(vec2);
@@ -234,21 +233,21 @@ Value vector_subtract_value(VM *vm, const ObjectVector *vec1, const ObjectVector
 	compute_vector_subtract(result_comp, comp1, comp2, vec1->dimensions);
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
 Value vector_scalar_multiply_value(VM *vm, const ObjectVector *vec, const double scalar)
 {
 	ObjectVector *result_vector = new_vector(vm, vec->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *comp = VECTOR_COMPONENTS(vec);
 	double *result_comp = VECTOR_COMPONENTS(result_vector);
 	compute_scalar_multiply(result_comp, comp, scalar, vec->dimensions);
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -259,14 +258,14 @@ Value vector_scalar_divide_value(VM *vm, const ObjectVector *vec, const double s
 	}
 
 	ObjectVector *result_vector = new_vector(vm, vec->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *comp = VECTOR_COMPONENTS(vec);
 	double *result_comp = VECTOR_COMPONENTS(result_vector);
 	compute_scalar_divide(result_comp, comp, scalar, vec->dimensions);
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -277,21 +276,21 @@ Value vector_component_divide_value(VM *vm, const ObjectVector *vec1, const Obje
 	}
 
 	ObjectVector *result_vector = new_vector(vm, vec1->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *comp1 = VECTOR_COMPONENTS(vec1);
 	const double *comp2 = VECTOR_COMPONENTS(vec2);
 	double *result_comp = VECTOR_COMPONENTS(result_vector);
 	for (uint32_t i = 0; i < vec1->dimensions; i++) {
 		if (IS_ZERO_SCALAR(comp2[i])) {
-			pop(vm->current_module_record);
+			pop(vm);
 			return MAKE_GC_SAFE_ERROR(vm, "Cannot divide by zero component.", MATH);
 		}
 		result_comp[i] = comp1[i] / comp2[i];
 	}
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -302,7 +301,7 @@ Value vector_cross_value(VM *vm, const ObjectVector *vec1, const ObjectVector *v
 	}
 
 	ObjectVector *tmp = new_vector(vm, 3);
-	push(vm->current_module_record, OBJECT_VAL(tmp));
+	push(vm, OBJECT_VAL(tmp));
 
 	const double *comp1 = VECTOR_COMPONENTS(vec1);
 	const double *comp2 = VECTOR_COMPONENTS(vec2);
@@ -313,7 +312,7 @@ Value vector_cross_value(VM *vm, const ObjectVector *vec1, const ObjectVector *v
 	result_comp[2] = comp1[0] * comp2[1] - comp1[1] * comp2[0];
 
 	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(tmp));
-	pop(vm->current_module_record);
+	pop(vm);
 	return OBJECT_VAL(res);
 }
 
@@ -398,7 +397,7 @@ Value vector_normalize_method(VM *vm, const Value *args)
 
 	compute_normalize(result_comp, comp, magnitude, vec->dimensions);
 
-	return OBJECT_VAL(new_ok_result(vm, OBJECT_VAL(result_vector)));
+	return native_ok(vm, OBJECT_VAL(result_vector));
 }
 
 /**
@@ -425,7 +424,7 @@ Value vector_distance_method(VM *vm, const Value *args)
 	const double distance = compute_distance(comp1, comp2,
 						 vec1->dimensions);
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(distance)));
+	return native_ok(vm, FLOAT_VAL(distance));
 }
 
 /**
@@ -471,7 +470,7 @@ Value vector_angle_between_method(VM *vm, const Value *args)
 	const double clampedCos = fmax(-1.0, fmin(1.0, cosTheta));
 	const double result = acos(clampedCos);
 
-	return OBJECT_VAL(new_ok_result(vm, FLOAT_VAL(result)));
+	return native_ok(vm, FLOAT_VAL(result));
 }
 
 /**
@@ -494,7 +493,7 @@ Value vector_lerp_method(VM *vm, const Value *args)
 	}
 
 	ObjectVector *result_vector = new_vector(vm, vec1->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *comp1 = VECTOR_COMPONENTS(vec1);
 	const double *comp2 = VECTOR_COMPONENTS(vec2);
@@ -502,9 +501,8 @@ Value vector_lerp_method(VM *vm, const Value *args)
 
 	compute_lerp(result_comp, comp1, comp2, t, vec1->dimensions);
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(result_vector));
 }
 
 /**
@@ -533,7 +531,7 @@ Value vector_reflect_method(VM *vm, const Value *args)
 	}
 
 	ObjectVector *result_vector = new_vector(vm, incident->dimensions);
-	push(vm->current_module_record, OBJECT_VAL(result_vector));
+	push(vm, OBJECT_VAL(result_vector));
 
 	const double *inc_comp = VECTOR_COMPONENTS(incident);
 	const double *norm_comp = VECTOR_COMPONENTS(normal);
@@ -542,9 +540,8 @@ Value vector_reflect_method(VM *vm, const Value *args)
 	compute_reflect(result_comp, inc_comp, norm_comp, normal_mag,
 			incident->dimensions);
 
-	ObjectResult *res = new_ok_result(vm, OBJECT_VAL(result_vector));
-	pop(vm->current_module_record);
-	return OBJECT_VAL(res);
+	pop(vm);
+	return native_ok(vm, OBJECT_VAL(result_vector));
 }
 
 /**
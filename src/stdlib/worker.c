@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "stdlib/worker.h"
+#include "file_handler.h"
+#include "worker.h"
+
+/**
+ * Rebuilds <message> in this VM and frees it.
+ */
+static Value message_result(VM *vm, WorkerMessage *message)
+{
+	Value value;
+	const bool decoded = decode_worker_message(vm, message, &value);
+	free_worker_message(message);
+	if (!decoded) {
+		return make_error_result(vm, "Failed to copy the message into this worker.", RUNTIME);
+	}
+	push(vm, value);
+	ObjectResult *result = new_ok_result(vm, value);
+	pop(vm);
+	return OBJECT_VAL(result);
+}
+
+/**
+ * Runs the script at <path> in a new isolate on its own thread and then calls its global function <function> with a
+ * copy of <argument>. The path is relative to the calling module.
+ * arg0 -> path: String
+ * arg1 -> function: String
+ * arg2 -> argument: Any
+ * Returns Result<Int> with the worker id
+ */
+Value worker_spawn_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	WorkerMessage *argument = encode_worker_message(args[2], &error);
+	if (argument == NULL) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+
+	char *path = resolve_path(vm->current_module_record->path->chars, AS_C_STRING(args[0]));
+	if (path == NULL) {
+		free_worker_message(argument);
+		return make_error_result(vm, "Failed to resolve the worker script path.", RUNTIME);
+	}
+
+	uint32_t id;
+	const bool spawned = spawn_worker(vm, path, AS_C_STRING(args[1]), argument, &id, &error);
+	free(path);
+	if (!spawned) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, INT_VAL((int32_t)id)));
+}
+
+/**
+ * Sends a copy of <message> to the worker, where receive_parent() returns it
+ * arg0 -> worker: Int
+ * arg1 -> message: Any
+ * Returns Result<Nil>
+ */
+Value worker_send_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	WorkerMessage *message = encode_worker_message(args[1], &error);
+	if (message == NULL || !send_to_worker(vm, (uint32_t)AS_INT(args[0]), message, &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Waits for the next message the worker sent with send_parent()
+ * arg0 -> worker: Int
+ * Returns Result<Any>, an error once the worker finished without sending more
+ */
+Value worker_receive_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	WorkerMessage *message = receive_from_worker(vm, (uint32_t)AS_INT(args[0]), &error);
+	if (message == NULL) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return message_result(vm, message);
+}
+
+/**
+ * Waits for the worker to finish. Messages it sent that were not received are discarded
+ * arg0 -> worker: Int
+ * Returns Result<Any> with a copy of the value the worker function returned
+ */
+Value worker_join_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	WorkerMessage *result = NULL;
+	if (!join_worker(vm, (uint32_t)AS_INT(args[0]), &result, &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return message_result(vm, result);
+}
+
+/**
+ * Sends a copy of <message> from inside a worker to its parent, where receive() returns it
+ * arg0 -> message: Any
+ * Returns Result<Nil>
+ */
+Value worker_send_parent_function(VM *vm, const Value *args)
+{
+	const char *error = NULL;
+	WorkerMessage *message = encode_worker_message(args[0], &error);
+	if (message == NULL || !send_to_parent(vm, message, &error)) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return OBJECT_VAL(new_ok_result(vm, NIL_VAL));
+}
+
+/**
+ * Waits inside a worker for the next message its parent sent with send()
+ * Returns Result<Any>
+ */
+Value worker_receive_parent_function(VM *vm, const Value *args)
+{
+	(void)args;
+	const char *error = NULL;
+	WorkerMessage *message = receive_from_parent(vm, &error);
+	if (message == NULL) {
+		return make_error_result(vm, error, RUNTIME);
+	}
+	return message_result(vm, message);
+}
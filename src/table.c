@@ -171,7 +171,7 @@ void table_remove_white(const VM *vm, const Table *table)
 		if (entry->key == NULL)
 			continue;
 
-		if (!object_is_marked(&entry->key->object)) {
+		if (!object_is_marked(&entry->key->object) && !object_is_immortal(&entry->key->object)) {
 			table_delete(table, entry->key);
 		}
 	}
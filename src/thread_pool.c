@@ -0,0 +1,237 @@
+#include "thread_pool.h"
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+static uint32_t configured_thread_count(void)
+{
+	const char *env = getenv("CRUX_THREADS");
+	long count = env != NULL ? strtol(env, NULL, 10) : 0;
+#ifndef _WIN32
+	if (count <= 0) {
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+#endif
+	if (count <= 0) {
+		count = 1;
+	}
+	return count > THREAD_POOL_MAX_THREADS ? THREAD_POOL_MAX_THREADS : (uint32_t)count;
+}
+
+#ifdef _WIN32
+
+uint32_t thread_pool_size(VM *vm)
+{
+	(void)vm;
+	return 1;
+}
+
+void run_parallel(VM *vm, const uint32_t task_count, const ParallelTask task, void *context)
+{
+	(void)vm;
+	for (uint32_t i = 0; i < task_count; i++) {
+		task(context, i, 0);
+	}
+}
+
+void free_thread_pool(VM *vm)
+{
+	(void)vm;
+}
+
+#else
+
+/**
+ * The task indices a thread has not started yet. The owner takes from the front, thieves from the back.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	uint32_t next;
+	uint32_t end;
+} TaskRange;
+
+typedef struct {
+	struct ThreadPool *pool;
+	uint32_t index;
+} PoolThread;
+
+struct ThreadPool {
+	uint32_t thread_count; // including the thread that calls run_parallel()
+	pthread_t threads[THREAD_POOL_MAX_THREADS];
+	PoolThread thread_args[THREAD_POOL_MAX_THREADS];
+	TaskRange ranges[THREAD_POOL_MAX_THREADS];
+
+	pthread_mutex_t lock;
+	pthread_cond_t job_ready;
+	pthread_cond_t job_done;
+	uint64_t generation; // incremented for every job, so sleeping threads notice a new one
+	uint32_t busy_threads; // pool threads that have not finished the current job
+	bool shutting_down;
+
+	ParallelTask task;
+	void *context;
+};
+
+static bool take_own_task(TaskRange *range, uint32_t *task_out)
+{
+	pthread_mutex_lock(&range->lock);
+	const bool taken = range->next < range->end;
+	if (taken) {
+		*task_out = range->next++;
+	}
+	pthread_mutex_unlock(&range->lock);
+	return taken;
+}
+
+static bool steal_task(TaskRange *range, uint32_t *task_out)
+{
+	pthread_mutex_lock(&range->lock);
+	const bool taken = range->next < range->end;
+	if (taken) {
+		*task_out = --range->end;
+	}
+	pthread_mutex_unlock(&range->lock);
+	return taken;
+}
+
+static void run_tasks(ThreadPool *pool, const uint32_t thread_index)
+{
+	uint32_t task_index;
+	while (take_own_task(&pool->ranges[thread_index], &task_index)) {
+		pool->task(pool->context, task_index, thread_index);
+	}
+	for (uint32_t offset = 1; offset < pool->thread_count; offset++) {
+		TaskRange *victim = &pool->ranges[(thread_index + offset) % pool->thread_count];
+		while (steal_task(victim, &task_index)) {
+			pool->task(pool->context, task_index, thread_index);
+		}
+	}
+}
+
+static void *pool_thread_main(void *arg)
+{
+	const PoolThread *thread = arg;
+	ThreadPool *pool = thread->pool;
+	uint64_t seen_generation = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->generation == seen_generation && !pool->shutting_down) {
+			pthread_cond_wait(&pool->job_ready, &pool->lock);
+		}
+		if (pool->shutting_down) {
+			break;
+		}
+		seen_generation = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		run_tasks(pool, thread->index);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->busy_threads == 0) {
+			pthread_cond_signal(&pool->job_done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+static void destroy_pool(ThreadPool *pool, const uint32_t started_threads)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->shutting_down = true;
+	pthread_cond_broadcast(&pool->job_ready);
+	pthread_mutex_unlock(&pool->lock);
+	for (uint32_t i = 1; i < started_threads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	for (uint32_t i = 0; i < THREAD_POOL_MAX_THREADS; i++) {
+		pthread_mutex_destroy(&pool->ranges[i].lock);
+	}
+	pthread_cond_destroy(&pool->job_done);
+	pthread_cond_destroy(&pool->job_ready);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+static ThreadPool *new_pool(const uint32_t thread_count)
+{
+	ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->thread_count = thread_count;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->job_ready, NULL);
+	pthread_cond_init(&pool->job_done, NULL);
+	for (uint32_t i = 0; i < THREAD_POOL_MAX_THREADS; i++) {
+		pthread_mutex_init(&pool->ranges[i].lock, NULL);
+	}
+
+	// thread 0 is whichever thread calls run_parallel()
+	for (uint32_t i = 1; i < thread_count; i++) {
+		pool->thread_args[i] = (PoolThread){.pool = pool, .index = i};
+		if (pthread_create(&pool->threads[i], NULL, pool_thread_main, &pool->thread_args[i]) != 0) {
+			destroy_pool(pool, i);
+			return NULL;
+		}
+	}
+	return pool;
+}
+
+uint32_t thread_pool_size(VM *vm)
+{
+	if (vm->thread_pool == NULL) {
+		vm->thread_pool = new_pool(configured_thread_count());
+	}
+	return vm->thread_pool != NULL ? vm->thread_pool->thread_count : 1;
+}
+
+void run_parallel(VM *vm, const uint32_t task_count, const ParallelTask task, void *context)
+{
+	if (task_count == 0) {
+		return;
+	}
+	const uint32_t thread_count = thread_pool_size(vm);
+	ThreadPool *pool = vm->thread_pool;
+	if (pool == NULL || thread_count == 1 || task_count == 1) {
+		for (uint32_t i = 0; i < task_count; i++) {
+			task(context, i, 0);
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < thread_count; i++) {
+		pool->ranges[i].next = (uint32_t)((uint64_t)task_count * i / thread_count);
+		pool->ranges[i].end = (uint32_t)((uint64_t)task_count * (i + 1) / thread_count);
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->context = context;
+	pool->busy_threads = thread_count - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->job_ready);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_tasks(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->busy_threads > 0) {
+		pthread_cond_wait(&pool->job_done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void free_thread_pool(VM *vm)
+{
+	if (vm->thread_pool != NULL) {
+		destroy_pool(vm->thread_pool, vm->thread_pool->thread_count);
+		vm->thread_pool = NULL;
+	}
+}
+
+#endif
@@ -235,6 +235,8 @@ bool runtime_types_compatible(const TypeMask expected, const Value actual)
 	if (expected == ANY_TYPE || expected == UNION_TYPE) // TODO: escape hatch for union types. fix later
 		return true;
 	const TypeMask actual_mask = get_type_mask(actual);
+	if ((expected & ITERATOR_TYPE) && actual_mask == COROUTINE_TYPE) // generators are typed as iterators
+		return true;
 	return (expected & actual_mask) != 0;
 }
 
@@ -244,18 +246,18 @@ bool runtime_types_compatible(const TypeMask expected, const Value actual)
  */
 ObjectTypeRecord *new_array_type_rec(VM *vm, ObjectTypeRecord *element_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(element_type));
+	push(vm, OBJECT_VAL(element_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, ARRAY_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	rec->as.array_type.element_type = element_type;
 	return rec;
 }
 
 ObjectTypeRecord *new_iterator_type_rec(VM *vm, ObjectTypeRecord *element_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(element_type));
+	push(vm, OBJECT_VAL(element_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, ITERATOR_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	rec->as.iterator_type.element_type = element_type;
 	return rec;
 }
@@ -266,11 +268,11 @@ ObjectTypeRecord *new_iterator_type_rec(VM *vm, ObjectTypeRecord *element_type)
  */
 ObjectTypeRecord *new_table_type_rec(VM *vm, ObjectTypeRecord *key_type, ObjectTypeRecord *value_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(key_type));
-	push(vm->current_module_record, OBJECT_VAL(value_type));
+	push(vm, OBJECT_VAL(key_type));
+	push(vm, OBJECT_VAL(value_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, TABLE_TYPE);
-	pop(vm->current_module_record);
-	pop(vm->current_module_record);
+	pop(vm);
+	pop(vm);
 	rec->as.table_type.key_type = key_type;
 	rec->as.table_type.value_type = value_type;
 	return rec;
@@ -282,18 +284,18 @@ ObjectTypeRecord *new_table_type_rec(VM *vm, ObjectTypeRecord *key_type, ObjectT
  */
 ObjectTypeRecord *new_result_type_rec(VM *vm, ObjectTypeRecord *ok_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(ok_type));
+	push(vm, OBJECT_VAL(ok_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, RESULT_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	rec->as.result_type.ok_type = ok_type;
 	return rec;
 }
 
 ObjectTypeRecord *new_option_type_rec(VM *vm, ObjectTypeRecord *some_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(some_type));
+	push(vm, OBJECT_VAL(some_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, OPTION_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	rec->as.option_type.some_type = some_type;
 	return rec;
 }
@@ -305,11 +307,11 @@ ObjectTypeRecord *new_option_type_rec(VM *vm, ObjectTypeRecord *some_type)
 ObjectTypeRecord *new_struct_type_rec(VM *vm, ObjectStruct *definition, ObjectTypeTable *field_types,
 									  const int field_count)
 {
-	push(vm->current_module_record, OBJECT_VAL(definition));
-	push(vm->current_module_record, OBJECT_VAL(field_types));
+	push(vm, OBJECT_VAL(definition));
+	push(vm, OBJECT_VAL(field_types));
 	ObjectTypeRecord *rec = new_type_rec(vm, STRUCT_TYPE);
-	pop(vm->current_module_record);
-	pop(vm->current_module_record);
+	pop(vm);
+	pop(vm);
 	rec->as.struct_type.definition = definition;
 	rec->as.struct_type.field_types = field_types;
 	rec->as.struct_type.field_count = field_count;
@@ -333,13 +335,13 @@ ObjectTypeRecord *new_vector_type_rec(VM *vm, const int dimensions)
 ObjectTypeRecord *new_tuple_type_rec(VM *vm, ObjectTypeRecord **element_types, const int element_count)
 {
 	for (int i = 0; i < element_count; i++) {
-		push(vm->current_module_record, OBJECT_VAL(element_types[i]));
+		push(vm, OBJECT_VAL(element_types[i]));
 	}
 	ObjectTypeRecord *rec = new_type_rec(vm, TUPLE_TYPE);
 	rec->as.tuple_type.element_types = element_types;
 	rec->as.tuple_type.element_count = element_count;
 	for (int i = 0; i < element_count; i++) {
-		pop(vm->current_module_record);
+		pop(vm);
 	}
 	return rec;
 }
@@ -363,13 +365,13 @@ ObjectTypeRecord *new_function_type_rec(VM *vm, ObjectTypeRecord **arg_types, co
 										ObjectTypeRecord *return_type)
 {
 	for (int i = 0; i < arg_count; i++) {
-		push(vm->current_module_record, OBJECT_VAL(arg_types[i]));
+		push(vm, OBJECT_VAL(arg_types[i]));
 	}
-	push(vm->current_module_record, OBJECT_VAL(return_type));
+	push(vm, OBJECT_VAL(return_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, FUNCTION_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	for (int i = 0; i < arg_count; i++) {
-		pop(vm->current_module_record);
+		pop(vm);
 	}
 	rec->as.function_type.arg_types = arg_types;
 	rec->as.function_type.arg_count = arg_count;
@@ -383,9 +385,9 @@ ObjectTypeRecord *new_function_type_rec(VM *vm, ObjectTypeRecord **arg_types, co
  */
 ObjectTypeRecord *new_set_type_rec(VM *vm, ObjectTypeRecord *element_type)
 {
-	push(vm->current_module_record, OBJECT_VAL(element_type));
+	push(vm, OBJECT_VAL(element_type));
 	ObjectTypeRecord *rec = new_type_rec(vm, SET_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	rec->as.set_type.element_type = element_type;
 	return rec;
 }
@@ -396,9 +398,9 @@ ObjectTypeRecord *new_set_type_rec(VM *vm, ObjectTypeRecord *element_type)
  */
 ObjectTypeRecord *new_shape_type_rec(VM *vm, ObjectTypeTable *element_types, const int element_count)
 {
-	push(vm->current_module_record, OBJECT_VAL(element_types));
+	push(vm, OBJECT_VAL(element_types));
 	ObjectTypeRecord *rec = new_type_rec(vm, SHAPE_TYPE);
-	pop(vm->current_module_record);
+	pop(vm);
 	rec->as.shape_type.element_types = element_types;
 	rec->as.shape_type.element_count = element_count;
 	return rec;
@@ -413,12 +415,12 @@ ObjectTypeRecord *new_union_type_rec(VM *vm, ObjectTypeRecord **element_types, O
 {
 	if (element_names != NULL) {
 		for (int i = 0; i < element_count; i++) {
-			push(vm->current_module_record, OBJECT_VAL(element_names[i]));
+			push(vm, OBJECT_VAL(element_names[i]));
 		}
 	}
 	if (element_types != NULL) {
 		for (int i = 0; i < element_count; i++) {
-			push(vm->current_module_record, OBJECT_VAL(element_types[i]));
+			push(vm, OBJECT_VAL(element_types[i]));
 		}
 	}
 
@@ -426,12 +428,12 @@ ObjectTypeRecord *new_union_type_rec(VM *vm, ObjectTypeRecord **element_types, O
 
 	if (element_types != NULL) {
 		for (int i = 0; i < element_count; i++) {
-			pop(vm->current_module_record);
+			pop(vm);
 		}
 	}
 	if (element_names != NULL) {
 		for (int i = 0; i < element_count; i++) {
-			pop(vm->current_module_record);
+			pop(vm);
 		}
 	}
 
@@ -895,59 +897,59 @@ ObjectTypeRecord *type_from_string(VM *vm, const ObjectTypeTable *type_table, co
 
 	if (strncmp(str, "Array", 5) == 0) {
 		ObjectTypeRecord *any_type = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_type));
+		push(vm, OBJECT_VAL(any_type));
 		ObjectTypeRecord *res = new_array_type_rec(vm, any_type);
-		pop(vm->current_module_record);
+		pop(vm);
 		return res;
 	}
 
 	if (strncmp(str, "Iterator", 8) == 0) {
 		ObjectTypeRecord *any_type = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_type));
+		push(vm, OBJECT_VAL(any_type));
 		ObjectTypeRecord *res = new_iterator_type_rec(vm, any_type);
-		pop(vm->current_module_record);
+		pop(vm);
 		return res;
 	}
 
 	if (strncmp(str, "Table", 5) == 0) {
 		ObjectTypeRecord *any_k = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_k));
+		push(vm, OBJECT_VAL(any_k));
 		ObjectTypeRecord *any_v = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_v));
+		push(vm, OBJECT_VAL(any_v));
 		ObjectTypeRecord *res = new_table_type_rec(vm, any_k, any_v);
-		pop(vm->current_module_record);
-		pop(vm->current_module_record);
+		pop(vm);
+		pop(vm);
 		return res;
 	}
 	if (strncmp(str, "Result", 6) == 0) {
 		ObjectTypeRecord *any_type = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_type));
+		push(vm, OBJECT_VAL(any_type));
 		ObjectTypeRecord *res = new_result_type_rec(vm, any_type);
-		pop(vm->current_module_record);
+		pop(vm);
 		return res;
 	}
 	if (strncmp(str, "Option", 6) == 0) {
 		ObjectTypeRecord *any_type = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_type));
+		push(vm, OBJECT_VAL(any_type));
 		ObjectTypeRecord *res = new_option_type_rec(vm, any_type);
-		pop(vm->current_module_record);
+		pop(vm);
 		return res;
 	}
 
 	if (strncmp(str, "Function", 8) == 0) {
 		ObjectTypeRecord *any_type = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_type));
+		push(vm, OBJECT_VAL(any_type));
 		ObjectTypeRecord *res = new_function_type_rec(vm, NULL, 0, any_type);
-		pop(vm->current_module_record);
+		pop(vm);
 		return res;
 	}
 	if (strncmp(str, "Tuple", 5) == 0)
 		return new_tuple_type_rec(vm, NULL, -1);
 	if (strncmp(str, "Set", 3) == 0) {
 		ObjectTypeRecord *any_type = new_type_rec(vm, ANY_TYPE);
-		push(vm->current_module_record, OBJECT_VAL(any_type));
+		push(vm, OBJECT_VAL(any_type));
 		ObjectTypeRecord *res = new_set_type_rec(vm, any_type);
-		pop(vm->current_module_record);
+		pop(vm);
 		return res;
 	}
 	if (strncmp(str, "Vector", 6) == 0)
@@ -958,13 +960,13 @@ ObjectTypeRecord *type_from_string(VM *vm, const ObjectTypeTable *type_table, co
 	if (strncmp(str, "Struct ", 7) == 0) {
 		if (type_table) {
 			ObjectString *name = copy_string(vm, str + 7, strlen(str + 7));
-			push(vm->current_module_record, OBJECT_VAL(name));
+			push(vm, OBJECT_VAL(name));
 			ObjectTypeRecord *rec = NULL;
 			if (type_table_get(type_table, name, &rec)) {
-				pop(vm->current_module_record);
+				pop(vm);
 				return rec;
 			}
-			pop(vm->current_module_record);
+			pop(vm);
 		}
 		return new_type_rec(vm, STRUCT_TYPE);
 	}
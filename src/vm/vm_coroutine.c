@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include "object.h"
+#include "panic.h"
+#include "vm.h"
+
+/**
+ * Exchanges the execution context held by the VM with the one held by the coroutine.
+ * Calling it twice restores both sides, which is how resume and suspend hand control back and forth.
+ */
+static void swap_coroutine_context(VM *vm, ObjectCoroutine *coroutine)
+{
+#define SWAP_FIELD(type, field)                                                                                        \
+	do {                                                                                                               \
+		type tmp = vm->field;                                                                                          \
+		vm->field = coroutine->field;                                                                                  \
+		coroutine->field = tmp;                                                                                        \
+	} while (0)
+
+	SWAP_FIELD(Value *, stack);
+	SWAP_FIELD(Value *, stack_top);
+	SWAP_FIELD(Value *, stack_limit);
+	SWAP_FIELD(CallFrame *, frames);
+	SWAP_FIELD(ObjectUpvalue *, open_upvalues);
+	SWAP_FIELD(uint32_t, frame_count);
+	SWAP_FIELD(uint32_t, frame_capacity);
+
+#undef SWAP_FIELD
+}
+
+InterpretResult resume_coroutine(VM *vm, ObjectCoroutine *coroutine, const Value send)
+{
+	ObjectCoroutine *previous = vm->current_coroutine;
+	const uint32_t previous_depth = vm->reentry_depth;
+
+	swap_coroutine_context(vm, coroutine);
+	coroutine->resumer = previous;
+	vm->current_coroutine = coroutine;
+	vm->reentry_depth = 0;
+
+	jmp_buf previous_jump_buffer;
+	memcpy(previous_jump_buffer, vm->jump_buffer, sizeof(jmp_buf));
+
+	const int jump_code = setjmp(vm->jump_buffer);
+	if (jump_code != INTERPRET_OK) {
+		// The coroutine panicked: give the resumer its context back and keep unwinding
+		coroutine->state = COROUTINE_ERROR;
+		swap_coroutine_context(vm, coroutine);
+		coroutine->resumer = NULL;
+		vm->current_coroutine = previous;
+		vm->reentry_depth = previous_depth;
+		vm->yield_requested = false;
+		memcpy(vm->jump_buffer, previous_jump_buffer, sizeof(jmp_buf));
+		longjmp(vm->jump_buffer, jump_code);
+	}
+
+	if (coroutine->state == COROUTINE_CREATED) {
+		// generators arrive with their first frame already set up by call_generator
+		if (vm->frame_count == 0) {
+			ObjectClosure *closure = coroutine->closure;
+			push(vm, OBJECT_VAL(closure));
+			if (closure->function->arity == 1) {
+				push(vm, send);
+			}
+			call(vm, closure, closure->function->arity);
+		}
+	} else {
+		// replace the placeholder result of the suspending native call
+		vm->stack_top[-1] = send;
+	}
+
+	coroutine->state = COROUTINE_RUNNING;
+	const InterpretResult result = run(vm, false);
+	coroutine->state = result == INTERPRET_YIELD ? COROUTINE_SUSPENDED : COROUTINE_DONE;
+
+	swap_coroutine_context(vm, coroutine);
+	coroutine->resumer = NULL;
+	vm->current_coroutine = previous;
+	vm->reentry_depth = previous_depth;
+	memcpy(vm->jump_buffer, previous_jump_buffer, sizeof(jmp_buf));
+
+	return result == INTERPRET_YIELD ? INTERPRET_OK : result;
+}
+
+bool request_coroutine_yield(VM *vm, const Value value)
+{
+	ObjectCoroutine *coroutine = vm->current_coroutine;
+	if (coroutine == NULL || vm->reentry_depth != 0) {
+		return false;
+	}
+	coroutine->transfer = value;
+	vm->yield_requested = true;
+	return true;
+}
+
+bool call_generator(VM *vm, ObjectClosure *closure, const int arg_count)
+{
+	if (arg_count != closure->function->arity) {
+		runtime_panic(vm, ARGUMENT_MISMATCH, "Expected %d arguments, got %d", closure->function->arity,
+					  arg_count);
+		return false;
+	}
+
+	ThreadedWord *code = threaded_code(&closure->function->chunk);
+	if (code == NULL) {
+		runtime_panic(vm, MEMORY, "Failed to allocate memory for function code.");
+		return false;
+	}
+
+	// the closure and arguments stay on the caller's stack until they have been copied
+	ObjectCoroutine *coroutine = new_coroutine(vm, closure);
+	Value *callee_slot = vm->stack_top - arg_count - 1;
+	memcpy(coroutine->stack, callee_slot, sizeof(Value) * (size_t)(arg_count + 1));
+	coroutine->stack_top = coroutine->stack + arg_count + 1;
+
+	CallFrame *frame = &coroutine->frames[coroutine->frame_count++];
+	frame->closure = closure;
+	frame->ip = code;
+	frame->slots = coroutine->stack;
+	frame->stats_start_ns = 0;
+
+	vm->stack_top = callee_slot;
+	push(vm, OBJECT_VAL(coroutine));
+	return true;
+}
+
+bool next_coroutine_value(VM *vm, ObjectCoroutine *coroutine, Value *value_out)
+{
+	switch (coroutine->state) {
+	case COROUTINE_DONE:
+	case COROUTINE_ERROR:
+		return false;
+	case COROUTINE_RUNNING:
+		runtime_panic(vm, RUNTIME, "Cannot iterate a coroutine from inside itself.");
+		return false;
+	default:
+		break;
+	}
+	if (coroutine->is_scheduled) {
+		runtime_panic(vm, RUNTIME, "Cannot iterate a task owned by the event loop.");
+		return false;
+	}
+
+	resume_coroutine(vm, coroutine, NIL_VAL);
+	*value_out = coroutine->transfer;
+	coroutine->transfer = NIL_VAL;
+	return coroutine->state != COROUTINE_DONE;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "function_stats.h"
+#include "garbage_collector.h"
+#include "object.h"
+
+#define FUNCTION_STATS_REPORT_ROWS 25
+
+static uint64_t function_stats_now_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (counter.QuadPart * 1000000000LL) / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void init_function_stats(FunctionStats *stats)
+{
+	stats->entries = NULL;
+	stats->count = 0;
+	stats->capacity = 0;
+	stats->enabled = false;
+	stats->report_on_exit = false;
+}
+
+void free_function_stats(FunctionStats *stats)
+{
+	free(stats->entries);
+	init_function_stats(stats);
+}
+
+void set_function_stats_enabled(VM *vm, const bool enabled)
+{
+	vm->function_stats.enabled = enabled;
+}
+
+void reset_function_stats(VM *vm)
+{
+	FunctionStats *stats = &vm->function_stats;
+	for (uint32_t i = 0; i < stats->count; i++) {
+		stats->entries[i].function->stats_slot = 0;
+	}
+	stats->count = 0;
+}
+
+FunctionStatsEntry *function_stats_entry(VM *vm, ObjectFunction *function)
+{
+	FunctionStats *stats = &vm->function_stats;
+	if (function->stats_slot != 0) {
+		return &stats->entries[function->stats_slot - 1];
+	}
+
+	if (stats->count == stats->capacity) {
+		const uint32_t new_capacity = stats->capacity < 64 ? 64 : stats->capacity * 2;
+		FunctionStatsEntry *entries = realloc(stats->entries, sizeof(FunctionStatsEntry) * new_capacity);
+		if (entries == NULL) {
+			return NULL;
+		}
+		stats->entries = entries;
+		stats->capacity = new_capacity;
+	}
+	stats->entries[stats->count++] = (FunctionStatsEntry){.function = function};
+	function->stats_slot = stats->count;
+	return &stats->entries[stats->count - 1];
+}
+
+void enter_function_stats(VM *vm, CallFrame *frame)
+{
+	FunctionStatsEntry *entry = function_stats_entry(vm, frame->closure->function);
+	if (entry == NULL) {
+		return;
+	}
+	entry->calls++;
+	entry->active_frames++;
+	frame->stats_child_ns = 0;
+	frame->stats_start_ns = function_stats_now_ns();
+}
+
+void exit_function_stats(VM *vm)
+{
+	CallFrame *frame = &vm->frames[vm->frame_count - 1];
+	if (frame->stats_start_ns == 0) {
+		return;
+	}
+	FunctionStatsEntry *entry = function_stats_entry(vm, frame->closure->function);
+	if (entry == NULL) {
+		return;
+	}
+
+	const uint64_t elapsed_ns = function_stats_now_ns() - frame->stats_start_ns;
+	if (entry->active_frames > 0 && --entry->active_frames == 0) {
+		entry->inclusive_ns += elapsed_ns;
+	}
+	entry->exclusive_ns += elapsed_ns > frame->stats_child_ns ? elapsed_ns - frame->stats_child_ns : 0;
+	frame->stats_start_ns = 0;
+
+	if (vm->frame_count > 1) {
+		frame[-1].stats_child_ns += elapsed_ns;
+	}
+}
+
+void record_function_allocation(VM *vm, const size_t size)
+{
+	if (vm->frame_count == 0) {
+		return;
+	}
+	const CallFrame *frame = &vm->frames[vm->frame_count - 1];
+	if (frame->stats_start_ns == 0) {
+		return;
+	}
+	FunctionStatsEntry *entry = function_stats_entry(vm, frame->closure->function);
+	if (entry != NULL) {
+		entry->alloc_bytes += size;
+	}
+}
+
+void mark_function_stats_roots(VM *vm)
+{
+	const FunctionStats *stats = &vm->function_stats;
+	for (uint32_t i = 0; i < stats->count; i++) {
+		mark_object(vm, (CruxObject *)stats->entries[i].function);
+	}
+}
+
+static int compare_exclusive_time(const void *a, const void *b)
+{
+	const uint64_t left = (*(const FunctionStatsEntry *const *)a)->exclusive_ns;
+	const uint64_t right = (*(const FunctionStatsEntry *const *)b)->exclusive_ns;
+	return left < right ? 1 : left > right ? -1 : 0;
+}
+
+void print_function_stats_report(VM *vm)
+{
+	const FunctionStats *stats = &vm->function_stats;
+	if (stats->count == 0) {
+		return;
+	}
+
+	const FunctionStatsEntry **sorted = malloc(sizeof(FunctionStatsEntry *) * stats->count);
+	if (sorted == NULL) {
+		return;
+	}
+	for (uint32_t i = 0; i < stats->count; i++) {
+		sorted[i] = &stats->entries[i];
+	}
+	qsort(sorted, stats->count, sizeof(FunctionStatsEntry *), compare_exclusive_time);
+
+	fprintf(stderr, "\n%12s %14s %14s %14s  %s\n", "calls", "exclusive ms", "inclusive ms", "alloc bytes", "function");
+	const uint32_t rows = stats->count < FUNCTION_STATS_REPORT_ROWS ? stats->count : FUNCTION_STATS_REPORT_ROWS;
+	for (uint32_t i = 0; i < rows; i++) {
+		const FunctionStatsEntry *entry = sorted[i];
+		const ObjectFunction *function = entry->function;
+		const char *name = function->name != NULL && function->name->byte_length > 0 ? function->name->chars
+																					   : "<script>";
+		const char *path = function->module_record != NULL && function->module_record->path != NULL
+							   ? function->module_record->path->chars
+							   : "<unknown>";
+		fprintf(stderr, "%12llu %14.3f %14.3f %14llu  %s (%s)\n", (unsigned long long)entry->calls,
+				(double)entry->exclusive_ns / 1e6, (double)entry->inclusive_ns / 1e6,
+				(unsigned long long)entry->alloc_bytes, name, path);
+	}
+	if (stats->count > rows) {
+		fprintf(stderr, "%12s ... %u more functions\n", "", stats->count - rows);
+	}
+	free(sorted);
+}
@@ -6,15 +6,25 @@
 
 #include "common.h"
 #include "compiler.h"
+#include "function_stats.h"
 #include "garbage_collector.h"
+#include "module_preload.h"
 #include "object.h"
+#include "opcode_stats.h"
 #include "panic.h"
+#include "gc_events.h"
+#include "heap_profiler.h"
+#include "profiler.h"
 #include "slab_allocator.h"
+#include "stdlib/coroutine.h"
+#include "stdlib/iterator.h"
 #include "stdlib/stdlib.h"
 #include "table.h"
+#include "thread_pool.h"
 #include "type_system.h"
 #include "value.h"
 #include "vm.h"
+#include "worker.h"
 
 void init_import_stack(VM *vm)
 {
@@ -131,30 +141,183 @@ VM *new_vm(const int argc, const char **argv)
 	return init_vm(vm, argc, argv) ? vm : NULL;
 }
 
-void reset_stack(ObjectModuleRecord *moduleRecord)
+void reset_stack(VM *vm)
 {
-	moduleRecord->stack_top = moduleRecord->stack;
-	moduleRecord->frame_count = 0;
-	moduleRecord->open_upvalues = NULL;
+	vm->stack_top = vm->stack;
+	vm->frame_count = 0;
+	vm->open_upvalues = NULL;
 }
 
-bool call(ObjectModuleRecord *module_record, ObjectClosure *closure, const int arg_count)
+/**
+ * Moves the running stack of <vm> to a block with room for <needed> more Values above its top. The slots of its frames
+ * and the locations of its open upvalues are moved along; suspended coroutines have their own stacks.
+ */
+static bool grow_stack(VM *vm, const size_t needed)
+{
+	const size_t used = (size_t)(vm->stack_top - vm->stack);
+	const size_t old_capacity = (size_t)(vm->stack_limit - vm->stack);
+	size_t capacity = old_capacity * 2;
+	if (capacity < used + needed) {
+		capacity = used + needed;
+	}
+
+	// a new block rather than realloc(), so the old stack is still intact if the allocation fails
+	Value *stack = ALLOCATE(vm, Value, capacity);
+	if (stack == NULL) {
+		return false;
+	}
+	Value *old_stack = vm->stack;
+	memcpy(stack, old_stack, sizeof(Value) * used);
+	for (uint32_t i = 0; i < vm->frame_count; i++) {
+		CallFrame *frame = &vm->frames[i];
+		frame->slots = stack + (frame->slots - old_stack);
+	}
+	for (ObjectUpvalue *upvalue = vm->open_upvalues; upvalue != NULL; upvalue = upvalue->next) {
+		upvalue->location = stack + (upvalue->location - old_stack);
+	}
+	vm->stack = stack;
+	vm->stack_top = stack + used;
+	vm->stack_limit = stack + capacity;
+	FREE_ARRAY(vm, Value, old_stack, old_capacity);
+	return true;
+}
+
+bool reserve_frame_stack(VM *vm, const ObjectFunction *function)
+{
+	// each instruction pushes at most one Value, so the chunk's length bounds what the frame itself pushes
+	const size_t needed = (size_t)function->chunk.count + STACK_RESERVE;
+	if (__builtin_expect((size_t)(vm->stack_limit - vm->stack_top) >= needed, 1)) {
+		return true;
+	}
+	return grow_stack(vm, needed);
+}
+
+/**
+ * Doubles the frame array of <vm>, up to its call depth limit.
+ */
+static bool grow_frames(VM *vm)
+{
+	const uint32_t old_capacity = vm->frame_capacity;
+	const uint32_t capacity = old_capacity > vm->max_frames / 2 ? vm->max_frames : old_capacity * 2;
+
+	CallFrame *frames = ALLOCATE(vm, CallFrame, capacity);
+	if (frames == NULL) {
+		return false;
+	}
+	memcpy(frames, vm->frames, sizeof(CallFrame) * vm->frame_count);
+	FREE_ARRAY(vm, CallFrame, vm->frames, old_capacity);
+	vm->frames = frames;
+	vm->frame_capacity = capacity;
+	return true;
+}
+
+bool call(VM *vm, ObjectClosure *closure, const int arg_count)
 {
 	if (arg_count != closure->function->arity) {
-		runtime_panic(module_record, ARGUMENT_MISMATCH, "Expected %d arguments, got %d", closure->function->arity,
-					  arg_count);
+		runtime_panic(vm, ARGUMENT_MISMATCH, "Expected %d arguments, got %d", closure->function->arity, arg_count);
 		return false;
 	}
 
-	if (module_record->frame_count >= FRAMES_MAX) {
-		runtime_panic(module_record, STACK_OVERFLOW, "Stack overflow");
+	if (vm->frame_count >= vm->max_frames) {
+		runtime_panic(vm, STACK_OVERFLOW, "Stack overflow");
 		return false;
 	}
+	if (vm->frame_count >= vm->frame_capacity) {
+		if (!grow_frames(vm)) {
+			runtime_panic(vm, MEMORY, "Failed to allocate memory for call frames.");
+			return false;
+		}
+	}
 
-	CallFrame *frame = &module_record->frames[module_record->frame_count++];
+	ThreadedWord *code = threaded_code(&closure->function->chunk);
+	if (code == NULL) {
+		runtime_panic(vm, MEMORY, "Failed to allocate memory for function code.");
+		return false;
+	}
+	if (!reserve_frame_stack(vm, closure->function)) {
+		runtime_panic(vm, MEMORY, "Failed to allocate memory for the stack.");
+		return false;
+	}
+
+	CallFrame *frame = &vm->frames[vm->frame_count++];
 	frame->closure = closure;
-	frame->ip = closure->function->chunk.code;
-	frame->slots = module_record->stack_top - arg_count - 1;
+	frame->ip = code;
+	frame->slots = vm->stack_top - arg_count - 1;
+	frame->stats_start_ns = 0;
+	if (__builtin_expect(vm->function_stats.enabled, 0)) {
+		enter_function_stats(vm, frame);
+	}
+	return true;
+}
+
+/**
+ * Calls a native function with the given arguments.
+ * @param vm The virtual machine
+ * @param native The native function to call
+ * @param arg_count Number of arguments on the stack
+ * @param unwrap Whether the caller unwraps the result right away. The native may then return its ok value unboxed
+ * and the value left on the stack is the unwrapped one
+ * @return true if the call succeeds, false otherwise
+ */
+bool call_native(VM *vm, const ObjectNativeCallable *native, const int arg_count, const bool unwrap)
+{
+
+	if (arg_count != native->arity) {
+		runtime_panic(vm, ARGUMENT_MISMATCH, "Expected %d argument(s), got %d", native->arity,
+					  arg_count);
+		return false;
+	}
+
+	const Value *args = vm->stack_top - arg_count;
+	for (int i = 0; i < arg_count; i++) {
+		if (!runtime_types_compatible(native->arg_types[i]->base_type, args[i])) {
+			char expected_name[128];
+			char actual_name[128];
+			type_mask_name(native->arg_types[i]->base_type, expected_name, sizeof(expected_name));
+			const TypeMask actual_mask = get_type_mask(args[i]);
+			type_mask_name(actual_mask, actual_name, sizeof(actual_name));
+			runtime_panic(vm, TYPE,
+						  "In %s() --- arg %d: expected "
+						  "%s, got %s",
+						  native->name->chars, i + 1, expected_name, actual_name);
+			return false;
+		}
+	}
+
+	// natives called from this one box their results unless their own caller unwraps them
+	const bool outer_unwrap = vm->unwrap_native_result;
+	vm->unwrap_native_result = unwrap;
+	vm->native_result_unboxed = false;
+
+#ifdef OPCODE_STATS
+	const uint64_t native_start_ns = opcode_stats_now_ns();
+	const Value result_value = native->function(vm, args);
+	record_native_call(vm->opcode_stats, native, opcode_stats_now_ns() - native_start_ns);
+#else
+	const Value result_value = native->function(vm, args);
+#endif
+
+	const bool unboxed = vm->native_result_unboxed;
+	vm->native_result_unboxed = false;
+	vm->unwrap_native_result = outer_unwrap;
+
+	vm->stack_top -= arg_count + 1;
+
+	// a native that suspended the running task returns a placeholder, and the caller unwraps the resumed value
+	if (!unwrap || unboxed || vm->yield_requested) {
+		push(vm, result_value);
+		return true;
+	}
+	if (!IS_CRUX_RESULT(result_value)) {
+		runtime_panic(vm, TYPE, "Only the 'result' type supports unwrapping.");
+		return false;
+	}
+	const ObjectResult *result = AS_CRUX_RESULT(result_value);
+	if (!result->is_ok) {
+		runtime_panic(vm, RUNTIME, "Panic: %s", result->as.error->message->chars);
+		return false;
+	}
+	push(vm, result->as.value);
 	return true;
 }
 
@@ -167,89 +330,57 @@ bool call(ObjectModuleRecord *module_record, ObjectClosure *closure, const int a
  */
 bool call_value(VM *vm, const Value callee, const int arg_count)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
 
-#define panic_exit(current_module_record)                                                                              \
+#define panic_exit(vm)                                                                                                 \
 	do {                                                                                                               \
-		runtime_panic((current_module_record), TYPE, "Only functions can be called.");                                 \
+		runtime_panic((vm), TYPE, "Only functions can be called.");                                                    \
 		return false;                                                                                                  \
 	} while (0)
 
-#define check_native_arity(arg_count, native)                                                                          \
-	do {                                                                                                               \
-		if ((arg_count) != (native)->arity) {                                                                          \
-			runtime_panic(current_module_record, ARGUMENT_MISMATCH, "Expected %d argument(s), got %d",                 \
-						  (native)->arity, (arg_count));                                                               \
-			return false;                                                                                              \
-		}                                                                                                              \
-	} while (0)
-
 	if (!IS_CRUX_OBJECT(callee)) {
-		panic_exit(current_module_record);
+		panic_exit(vm);
 	}
 
 	switch (OBJECT_TYPE(callee)) {
-	case OBJECT_CLOSURE:
-		return call(current_module_record, AS_CRUX_CLOSURE(callee), arg_count);
-	case OBJECT_NATIVE_CALLABLE: {
-		const ObjectNativeCallable *native = AS_CRUX_NATIVE_CALLABLE(callee);
-		check_native_arity(arg_count, native);
-
-		const Value *args = current_module_record->stack_top - arg_count;
-		for (int i = 0; i < arg_count; i++) {
-			if (!runtime_types_compatible(native->arg_types[i]->base_type, args[i])) {
-				char expected_name[128];
-				char actual_name[128];
-				type_mask_name(native->arg_types[i]->base_type, expected_name, sizeof(expected_name));
-				const TypeMask actual_mask = get_type_mask(args[i]);
-				type_mask_name(actual_mask, actual_name, sizeof(actual_name));
-				runtime_panic(current_module_record, TYPE,
-							  "In %s() --- arg %d: expected "
-							  "%s, got %s",
-							  native->name->chars, i + 1, expected_name, actual_name);
-				return false;
-			}
+	case OBJECT_CLOSURE: {
+		ObjectClosure *closure = AS_CRUX_CLOSURE(callee);
+		if (__builtin_expect(closure->function->is_generator, 0)) {
+			return call_generator(vm, closure, arg_count);
 		}
-
-		const Value result_value = native->function(vm, args);
-
-		current_module_record->stack_top -= arg_count + 1;
-
-		push(current_module_record, result_value);
-		return true;
+		return call(vm, closure, arg_count);
 	}
+	case OBJECT_NATIVE_CALLABLE:
+		return call_native(vm, AS_CRUX_NATIVE_CALLABLE(callee), arg_count, false);
 	default: {
-		panic_exit(current_module_record);
+		panic_exit(vm);
 	}
 	}
-#undef check_native_arity
 #undef panic_exit
 }
 
 bool handle_invoke(VM *vm, const int arg_count, const Value receiver, const Value original, const Value value)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
 
 	mark_value(vm, original);
 
 	// Save original stack order
-	current_module_record->stack_top[-arg_count - 1] = value;
-	current_module_record->stack_top[-arg_count] = receiver;
+	vm->stack_top[-arg_count - 1] = value;
+	vm->stack_top[-arg_count] = receiver;
 
 	if (!call_value(vm, value, arg_count)) {
 		return false;
 	}
 
 	// restore the caller and put the result in the right place
-	const Value result = pop(current_module_record);
-	push(current_module_record, original);
-	push(current_module_record, result);
+	const Value result = pop(vm);
+	push(vm, original);
+	push(vm, result);
 	return true;
 }
 
-#define undefined_method_return(current_module_record, name)                                                           \
+#define undefined_method_return(vm, name)                                                                              \
 	do {                                                                                                               \
-		runtime_panic((current_module_record), NAME, "Undefined method '%s'.", (name)->chars);                         \
+		runtime_panic((vm), NAME, "Undefined method '%s'.", (name)->chars);                                            \
 		return false;                                                                                                  \
 	} while (0)
 
@@ -271,6 +402,7 @@ static bool is_builtin_iterable_value(const Value value)
 	case OBJECT_VECTOR:
 	case OBJECT_MATRIX:
 	case OBJECT_ITERATOR:
+	case OBJECT_COROUTINE:
 		return true;
 	default:
 		return false;
@@ -295,43 +427,21 @@ static bool invoke_zero_arg_struct_method(VM *vm, const Value receiver, const ch
 		return false;
 	}
 
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	Value *saved_top = current_module_record->stack_top;
-	push(current_module_record, receiver);
-
-	const uint32_t current_frame_count = current_module_record->frame_count;
-	if (!call_value(vm, method_val, 0)) {
-		current_module_record->stack_top = saved_top;
-		return false;
-	}
-
-	InterpretResult result = INTERPRET_OK;
-	if (current_module_record->frame_count > current_frame_count) {
-		result = run(vm, true);
-		current_module_record->frame_count = current_frame_count;
-	}
-
-	if (result != INTERPRET_OK) {
-		current_module_record->stack_top = saved_top;
-		return false;
-	}
-
-	*result_out = PEEK(current_module_record, 0);
-	current_module_record->stack_top = saved_top;
-	return true;
+	// the receiver takes the callee slot and becomes the method's self
+	push(vm, receiver);
+	return call_from_native(vm, method_val, 0, result_out) == INTERPRET_OK;
 }
 
 bool get_iterator_from_value(VM *vm, const Value value, Value *iterator_out)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
 
 	if (!IS_CRUX_OBJECT(value)) {
-		runtime_panic(current_module_record, TYPE, "Cannot iterate over a non-iterable value.");
+		runtime_panic(vm, TYPE, "Cannot iterate over a non-iterable value.");
 		return false;
 	}
 
 	if (is_builtin_iterable_value(value)) {
-		if (IS_CRUX_ITERATOR(value)) {
+		if (IS_CRUX_ITERATOR(value) || IS_CRUX_COROUTINE(value)) {
 			*iterator_out = value;
 			return true;
 		}
@@ -345,14 +455,14 @@ bool get_iterator_from_value(VM *vm, const Value value, Value *iterator_out)
 		Value iter_result;
 		if (invoke_zero_arg_struct_method(vm, value, "__iter", &iter_result)) {
 			if (!IS_CRUX_OBJECT(iter_result)) {
-				runtime_panic(current_module_record, TYPE, "__iter() must return an iterator object.");
+				runtime_panic(vm, TYPE, "__iter() must return an iterator object.");
 				return false;
 			}
 			if (IS_CRUX_ITERATOR(iter_result) || IS_CRUX_STRUCT_INSTANCE(iter_result)) {
 				*iterator_out = iter_result;
 				return true;
 			}
-			runtime_panic(current_module_record, TYPE,
+			runtime_panic(vm, TYPE,
 						  "__iter() must return an Iterator or a struct instance implementing __next().");
 			return false;
 		}
@@ -364,36 +474,32 @@ bool get_iterator_from_value(VM *vm, const Value value, Value *iterator_out)
 		}
 	}
 
-	runtime_panic(current_module_record, TYPE, "Expected an iterable value.");
+	runtime_panic(vm, TYPE, "Expected an iterable value.");
 	return false;
 }
 
 bool get_next_option_from_iterator(VM *vm, const Value iterator, Value *option_out)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
 
-	if (IS_CRUX_ITERATOR(iterator)) {
-		ObjectIterator *builtin_iterator = AS_CRUX_ITERATOR(iterator);
+	if (IS_CRUX_ITERATOR(iterator) || IS_CRUX_COROUTINE(iterator)) {
 		Value next_value;
-		if (!iterate_next(current_module_record, builtin_iterator, &next_value)) {
-			ObjectOption *none = new_option(vm, NIL_VAL, false);
-			*option_out = OBJECT_VAL(none);
-			return true;
-		}
-		ObjectOption *some = new_option(vm, next_value, true);
-		*option_out = OBJECT_VAL(some);
+		const bool has_value = next_iterator_value(vm, iterator, &next_value);
+		push(vm, next_value);
+		ObjectOption *option = new_option(vm, has_value ? next_value : NIL_VAL, has_value);
+		pop(vm);
+		*option_out = OBJECT_VAL(option);
 		return true;
 	}
 
 	if (IS_CRUX_STRUCT_INSTANCE(iterator)) {
 		Value next_result;
 		if (!invoke_zero_arg_struct_method(vm, iterator, "__next", &next_result)) {
-			runtime_panic(current_module_record, TYPE, "Iterator struct must define __next() -> Option.");
+			runtime_panic(vm, TYPE, "Iterator struct must define __next() -> Option.");
 			return false;
 		}
 
 		if (!IS_CRUX_OPTION(next_result)) {
-			runtime_panic(current_module_record, TYPE, "__next() must return Option.");
+			runtime_panic(vm, TYPE, "__next() must return Option.");
 			return false;
 		}
 
@@ -401,10 +507,33 @@ bool get_next_option_from_iterator(VM *vm, const Value iterator, Value *option_o
 		return true;
 	}
 
-	runtime_panic(current_module_record, TYPE, "Expected an iterator value.");
+	runtime_panic(vm, TYPE, "Expected an iterator value.");
 	return false;
 }
 
+bool next_iterator_value(VM *vm, const Value iterator, Value *value_out)
+{
+	if (IS_CRUX_ITERATOR(iterator)) {
+		ObjectIterator *builtin_iterator = AS_CRUX_ITERATOR(iterator);
+		if (builtin_iterator->kind == ITERATOR_SEQUENCE) {
+			return iterate_next(vm, builtin_iterator, value_out);
+		}
+		return iterator_adapter_next(vm, builtin_iterator, value_out);
+	}
+
+	if (IS_CRUX_COROUTINE(iterator)) {
+		return next_coroutine_value(vm, AS_CRUX_COROUTINE(iterator), value_out);
+	}
+
+	Value option;
+	if (!get_next_option_from_iterator(vm, iterator, &option)) {
+		return false;
+	}
+	const ObjectOption *next_option = AS_CRUX_OPTION(option);
+	*value_out = next_option->value;
+	return next_option->is_some;
+}
+
 static bool handle_string_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
 								 const Value receiver)
 {
@@ -412,7 +541,7 @@ static bool handle_string_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->string_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_undefined_invoke(VM *vm, const ObjectString *name, int arg_count, Value original, Value receiver)
@@ -422,7 +551,7 @@ static bool handle_undefined_invoke(VM *vm, const ObjectString *name, int arg_co
 	(void)original;
 	(void)receiver;
 
-	runtime_panic(vm->current_module_record, TYPE, "Only instances have methods");
+	runtime_panic(vm, TYPE, "Only instances have methods");
 	return false;
 }
 
@@ -433,7 +562,7 @@ static bool handle_array_invoke(VM *vm, const ObjectString *name, const int arg_
 	if (table_get(&vm->array_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_file_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -443,7 +572,7 @@ static bool handle_file_invoke(VM *vm, const ObjectString *name, const int arg_c
 	if (table_get(&vm->file_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_error_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -453,7 +582,7 @@ static bool handle_error_invoke(VM *vm, const ObjectString *name, const int arg_
 	if (table_get(&vm->error_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_table_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -463,7 +592,7 @@ static bool handle_table_invoke(VM *vm, const ObjectString *name, const int arg_
 	if (table_get(&vm->table_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_random_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -473,7 +602,7 @@ static bool handle_random_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->random_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_vector_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -483,7 +612,7 @@ static bool handle_vector_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->vector_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_complex_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -493,7 +622,7 @@ static bool handle_complex_invoke(VM *vm, const ObjectString *name, const int ar
 	if (table_get(&vm->complex_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_matrix_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -503,7 +632,7 @@ static bool handle_matrix_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->matrix_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_result_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -513,7 +642,7 @@ static bool handle_result_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->result_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_option_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -523,7 +652,7 @@ static bool handle_option_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->option_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_range_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -533,7 +662,7 @@ static bool handle_range_invoke(VM *vm, const ObjectString *name, const int arg_
 	if (table_get(&vm->range_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_set_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -543,7 +672,7 @@ static bool handle_set_invoke(VM *vm, const ObjectString *name, const int arg_co
 	if (table_get(&vm->set_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_tuple_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -553,7 +682,7 @@ static bool handle_tuple_invoke(VM *vm, const ObjectString *name, const int arg_
 	if (table_get(&vm->tuple_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static bool handle_buffer_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
@@ -563,7 +692,17 @@ static bool handle_buffer_invoke(VM *vm, const ObjectString *name, const int arg
 	if (table_get(&vm->buffer_type, name, &value)) {
 		return handle_invoke(vm, arg_count, receiver, original, value);
 	}
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
+}
+
+static bool handle_iterator_invoke(VM *vm, const ObjectString *name, const int arg_count, const Value original,
+								   const Value receiver)
+{
+	Value value;
+	if (table_get(&vm->iterator_type, name, &value)) {
+		return handle_invoke(vm, arg_count, receiver, original, value);
+	}
+	undefined_method_return(vm, name);
 }
 
 static bool handle_struct_instance_invoke(VM *vm, const ObjectString *name, int arg_count, Value original,
@@ -584,7 +723,7 @@ static bool handle_struct_instance_invoke(VM *vm, const ObjectString *name, int
 		return call_value(vm, instance->fields[(uint16_t)AS_INT(indexValue)], arg_count);
 	}
 
-	undefined_method_return(vm->current_module_record, name);
+	undefined_method_return(vm, name);
 }
 
 static const TypeInvokeHandler invoke_dispatch_table[] = {
@@ -605,12 +744,16 @@ static const TypeInvokeHandler invoke_dispatch_table[] = {
 	[OBJECT_STRUCT_INSTANCE] = handle_struct_instance_invoke,
 	[OBJECT_VECTOR] = handle_vector_invoke,
 	[OBJECT_RANGE] = handle_range_invoke,
-	[OBJECT_ITERATOR] = handle_undefined_invoke,
+	[OBJECT_ITERATOR] = handle_iterator_invoke,
 	[OBJECT_SET] = handle_set_invoke,
 	[OBJECT_TUPLE] = handle_tuple_invoke,
 	[OBJECT_BUFFER] = handle_buffer_invoke,
 	[OBJECT_COMPLEX] = handle_complex_invoke,
 	[OBJECT_MATRIX] = handle_matrix_invoke,
+	[OBJECT_TYPE_RECORD] = handle_undefined_invoke,
+	[OBJECT_TYPE_TABLE] = handle_undefined_invoke,
+	[OBJECT_ENUM] = handle_undefined_invoke,
+	[OBJECT_COROUTINE] = handle_iterator_invoke,
 };
 
 /**
@@ -622,13 +765,12 @@ static const TypeInvokeHandler invoke_dispatch_table[] = {
  */
 bool invoke(VM *vm, const ObjectString *name, int arg_count)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	const Value receiver = PEEK(current_module_record, arg_count);
-	const Value original = PEEK(current_module_record,
+	const Value receiver = PEEK(vm, arg_count);
+	const Value original = PEEK(vm,
 								arg_count + 1); // Store the original caller
 
 	if (!IS_CRUX_OBJECT(receiver)) {
-		runtime_panic(current_module_record, TYPE, "Only instances have methods");
+		runtime_panic(vm, TYPE, "Only instances have methods");
 		return false;
 	}
 
@@ -638,9 +780,8 @@ bool invoke(VM *vm, const ObjectString *name, int arg_count)
 
 ObjectUpvalue *capture_upvalue(VM *vm, Value *local)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
 	ObjectUpvalue *prevUpvalue = NULL;
-	ObjectUpvalue *upvalue = current_module_record->open_upvalues;
+	ObjectUpvalue *upvalue = vm->open_upvalues;
 
 	while (upvalue != NULL && upvalue->location > local) {
 		prevUpvalue = upvalue;
@@ -654,7 +795,7 @@ ObjectUpvalue *capture_upvalue(VM *vm, Value *local)
 
 	createdUpvalue->next = upvalue;
 	if (prevUpvalue == NULL) {
-		current_module_record->open_upvalues = createdUpvalue;
+		vm->open_upvalues = createdUpvalue;
 	} else {
 		prevUpvalue->next = createdUpvalue;
 	}
@@ -664,16 +805,16 @@ ObjectUpvalue *capture_upvalue(VM *vm, Value *local)
 
 /**
  * Closes all upvalues up to a certain stack position.
- * @param moduleRecord the currently executing module
+ * @param vm The virtual machine
  * @param last Pointer to the last variable to close
  */
-void close_upvalues(ObjectModuleRecord *moduleRecord, const Value *last)
+void close_upvalues(VM *vm, const Value *last)
 {
-	while (moduleRecord->open_upvalues != NULL && moduleRecord->open_upvalues->location >= last) {
-		ObjectUpvalue *upvalue = moduleRecord->open_upvalues;
+	while (vm->open_upvalues != NULL && vm->open_upvalues->location >= last) {
+		ObjectUpvalue *upvalue = vm->open_upvalues;
 		upvalue->closed = *upvalue->location;
 		upvalue->location = &upvalue->closed;
-		moduleRecord->open_upvalues = upvalue->next;
+		vm->open_upvalues = upvalue->next;
 	}
 }
 
@@ -695,9 +836,8 @@ bool is_falsy(const Value value)
  */
 bool concatenate(VM *vm)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	const Value b = PEEK(current_module_record, 0);
-	const Value a = PEEK(current_module_record, 1);
+	const Value b = PEEK(vm, 0);
+	const Value a = PEEK(vm, 1);
 
 	if (!IS_CRUX_STRING(a) || !IS_CRUX_STRING(b)) {
 		/* Concatenation is only defined for string */
@@ -711,7 +851,7 @@ bool concatenate(VM *vm)
 	char *chars = ALLOCATE(vm, char, length + 1);
 
 	if (chars == NULL) {
-		runtime_panic(current_module_record, MEMORY, "Could not allocate memory for concatenation.");
+		runtime_panic(vm, MEMORY, "Could not allocate memory for concatenation.");
 		return false;
 	}
 
@@ -721,8 +861,8 @@ bool concatenate(VM *vm)
 
 	ObjectString *result = take_string(vm, chars, length);
 
-	pop_two(current_module_record);
-	push(current_module_record, OBJECT_VAL(result));
+	pop_two(vm);
+	push(vm, OBJECT_VAL(result));
 	return true;
 }
 
@@ -796,12 +936,71 @@ bool init_vm(VM *vm, const int argc, const char **argv)
 	vm->gray_stack = NULL;
 	vm->struct_instance_stack.structs = NULL;
 	vm->main_compiler = NULL;
+	vm->current_coroutine = NULL;
+	vm->coroutines = NULL;
+	vm->reentry_depth = 0;
+	vm->max_frames = DEFAULT_MAX_FRAMES;
+	const char *max_frames_env = getenv("CRUX_MAX_FRAMES");
+	if (max_frames_env != NULL) {
+		const long max_frames = strtol(max_frames_env, NULL, 10);
+		if (max_frames > 0) {
+			vm->max_frames = max_frames < UINT32_MAX ? (uint32_t)max_frames : UINT32_MAX;
+		}
+	}
+	vm->yield_requested = false;
+	vm->unwrap_native_result = false;
+	vm->native_result_unboxed = false;
+	vm->profiler = NULL;
+	vm->profile_ticks = 0;
+	vm->heap_profiler = NULL;
+	vm->gc_event_log = NULL;
+	vm->workers.items = NULL;
+	vm->workers.count = 0;
+	vm->workers.capacity = 0;
+	vm->worker = NULL;
+	vm->thread_pool = NULL;
+	vm->gc_background_sweep = false;
+	vm->gc_sweep_pending = false;
+	vm->background_sweeper = NULL;
+	const char *background_sweep_env = getenv("CRUX_GC_BACKGROUND_SWEEP");
+	if (background_sweep_env != NULL && background_sweep_env[0] != '\0' && strcmp(background_sweep_env, "0") != 0) {
+		vm->gc_background_sweep = true;
+	}
+	const char *gc_log_env = getenv("CRUX_GC_LOG");
+	if (gc_log_env != NULL && gc_log_env[0] != '\0') {
+		const char *error = NULL;
+		if (!open_gc_event_log(vm, gc_log_env, &error)) {
+			fprintf(stderr, "%s\n", error);
+		}
+	}
+	init_function_stats(&vm->function_stats);
+	const char *function_stats_env = getenv("CRUX_FUNCTION_STATS");
+	if (function_stats_env != NULL && function_stats_env[0] != '\0' && strcmp(function_stats_env, "0") != 0) {
+		vm->function_stats.enabled = true;
+		vm->function_stats.report_on_exit = true;
+	}
+#ifdef OPCODE_STATS
+	vm->opcode_stats = new_opcode_stats();
+	if (vm->opcode_stats == NULL) {
+		fprintf(stderr, "Fatal Error: Could not allocate memory for opcode statistics.\nShutting Down!\n");
+		return false;
+	}
+#endif
+	init_event_loop(&vm->event_loop);
 
 	vm->heap_growth_factor = INIT_GC_HEAP_GROW_FACTOR;
 
-	vm->current_module_record = new_object_module_record(vm, NULL, is_repl, true);
+	vm->stack = ALLOCATE(vm, Value, STACK_INITIAL);
+	vm->frames = ALLOCATE(vm, CallFrame, FRAMES_INITIAL);
+	if (vm->stack == NULL || vm->frames == NULL) {
+		fprintf(stderr, "Fatal Error: Could not allocate memory for the VM stack.\nShutting Down!\n");
+		return false;
+	}
+	vm->stack_limit = vm->stack + STACK_INITIAL;
+	vm->frame_capacity = FRAMES_INITIAL;
+	reset_stack(vm);
 
-	reset_stack(vm->current_module_record);
+	vm->current_module_record = new_object_module_record(vm, NULL, is_repl, true);
 
 	init_table(&vm->string_type);
 	init_table(&vm->array_type);
@@ -818,11 +1017,22 @@ bool init_vm(VM *vm, const int argc, const char **argv)
 	init_table(&vm->set_type);
 	init_table(&vm->tuple_type);
 	init_table(&vm->buffer_type);
+	init_table(&vm->iterator_type);
 	init_table(&vm->core_fns);
 	init_table(&vm->module_cache);
+	init_module_preload(&vm->module_preload);
 
 	init_table(&vm->strings);
 
+	vm->none_option = NULL;
+	vm->ok_nil_result = NULL;
+	vm->ok_bool_results[false] = NULL;
+	vm->ok_bool_results[true] = NULL;
+	vm->static_errors.entries = NULL;
+	vm->static_errors.count = 0;
+	vm->static_errors.capacity = 0;
+	init_immortal_values(vm);
+
 	init_import_stack(vm);
 
 	initNativeModules(&vm->native_modules);
@@ -836,7 +1046,7 @@ bool init_vm(VM *vm, const int argc, const char **argv)
 	initMatchHandlerStack(&vm->match_handler_stack);
 
 	if (!initialize_std_lib(vm)) {
-		runtime_panic(vm->current_module_record, RUNTIME, "Failed to initialize standard library.");
+		runtime_panic(vm, RUNTIME, "Failed to initialize standard library.");
 	}
 	vm->import_count = 0;
 
@@ -871,6 +1081,27 @@ bool init_vm(VM *vm, const int argc, const char **argv)
 
 void free_vm(VM *vm)
 {
+	free_workers(vm);
+	free_thread_pool(vm);
+	free_background_sweeper(vm);
+	if (vm->profiler != NULL) {
+		const char *error = NULL;
+		profiler_stop(vm, NULL, &error);
+	}
+	if (vm->heap_profiler != NULL) {
+		const char *error = NULL;
+		heap_profiler_stop(vm, NULL, &error);
+	}
+	close_gc_event_log(vm);
+	if (vm->function_stats.report_on_exit) {
+		print_function_stats_report(vm);
+	}
+	free_function_stats(&vm->function_stats);
+#ifdef OPCODE_STATS
+	dump_opcode_stats(vm->opcode_stats);
+	vm->opcode_stats = NULL;
+#endif
+
 	free_table(vm, &vm->strings);
 
 	free_table(vm, &vm->string_type);
@@ -888,6 +1119,7 @@ void free_vm(VM *vm)
 	free_table(vm, &vm->set_type);
 	free_table(vm, &vm->tuple_type);
 	free_table(vm, &vm->buffer_type);
+	free_table(vm, &vm->iterator_type);
 	free_table(vm, &vm->core_fns);
 
 	for (int i = 0; i < vm->native_modules.count; i++) {
@@ -897,13 +1129,18 @@ void free_vm(VM *vm)
 	}
 	freeNativeModules(&vm->native_modules);
 	free_table(vm, &vm->module_cache);
+	release_preloaded_sources(&vm->module_preload);
 
 	free_import_stack(vm);
 	freeStructInstanceStack(&vm->struct_instance_stack);
+	free_event_loop(&vm->event_loop);
 
 	free_module_record(vm, vm->current_module_record);
+	FREE_ARRAY(vm, CallFrame, vm->frames, vm->frame_capacity);
+	FREE_ARRAY(vm, Value, vm->stack, vm->stack_limit - vm->stack);
 
 	free_objects(vm, true);
+	free_static_errors(vm);
 	destroy_slab_allocator(vm->slab_24);
 	destroy_slab_allocator(vm->slab_32);
 	destroy_slab_allocator(vm->slab_48);
@@ -912,224 +1149,224 @@ void free_vm(VM *vm)
 	free(vm);
 }
 
-typedef bool (*IntBinaryOp)(ObjectModuleRecord *current_module_record, int32_t intA, int32_t intB);
-typedef bool (*FloatBinaryOp)(ObjectModuleRecord *current_module_record, double doubleA, double doubleB);
+typedef bool (*IntBinaryOp)(VM *vm, int32_t intA, int32_t intB);
+typedef bool (*FloatBinaryOp)(VM *vm, double doubleA, double doubleB);
 
-static bool int_add(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_add(VM *vm, const int32_t intA, const int32_t intB)
 {
 	const int64_t result = (int64_t)intA + (int64_t)intB;
-	pop_two(current_module_record);
+	pop_two(vm);
 	if (result >= INT32_MIN && result <= INT32_MAX) {
-		push(current_module_record, INT_VAL((int32_t)result));
+		push(vm, INT_VAL((int32_t)result));
 	} else {
-		push(current_module_record,
+		push(vm,
 			 FLOAT_VAL((double)result)); // Promote on overflow
 	}
 	return true;
 }
 
-static bool int_subtract(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_subtract(VM *vm, const int32_t intA, const int32_t intB)
 {
 	const int64_t result = (int64_t)intA - (int64_t)intB;
-	pop_two(current_module_record);
+	pop_two(vm);
 	if (result >= INT32_MIN && result <= INT32_MAX) {
-		push(current_module_record, INT_VAL((int32_t)result));
+		push(vm, INT_VAL((int32_t)result));
 	} else {
-		push(current_module_record,
+		push(vm,
 			 FLOAT_VAL((double)result)); // Promote on overflow
 	}
 	return true;
 }
 
-static bool int_multiply(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_multiply(VM *vm, const int32_t intA, const int32_t intB)
 {
 	const int64_t result = (int64_t)intA * (int64_t)intB;
-	pop_two(current_module_record);
+	pop_two(vm);
 	if (result >= INT32_MIN && result <= INT32_MAX) {
-		push(current_module_record, INT_VAL((int32_t)result));
+		push(vm, INT_VAL((int32_t)result));
 	} else {
-		push(current_module_record,
+		push(vm,
 			 FLOAT_VAL((double)result)); // Promote on overflow
 	}
 	return true;
 }
 
-static bool int_divide(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_divide(VM *vm, const int32_t intA, const int32_t intB)
 {
 	if (intB == 0) {
-		runtime_panic(current_module_record, MATH, "Division by zero.");
+		runtime_panic(vm, MATH, "Division by zero.");
 		return false;
 	}
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL((double)intA / (double)intB));
+	pop_two(vm);
+	push(vm, FLOAT_VAL((double)intA / (double)intB));
 	return true;
 }
 
-static bool int_int_divide(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_int_divide(VM *vm, const int32_t intA, const int32_t intB)
 {
 	if (intB == 0) {
-		runtime_panic(current_module_record, MATH, "Integer division by zero.");
+		runtime_panic(vm, MATH, "Integer division by zero.");
 		return false;
 	}
 	// Edge case: INT32_MIN / -1 overflows int32_t
 	if (intA == INT32_MIN && intB == -1) {
-		pop_two(current_module_record);
-		push(current_module_record,
+		pop_two(vm);
+		push(vm,
 			 FLOAT_VAL(-(double)INT32_MIN)); // Promote
 	} else {
-		pop_two(current_module_record);
-		push(current_module_record, INT_VAL(intA / intB));
+		pop_two(vm);
+		push(vm, INT_VAL(intA / intB));
 	}
 	return true;
 }
 
-static bool int_modulus(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_modulus(VM *vm, const int32_t intA, const int32_t intB)
 {
 	if (intB == 0) {
-		runtime_panic(current_module_record, MATH, "Modulo by zero.");
+		runtime_panic(vm, MATH, "Modulo by zero.");
 		return false;
 	}
 
 	if (intA == INT32_MIN && intB == -1) {
-		pop_two(current_module_record);
-		push(current_module_record, INT_VAL(0));
+		pop_two(vm);
+		push(vm, INT_VAL(0));
 	} else {
-		pop_two(current_module_record);
-		push(current_module_record, INT_VAL(intA % intB));
+		pop_two(vm);
+		push(vm, INT_VAL(intA % intB));
 	}
 	return true;
 }
 
-static bool int_left_shift(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_left_shift(VM *vm, const int32_t intA, const int32_t intB)
 {
 	if (intB < 0 || intB >= 32) {
-		runtime_panic(current_module_record, RUNTIME, "Invalid shift amount (%d) for <<.", intB);
+		runtime_panic(vm, RUNTIME, "Invalid shift amount (%d) for <<.", intB);
 		return false;
 	}
-	pop_two(current_module_record);
-	push(current_module_record, INT_VAL(intA << intB));
+	pop_two(vm);
+	push(vm, INT_VAL(intA << intB));
 	return true;
 }
 
-static bool int_right_shift(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_right_shift(VM *vm, const int32_t intA, const int32_t intB)
 {
 	if (intB < 0 || intB >= 32) {
-		runtime_panic(current_module_record, RUNTIME, "Invalid shift amount (%d) for >>.", intB);
+		runtime_panic(vm, RUNTIME, "Invalid shift amount (%d) for >>.", intB);
 		return false;
 	}
-	pop_two(current_module_record);
-	push(current_module_record, INT_VAL(intA >> intB));
+	pop_two(vm);
+	push(vm, INT_VAL(intA >> intB));
 	return true;
 }
 
-static bool int_power(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_power(VM *vm, const int32_t intA, const int32_t intB)
 {
 	// Promote int^int to float
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL(pow(intA, intB)));
+	pop_two(vm);
+	push(vm, FLOAT_VAL(pow(intA, intB)));
 	return true;
 }
 
-static bool int_less(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_less(VM *vm, const int32_t intA, const int32_t intB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(intA < intB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(intA < intB));
 	return true;
 }
 
-static bool int_less_equal(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_less_equal(VM *vm, const int32_t intA, const int32_t intB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(intA <= intB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(intA <= intB));
 	return true;
 }
 
-static bool int_greater(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_greater(VM *vm, const int32_t intA, const int32_t intB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(intA > intB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(intA > intB));
 	return true;
 }
 
-static bool int_greater_equal(ObjectModuleRecord *current_module_record, const int32_t intA, const int32_t intB)
+static bool int_greater_equal(VM *vm, const int32_t intA, const int32_t intB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(intA >= intB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(intA >= intB));
 	return true;
 }
 
-static bool float_add(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_add(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL(doubleA + doubleB));
+	pop_two(vm);
+	push(vm, FLOAT_VAL(doubleA + doubleB));
 	return true;
 }
 
-static bool float_subtract(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_subtract(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL(doubleA - doubleB));
+	pop_two(vm);
+	push(vm, FLOAT_VAL(doubleA - doubleB));
 	return true;
 }
 
-static bool float_multiply(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_multiply(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL(doubleA * doubleB));
+	pop_two(vm);
+	push(vm, FLOAT_VAL(doubleA * doubleB));
 	return true;
 }
 
-static bool float_divide(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_divide(VM *vm, const double doubleA, const double doubleB)
 {
 	if (doubleB == 0.0) {
-		runtime_panic(current_module_record, MATH, "Division by zero.");
+		runtime_panic(vm, MATH, "Division by zero.");
 		return false;
 	}
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL(doubleA / doubleB));
+	pop_two(vm);
+	push(vm, FLOAT_VAL(doubleA / doubleB));
 	return true;
 }
 
-static bool float_power(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_power(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, FLOAT_VAL(pow(doubleA, doubleB)));
+	pop_two(vm);
+	push(vm, FLOAT_VAL(pow(doubleA, doubleB)));
 	return true;
 }
 
-static bool float_less(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_less(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(doubleA < doubleB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(doubleA < doubleB));
 	return true;
 }
 
-static bool float_less_equal(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_less_equal(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(doubleA <= doubleB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(doubleA <= doubleB));
 	return true;
 }
 
-static bool float_greater(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_greater(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(doubleA > doubleB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(doubleA > doubleB));
 	return true;
 }
 
-static bool float_greater_equal(ObjectModuleRecord *current_module_record, const double doubleA, const double doubleB)
+static bool float_greater_equal(VM *vm, const double doubleA, const double doubleB)
 {
-	pop_two(current_module_record);
-	push(current_module_record, BOOL_VAL(doubleA >= doubleB));
+	pop_two(vm);
+	push(vm, BOOL_VAL(doubleA >= doubleB));
 	return true;
 }
 
-static bool float_invalid_int_op(ObjectModuleRecord *current_module_record, double doubleA, double doubleB)
+static bool float_invalid_int_op(VM *vm, double doubleA, double doubleB)
 {
 	(void)doubleA;
 	(void)doubleB;
-	runtime_panic(current_module_record, TYPE, "Operands for integer operation must both be integers.");
+	runtime_panic(vm, TYPE, "Operands for integer operation must both be integers.");
 	return false;
 }
 
@@ -1166,16 +1403,16 @@ static const FloatBinaryOp float_binary_ops[] = {
 };
 
 // Function pointer types for compound operations
-typedef InterpretResult (*IntCompoundOp)(ObjectModuleRecord *current_module_record, const char *target_name,
+typedef InterpretResult (*IntCompoundOp)(VM *vm, const char *target_name,
 										 char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue);
-typedef InterpretResult (*FloatCompoundOp)(ObjectModuleRecord *current_module_record, const char *target_name,
+typedef InterpretResult (*FloatCompoundOp)(VM *vm, const char *target_name,
 										   char *operation, double dcurrent, double doperand, Value *resultValue);
 
 // Integer compound operation handlers
-static InterpretResult int_compound_plus(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult int_compound_plus(VM *vm, const char *target_name,
 										 char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)operation;
 	(void)target_name;
 	const int64_t result = (int64_t)icurrent + (int64_t)ioperand;
@@ -1187,10 +1424,10 @@ static InterpretResult int_compound_plus(ObjectModuleRecord *current_module_reco
 	return INTERPRET_OK;
 }
 
-static InterpretResult int_compound_minus(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult int_compound_minus(VM *vm, const char *target_name,
 										  char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)target_name;
 	(void)operation;
 	const int64_t result = (int64_t)icurrent - (int64_t)ioperand;
@@ -1202,10 +1439,10 @@ static InterpretResult int_compound_minus(ObjectModuleRecord *current_module_rec
 	return INTERPRET_OK;
 }
 
-static InterpretResult int_compound_star(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult int_compound_star(VM *vm, const char *target_name,
 										 char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)target_name;
 	(void)operation;
 	const int64_t result = (int64_t)icurrent * (int64_t)ioperand;
@@ -1217,22 +1454,22 @@ static InterpretResult int_compound_star(ObjectModuleRecord *current_module_reco
 	return INTERPRET_OK;
 }
 
-static InterpretResult int_compound_slash(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult int_compound_slash(VM *vm, const char *target_name,
 										  char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue)
 {
 	if (ioperand == 0) {
-		runtime_panic(current_module_record, MATH, "Division by zero in '%s %s'.", target_name, operation);
+		runtime_panic(vm, MATH, "Division by zero in '%s %s'.", target_name, operation);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	*resultValue = FLOAT_VAL((double)icurrent / (double)ioperand);
 	return INTERPRET_OK;
 }
 
-static InterpretResult int_compound_int_divide(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult int_compound_int_divide(VM *vm, const char *target_name,
 											   char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue)
 {
 	if (ioperand == 0) {
-		runtime_panic(current_module_record, RUNTIME, "Division by zero in '%s %s'.", target_name, operation);
+		runtime_panic(vm, RUNTIME, "Division by zero in '%s %s'.", target_name, operation);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	if (icurrent == INT32_MIN && ioperand == -1) {
@@ -1243,11 +1480,11 @@ static InterpretResult int_compound_int_divide(ObjectModuleRecord *current_modul
 	return INTERPRET_OK;
 }
 
-static InterpretResult int_compound_modulus(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult int_compound_modulus(VM *vm, const char *target_name,
 											char *operation, int32_t icurrent, int32_t ioperand, Value *resultValue)
 {
 	if (ioperand == 0) {
-		runtime_panic(current_module_record, RUNTIME, "Division by zero in '%s %s'.", target_name, operation);
+		runtime_panic(vm, RUNTIME, "Division by zero in '%s %s'.", target_name, operation);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	if (icurrent == INT32_MIN && ioperand == -1) {
@@ -1259,57 +1496,57 @@ static InterpretResult int_compound_modulus(ObjectModuleRecord *current_module_r
 }
 
 // Float compound operation handlers
-static InterpretResult float_compound_plus(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult float_compound_plus(VM *vm, const char *target_name,
 										   char *operation, double dcurrent, double doperand, Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)target_name;
 	(void)operation;
 	*resultValue = FLOAT_VAL(dcurrent + doperand);
 	return INTERPRET_OK;
 }
 
-static InterpretResult float_compound_minus(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult float_compound_minus(VM *vm, const char *target_name,
 											char *operation, double dcurrent, double doperand, Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)target_name;
 	(void)operation;
 	*resultValue = FLOAT_VAL(dcurrent - doperand);
 	return INTERPRET_OK;
 }
 
-static InterpretResult float_compound_star(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult float_compound_star(VM *vm, const char *target_name,
 										   char *operation, double dcurrent, double doperand, Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)target_name;
 	(void)operation;
 	*resultValue = FLOAT_VAL(dcurrent * doperand);
 	return INTERPRET_OK;
 }
 
-static InterpretResult float_compound_slash(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult float_compound_slash(VM *vm, const char *target_name,
 											char *operation, double dcurrent, double doperand, Value *resultValue)
 {
 	if (doperand == 0.0) {
-		runtime_panic(current_module_record, MATH, "Division by zero in '%s %s'.", target_name, operation);
+		runtime_panic(vm, MATH, "Division by zero in '%s %s'.", target_name, operation);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	*resultValue = FLOAT_VAL(dcurrent / doperand);
 	return INTERPRET_OK;
 }
 
-static InterpretResult float_compound_invalid_int_op(ObjectModuleRecord *current_module_record, const char *target_name,
+static InterpretResult float_compound_invalid_int_op(VM *vm, const char *target_name,
 													 char *operation, double dcurrent, double doperand,
 													 Value *resultValue)
 {
-	(void)current_module_record;
+	(void)vm;
 	(void)target_name;
 	(void)dcurrent;
 	(void)doperand;
 	(void)resultValue;
-	runtime_panic(current_module_record, TYPE,
+	runtime_panic(vm, TYPE,
 				  "Operands for integer compound assignment '%s' must both "
 				  "be integers.",
 				  operation);
@@ -1343,9 +1580,8 @@ static const FloatCompoundOp float_compound_ops[] = {
  */
 bool binary_operation(VM *vm, const OpCode operation)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	const Value b = PEEK(current_module_record, 0);
-	const Value a = PEEK(current_module_record, 1);
+	const Value b = PEEK(vm, 0);
+	const Value a = PEEK(vm, 1);
 
 	const bool aIsInt = IS_INT(a);
 	const bool bIsInt = IS_INT(b);
@@ -1354,9 +1590,9 @@ bool binary_operation(VM *vm, const OpCode operation)
 
 	if (!((aIsInt || aIsFloat) && (bIsInt || bIsFloat))) {
 		if (!(aIsInt || aIsFloat)) {
-			runtime_panic(current_module_record, TYPE, type_error_message(vm, a, "'int' or 'float'"));
+			runtime_panic(vm, TYPE, type_error_message(vm, a, "'int' or 'float'"));
 		} else {
-			runtime_panic(current_module_record, TYPE, type_error_message(vm, b, "'int' or 'float'"));
+			runtime_panic(vm, TYPE, type_error_message(vm, b, "'int' or 'float'"));
 		}
 		return false;
 	}
@@ -1367,31 +1603,32 @@ bool binary_operation(VM *vm, const OpCode operation)
 
 		if (operation >= (OpCode)(sizeof(int_binary_ops) / sizeof(int_binary_ops[0])) ||
 			int_binary_ops[operation] == NULL) {
-			runtime_panic(current_module_record, RUNTIME, "Unknown binary operation %d for int, int.", operation);
+			runtime_panic(vm, RUNTIME, "Unknown binary operation %d for int, int.", operation);
 			return false;
 		}
 
-		return int_binary_ops[operation](current_module_record, intA, intB);
+		return int_binary_ops[operation](vm, intA, intB);
 	}
 	const double doubleA = aIsFloat ? AS_FLOAT(a) : (double)AS_INT(a);
 	const double doubleB = bIsFloat ? AS_FLOAT(b) : (double)AS_INT(b);
 
 	if (operation >= (OpCode)(sizeof(float_binary_ops) / sizeof(float_binary_ops[0])) ||
 		float_binary_ops[operation] == NULL) {
-		runtime_panic(current_module_record, RUNTIME, "Unknown binary operation %d for float/mixed.", operation);
+		runtime_panic(vm, RUNTIME, "Unknown binary operation %d for float/mixed.", operation);
 		return false;
 	}
 
-	return float_binary_ops[operation](current_module_record, doubleA, doubleB);
+	return float_binary_ops[operation](vm, doubleA, doubleB);
 	return true;
 }
 
 InterpretResult global_compound_operation(VM *vm, const uint16_t index, const OpCode opcode, char *operation)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	Value currentValue = current_module_record->globals[index];
+	// the global belongs to the module of the running function, which need not be the module whose script runs
+	Value *globals = vm->frames[vm->frame_count - 1].closure->function->module_record->globals;
+	Value currentValue = globals[index];
 
-	const Value operandValue = PEEK(current_module_record, 0);
+	const Value operandValue = PEEK(vm, 0);
 
 	const bool currentIsInt = IS_INT(currentValue);
 	const bool currentIsFloat = IS_FLOAT(currentValue);
@@ -1400,9 +1637,9 @@ InterpretResult global_compound_operation(VM *vm, const uint16_t index, const Op
 
 	if (!((currentIsInt || currentIsFloat) && (operandIsInt || operandIsFloat))) {
 		if (!(currentIsInt || currentIsFloat)) {
-			runtime_panic(current_module_record, TYPE, "Global is not a number for '%s' operator.", operation);
+			runtime_panic(vm, TYPE, "Global is not a number for '%s' operator.", operation);
 		} else {
-			runtime_panic(current_module_record, TYPE,
+			runtime_panic(vm, TYPE,
 						  "Right-hand operand for '%s' must be an "
 						  "'int' or 'float'.",
 						  operation);
@@ -1418,14 +1655,14 @@ InterpretResult global_compound_operation(VM *vm, const uint16_t index, const Op
 
 		if (opcode >= (OpCode)(sizeof(int_compound_ops) / sizeof(int_compound_ops[0])) ||
 			int_compound_ops[opcode] == NULL) {
-			runtime_panic(current_module_record, RUNTIME,
+			runtime_panic(vm, RUNTIME,
 						  "Unsupported compound assignment opcode "
 						  "%d for int/int.",
 						  opcode);
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
-		const InterpretResult result = int_compound_ops[opcode](current_module_record, "global", operation, icurrent,
+		const InterpretResult result = int_compound_ops[opcode](vm, "global", operation, icurrent,
 																ioperand, &resultValue);
 		if (result != INTERPRET_OK) {
 			return result;
@@ -1436,20 +1673,20 @@ InterpretResult global_compound_operation(VM *vm, const uint16_t index, const Op
 
 		if (opcode >= (OpCode)(sizeof(float_compound_ops) / sizeof(float_compound_ops[0])) ||
 			float_compound_ops[opcode] == NULL) {
-			runtime_panic(current_module_record, RUNTIME,
+			runtime_panic(vm, RUNTIME,
 						  "Unsupported compound assignment opcode "
 						  "%d for float/mixed.",
 						  opcode);
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
-		const InterpretResult result = float_compound_ops[opcode](current_module_record, "global", operation, dcurrent,
+		const InterpretResult result = float_compound_ops[opcode](vm, "global", operation, dcurrent,
 																  doperand, &resultValue);
 		if (result != INTERPRET_OK) {
 			return result;
 		}
 	}
-	current_module_record->globals[index] = resultValue;
+	globals[index] = resultValue;
 	return INTERPRET_OK;
 }
 
@@ -1457,6 +1694,8 @@ InterpretResult interpret(VM *vm, char *source)
 {
 	jmp_buf previous_jump_buffer;
 	memcpy(previous_jump_buffer, vm->jump_buffer, sizeof(jmp_buf));
+	ObjectModuleRecord *script_module_record = vm->current_module_record;
+	const uint32_t import_depth = vm->import_stack.count;
 
 	int jump_code = setjmp(vm->jump_buffer);
 	if (jump_code != INTERPRET_OK) {
@@ -1468,6 +1707,19 @@ InterpretResult interpret(VM *vm, char *source)
 		if (vm->current_module_record != NULL) {
 			vm->current_module_record->state = STATE_ERROR;
 		}
+		// imports whose scripts were still running never finish, and their importers are current again
+		for (uint32_t i = import_depth; i < vm->import_stack.count; i++) {
+			Value module;
+			if (table_get(&vm->module_cache, vm->import_stack.paths[i], &module)) {
+				AS_CRUX_MODULE_RECORD(module)->state = STATE_ERROR;
+			}
+		}
+		vm->import_stack.count = import_depth;
+		vm->current_module_record = script_module_record;
+		vm->current_coroutine = NULL;
+		vm->reentry_depth = 0;
+		vm->yield_requested = false;
+		release_preloaded_sources(&vm->module_preload);
 
 		// restore previous jump buffer
 
@@ -1481,7 +1733,9 @@ InterpretResult interpret(VM *vm, char *source)
 	}
 	vm->main_compiler = compiler;
 
+	preload_import_graph(vm, vm->current_module_record->path->chars, source);
 	ObjectFunction *function = compile(vm, compiler, NULL, source);
+	release_preloaded_sources(&vm->module_preload);
 
 	free(compiler);
 	vm->main_compiler = NULL;
@@ -1493,20 +1747,22 @@ InterpretResult interpret(VM *vm, char *source)
 		return INTERPRET_COMPILE_ERROR;
 	}
 
+
 	ObjectModuleRecord *current_module_record = vm->current_module_record;
 
-	// allocate module globals array
+	// allocate module globals array. Quickened instructions point into it, so the REPL, whose lines keep declaring
+	// globals, gets room for every index a global instruction can address
 	if (current_module_record->global_count > 0 && current_module_record->globals == NULL) {
-		current_module_record->globals = realloc(current_module_record->globals,
-												 sizeof(Value) * current_module_record->global_count);
+		const uint32_t capacity = current_module_record->is_repl ? UINT16_MAX + 1 : current_module_record->global_count;
+		current_module_record->globals = malloc(sizeof(Value) * capacity);
 	}
 
-	push(current_module_record, OBJECT_VAL(function));
+	push(vm, OBJECT_VAL(function));
 	ObjectClosure *closure = new_closure(vm, function);
 	vm->current_module_record->module_closure = closure;
-	pop(current_module_record);
-	push(current_module_record, OBJECT_VAL(closure));
-	call(current_module_record, closure, 0);
+	pop(vm);
+	push(vm, OBJECT_VAL(closure));
+	call(vm, closure, 0);
 
 	const InterpretResult result = run(vm, false);
 
@@ -1516,41 +1772,34 @@ InterpretResult interpret(VM *vm, char *source)
 	return result;
 }
 
-/**
- *
- * @param vm
- * @param closure The closure to be executed. The caller must ensure that the
- * arguments are on the stack correctly and match the arity
- * @param arg_count
- * @param result result from executing the function
- * @return
- */
-ObjectResult *execute_callable(VM *vm, const Value callable, const int arg_count, InterpretResult *result)
+InterpretResult call_from_native(VM *vm, const Value callable, const int arg_count, Value *result_out)
 {
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	const uint32_t currentFrameCount = current_module_record->frame_count;
-	ObjectResult *errorResult = new_error_result(vm, new_error(vm, copy_string(vm, "", 0), RUNTIME, true));
+	// an offset, since the callee may grow the stack and move it
+	const ptrdiff_t callee_slot = vm->stack_top - arg_count - 1 - vm->stack;
+	const uint32_t current_frame_count = vm->frame_count;
 
+	// every level nests run() on the C stack, which would overflow long before the frame limit is reached
+	if (vm->reentry_depth >= MAX_REENTRY_DEPTH) {
+		runtime_panic(vm, STACK_OVERFLOW, "Stack overflow");
+		return INTERPRET_RUNTIME_ERROR;
+	}
+	vm->reentry_depth++;
 	if (!call_value(vm, callable, arg_count)) {
-		*result = INTERPRET_RUNTIME_ERROR;
-		return errorResult;
+		vm->reentry_depth--;
+		vm->stack_top = vm->stack + callee_slot;
+		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	if (current_module_record->frame_count > currentFrameCount) {
-		*result = run(vm, true);
-		vm->current_module_record->frame_count = currentFrameCount;
-	} else {
-		*result = INTERPRET_OK;
+	InterpretResult result = INTERPRET_OK;
+	if (vm->frame_count > current_frame_count) {
+		result = run(vm, true);
+		vm->frame_count = current_frame_count;
 	}
+	vm->reentry_depth--;
 
-	if (*result == INTERPRET_OK) {
-		const Value executionResult = PEEK(current_module_record, 0);
-		if (IS_CRUX_ERROR(executionResult)) {
-			return new_error_result(vm, AS_CRUX_ERROR(executionResult));
-		}
-		return new_ok_result(vm, executionResult);
-	}
-	return errorResult;
+	*result_out = result == INTERPRET_OK ? PEEK(vm, 0) : NIL_VAL;
+	vm->stack_top = vm->stack + callee_slot;
+	return result;
 }
 
 Value typeof_value(VM *vm, const Value value)
@@ -1560,7 +1809,7 @@ Value typeof_value(VM *vm, const Value value)
 	return OBJECT_VAL(copy_string(vm, buffer, (uint32_t)strlen(buffer)));
 }
 
-bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *target, const Value operand,
+bool handle_compound_assignment(VM *vm, Value *target, const Value operand,
 								const OpCode op)
 {
 	const bool currentIsInt = IS_INT(*target);
@@ -1574,7 +1823,7 @@ bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *
 	}
 
 	if (!((currentIsInt || currentIsFloat) && (operandIsInt || operandIsFloat))) {
-		runtime_panic(currentModuleRecord, TYPE, "Operands must be numbers.");
+		runtime_panic(vm, TYPE, "Operands must be numbers.");
 		return false;
 	}
 
@@ -1609,7 +1858,7 @@ bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *
 		case OP_SET_UPVALUE_SLASH:
 		case OP_SET_GLOBAL_SLASH:
 			if (b == 0) {
-				runtime_panic(currentModuleRecord, MATH, "Division by zero.");
+				runtime_panic(vm, MATH, "Division by zero.");
 				return false;
 			}
 			result = FLOAT_VAL((double)a / (double)b);
@@ -1618,7 +1867,7 @@ bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *
 		case OP_SET_UPVALUE_INT_DIVIDE:
 		case OP_SET_GLOBAL_INT_DIVIDE:
 			if (b == 0) {
-				runtime_panic(currentModuleRecord, MATH, "Integer division by zero.");
+				runtime_panic(vm, MATH, "Integer division by zero.");
 				return false;
 			}
 			result = (a == INT32_MIN && b == -1) ? FLOAT_VAL(-(double)INT32_MIN) : INT_VAL(a / b);
@@ -1627,7 +1876,7 @@ bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *
 		case OP_SET_UPVALUE_MODULUS:
 		case OP_SET_GLOBAL_MODULUS:
 			if (b == 0) {
-				runtime_panic(currentModuleRecord, MATH, "Modulo by zero.");
+				runtime_panic(vm, MATH, "Modulo by zero.");
 				return false;
 			}
 			result = (a == INT32_MIN && b == -1) ? INT_VAL(0) : INT_VAL(a % b);
@@ -1660,13 +1909,13 @@ bool handle_compound_assignment(ObjectModuleRecord *currentModuleRecord, Value *
 		case OP_SET_UPVALUE_SLASH:
 		case OP_SET_GLOBAL_SLASH:
 			if (b == 0.0) {
-				runtime_panic(currentModuleRecord, MATH, "Division by zero.");
+				runtime_panic(vm, MATH, "Division by zero.");
 				return false;
 			}
 			result = FLOAT_VAL(a / b);
 			break;
 		default:
-			runtime_panic(currentModuleRecord, TYPE, "Integer operations require integer operands.");
+			runtime_panic(vm, TYPE, "Integer operations require integer operands.");
 			return false;
 		}
 	}
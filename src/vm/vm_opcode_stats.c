@@ -0,0 +1,153 @@
+#include "opcode_stats.h"
+
+#ifdef OPCODE_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "debug.h"
+
+typedef struct {
+	uint16_t first;
+	uint16_t second;
+	uint64_t count;
+} OpcodePair;
+
+OpcodeStats *new_opcode_stats(void)
+{
+	return calloc(1, sizeof(OpcodeStats));
+}
+
+uint64_t opcode_stats_now_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (counter.QuadPart * 1000000000LL) / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void record_native_call(OpcodeStats *stats, const ObjectNativeCallable *native, const uint64_t elapsed_ns)
+{
+	// a few hundred natives at most, and the recently used ones are found first
+	for (uint32_t i = stats->native_count; i > 0; i--) {
+		NativeCallStats *entry = &stats->natives[i - 1];
+		if (entry->native == native) {
+			entry->calls++;
+			entry->total_ns += elapsed_ns;
+			return;
+		}
+	}
+
+	if (stats->native_count == stats->native_capacity) {
+		const uint32_t new_capacity = stats->native_capacity < 32 ? 32 : stats->native_capacity * 2;
+		NativeCallStats *natives = realloc(stats->natives, sizeof(NativeCallStats) * new_capacity);
+		if (natives == NULL) {
+			return;
+		}
+		stats->natives = natives;
+		stats->native_capacity = new_capacity;
+	}
+	stats->natives[stats->native_count++] = (NativeCallStats){.native = native, .calls = 1, .total_ns = elapsed_ns};
+}
+
+static int compare_pairs(const void *a, const void *b)
+{
+	const uint64_t left = ((const OpcodePair *)a)->count;
+	const uint64_t right = ((const OpcodePair *)b)->count;
+	return left < right ? 1 : left > right ? -1 : 0;
+}
+
+static int compare_natives(const void *a, const void *b)
+{
+	const uint64_t left = ((const NativeCallStats *)a)->total_ns;
+	const uint64_t right = ((const NativeCallStats *)b)->total_ns;
+	return left < right ? 1 : left > right ? -1 : 0;
+}
+
+void dump_opcode_stats(OpcodeStats *stats)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	const char *path = getenv("CRUX_OPCODE_STATS_FILE");
+	if (path == NULL || path[0] == '\0') {
+		path = "crux-opcode-stats.json";
+	}
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Could not write opcode statistics to \"%s\".\n", path);
+		free(stats->natives);
+		free(stats);
+		return;
+	}
+
+	uint64_t total = 0;
+	for (int i = 0; i < OP_COUNT; i++) {
+		total += stats->counts[i];
+	}
+
+	fprintf(file, "{\n  \"total_instructions\": %llu,\n  \"opcodes\": {", (unsigned long long)total);
+	bool first = true;
+	for (int i = 0; i < OP_COUNT; i++) {
+		if (stats->counts[i] == 0) {
+			continue;
+		}
+		fprintf(file, "%s\n    \"%s\": %llu", first ? "" : ",", opcode_name(i),
+				(unsigned long long)stats->counts[i]);
+		first = false;
+	}
+	fprintf(file, "\n  },\n  \"pairs\": [");
+
+	uint32_t pair_count = 0;
+	for (int i = 0; i < OP_COUNT; i++) {
+		for (int j = 0; j < OP_COUNT; j++) {
+			pair_count += stats->pairs[i][j] != 0;
+		}
+	}
+	OpcodePair *pairs = malloc(sizeof(OpcodePair) * (pair_count > 0 ? pair_count : 1));
+	if (pairs != NULL) {
+		uint32_t index = 0;
+		for (int i = 0; i < OP_COUNT; i++) {
+			for (int j = 0; j < OP_COUNT; j++) {
+				if (stats->pairs[i][j] != 0) {
+					pairs[index++] = (OpcodePair){.first = (uint16_t)i, .second = (uint16_t)j, .count = stats->pairs[i][j]};
+				}
+			}
+		}
+		qsort(pairs, pair_count, sizeof(OpcodePair), compare_pairs);
+		for (uint32_t i = 0; i < pair_count; i++) {
+			fprintf(file, "%s\n    {\"first\": \"%s\", \"second\": \"%s\", \"count\": %llu}", i == 0 ? "" : ",",
+					opcode_name(pairs[i].first), opcode_name(pairs[i].second), (unsigned long long)pairs[i].count);
+		}
+		free(pairs);
+	}
+	fprintf(file, "\n  ],\n  \"natives\": [");
+
+	qsort(stats->natives, stats->native_count, sizeof(NativeCallStats), compare_natives);
+	for (uint32_t i = 0; i < stats->native_count; i++) {
+		const NativeCallStats *entry = &stats->natives[i];
+		fprintf(file, "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"total_ns\": %llu}", i == 0 ? "" : ",",
+				entry->native->name != NULL ? entry->native->name->chars : "<native>",
+				(unsigned long long)entry->calls, (unsigned long long)entry->total_ns);
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+
+	free(stats->natives);
+	free(stats);
+}
+
+#endif // OPCODE_STATS
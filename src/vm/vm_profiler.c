@@ -0,0 +1,588 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+#endif
+
+#include "garbage_collector.h"
+#include "object.h"
+#include "profiler.h"
+#include "vm.h"
+
+#define PROFILER_MAX_DEPTH 128
+
+/**
+ * A line inside a function. Locations are numbered from 1, as pprof expects.
+ */
+typedef struct {
+	ObjectFunction *function;
+	int line;
+} ProfileLocation;
+
+/**
+ * A distinct call stack, stored leaf first.
+ */
+typedef struct {
+	uint32_t *locations;
+	uint32_t depth;
+	uint32_t hash;
+	uint64_t samples;
+	uint64_t cpu_ns;
+} ProfileStack;
+
+/**
+ * Open addressing index from a hash to the 1-based position of an entry, 0 marks an empty slot.
+ */
+typedef struct {
+	uint32_t *slots;
+	uint32_t capacity;
+} ProfileIndex;
+
+struct SamplingProfiler {
+	ProfileLocation *locations;
+	uint32_t location_count;
+	uint32_t location_capacity;
+	ProfileIndex location_index;
+
+	ProfileStack *stacks;
+	uint32_t stack_count;
+	uint32_t stack_capacity;
+	ProfileIndex stack_index;
+
+	int hz;
+	uint64_t start_time_ns;
+	uint64_t start_clock_ns;
+	uint64_t last_cpu_ns; // timer expiries are coalesced, so samples are weighted by the CPU time they cover
+};
+
+static uint64_t profiler_now_ns(const clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t hash_location(const ObjectFunction *function, const int line)
+{
+	uint64_t key = (uint64_t)(uintptr_t)function ^ ((uint64_t)(uint32_t)line * 0x9E3779B97F4A7C15ULL);
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return (uint32_t)key;
+}
+
+static uint32_t hash_stack(const uint32_t *locations, const uint32_t depth)
+{
+	uint32_t hash = 2166136261u;
+	for (uint32_t i = 0; i < depth; i++) {
+		hash ^= locations[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+/**
+ * Grows the index so it stays at most half full. <hash_of> gives the hash of the entry at a 0-based position.
+ */
+static bool grow_index(ProfileIndex *index, const uint32_t entry_count, const SamplingProfiler *profiler,
+					   uint32_t (*hash_of)(const SamplingProfiler *, uint32_t))
+{
+	if ((entry_count + 1) * 2 <= index->capacity) {
+		return true;
+	}
+	const uint32_t new_capacity = index->capacity < 64 ? 64 : index->capacity * 2;
+	uint32_t *slots = calloc(new_capacity, sizeof(uint32_t));
+	if (slots == NULL) {
+		return false;
+	}
+	for (uint32_t i = 0; i < entry_count; i++) {
+		uint32_t slot = hash_of(profiler, i) & (new_capacity - 1);
+		while (slots[slot] != 0) {
+			slot = (slot + 1) & (new_capacity - 1);
+		}
+		slots[slot] = i + 1;
+	}
+	free(index->slots);
+	index->slots = slots;
+	index->capacity = new_capacity;
+	return true;
+}
+
+static uint32_t location_hash_of(const SamplingProfiler *profiler, const uint32_t position)
+{
+	const ProfileLocation *location = &profiler->locations[position];
+	return hash_location(location->function, location->line);
+}
+
+static uint32_t stack_hash_of(const SamplingProfiler *profiler, const uint32_t position)
+{
+	return profiler->stacks[position].hash;
+}
+
+/**
+ * @return The 1-based id of the location, or 0 if it could not be stored
+ */
+static uint32_t intern_location(SamplingProfiler *profiler, ObjectFunction *function, const int line)
+{
+	if (!grow_index(&profiler->location_index, profiler->location_count, profiler, location_hash_of)) {
+		return 0;
+	}
+	const uint32_t mask = profiler->location_index.capacity - 1;
+	uint32_t slot = hash_location(function, line) & mask;
+	for (;;) {
+		const uint32_t id = profiler->location_index.slots[slot];
+		if (id == 0) {
+			break;
+		}
+		const ProfileLocation *location = &profiler->locations[id - 1];
+		if (location->function == function && location->line == line) {
+			return id;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (profiler->location_count == profiler->location_capacity) {
+		const uint32_t new_capacity = profiler->location_capacity < 64 ? 64 : profiler->location_capacity * 2;
+		ProfileLocation *locations = realloc(profiler->locations, sizeof(ProfileLocation) * new_capacity);
+		if (locations == NULL) {
+			return 0;
+		}
+		profiler->locations = locations;
+		profiler->location_capacity = new_capacity;
+	}
+	profiler->locations[profiler->location_count++] = (ProfileLocation){.function = function, .line = line};
+	profiler->location_index.slots[slot] = profiler->location_count;
+	return profiler->location_count;
+}
+
+static void add_stack_sample(SamplingProfiler *profiler, const uint32_t *locations, const uint32_t depth,
+							 const uint64_t cpu_ns)
+{
+	if (!grow_index(&profiler->stack_index, profiler->stack_count, profiler, stack_hash_of)) {
+		return;
+	}
+	const uint32_t hash = hash_stack(locations, depth);
+	const uint32_t mask = profiler->stack_index.capacity - 1;
+	uint32_t slot = hash & mask;
+	for (;;) {
+		const uint32_t id = profiler->stack_index.slots[slot];
+		if (id == 0) {
+			break;
+		}
+		ProfileStack *stack = &profiler->stacks[id - 1];
+		if (stack->hash == hash && stack->depth == depth &&
+			memcmp(stack->locations, locations, sizeof(uint32_t) * depth) == 0) {
+			stack->samples++;
+			stack->cpu_ns += cpu_ns;
+			return;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (profiler->stack_count == profiler->stack_capacity) {
+		const uint32_t new_capacity = profiler->stack_capacity < 64 ? 64 : profiler->stack_capacity * 2;
+		ProfileStack *stacks = realloc(profiler->stacks, sizeof(ProfileStack) * new_capacity);
+		if (stacks == NULL) {
+			return;
+		}
+		profiler->stacks = stacks;
+		profiler->stack_capacity = new_capacity;
+	}
+	uint32_t *copy = malloc(sizeof(uint32_t) * depth);
+	if (copy == NULL) {
+		return;
+	}
+	memcpy(copy, locations, sizeof(uint32_t) * depth);
+	profiler->stacks[profiler->stack_count++] =
+		(ProfileStack){.locations = copy, .depth = depth, .hash = hash, .samples = 1, .cpu_ns = cpu_ns};
+	profiler->stack_index.slots[slot] = profiler->stack_count;
+}
+
+int call_frame_line(const CallFrame *frame)
+{
+	const ObjectFunction *function = frame->closure->function;
+	if (function->chunk.lines == NULL || function->chunk.count == 0) {
+		return 0;
+	}
+	size_t instruction = 0;
+	if (frame->ip > function->chunk.threaded) {
+		instruction = (size_t)(frame->ip - function->chunk.threaded - 1);
+	}
+	if (instruction >= (size_t)function->chunk.count) {
+		instruction = (size_t)function->chunk.count - 1;
+	}
+	return function->chunk.lines[instruction];
+}
+
+void profiler_record_sample(VM *vm)
+{
+	vm->profile_ticks = 0;
+
+	SamplingProfiler *profiler = vm->profiler;
+	if (profiler == NULL) {
+		return;
+	}
+	const uint64_t cpu_now_ns = profiler_now_ns(CLOCK_PROCESS_CPUTIME_ID);
+	const uint64_t cpu_ns = cpu_now_ns - profiler->last_cpu_ns;
+	profiler->last_cpu_ns = cpu_now_ns;
+
+	uint32_t locations[PROFILER_MAX_DEPTH];
+	uint32_t depth = 0;
+
+	for (int i = (int)vm->frame_count - 1; i >= 0 && depth < PROFILER_MAX_DEPTH; i--) {
+		const CallFrame *frame = &vm->frames[i];
+		const uint32_t id = intern_location(profiler, frame->closure->function, call_frame_line(frame));
+		if (id != 0) {
+			locations[depth++] = id;
+		}
+	}
+
+	if (depth > 0) {
+		add_stack_sample(profiler, locations, depth, cpu_ns);
+	}
+}
+
+void mark_profiler_roots(VM *vm)
+{
+	const SamplingProfiler *profiler = vm->profiler;
+	if (profiler == NULL) {
+		return;
+	}
+	for (uint32_t i = 0; i < profiler->location_count; i++) {
+		mark_object(vm, (CruxObject *)profiler->locations[i].function);
+	}
+}
+
+static void free_profiler(SamplingProfiler *profiler)
+{
+	for (uint32_t i = 0; i < profiler->stack_count; i++) {
+		free(profiler->stacks[i].locations);
+	}
+	free(profiler->stacks);
+	free(profiler->stack_index.slots);
+	free(profiler->locations);
+	free(profiler->location_index.slots);
+	free(profiler);
+}
+
+static const char *function_name(const ObjectFunction *function)
+{
+	if (function->name == NULL || function->name->byte_length == 0) {
+		return "<script>";
+	}
+	return function->name->chars;
+}
+
+static const char *function_file(const ObjectFunction *function)
+{
+	if (function->module_record != NULL && function->module_record->path != NULL) {
+		return function->module_record->path->chars;
+	}
+	return "<unknown>";
+}
+
+static bool write_folded(const SamplingProfiler *profiler, const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	for (uint32_t i = 0; i < profiler->stack_count; i++) {
+		const ProfileStack *stack = &profiler->stacks[i];
+		for (uint32_t j = stack->depth; j > 0; j--) {
+			const ProfileLocation *location = &profiler->locations[stack->locations[j - 1] - 1];
+			fprintf(file, "%s%s (%s:%d)", j == stack->depth ? "" : ";", function_name(location->function),
+					function_file(location->function), location->line);
+		}
+		fprintf(file, " %llu\n", (unsigned long long)(stack->cpu_ns / 1000));
+	}
+	return fclose(file) == 0;
+}
+
+// Minimal protocol buffer writer for profile.proto
+
+typedef struct {
+	uint8_t *bytes;
+	size_t count;
+	size_t capacity;
+	bool failed;
+} ProtoBuffer;
+
+enum { PROTO_VARINT = 0, PROTO_LENGTH_DELIMITED = 2 };
+
+static void proto_append(ProtoBuffer *buffer, const void *bytes, const size_t length)
+{
+	if (buffer->failed) {
+		return;
+	}
+	if (buffer->count + length > buffer->capacity) {
+		size_t new_capacity = buffer->capacity < 256 ? 256 : buffer->capacity;
+		while (new_capacity < buffer->count + length) {
+			new_capacity *= 2;
+		}
+		uint8_t *grown = realloc(buffer->bytes, new_capacity);
+		if (grown == NULL) {
+			buffer->failed = true;
+			return;
+		}
+		buffer->bytes = grown;
+		buffer->capacity = new_capacity;
+	}
+	memcpy(buffer->bytes + buffer->count, bytes, length);
+	buffer->count += length;
+}
+
+static void proto_varint(ProtoBuffer *buffer, uint64_t value)
+{
+	uint8_t bytes[10];
+	size_t length = 0;
+	do {
+		bytes[length] = value & 0x7F;
+		value >>= 7;
+		if (value != 0) {
+			bytes[length] |= 0x80;
+		}
+		length++;
+	} while (value != 0);
+	proto_append(buffer, bytes, length);
+}
+
+static void proto_uint(ProtoBuffer *buffer, const uint32_t field, const uint64_t value)
+{
+	proto_varint(buffer, (uint64_t)field << 3 | PROTO_VARINT);
+	proto_varint(buffer, value);
+}
+
+static void proto_bytes(ProtoBuffer *buffer, const uint32_t field, const void *bytes, const size_t length)
+{
+	proto_varint(buffer, (uint64_t)field << 3 | PROTO_LENGTH_DELIMITED);
+	proto_varint(buffer, length);
+	proto_append(buffer, bytes, length);
+}
+
+/**
+ * Appends <message> as a length delimited field and resets it for reuse.
+ */
+static void proto_message(ProtoBuffer *buffer, const uint32_t field, ProtoBuffer *message)
+{
+	if (message->failed) {
+		buffer->failed = true;
+	}
+	proto_bytes(buffer, field, message->bytes, message->count);
+	message->count = 0;
+}
+
+static void proto_string(ProtoBuffer *buffer, const char *string)
+{
+	proto_bytes(buffer, 6, string, strlen(string));
+}
+
+static void proto_value_type(ProtoBuffer *buffer, ProtoBuffer *scratch, const uint32_t field, const uint64_t type,
+							 const uint64_t unit)
+{
+	proto_uint(scratch, 1, type);
+	proto_uint(scratch, 2, unit);
+	proto_message(buffer, field, scratch);
+}
+
+static bool write_pprof(const SamplingProfiler *profiler, const char *path, const uint64_t duration_ns)
+{
+	// fixed strings come first in the string table, then a name and a file name per function
+	enum { STR_EMPTY, STR_SAMPLES, STR_COUNT, STR_CPU, STR_NANOSECONDS, STR_FIRST_FUNCTION };
+	const uint64_t period_ns = 1000000000ULL / (uint64_t)profiler->hz;
+
+	ProtoBuffer profile = {0};
+	ProtoBuffer message = {0};
+	ProtoBuffer nested = {0};
+
+	proto_value_type(&profile, &message, 1, STR_SAMPLES, STR_COUNT);
+	proto_value_type(&profile, &message, 1, STR_CPU, STR_NANOSECONDS);
+
+	for (uint32_t i = 0; i < profiler->stack_count; i++) {
+		const ProfileStack *stack = &profiler->stacks[i];
+		for (uint32_t j = 0; j < stack->depth; j++) {
+			proto_varint(&nested, stack->locations[j]);
+		}
+		proto_message(&message, 1, &nested);
+		proto_varint(&nested, stack->samples);
+		proto_varint(&nested, stack->cpu_ns);
+		proto_message(&message, 2, &nested);
+		proto_message(&profile, 2, &message);
+	}
+
+	// every location gets its own function entry, the string table keeps them apart by name and file
+	for (uint32_t i = 0; i < profiler->location_count; i++) {
+		const uint32_t id = i + 1;
+		proto_uint(&nested, 1, id);
+		proto_uint(&nested, 2, (uint64_t)(profiler->locations[i].line < 0 ? 0 : profiler->locations[i].line));
+		proto_uint(&message, 1, id);
+		proto_message(&message, 4, &nested);
+		proto_message(&profile, 4, &message);
+	}
+	for (uint32_t i = 0; i < profiler->location_count; i++) {
+		const uint32_t id = i + 1;
+		const uint64_t name = STR_FIRST_FUNCTION + 2 * (uint64_t)i;
+		proto_uint(&message, 1, id);
+		proto_uint(&message, 2, name);
+		proto_uint(&message, 3, name);
+		proto_uint(&message, 4, name + 1);
+		proto_message(&profile, 5, &message);
+	}
+
+	proto_string(&profile, "");
+	proto_string(&profile, "samples");
+	proto_string(&profile, "count");
+	proto_string(&profile, "cpu");
+	proto_string(&profile, "nanoseconds");
+	for (uint32_t i = 0; i < profiler->location_count; i++) {
+		proto_string(&profile, function_name(profiler->locations[i].function));
+		proto_string(&profile, function_file(profiler->locations[i].function));
+	}
+
+	proto_uint(&profile, 9, profiler->start_time_ns);
+	proto_uint(&profile, 10, duration_ns);
+	proto_value_type(&profile, &message, 11, STR_CPU, STR_NANOSECONDS);
+	proto_uint(&profile, 12, period_ns);
+
+	bool written = false;
+	if (!profile.failed && !message.failed && !nested.failed) {
+		FILE *file = fopen(path, "wb");
+		if (file != NULL) {
+			written = fwrite(profile.bytes, 1, profile.count, file) == profile.count;
+			written = fclose(file) == 0 && written;
+		}
+	}
+	free(profile.bytes);
+	free(message.bytes);
+	free(nested.bytes);
+	return written;
+}
+
+#ifndef _WIN32
+// SIGPROF is delivered to the process, so only one VM (isolate) can be profiled at a time
+static _Atomic(VM *) profiled_vm = NULL;
+static struct sigaction previous_action;
+
+static void profiler_signal_handler(const int signal)
+{
+	(void)signal;
+	VM *vm = atomic_load(&profiled_vm);
+	if (vm != NULL) {
+		vm->profile_ticks++;
+	}
+}
+#endif
+
+bool profiler_start(VM *vm, const int hz, const char **error_out)
+{
+#ifdef _WIN32
+	(void)vm;
+	(void)hz;
+	*error_out = "The sampling profiler is not supported on Windows.";
+	return false;
+#else
+	if (hz <= 0 || hz > 1000000) {
+		*error_out = "Sampling frequency must be between 1 and 1000000 Hz.";
+		return false;
+	}
+	VM *no_vm = NULL;
+	if (vm->profiler != NULL || !atomic_compare_exchange_strong(&profiled_vm, &no_vm, vm)) {
+		*error_out = "The profiler is already running.";
+		return false;
+	}
+
+	SamplingProfiler *profiler = calloc(1, sizeof(SamplingProfiler));
+	if (profiler == NULL) {
+		atomic_store(&profiled_vm, NULL);
+		*error_out = "Failed to allocate memory for the profiler.";
+		return false;
+	}
+	profiler->hz = hz;
+	profiler->start_time_ns = profiler_now_ns(CLOCK_REALTIME);
+	profiler->start_clock_ns = profiler_now_ns(CLOCK_MONOTONIC);
+	profiler->last_cpu_ns = profiler_now_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+	vm->profile_ticks = 0;
+	vm->profiler = profiler;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = profiler_signal_handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+
+	const long interval_us = hz >= 1000000 ? 1 : 1000000L / hz;
+	struct itimerval timer;
+	timer.it_interval.tv_sec = interval_us / 1000000L;
+	timer.it_interval.tv_usec = interval_us % 1000000L;
+	timer.it_value = timer.it_interval;
+
+	if (sigaction(SIGPROF, &action, &previous_action) != 0) {
+		vm->profiler = NULL;
+		atomic_store(&profiled_vm, NULL);
+		free_profiler(profiler);
+		*error_out = "Failed to install the profiling signal handler.";
+		return false;
+	}
+	if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+		sigaction(SIGPROF, &previous_action, NULL);
+		vm->profiler = NULL;
+		atomic_store(&profiled_vm, NULL);
+		free_profiler(profiler);
+		*error_out = "Failed to start the profiling timer.";
+		return false;
+	}
+	return true;
+#endif
+}
+
+bool profiler_stop(VM *vm, const char *prefix, const char **error_out)
+{
+	SamplingProfiler *profiler = vm->profiler;
+	if (profiler == NULL) {
+		*error_out = "The profiler is not running.";
+		return false;
+	}
+
+#ifndef _WIN32
+	const struct itimerval stopped = {0};
+	setitimer(ITIMER_PROF, &stopped, NULL);
+	sigaction(SIGPROF, &previous_action, NULL);
+	atomic_store(&profiled_vm, NULL);
+#endif
+	vm->profile_ticks = 0;
+	vm->profiler = NULL;
+
+	bool written = true;
+	if (prefix != NULL) {
+		const uint64_t duration_ns = profiler_now_ns(CLOCK_MONOTONIC) - profiler->start_clock_ns;
+		const size_t prefix_length = strlen(prefix);
+		char *path = malloc(prefix_length + sizeof(".folded"));
+		if (path == NULL) {
+			*error_out = "Failed to allocate memory for the profile path.";
+			written = false;
+		} else {
+			memcpy(path, prefix, prefix_length);
+			memcpy(path + prefix_length, ".folded", sizeof(".folded"));
+			if (!write_folded(profiler, path)) {
+				*error_out = "Failed to write the folded stack profile.";
+				written = false;
+			}
+			memcpy(path + prefix_length, ".pprof", sizeof(".pprof"));
+			if (written && !write_pprof(profiler, path, duration_ns)) {
+				*error_out = "Failed to write the pprof profile.";
+				written = false;
+			}
+			free(path);
+		}
+	}
+
+	free_profiler(profiler);
+	return written;
+}
@@ -1,9 +1,11 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "chunk.h"
 #include "file_handler.h"
+#include "function_stats.h"
 #include "garbage_collector.h"
 #include "stdlib/stdlib.h"
 #include "type_system.h"
@@ -15,34 +17,167 @@
 
 #include "debug.h"
 #include "object.h"
+#include "opcode_stats.h"
 #include "panic.h"
+#include "profiler.h"
 #include "stdlib/complex.h"
 #include "stdlib/matrix.h"
 #include "stdlib/range.h"
 #include "stdlib/set.h"
 
 #ifdef DEBUG_TRACE_EXECUTION
-#define DISPATCH() goto *dispatchTable[endIndex]
-#else
+#define DISPATCH() goto end
+#elif defined(OPCODE_STATS)
 #define DISPATCH()                                                                                                     \
-	instruction = READ_SHORT();                                                                                        \
-	goto *dispatchTable[instruction]
+	record_opcode(vm->opcode_stats, frame->ip->operand);                                                               \
+	goto *(frame->ip++)->handler
+#else
+#define DISPATCH() goto *(frame->ip++)->handler
 #endif
 
+/**
+ * Makes the instruction that is being executed, whose operands start at <frame>->ip, run <new_handler> from now on.
+ */
+#define QUICKEN(new_handler) (frame->ip[-1].handler = (new_handler))
+
+/**
+ * Specializes a generic binary instruction on its first execution for the operand types it sees: two Ints, two
+ * Floats, or anything else, which keeps the generic handler for good.
+ */
+#define QUICKEN_BINARY(int_handler, float_handler, generic_handler)                                                    \
+	do {                                                                                                               \
+		const Value quick_b = PEEK(vm, 0);                                                                             \
+		const Value quick_a = PEEK(vm, 1);                                                                             \
+		if (IS_INT(quick_a) && IS_INT(quick_b)) {                                                                      \
+			QUICKEN(&&int_handler);                                                                                    \
+			goto int_handler;                                                                                          \
+		}                                                                                                              \
+		if (IS_FLOAT(quick_a) && IS_FLOAT(quick_b)) {                                                                  \
+			QUICKEN(&&float_handler);                                                                                  \
+			goto float_handler;                                                                                        \
+		}                                                                                                              \
+		QUICKEN(&&generic_handler);                                                                                    \
+		goto generic_handler;                                                                                          \
+	} while (0)
+
+/**
+ * The body of a specialized instruction: runs <fast_handler> while both operands pass <check>, and otherwise falls
+ * back to <generic_handler> for good.
+ */
+#define GUARD_BINARY(check, fast_handler, generic_handler)                                                             \
+	do {                                                                                                               \
+		if (check(PEEK(vm, 0)) && check(PEEK(vm, 1))) {                                                                \
+			goto fast_handler;                                                                                         \
+		}                                                                                                              \
+		QUICKEN(&&generic_handler);                                                                                    \
+		goto generic_handler;                                                                                          \
+	} while (0)
+
+#define QUICK_COMPARISON(check, unbox, operator, generic_handler)                                                      \
+	do {                                                                                                               \
+		const Value b = PEEK(vm, 0);                                                                                   \
+		const Value a = PEEK(vm, 1);                                                                                   \
+		if (!check(a) || !check(b)) {                                                                                  \
+			QUICKEN(&&generic_handler);                                                                                \
+			goto generic_handler;                                                                                      \
+		}                                                                                                              \
+		vm->stack_top--;                                                                                               \
+		vm->stack_top[-1] = BOOL_VAL(unbox(a) operator unbox(b));                                                      \
+		DISPATCH();                                                                                                    \
+	} while (0)
+
+// the handler of every opcode, published by run() because label addresses are only visible inside it
+static void **opcode_handlers = NULL;
+
+ThreadedWord *translate_chunk(Chunk *chunk)
+{
+	void **handlers = __atomic_load_n(&opcode_handlers, __ATOMIC_ACQUIRE);
+	if (handlers == NULL) {
+		run(NULL, false);
+		handlers = __atomic_load_n(&opcode_handlers, __ATOMIC_ACQUIRE);
+	}
+
+	ThreadedWord *threaded = malloc(sizeof(ThreadedWord) * (size_t)(chunk->count > 0 ? chunk->count : 1));
+	if (threaded == NULL) {
+		return NULL;
+	}
+	for (int i = 0; i < chunk->count; i++) {
+		const uint16_t word = chunk->code[i];
+		threaded[i].handler = word < OP_COUNT ? handlers[word] : NULL;
+		threaded[i].constant = word < chunk->constants.count ? chunk->constants.values[word] : NIL_VAL;
+		threaded[i].operand = word;
+	}
+	chunk->threaded = threaded;
+	return threaded;
+}
+
+/**
+ * Returns the object a typed Vector operation writes its result to: an operand the compiler flagged as an unshared
+ * temporary, or a new vector. A reused operand always has the result's dimensions.
+ */
+static ObjectVector *vector_result(VM *vm, const Value *operands, const uint16_t reuse, const uint32_t dimensions)
+{
+	if (reuse & REUSE_LEFT_OPERAND) {
+		return AS_CRUX_VECTOR(operands[0]);
+	}
+	if (reuse & REUSE_RIGHT_OPERAND) {
+		return AS_CRUX_VECTOR(operands[1]);
+	}
+	return new_vector(vm, dimensions);
+}
+
+static ObjectComplex *complex_result_target(const Value *operands, const uint16_t reuse)
+{
+	if (reuse & REUSE_LEFT_OPERAND) {
+		return AS_CRUX_COMPLEX(operands[0]);
+	}
+	if (reuse & REUSE_RIGHT_OPERAND) {
+		return AS_CRUX_COMPLEX(operands[1]);
+	}
+	return NULL;
+}
+
+/**
+ * Pushes the closure of <function> for OP_CLOSURE and OP_ANON_FUNCTION, reading its capture operands from <frame>.
+ */
+static void push_closure(VM *vm, CallFrame *frame, ObjectFunction *function)
+{
+	if (function->upvalue_count == 0) {
+		// closures without upvalues cannot differ, so one is shared by every evaluation
+		if (function->shared_closure == NULL) {
+			function->shared_closure = new_closure(vm, function);
+		}
+		push(vm, OBJECT_VAL(function->shared_closure));
+		return;
+	}
+	ObjectClosure *closure = new_closure(vm, function);
+	push(vm, OBJECT_VAL(closure));
+
+	for (int i = 0; i < closure->upvalue_count; i++) {
+		const uint16_t capture = (frame->ip++)->operand;
+		const uint16_t index = (frame->ip++)->operand;
+
+		if (capture == CAPTURE_LOCAL) {
+			closure->upvalues[i] = capture_upvalue(vm, frame->slots + index);
+		} else if (capture == CAPTURE_LOCAL_VALUE) {
+			closure->upvalues[i] = new_closed_upvalue(vm, frame->slots[index]);
+		} else {
+			closure->upvalues[i] = frame->closure->upvalues[index];
+		}
+	}
+}
+
 /**
  * Executes bytecode in the virtual machine.
  * @param vm The virtual machine
- * @param is_anonymous_frame Is this frame anonymous? (should this frame return
- * from run() at OP_RETURN?)
+ * @param is_anonymous_frame Is this frame anonymous? (should run() return once the
+ * current frame has returned, instead of continuing with its caller?)
  * @return The interpretation result
  */
 InterpretResult run(VM *vm, const bool is_anonymous_frame)
 {
-	register ObjectModuleRecord *current_module_record = vm->current_module_record;
-	register CallFrame *frame = &current_module_record->frames[current_module_record->frame_count - 1];
-
-#define READ_SHORT() (*frame->ip++)
-#define READ_CONSTANT() (frame->closure->function->chunk.constants.values[READ_SHORT()])
+#define READ_SHORT() ((frame->ip++)->operand)
+#define READ_CONSTANT() ((frame->ip++)->constant)
 #define READ_STRING() AS_CRUX_STRING(READ_CONSTANT())
 
 	static void *dispatchTable[] = {&&OP_RETURN,
@@ -204,114 +339,160 @@ InterpretResult run(VM *vm, const bool is_anonymous_frame)
 									&&OP_0_FLOAT,
 									&&OP_1_FLOAT,
 									&&OP_2_FLOAT,
+									&&OP_YIELD,
+									&&OP_NEW_STRUCT,
+									&&OP_TAIL_CALL,
 									&&end};
+	_Static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == OP_COUNT + 1, "dispatchTable must cover every opcode");
+
+	// called without a VM by translate_chunk(), which needs the handlers before anything runs
+	if (vm == NULL) {
+		__atomic_store_n(&opcode_handlers, dispatchTable, __ATOMIC_RELEASE);
+		return INTERPRET_OK;
+	}
+
+	register CallFrame *frame = &vm->frames[vm->frame_count - 1];
+	// calls made by the anonymous frame itself return into this loop, so only its own return ends it
+	const uint32_t exit_frame_count = is_anonymous_frame ? vm->frame_count - 1U : 0U;
 
-	register uint16_t instruction;
-#ifdef DEBUG_TRACE_EXECUTION
-	static uint16_t endIndex = sizeof(dispatchTable) / sizeof(dispatchTable[0]) - 1;
-#endif
 	DISPATCH();
 OP_RETURN: {
-	Value result = pop(current_module_record);
-	close_upvalues(current_module_record, frame->slots);
-	current_module_record->frame_count--;
-	if (current_module_record->frame_count == 0) {
-		pop(current_module_record);
+	Value result = pop(vm);
+	close_upvalues(vm, frame->slots);
+	if (__builtin_expect(vm->function_stats.enabled, 0)) {
+		exit_function_stats(vm);
+	}
+	vm->frame_count--;
+	if (vm->frame_count == 0) {
+		pop(vm);
+		if (vm->current_coroutine != NULL) {
+			vm->current_coroutine->transfer = result;
+		}
 		return INTERPRET_OK;
 	}
-	current_module_record->stack_top = frame->slots;
-	push(current_module_record, result);
-	frame = &current_module_record->frames[current_module_record->frame_count - 1];
+	vm->stack_top = frame->slots;
+	push(vm, result);
+	frame = &vm->frames[vm->frame_count - 1];
 
-	if (is_anonymous_frame)
+	if (is_anonymous_frame && vm->frame_count == exit_frame_count)
 		return INTERPRET_OK;
 	DISPATCH();
 }
 
 OP_CONSTANT: {
 	Value constant = READ_CONSTANT();
-	push(current_module_record, constant);
+	push(vm, constant);
 	DISPATCH();
 }
 
 OP_NIL: {
-	push(current_module_record, NIL_VAL);
+	push(vm, NIL_VAL);
 	DISPATCH();
 }
 
 OP_TRUE: {
-	push(current_module_record, BOOL_VAL(true));
+	push(vm, BOOL_VAL(true));
 	DISPATCH();
 }
 
 OP_FALSE: {
-	push(current_module_record, BOOL_VAL(false));
+	push(vm, BOOL_VAL(false));
 	DISPATCH();
 }
 
 OP_NEGATE: {
-	Value operand = PEEK(current_module_record, 0);
+	Value operand = PEEK(vm, 0);
 	if (IS_INT(operand)) {
 		int32_t iVal = AS_INT(operand);
 		if (iVal == INT32_MIN) {
-			pop_push(current_module_record, FLOAT_VAL(-(double)INT32_MIN));
+			pop_push(vm, FLOAT_VAL(-(double)INT32_MIN));
 		} else {
-			pop_push(current_module_record, INT_VAL(-iVal));
+			pop_push(vm, INT_VAL(-iVal));
 		}
 	} else if (IS_FLOAT(operand)) {
-		pop_push(current_module_record, FLOAT_VAL(-AS_FLOAT(operand)));
+		pop_push(vm, FLOAT_VAL(-AS_FLOAT(operand)));
 	} else {
-		pop(current_module_record);
-		runtime_panic(current_module_record, TYPE, type_error_message(vm, operand, "int' | 'float"));
+		pop(vm);
+		runtime_panic(vm, TYPE, type_error_message(vm, operand, "int' | 'float"));
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
 }
 
 OP_EQUAL: {
-	Value b = pop(current_module_record);
-	Value a = pop(current_module_record);
-	push(current_module_record, BOOL_VAL(values_equal(a, b)));
+	Value b = pop(vm);
+	Value a = pop(vm);
+	push(vm, BOOL_VAL(values_equal(a, b)));
 	DISPATCH();
 }
 
-OP_GREATER: {
+OP_GREATER:
+	QUICKEN_BINARY(QUICK_GREATER_INT, QUICK_GREATER_FLOAT, GREATER_GENERIC);
+GREATER_GENERIC: {
 	if (!binary_operation(vm, OP_GREATER)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
 }
+QUICK_GREATER_INT:
+	QUICK_COMPARISON(IS_INT, AS_INT, >, GREATER_GENERIC);
+QUICK_GREATER_FLOAT:
+	QUICK_COMPARISON(IS_FLOAT, AS_FLOAT, >, GREATER_GENERIC);
 
-OP_LESS: {
+OP_LESS:
+	QUICKEN_BINARY(QUICK_LESS_INT, QUICK_LESS_FLOAT, LESS_GENERIC);
+LESS_GENERIC: {
 	if (!binary_operation(vm, OP_LESS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
 }
+QUICK_LESS_INT:
+	QUICK_COMPARISON(IS_INT, AS_INT, <, LESS_GENERIC);
+QUICK_LESS_FLOAT:
+	QUICK_COMPARISON(IS_FLOAT, AS_FLOAT, <, LESS_GENERIC);
 
-OP_LESS_EQUAL: {
+OP_LESS_EQUAL:
+	QUICKEN_BINARY(QUICK_LESS_EQUAL_INT, QUICK_LESS_EQUAL_FLOAT, LESS_EQUAL_GENERIC);
+LESS_EQUAL_GENERIC: {
 	if (!binary_operation(vm, OP_LESS_EQUAL)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
 }
+QUICK_LESS_EQUAL_INT:
+	QUICK_COMPARISON(IS_INT, AS_INT, <=, LESS_EQUAL_GENERIC);
+QUICK_LESS_EQUAL_FLOAT:
+	QUICK_COMPARISON(IS_FLOAT, AS_FLOAT, <=, LESS_EQUAL_GENERIC);
 
-OP_GREATER_EQUAL: {
+OP_GREATER_EQUAL:
+	QUICKEN_BINARY(QUICK_GREATER_EQUAL_INT, QUICK_GREATER_EQUAL_FLOAT, GREATER_EQUAL_GENERIC);
+GREATER_EQUAL_GENERIC: {
 	if (!binary_operation(vm, OP_GREATER_EQUAL)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
 }
+QUICK_GREATER_EQUAL_INT:
+	QUICK_COMPARISON(IS_INT, AS_INT, >=, GREATER_EQUAL_GENERIC);
+QUICK_GREATER_EQUAL_FLOAT:
+	QUICK_COMPARISON(IS_FLOAT, AS_FLOAT, >=, GREATER_EQUAL_GENERIC);
 
 OP_NOT_EQUAL: {
-	Value b = pop(current_module_record);
-	Value a = pop(current_module_record);
-	push(current_module_record, BOOL_VAL(!values_equal(a, b)));
+	Value b = pop(vm);
+	Value a = pop(vm);
+	push(vm, BOOL_VAL(!values_equal(a, b)));
 	DISPATCH();
 }
 
-OP_ADD: {
-	if (IS_CRUX_STRING(PEEK(current_module_record, 0)) && IS_CRUX_STRING(PEEK(current_module_record, 1))) {
+OP_ADD:
+	QUICKEN_BINARY(QUICK_ADD_INT, QUICK_ADD_FLOAT, ADD_GENERIC);
+QUICK_ADD_INT:
+	GUARD_BINARY(IS_INT, OP_ADD_INT, ADD_GENERIC);
+QUICK_ADD_FLOAT:
+	GUARD_BINARY(IS_FLOAT, OP_ADD_NUM, ADD_GENERIC);
+ADD_GENERIC: {
+	if (IS_CRUX_STRING(PEEK(vm, 0)) && IS_CRUX_STRING(PEEK(vm, 1))) {
 		if (!concatenate(vm)) {
 			return INTERPRET_RUNTIME_ERROR;
 		}
@@ -324,18 +505,30 @@ OP_ADD: {
 }
 
 OP_NOT: {
-	push(current_module_record, BOOL_VAL(is_falsy(pop(current_module_record))));
+	push(vm, BOOL_VAL(is_falsy(pop(vm))));
 	DISPATCH();
 }
 
-OP_SUBTRACT: {
+OP_SUBTRACT:
+	QUICKEN_BINARY(QUICK_SUBTRACT_INT, QUICK_SUBTRACT_FLOAT, SUBTRACT_GENERIC);
+QUICK_SUBTRACT_INT:
+	GUARD_BINARY(IS_INT, OP_SUBTRACT_INT, SUBTRACT_GENERIC);
+QUICK_SUBTRACT_FLOAT:
+	GUARD_BINARY(IS_FLOAT, OP_SUBTRACT_NUM, SUBTRACT_GENERIC);
+SUBTRACT_GENERIC: {
 	if (!binary_operation(vm, OP_SUBTRACT)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
 }
 
-OP_MULTIPLY: {
+OP_MULTIPLY:
+	QUICKEN_BINARY(QUICK_MULTIPLY_INT, QUICK_MULTIPLY_FLOAT, MULTIPLY_GENERIC);
+QUICK_MULTIPLY_INT:
+	GUARD_BINARY(IS_INT, OP_MULTIPLY_INT, MULTIPLY_GENERIC);
+QUICK_MULTIPLY_FLOAT:
+	GUARD_BINARY(IS_FLOAT, OP_MULTIPLY_NUM, MULTIPLY_GENERIC);
+MULTIPLY_GENERIC: {
 	if (!binary_operation(vm, OP_MULTIPLY)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
@@ -350,7 +543,7 @@ OP_DIVIDE: {
 }
 
 OP_POP: {
-	pop(current_module_record);
+	pop(vm);
 	DISPATCH();
 }
 
@@ -358,69 +551,76 @@ OP_POP: {
 OP_DEFINE_GLOBAL: {
 	uint16_t index = READ_SHORT();
 	ObjectModuleRecord *frame_module_record = frame->closure->function->module_record;
-	frame_module_record->globals[index] = PEEK(current_module_record, 0);
-	pop(current_module_record);
+	frame_module_record->globals[index] = PEEK(vm, 0);
+	pop(vm);
 	DISPATCH();
 }
 
+// the globals of a module are allocated before its code runs and never move, so the slot is resolved once
 OP_GET_GLOBAL: {
-	uint16_t index = READ_SHORT();
 	ObjectModuleRecord *frame_module_record = frame->closure->function->module_record;
-	Value value = frame_module_record->globals[index];
-	push(current_module_record, value);
+	frame->ip->global = &frame_module_record->globals[frame->ip->operand];
+	QUICKEN(&&QUICK_GET_GLOBAL);
+}
+QUICK_GET_GLOBAL: {
+	push(vm, *(frame->ip++)->global);
 	DISPATCH();
 }
 
 OP_SET_GLOBAL: {
-	uint16_t index = READ_SHORT();
 	ObjectModuleRecord *frame_module_record = frame->closure->function->module_record;
-	frame_module_record->globals[index] = PEEK(current_module_record, 0);
+	frame->ip->global = &frame_module_record->globals[frame->ip->operand];
+	QUICKEN(&&QUICK_SET_GLOBAL);
+}
+QUICK_SET_GLOBAL: {
+	*(frame->ip++)->global = PEEK(vm, 0);
 	DISPATCH();
 }
 
 OP_GET_LOCAL: {
 	uint16_t slot = READ_SHORT();
-	push(current_module_record, frame->slots[slot]);
+	push(vm, frame->slots[slot]);
 	DISPATCH();
 }
 
 OP_SET_LOCAL: {
 	uint16_t slot = READ_SHORT();
-	frame->slots[slot] = PEEK(current_module_record, 0);
+	frame->slots[slot] = PEEK(vm, 0);
 	DISPATCH();
 }
 
 OP_ITER_INIT: {
-	const Value iterable = PEEK(current_module_record, 0);
+	const Value iterable = PEEK(vm, 0);
 	Value iterator;
 	if (!get_iterator_from_value(vm, iterable, &iterator)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	current_module_record->stack_top[-1] = iterator;
+	vm->stack_top[-1] = iterator;
+	// an __iter method may have grown the frame array
+	frame = &vm->frames[vm->frame_count - 1];
 	DISPATCH();
 }
 
 OP_ITER_NEXT: {
 	uint16_t offset = READ_SHORT();
-	Value option;
-	if (!get_next_option_from_iterator(vm, PEEK(current_module_record, 0), &option)) {
-		return INTERPRET_RUNTIME_ERROR;
-	}
-
-	ObjectOption *next_option = AS_CRUX_OPTION(option);
-	if (!next_option->is_some) {
-		pop(current_module_record);
+	// elements are handed over directly, without wrapping each one in an Option
+	Value next_value;
+	const bool has_value = next_iterator_value(vm, PEEK(vm, 0), &next_value);
+	// the iterator may call functions, which can grow the frame array
+	frame = &vm->frames[vm->frame_count - 1];
+	if (!has_value) {
+		pop(vm);
 		frame->ip += offset; // jump to after the loop
 		DISPATCH();
 	}
 
-	current_module_record->stack_top[-1] = next_option->value; // set the value to the next item
+	vm->stack_top[-1] = next_value; // set the value to the next item
 	DISPATCH();
 }
 
 OP_JUMP_IF_FALSE: {
 	uint16_t offset = READ_SHORT();
-	if (is_falsy(PEEK(current_module_record, 0))) {
+	if (is_falsy(PEEK(vm, 0))) {
 		frame->ip += offset;
 		DISPATCH();
 	}
@@ -436,58 +636,95 @@ OP_JUMP: {
 OP_LOOP: {
 	uint16_t offset = READ_SHORT();
 	frame->ip -= offset;
+	if (__builtin_expect(vm->profile_ticks, 0)) {
+		profiler_record_sample(vm);
+	}
 	DISPATCH();
 }
 
 OP_CALL: {
 	int arg_count = READ_SHORT();
-	if (!call_value(vm, PEEK(current_module_record, arg_count), arg_count)) {
+	const Value callee = PEEK(vm, arg_count);
+	if (IS_CRUX_NATIVE_CALLABLE(callee) && frame->ip->operand == OP_UNWRAP) {
+		// the result is unwrapped right away, so the native does not have to box it
+		if (!call_native(vm, AS_CRUX_NATIVE_CALLABLE(callee), arg_count, true)) {
+			return INTERPRET_RUNTIME_ERROR;
+		}
+		// the native may have called functions that grew the frame array
+		frame = &vm->frames[vm->frame_count - 1];
+		// a suspended task resumes at OP_UNWRAP, which unwraps the Result the task is resumed with
+		if (!vm->yield_requested) {
+			frame->ip++;
+		}
+	} else if (!call_value(vm, callee, arg_count)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	frame = &current_module_record->frames[current_module_record->frame_count - 1];
+	if (__builtin_expect(vm->yield_requested, 0)) {
+		vm->yield_requested = false;
+		return INTERPRET_YIELD;
+	}
+	frame = &vm->frames[vm->frame_count - 1];
+	if (__builtin_expect(vm->profile_ticks, 0)) {
+		profiler_record_sample(vm);
+	}
 	DISPATCH();
 }
 
-OP_CLOSURE: {
-	ObjectFunction *function = AS_CRUX_FUNCTION(READ_CONSTANT());
-	ObjectClosure *closure = new_closure(vm, function);
-	push(current_module_record, OBJECT_VAL(closure));
-
-	for (int i = 0; i < closure->upvalue_count; i++) {
-		uint16_t isLocal = READ_SHORT();
-		uint16_t index = READ_SHORT();
+// followed by OP_RETURN, which returns the result when the call cannot reuse the frame
+OP_TAIL_CALL: {
+	const int arg_count = frame->ip->operand;
+	const Value callee = PEEK(vm, arg_count);
+	if (!IS_CRUX_CLOSURE(callee) || vm->function_stats.enabled) {
+		goto OP_CALL;
+	}
+	ObjectClosure *closure = AS_CRUX_CLOSURE(callee);
+	if (closure->function->arity != arg_count || closure->function->is_generator) {
+		goto OP_CALL;
+	}
+	ThreadedWord *code = threaded_code(&closure->function->chunk);
+	if (code == NULL || !reserve_frame_stack(vm, closure->function)) {
+		goto OP_CALL;
+	}
 
-		if (isLocal) {
-			closure->upvalues[i] = capture_upvalue(vm, frame->slots + index);
-		} else {
-			closure->upvalues[i] = frame->closure->upvalues[index];
-		}
+	// the callee and its arguments replace this frame's slots, so its locals must not be referenced anymore
+	close_upvalues(vm, frame->slots);
+	memmove(frame->slots, vm->stack_top - arg_count - 1, sizeof(Value) * (size_t)(arg_count + 1));
+	vm->stack_top = frame->slots + arg_count + 1;
+	frame->closure = closure;
+	frame->ip = code;
+	if (__builtin_expect(vm->profile_ticks, 0)) {
+		profiler_record_sample(vm);
 	}
 	DISPATCH();
 }
 
+OP_CLOSURE: {
+	push_closure(vm, frame, AS_CRUX_FUNCTION(READ_CONSTANT()));
+	DISPATCH();
+}
+
 OP_GET_UPVALUE: {
 	uint16_t slot = READ_SHORT();
-	push(current_module_record, *frame->closure->upvalues[slot]->location);
+	push(vm, *frame->closure->upvalues[slot]->location);
 	DISPATCH();
 }
 
 OP_SET_UPVALUE: {
 	uint16_t slot = READ_SHORT();
-	*frame->closure->upvalues[slot]->location = PEEK(current_module_record, 0);
+	*frame->closure->upvalues[slot]->location = PEEK(vm, 0);
 	DISPATCH();
 }
 
 OP_CLOSE_UPVALUE: {
-	close_upvalues(current_module_record, current_module_record->stack_top - 1);
-	pop(current_module_record);
+	close_upvalues(vm, vm->stack_top - 1);
+	pop(vm);
 	DISPATCH();
 }
 
 OP_GET_PROPERTY: {
-	Value receiver = pop(current_module_record);
+	Value receiver = pop(vm);
 	if (!IS_CRUX_STRUCT_INSTANCE(receiver)) {
-		runtime_panic(current_module_record, TYPE, "Cannot get property on non 'struct instance' type.");
+		runtime_panic(vm, TYPE, "Cannot get property on non 'struct instance' type.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -497,22 +734,22 @@ OP_GET_PROPERTY: {
 
 	Value indexValue;
 	if (!table_get(&structType->fields, name, &indexValue)) {
-		runtime_panic(current_module_record, NAME, "Property '%s' does not exist on struct '%s'.", name->chars,
+		runtime_panic(vm, NAME, "Property '%s' does not exist on struct '%s'.", name->chars,
 					  structType->name->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	push(current_module_record, instance->fields[(uint16_t)AS_INT(indexValue)]);
+	push(vm, instance->fields[(uint16_t)AS_INT(indexValue)]);
 	DISPATCH();
 }
 
 OP_SET_PROPERTY: {
-	Value valueToSet = pop(current_module_record);
-	Value receiver = pop(current_module_record);
+	Value valueToSet = pop(vm);
+	Value receiver = pop(vm);
 
 	if (!IS_CRUX_STRUCT_INSTANCE(receiver)) {
 		ObjectString *name = READ_STRING();
-		runtime_panic(current_module_record, TYPE,
+		runtime_panic(vm, TYPE,
 					  "Cannot set property '%s' on non struct instance "
 					  "value. %s",
 					  name->chars, type_error_message(vm, receiver, "struct instance"));
@@ -525,13 +762,13 @@ OP_SET_PROPERTY: {
 
 	Value indexValue;
 	if (!table_get(&structType->fields, name, &indexValue)) {
-		runtime_panic(current_module_record, NAME, "Property '%s' does not exist on struct '%s'.", name->chars,
+		runtime_panic(vm, NAME, "Property '%s' does not exist on struct '%s'.", name->chars,
 					  structType->name->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
 	instance->fields[(uint16_t)AS_INT(indexValue)] = valueToSet;
-	push(current_module_record, valueToSet);
+	push(vm, valueToSet);
 
 	DISPATCH();
 }
@@ -542,7 +779,7 @@ OP_INVOKE: {
 	if (!invoke(vm, methodName, arg_count)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	frame = &current_module_record->frames[current_module_record->frame_count - 1];
+	frame = &vm->frames[vm->frame_count - 1];
 	DISPATCH();
 }
 
@@ -550,30 +787,30 @@ OP_ARRAY: {
 	uint16_t elementCount = READ_SHORT();
 	ObjectArray *array = new_array(vm, elementCount);
 	for (int i = elementCount - 1; i >= 0; i--) {
-		array_add(vm, array, pop(current_module_record), i);
+		array_add(vm, array, pop(vm), i);
 	}
-	push(current_module_record, OBJECT_VAL(array));
+	push(vm, OBJECT_VAL(array));
 	DISPATCH();
 }
 
 OP_GET_COLLECTION: {
-	Value indexValue = pop(current_module_record);
-	if (!IS_CRUX_OBJECT(PEEK(current_module_record, 0))) {
-		runtime_panic(current_module_record, TYPE, "Cannot get from a non-collection type.");
+	Value indexValue = pop(vm);
+	if (!IS_CRUX_OBJECT(PEEK(vm, 0))) {
+		runtime_panic(vm, TYPE, "Cannot get from a non-collection type.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	switch (object_get_type(AS_CRUX_OBJECT(PEEK(current_module_record, 0)))) {
+	switch (object_get_type(AS_CRUX_OBJECT(PEEK(vm, 0)))) {
 	case OBJECT_TABLE: {
 		if (IS_CRUX_HASHABLE(indexValue)) {
-			ObjectTable *table = AS_CRUX_TABLE(PEEK(current_module_record, 0));
+			ObjectTable *table = AS_CRUX_TABLE(PEEK(vm, 0));
 			Value value;
 			if (!object_table_get(table->entries, table->size, table->capacity, indexValue, &value)) {
-				runtime_panic(current_module_record, COLLECTION_GET, "Failed to get value from table");
+				runtime_panic(vm, COLLECTION_GET, "Failed to get value from table");
 				return INTERPRET_RUNTIME_ERROR;
 			}
-			pop_push(current_module_record, value);
+			pop_push(vm, value);
 		} else {
-			runtime_panic(current_module_record, TYPE, "Key cannot be hashed.", READ_STRING());
+			runtime_panic(vm, TYPE, "Key cannot be hashed.", READ_STRING());
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		DISPATCH();
@@ -582,78 +819,78 @@ OP_GET_COLLECTION: {
 		if (!IS_INT(indexValue)) {
 			char buf[64];
 			type_mask_name(get_type_mask(indexValue), buf, sizeof(buf));
-			runtime_panic(current_module_record, TYPE,
+			runtime_panic(vm, TYPE,
 						  "Index must be of type 'Int' but "
 						  "got type '%s'.",
 						  buf);
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		uint32_t index = (uint32_t)AS_INT(indexValue);
-		ObjectArray *array = AS_CRUX_ARRAY(PEEK(current_module_record, 0));
+		ObjectArray *array = AS_CRUX_ARRAY(PEEK(vm, 0));
 
 		if (index >= array->size) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
 		Value value = array->values[index];
 
-		pop_push(current_module_record,
+		pop_push(vm,
 				 value); // pop the array off the stack // push the
 						 // value onto the stack
 		DISPATCH();
 	}
 	case OBJECT_STRING: {
 		if (!IS_INT(indexValue)) {
-			runtime_panic(current_module_record, TYPE, "Index must be of type 'int'.");
+			runtime_panic(vm, TYPE, "Index must be of type 'int'.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		uint32_t index = (uint32_t)AS_INT(indexValue);
-		ObjectString *string = AS_CRUX_STRING(PEEK(current_module_record, 0));
+		ObjectString *string = AS_CRUX_STRING(PEEK(vm, 0));
 		ObjectString *ch;
 		if (index >= string->code_point_length) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		// Only single character indexing
 		ch = copy_string(vm, string->chars + index, 1);
-		pop_push(current_module_record,
+		pop_push(vm,
 				 OBJECT_VAL(ch)); // pop the string off the stack, push the character onto the stack
 		DISPATCH();
 	}
 	case OBJECT_TUPLE: {
 		if (!IS_INT(indexValue)) {
-			runtime_panic(current_module_record, TYPE, "Index must be of type 'int'.");
+			runtime_panic(vm, TYPE, "Index must be of type 'int'.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		uint32_t index = (uint32_t)AS_INT(indexValue);
-		ObjectTuple *tuple = AS_CRUX_TUPLE(PEEK(current_module_record, 0));
+		ObjectTuple *tuple = AS_CRUX_TUPLE(PEEK(vm, 0));
 		if (index >= tuple->size) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		Value value = tuple->elements[index];
-		pop_push(current_module_record, value); // pop the tuple off the stack, push the value onto the stack
+		pop_push(vm, value); // pop the tuple off the stack, push the value onto the stack
 		DISPATCH();
 	}
 	case OBJECT_BUFFER: {
 		if (!IS_INT(indexValue)) {
-			runtime_panic(current_module_record, TYPE, "Index must be of type 'int'.");
+			runtime_panic(vm, TYPE, "Index must be of type 'int'.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		uint32_t index = (uint32_t)AS_INT(indexValue);
-		ObjectBuffer *buffer = AS_CRUX_BUFFER(PEEK(current_module_record, 0));
+		ObjectBuffer *buffer = AS_CRUX_BUFFER(PEEK(vm, 0));
 		if (index >= (buffer->write_pos - buffer->read_pos)) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		Value value = AS_INT(buffer->data[index + buffer->read_pos]);
-		pop_push(current_module_record, value); // pop the buffer off the stack, push the value onto the stack
+		pop_push(vm, value); // pop the buffer off the stack, push the value onto the stack
 		DISPATCH();
 	}
 
 	default: {
-		runtime_panic(current_module_record, TYPE, "Cannot get from a non-collection type.");
+		runtime_panic(vm, TYPE, "Cannot get from a non-collection type.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	}
@@ -661,20 +898,20 @@ OP_GET_COLLECTION: {
 }
 
 OP_SET_COLLECTION: {
-	Value value = pop(current_module_record);
-	Value indexValue = PEEK(current_module_record, 0);
-	Value collection = PEEK(current_module_record, 1);
+	Value value = pop(vm);
+	Value indexValue = PEEK(vm, 0);
+	Value collection = PEEK(vm, 1);
 
 	switch (object_get_type(AS_CRUX_OBJECT(collection))) {
 	case OBJECT_TABLE: {
 		ObjectTable *table = AS_CRUX_TABLE(collection);
 		if (IS_INT(indexValue) || IS_CRUX_STRING(indexValue)) {
 			if (!object_table_set(vm, table, indexValue, value)) {
-				runtime_panic(current_module_record, COLLECTION_GET, "Failed to set value in table");
+				runtime_panic(vm, COLLECTION_GET, "Failed to set value in table");
 				return INTERPRET_RUNTIME_ERROR;
 			}
 		} else {
-			runtime_panic(current_module_record, TYPE, "Key cannot be hashed.");
+			runtime_panic(vm, TYPE, "Key cannot be hashed.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		break;
@@ -684,19 +921,19 @@ OP_SET_COLLECTION: {
 		ObjectArray *array = AS_CRUX_ARRAY(collection);
 		int index = AS_INT(indexValue);
 		if (!array_set(vm, array, index, value)) {
-			runtime_panic(current_module_record, BOUNDS, "Cannot set a value in an empty array.");
+			runtime_panic(vm, BOUNDS, "Cannot set a value in an empty array.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		break;
 	}
 	default: {
-		runtime_panic(current_module_record, TYPE, "Value is not a mutable collection type.");
+		runtime_panic(vm, TYPE, "Value is not a mutable collection type.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	}
 
-	pop_two(current_module_record); // indexValue and collection
-	push(current_module_record, indexValue);
+	pop_two(vm); // indexValue and collection
+	push(vm, indexValue);
 	DISPATCH();
 }
 
@@ -724,7 +961,7 @@ OP_RIGHT_SHIFT: {
 OP_SET_LOCAL_SLASH: {
 	uint16_t slot = READ_SHORT();
 	Value currentValue = frame->slots[slot];
-	Value operandValue = PEEK(current_module_record, 0); // Right-hand side
+	Value operandValue = PEEK(vm, 0); // Right-hand side
 
 	bool currentIsInt = IS_INT(currentValue);
 	bool currentIsFloat = IS_FLOAT(currentValue);
@@ -732,7 +969,7 @@ OP_SET_LOCAL_SLASH: {
 	bool operandIsFloat = IS_FLOAT(operandValue);
 
 	if (!((currentIsInt || currentIsFloat) && (operandIsInt || operandIsFloat))) {
-		runtime_panic(current_module_record, TYPE, "Operands for '/=' must be numbers.");
+		runtime_panic(vm, TYPE, "Operands for '/=' must be numbers.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -742,7 +979,7 @@ OP_SET_LOCAL_SLASH: {
 	double doperand = operandIsFloat ? AS_FLOAT(operandValue) : (double)AS_INT(operandValue);
 
 	if (doperand == 0.0) {
-		runtime_panic(current_module_record, MATH, "Division by zero in '/=' assignment.");
+		runtime_panic(vm, MATH, "Division by zero in '/=' assignment.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -754,7 +991,7 @@ OP_SET_LOCAL_SLASH: {
 OP_SET_LOCAL_STAR: {
 	uint16_t slot = READ_SHORT();
 	Value currentValue = frame->slots[slot];
-	Value operandValue = PEEK(current_module_record, 0);
+	Value operandValue = PEEK(vm, 0);
 
 	bool currentIsInt = IS_INT(currentValue);
 	bool currentIsFloat = IS_FLOAT(currentValue);
@@ -762,7 +999,7 @@ OP_SET_LOCAL_STAR: {
 	bool operandIsFloat = IS_FLOAT(operandValue);
 
 	if (!((currentIsInt || currentIsFloat) && (operandIsInt || operandIsFloat))) {
-		runtime_panic(current_module_record, TYPE, "Operands for '*=' must be numbers.");
+		runtime_panic(vm, TYPE, "Operands for '*=' must be numbers.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -789,7 +1026,7 @@ OP_SET_LOCAL_STAR: {
 
 OP_SET_LOCAL_PLUS: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, &frame->slots[slot], PEEK(current_module_record, 0),
+	if (!handle_compound_assignment(vm, &frame->slots[slot], PEEK(vm, 0),
 									OP_SET_LOCAL_PLUS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
@@ -798,7 +1035,7 @@ OP_SET_LOCAL_PLUS: {
 
 OP_SET_LOCAL_MINUS: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, &frame->slots[slot], PEEK(current_module_record, 0),
+	if (!handle_compound_assignment(vm, &frame->slots[slot], PEEK(vm, 0),
 									OP_SET_LOCAL_MINUS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
@@ -807,8 +1044,8 @@ OP_SET_LOCAL_MINUS: {
 
 OP_SET_UPVALUE_SLASH: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, frame->closure->upvalues[slot]->location,
-									PEEK(current_module_record, 0), OP_SET_UPVALUE_SLASH)) {
+	if (!handle_compound_assignment(vm, frame->closure->upvalues[slot]->location,
+									PEEK(vm, 0), OP_SET_UPVALUE_SLASH)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -816,8 +1053,8 @@ OP_SET_UPVALUE_SLASH: {
 
 OP_SET_UPVALUE_STAR: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, frame->closure->upvalues[slot]->location,
-									PEEK(current_module_record, 0), OP_SET_UPVALUE_STAR)) {
+	if (!handle_compound_assignment(vm, frame->closure->upvalues[slot]->location,
+									PEEK(vm, 0), OP_SET_UPVALUE_STAR)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -825,8 +1062,8 @@ OP_SET_UPVALUE_STAR: {
 
 OP_SET_UPVALUE_PLUS: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, frame->closure->upvalues[slot]->location,
-									PEEK(current_module_record, 0), OP_SET_UPVALUE_PLUS)) {
+	if (!handle_compound_assignment(vm, frame->closure->upvalues[slot]->location,
+									PEEK(vm, 0), OP_SET_UPVALUE_PLUS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -834,8 +1071,8 @@ OP_SET_UPVALUE_PLUS: {
 
 OP_SET_UPVALUE_MINUS: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, frame->closure->upvalues[slot]->location,
-									PEEK(current_module_record, 0), OP_SET_UPVALUE_MINUS)) {
+	if (!handle_compound_assignment(vm, frame->closure->upvalues[slot]->location,
+									PEEK(vm, 0), OP_SET_UPVALUE_MINUS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -877,34 +1114,34 @@ OP_TABLE: {
 	uint16_t elementCount = READ_SHORT();
 	ObjectTable *table = new_object_table(vm, elementCount);
 	for (int i = elementCount - 1; i >= 0; i--) {
-		Value value = pop(current_module_record);
-		Value key = pop(current_module_record);
+		Value value = pop(vm);
+		Value key = pop(vm);
 		if (IS_CRUX_HASHABLE(key)) {
 			if (!object_table_set(vm, table, key, value)) {
-				runtime_panic(current_module_record, COLLECTION_SET, "Failed to set value in table.");
+				runtime_panic(vm, COLLECTION_SET, "Failed to set value in table.");
 				return INTERPRET_RUNTIME_ERROR;
 			}
 		} else {
-			runtime_panic(current_module_record, TYPE, "Key cannot be hashed.");
+			runtime_panic(vm, TYPE, "Key cannot be hashed.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 	}
-	push(current_module_record, OBJECT_VAL(table));
+	push(vm, OBJECT_VAL(table));
 	DISPATCH();
 }
 
 OP_SET: {
 	uint16_t elementCount = READ_SHORT();
 	ObjectSet *set = new_set(vm, elementCount);
-	push(current_module_record, OBJECT_VAL(set));
+	push(vm, OBJECT_VAL(set));
 	for (int i = elementCount - 1; i >= 0; i--) {
 		(void)i;
-		Value value = current_module_record->stack_top[-2];
-		current_module_record->stack_top[-2] = current_module_record->stack_top[-1];
-		current_module_record->stack_top--;
+		Value value = vm->stack_top[-2];
+		vm->stack_top[-2] = vm->stack_top[-1];
+		vm->stack_top--;
 		if (!set_add_value(vm, set, value)) {
-			pop(current_module_record); // set
-			runtime_panic(current_module_record, TYPE, "All set elements must be hashable.");
+			pop(vm); // set
+			runtime_panic(vm, TYPE, "All set elements must be hashable.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 	}
@@ -915,19 +1152,19 @@ OP_TUPLE: {
 	uint16_t elementCount = READ_SHORT();
 	ObjectTuple *tuple = new_tuple(vm, elementCount);
 	for (int i = elementCount - 1; i >= 0; i--) {
-		tuple->elements[i] = pop(current_module_record);
+		tuple->elements[i] = pop(vm);
 	}
-	push(current_module_record, OBJECT_VAL(tuple));
+	push(vm, OBJECT_VAL(tuple));
 	DISPATCH();
 }
 
 OP_RANGE: {
-	Value end_value = pop(current_module_record);
-	Value step_value = pop(current_module_record);
-	Value start_value = pop(current_module_record);
+	Value end_value = pop(vm);
+	Value step_value = pop(vm);
+	Value start_value = pop(vm);
 
 	if (!IS_INT(start_value) || !IS_INT(step_value) || !IS_INT(end_value)) {
-		runtime_panic(current_module_record, TYPE, "Range literal operands must be Int values.");
+		runtime_panic(vm, TYPE, "Range literal operands must be Int values.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -936,29 +1173,17 @@ OP_RANGE: {
 	int32_t end = AS_INT(end_value);
 	const char *error_message = NULL;
 	if (!validate_range_values(start, step, end, &error_message)) {
-		runtime_panic(current_module_record, VALUE, "%s", error_message);
+		runtime_panic(vm, VALUE, "%s", error_message);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
 	ObjectRange *range = new_range(vm, start, end, step);
-	push(current_module_record, OBJECT_VAL(range));
+	push(vm, OBJECT_VAL(range));
 	DISPATCH();
 }
 
 OP_ANON_FUNCTION: {
-	ObjectFunction *function = AS_CRUX_FUNCTION(READ_CONSTANT());
-	ObjectClosure *closure = new_closure(vm, function);
-	push(current_module_record, OBJECT_VAL(closure));
-	for (int i = 0; i < closure->upvalue_count; i++) {
-		uint16_t isLocal = READ_SHORT();
-		uint16_t index = READ_SHORT();
-
-		if (isLocal) {
-			closure->upvalues[i] = capture_upvalue(vm, frame->slots + index);
-		} else {
-			closure->upvalues[i] = frame->closure->upvalues[index];
-		}
-	}
+	push_closure(vm, frame, AS_CRUX_FUNCTION(READ_CONSTANT()));
 	DISPATCH();
 }
 
@@ -967,9 +1192,9 @@ OP_PUB: {
 }
 
 OP_MATCH: {
-	Value target = PEEK(current_module_record, 0);
+	Value target = PEEK(vm, 0);
 	if (vm->match_handler_stack.count >= vm->match_handler_stack.capacity) {
-		runtime_panic(current_module_record, RUNTIME, "Match nesting depth exceeded.");
+		runtime_panic(vm, RUNTIME, "Match nesting depth exceeded.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	vm->match_handler_stack.count++;
@@ -982,8 +1207,8 @@ OP_MATCH: {
 
 OP_MATCH_JUMP: {
 	uint16_t offset = READ_SHORT();
-	Value pattern = pop(current_module_record);
-	Value target = PEEK(current_module_record, 0);
+	Value pattern = pop(vm);
+	Value target = PEEK(vm, 0);
 	if (!values_equal(pattern, target)) {
 		frame->ip += offset;
 	}
@@ -1001,31 +1226,31 @@ OP_MATCH_END: {
 
 OP_RESULT_MATCH_OK: {
 	uint16_t offset = READ_SHORT();
-	Value target = PEEK(current_module_record, 0);
+	Value target = PEEK(vm, 0);
 	if (!IS_CRUX_RESULT(target) || !AS_CRUX_RESULT(target)->is_ok) {
 		frame->ip += offset;
 	} else {
 		Value value = AS_CRUX_RESULT(target)->as.value;
-		pop_push(current_module_record, value);
+		pop_push(vm, value);
 	}
 	DISPATCH();
 }
 
 OP_RESULT_MATCH_ERR: {
 	uint16_t offset = READ_SHORT();
-	Value target = PEEK(current_module_record, 0);
+	Value target = PEEK(vm, 0);
 	if (!IS_CRUX_RESULT(target) || AS_CRUX_RESULT(target)->is_ok) {
 		frame->ip += offset;
 	} else {
 		Value error = OBJECT_VAL(AS_CRUX_RESULT(target)->as.error);
-		pop_push(current_module_record, error);
+		pop_push(vm, error);
 	}
 	DISPATCH();
 }
 
 OP_RESULT_BIND: {
 	uint16_t slot = READ_SHORT();
-	Value bind = PEEK(current_module_record, 0);
+	Value bind = PEEK(vm, 0);
 	vm->match_handler_stack.handlers[vm->match_handler_stack.count - 1].match_bind = bind;
 	vm->match_handler_stack.handlers[vm->match_handler_stack.count - 1].is_match_bind = true;
 	frame->slots[slot] = bind;
@@ -1034,19 +1259,19 @@ OP_RESULT_BIND: {
 
 OP_OPTION_MATCH_SOME: {
 	uint16_t offset = READ_SHORT();
-	Value target = PEEK(current_module_record, 0);
+	Value target = PEEK(vm, 0);
 	if (!IS_CRUX_OPTION(target) || !AS_CRUX_OPTION(target)->is_some) {
 		frame->ip += offset;
 	} else {
 		Value value = AS_CRUX_OPTION(target)->value;
-		pop_push(current_module_record, value);
+		pop_push(vm, value);
 	}
 	DISPATCH();
 }
 
 OP_OPTION_MATCH_NONE: {
 	uint16_t offset = READ_SHORT();
-	Value target = PEEK(current_module_record, 0);
+	Value target = PEEK(vm, 0);
 	if (!IS_CRUX_OPTION(target) || AS_CRUX_OPTION(target)->is_some) {
 		frame->ip += offset;
 	}
@@ -1056,7 +1281,7 @@ OP_OPTION_MATCH_NONE: {
 OP_TYPE_MATCH: {
 	TypeMask expected = (TypeMask)READ_SHORT();
 	uint16_t offset = READ_SHORT();
-	Value target = PEEK(current_module_record, 0);
+	Value target = PEEK(vm, 0);
 	if (!runtime_types_compatible(expected, target)) {
 		frame->ip += offset;
 	}
@@ -1064,8 +1289,8 @@ OP_TYPE_MATCH: {
 }
 
 OP_GIVE: {
-	Value result = pop(current_module_record);
-	pop_push(current_module_record, result);
+	Value result = pop(vm);
+	pop_push(vm, result);
 	DISPATCH();
 }
 
@@ -1101,7 +1326,7 @@ OP_SET_GLOBAL_MODULUS: {
 
 OP_SET_LOCAL_INT_DIVIDE: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, &frame->slots[slot], PEEK(current_module_record, 0),
+	if (!handle_compound_assignment(vm, &frame->slots[slot], PEEK(vm, 0),
 									OP_SET_LOCAL_INT_DIVIDE)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
@@ -1109,7 +1334,7 @@ OP_SET_LOCAL_INT_DIVIDE: {
 }
 OP_SET_LOCAL_MODULUS: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, &frame->slots[slot], PEEK(current_module_record, 0),
+	if (!handle_compound_assignment(vm, &frame->slots[slot], PEEK(vm, 0),
 									OP_SET_LOCAL_MODULUS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
@@ -1118,8 +1343,8 @@ OP_SET_LOCAL_MODULUS: {
 
 OP_SET_UPVALUE_INT_DIVIDE: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, frame->closure->upvalues[slot]->location,
-									PEEK(current_module_record, 0), OP_SET_UPVALUE_INT_DIVIDE)) {
+	if (!handle_compound_assignment(vm, frame->closure->upvalues[slot]->location,
+									PEEK(vm, 0), OP_SET_UPVALUE_INT_DIVIDE)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -1127,8 +1352,8 @@ OP_SET_UPVALUE_INT_DIVIDE: {
 
 OP_SET_UPVALUE_MODULUS: {
 	uint16_t slot = READ_SHORT();
-	if (!handle_compound_assignment(current_module_record, frame->closure->upvalues[slot]->location,
-									PEEK(current_module_record, 0), OP_SET_UPVALUE_MODULUS)) {
+	if (!handle_compound_assignment(vm, frame->closure->upvalues[slot]->location,
+									PEEK(vm, 0), OP_SET_UPVALUE_MODULUS)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -1139,8 +1364,7 @@ OP_USE_MODULE: {
 	ObjectString *resolvedPath = READ_STRING();
 
 	if (is_in_import_stack(vm, resolvedPath)) {
-		runtime_panic(current_module_record, IMPORT, "Circular dependency detected when importing: %s",
-					  resolvedPath->chars);
+		runtime_panic(vm, IMPORT, "Circular dependency detected when importing: %s", resolvedPath->chars);
 		vm->current_module_record->state = STATE_ERROR;
 		return INTERPRET_RUNTIME_ERROR;
 	}
@@ -1148,54 +1372,54 @@ OP_USE_MODULE: {
 	Value cachedModule;
 	if (table_get(&vm->module_cache, resolvedPath, &cachedModule)) {
 		ObjectModuleRecord *module = AS_CRUX_MODULE_RECORD(cachedModule);
+		push(vm, OBJECT_VAL(module));
 
 		if (module->state == STATE_LOADED) {
 			push_import_stack(vm, resolvedPath);
-			ObjectModuleRecord *previousModuleRecord = vm->current_module_record;
-			vm->current_module_record = module;
 
 			// Allocate globals for the module
 			if (module->global_count > 0 && module->globals == NULL) {
 				module->globals = malloc(sizeof(Value) * module->global_count);
 			}
 
-			// Execute the module code
-			push(module, OBJECT_VAL(module->module_closure));
-			call(module, module->module_closure, 0);
-
-			InterpretResult result = run(vm, false);
-
-			vm->current_module_record = previousModuleRecord;
-			pop_import_stack(vm);
-
-			if (result != INTERPRET_OK) {
-				module->state = STATE_ERROR;
-				return result;
-			}
-			module->state = STATE_EXECUTED;
+			// the module's script runs on this stack like any call and returns into OP_FINISH_USE
+			push(vm, OBJECT_VAL(module->module_closure));
+			call(vm, module->module_closure, 0);
+			module->state = STATE_EXECUTING;
+			vm->current_module_record = module;
+			frame = &vm->frames[vm->frame_count - 1];
 		}
-		push(current_module_record, OBJECT_VAL(module));
 		DISPATCH();
 	}
 
 	// IF WE REACH HERE, IT MEANS THE COMPILER FAILED TO CACHE IT!
-	runtime_panic(current_module_record, RUNTIME, "FATAL: Module '%s' was not statically compiled!",
-				  resolvedPath->chars);
+	runtime_panic(vm, RUNTIME, "FATAL: Module '%s' was not statically compiled!", resolvedPath->chars);
 	return INTERPRET_RUNTIME_ERROR;
 }
 
 OP_FINISH_USE: {
 	uint16_t nameCount = READ_SHORT();
 
-	Value moduleValue = pop(current_module_record);
+	Value moduleValue = pop(vm);
+	if (!IS_CRUX_MODULE_RECORD(moduleValue)) {
+		// the module's script just ran and left its result above the module
+		moduleValue = pop(vm);
+	}
 	if (!IS_CRUX_MODULE_RECORD(moduleValue)) {
-		runtime_panic(current_module_record, RUNTIME, "Stack corrupted during import.");
+		runtime_panic(vm, RUNTIME, "Stack corrupted during import.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	ObjectModuleRecord *importedModule = AS_CRUX_MODULE_RECORD(moduleValue);
+	ObjectModuleRecord *importingModule = frame->closure->function->module_record;
+
+	if (importedModule->state == STATE_EXECUTING) {
+		importedModule->state = STATE_EXECUTED;
+		vm->current_module_record = importingModule;
+		pop_import_stack(vm);
+	}
 
 	if (importedModule->state == STATE_ERROR) {
-		runtime_panic(current_module_record, IMPORT, "Failed to import module from %s", importedModule->path->chars);
+		runtime_panic(vm, IMPORT, "Failed to import module from %s", importedModule->path->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -1206,15 +1430,15 @@ OP_FINISH_USE: {
 
 		Value value;
 		if (!table_get(&importedModule->publics, export_name, &value)) {
-			runtime_panic(current_module_record, IMPORT, "'%s' is not an exported name.", export_name->chars);
+			runtime_panic(vm, IMPORT, "'%s' is not an exported name.", export_name->chars);
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
 		// 0xFFFF is a sentinel - SKIP FOR LOCAL ASSIGNMENT
 		if (global_index == 0xFFFF) {
-			push(current_module_record, value);
+			push(vm, value);
 		} else {
-			current_module_record->globals[global_index] = value;
+			importingModule->globals[global_index] = value;
 		}
 	}
 
@@ -1225,26 +1449,26 @@ OP_FINISH_USE: {
 }
 
 OP_TYPEOF: {
-	Value value = PEEK(current_module_record, 0);
+	Value value = PEEK(vm, 0);
 	Value typeValue = typeof_value(vm, value);
-	pop(current_module_record);
-	push(current_module_record, typeValue);
+	pop(vm);
+	push(vm, typeValue);
 	DISPATCH();
 }
 
 OP_STRUCT: {
 	ObjectStruct *structObject = AS_CRUX_STRUCT(READ_CONSTANT());
-	push(current_module_record, OBJECT_VAL(structObject));
+	push(vm, OBJECT_VAL(structObject));
 	DISPATCH();
 }
 
 OP_STRUCT_INSTANCE_START: {
-	Value value = PEEK(current_module_record, 0);
+	Value value = PEEK(vm, 0);
 	ObjectStruct *objectStruct = AS_CRUX_STRUCT(value);
 	ObjectStructInstance *structInstance = new_struct_instance(vm, objectStruct, objectStruct->fields.count);
-	pop(current_module_record); // struct type
+	pop(vm); // struct type
 	if (!pushStructStack(vm, structInstance)) {
-		runtime_panic(current_module_record, RUNTIME, "Failed to push struct onto stack.");
+		runtime_panic(vm, RUNTIME, "Failed to push struct onto stack.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	DISPATCH();
@@ -1253,7 +1477,7 @@ OP_STRUCT_INSTANCE_START: {
 OP_STRUCT_NAMED_FIELD: {
 	ObjectStructInstance *structInstance = peek_struct_stack(vm);
 	if (structInstance == NULL) {
-		runtime_panic(current_module_record, RUNTIME, "Failed to get struct from stack.");
+		runtime_panic(vm, RUNTIME, "Failed to get struct from stack.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -1262,107 +1486,113 @@ OP_STRUCT_NAMED_FIELD: {
 	ObjectStruct *structType = structInstance->struct_type;
 	Value indexValue;
 	if (!table_get(&structType->fields, fieldName, &indexValue)) {
-		runtime_panic(current_module_record, RUNTIME, "Field '%s' does not exist on strut type '%s'.", fieldName->chars,
+		runtime_panic(vm, RUNTIME, "Field '%s' does not exist on strut type '%s'.", fieldName->chars,
 					  structType->name->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
 	uint16_t index = (uint16_t)AS_INT(indexValue);
-	structInstance->fields[index] = pop(current_module_record);
+	structInstance->fields[index] = pop(vm);
 	DISPATCH();
 }
 
 OP_STRUCT_INSTANCE_END: {
 	ObjectStructInstance *structInstance = pop_struct_stack(vm);
 	if (structInstance == NULL) {
-		runtime_panic(current_module_record, RUNTIME, "Failed to pop struct from stack.");
+		runtime_panic(vm, RUNTIME, "Failed to pop struct from stack.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	push(current_module_record, OBJECT_VAL(structInstance));
+	push(vm, OBJECT_VAL(structInstance));
 	DISPATCH();
 }
 
 OP_NIL_RETURN: {
-	close_upvalues(current_module_record, frame->slots);
-	current_module_record->frame_count--;
-	if (current_module_record->frame_count == 0) {
-		pop(current_module_record);
+	close_upvalues(vm, frame->slots);
+	if (__builtin_expect(vm->function_stats.enabled, 0)) {
+		exit_function_stats(vm);
+	}
+	vm->frame_count--;
+	if (vm->frame_count == 0) {
+		pop(vm);
+		if (vm->current_coroutine != NULL) {
+			vm->current_coroutine->transfer = NIL_VAL;
+		}
 		return INTERPRET_OK;
 	}
-	current_module_record->stack_top = frame->slots;
-	push(current_module_record, NIL_VAL);
-	frame = &current_module_record->frames[current_module_record->frame_count - 1];
+	vm->stack_top = frame->slots;
+	push(vm, NIL_VAL);
+	frame = &vm->frames[vm->frame_count - 1];
 
-	if (is_anonymous_frame)
+	if (is_anonymous_frame && vm->frame_count == exit_frame_count)
 		return INTERPRET_OK;
 	DISPATCH();
 }
 
 OP_UNWRAP: {
-	Value value = pop(current_module_record);
+	Value value = pop(vm);
 	if (!IS_CRUX_RESULT(value)) {
-		runtime_panic(current_module_record, TYPE, "Only the 'result' type supports unwrapping.");
+		runtime_panic(vm, TYPE, "Only the 'result' type supports unwrapping.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	ObjectResult *result = AS_CRUX_RESULT(value);
 	if (result->is_ok) {
-		push(current_module_record, result->as.value);
+		push(vm, result->as.value);
 	} else {
 		ObjectError *error = result->as.error;
-		runtime_panic(current_module_record, RUNTIME, "Panic: %s", error->message->chars);
+		runtime_panic(vm, RUNTIME, "Panic: %s", error->message->chars);
 	}
 	DISPATCH();
 }
 
 OP_PANIC: {
-	Value value = pop(current_module_record);
+	Value value = pop(vm);
 	ObjectString *message = to_string(vm, value);
-	runtime_panic(vm->current_module_record, RUNTIME, "Panic --- %s", message->chars);
+	runtime_panic(vm, RUNTIME, "Panic --- %s", message->chars);
 	return INTERPRET_RUNTIME_ERROR;
 }
 
 OP_BITWISE_AND: {
-	Value left = pop(current_module_record);
-	Value right = pop(current_module_record);
+	Value left = pop(vm);
+	Value right = pop(vm);
 	if (!IS_INT(left) || !IS_INT(right)) {
-		runtime_panic(current_module_record, TYPE, "Bitwise AND operation requires type 'Int'.");
+		runtime_panic(vm, TYPE, "Bitwise AND operation requires type 'Int'.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	push(current_module_record, INT_VAL(INT_VAL(left) & INT_VAL(right)));
+	push(vm, INT_VAL(INT_VAL(left) & INT_VAL(right)));
 	DISPATCH();
 }
 
 OP_BITWISE_XOR: {
-	Value left = pop(current_module_record);
-	Value right = pop(current_module_record);
+	Value left = pop(vm);
+	Value right = pop(vm);
 	if (!IS_INT(left) || !IS_INT(right)) {
-		runtime_panic(current_module_record, TYPE, "Bitwise XOR operation requires type 'Int'.");
+		runtime_panic(vm, TYPE, "Bitwise XOR operation requires type 'Int'.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	push(current_module_record, INT_VAL(INT_VAL(left) ^ INT_VAL(right)));
+	push(vm, INT_VAL(INT_VAL(left) ^ INT_VAL(right)));
 	DISPATCH();
 }
 
 OP_BITWISE_OR: {
-	Value left = pop(current_module_record);
-	Value right = pop(current_module_record);
+	Value left = pop(vm);
+	Value right = pop(vm);
 	if (!IS_INT(left) || !IS_INT(right)) {
-		runtime_panic(current_module_record, TYPE, "Bitwise OR operation requires type 'Int'.");
+		runtime_panic(vm, TYPE, "Bitwise OR operation requires type 'Int'.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	push(current_module_record, INT_VAL(INT_VAL(left) | INT_VAL(right)));
+	push(vm, INT_VAL(INT_VAL(left) | INT_VAL(right)));
 	DISPATCH();
 }
 
 OP_METHOD: {
 	ObjectString *method_name = READ_STRING();
-	Value method_closure = PEEK(current_module_record, 0);
-	Value struct_val = PEEK(current_module_record, 1);
+	Value method_closure = PEEK(vm, 0);
+	Value struct_val = PEEK(vm, 1);
 
 	ObjectStruct *struct_obj = AS_CRUX_STRUCT(struct_val);
 	table_set(vm, &struct_obj->methods, method_name, method_closure);
 
-	pop(current_module_record); // closure
+	pop(vm); // closure
 	DISPATCH();
 }
 
@@ -1372,12 +1602,13 @@ OP_SET_PROPERTY_STAR:
 OP_SET_PROPERTY_SLASH:
 OP_SET_PROPERTY_INT_DIVIDE:
 OP_SET_PROPERTY_MODULUS: {
+	const uint16_t instruction = frame->ip[-1].operand;
 	ObjectString *name = READ_STRING();
-	Value operand = pop(current_module_record);
-	Value instance_val = PEEK(current_module_record, 0);
+	Value operand = pop(vm);
+	Value instance_val = PEEK(vm, 0);
 
 	if (!IS_CRUX_STRUCT_INSTANCE(instance_val)) {
-		runtime_panic(current_module_record, TYPE, "Only instances have properties.");
+		runtime_panic(vm, TYPE, "Only instances have properties.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	ObjectStructInstance *instance = AS_CRUX_STRUCT_INSTANCE(instance_val);
@@ -1401,36 +1632,36 @@ OP_SET_PROPERTY_MODULUS: {
 		else
 			math_op = OP_SET_LOCAL_MODULUS;
 
-		if (!handle_compound_assignment(current_module_record, &current_val, operand, math_op)) {
+		if (!handle_compound_assignment(vm, &current_val, operand, math_op)) {
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
 		instance->fields[index] = current_val;
 
-		pop(current_module_record);
-		push(current_module_record, current_val);
+		pop(vm);
+		push(vm, current_val);
 		DISPATCH();
 	}
 
-	runtime_panic(current_module_record, NAME, "Undefined property '%s'.", name->chars);
+	runtime_panic(vm, NAME, "Undefined property '%s'.", name->chars);
 	return INTERPRET_RUNTIME_ERROR;
 }
 
 OP_GET_PROPERTY_INDEX: {
-	Value receiver = pop(current_module_record);
+	Value receiver = pop(vm);
 	uint16_t index = READ_SHORT();
 	ObjectStructInstance *instance = AS_CRUX_STRUCT_INSTANCE(receiver);
-	push(current_module_record, instance->fields[index]);
+	push(vm, instance->fields[index]);
 	DISPATCH();
 }
 
 OP_SET_PROPERTY_INDEX: {
-	Value valueToSet = pop(current_module_record);
-	Value receiver = pop(current_module_record);
+	Value valueToSet = pop(vm);
+	Value receiver = pop(vm);
 	uint16_t index = READ_SHORT();
 	ObjectStructInstance *instance = AS_CRUX_STRUCT_INSTANCE(receiver);
 	instance->fields[index] = valueToSet;
-	push(current_module_record, valueToSet);
+	push(vm, valueToSet);
 	DISPATCH();
 }
 
@@ -1440,9 +1671,10 @@ OP_SET_PROPERTY_STAR_INDEX:
 OP_SET_PROPERTY_SLASH_INDEX:
 OP_SET_PROPERTY_INT_DIVIDE_INDEX:
 OP_SET_PROPERTY_MODULUS_INDEX: {
+	const uint16_t instruction = frame->ip[-1].operand;
 	uint16_t index = READ_SHORT();
-	Value operand = pop(current_module_record);
-	Value instance_val = PEEK(current_module_record, 0);
+	Value operand = pop(vm);
+	Value instance_val = PEEK(vm, 0);
 
 	ObjectStructInstance *instance = AS_CRUX_STRUCT_INSTANCE(instance_val);
 	Value current_val = instance->fields[index];
@@ -1461,36 +1693,36 @@ OP_SET_PROPERTY_MODULUS_INDEX: {
 	else
 		math_op = OP_SET_LOCAL_MODULUS;
 
-	if (!handle_compound_assignment(current_module_record, &current_val, operand, math_op)) {
+	if (!handle_compound_assignment(vm, &current_val, operand, math_op)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
 	instance->fields[index] = current_val;
 
-	pop(current_module_record);
-	push(current_module_record, current_val);
+	pop(vm);
+	push(vm, current_val);
 	DISPATCH();
 }
 
 OP_BITWISE_NOT: {
-	Value value = pop(current_module_record);
+	Value value = pop(vm);
 	if (!IS_INT(value)) {
-		runtime_panic(current_module_record, TYPE, "Bitwise NOT operation requires type 'Int'.");
+		runtime_panic(vm, TYPE, "Bitwise NOT operation requires type 'Int'.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	int32_t int_val = AS_INT(value);
-	push(current_module_record, INT_VAL(~int_val));
+	push(vm, INT_VAL(~int_val));
 	DISPATCH();
 }
 
 OP_TYPE_COERCE: {
 	Value value = READ_CONSTANT();
 	ObjectTypeRecord *type_record = AS_CRUX_TYPE_RECORD(value);
-	Value query = PEEK(current_module_record, 0);
+	Value query = PEEK(vm, 0);
 	if (!runtime_types_compatible(type_record->base_type, query)) {
 		char type_name[128];
 		type_record_name(type_record, type_name, 128);
-		runtime_panic(current_module_record, TYPE, "Failed to perform type coercion. Expected type: '%s'.", type_name);
+		runtime_panic(vm, TYPE, "Failed to perform type coercion. Expected type: '%s'.", type_name);
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	// if the type matched then continue on like nothing happened
@@ -1498,19 +1730,19 @@ OP_TYPE_COERCE: {
 }
 
 OP_GET_SLICE: {
-	Value range_value = pop(current_module_record);
+	Value range_value = pop(vm);
 	ObjectRange *range = AS_CRUX_RANGE(range_value);
-	if (!IS_CRUX_OBJECT(PEEK(current_module_record, 0))) {
-		runtime_panic(current_module_record, TYPE, "Cannot get from a non-collection type.");
+	if (!IS_CRUX_OBJECT(PEEK(vm, 0))) {
+		runtime_panic(vm, TYPE, "Cannot get from a non-collection type.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	switch (object_get_type(AS_CRUX_OBJECT(PEEK(current_module_record, 0)))) {
+	switch (object_get_type(AS_CRUX_OBJECT(PEEK(vm, 0)))) {
 	case OBJECT_ARRAY: {
-		ObjectArray *array = AS_CRUX_ARRAY(PEEK(current_module_record, 0));
+		ObjectArray *array = AS_CRUX_ARRAY(PEEK(vm, 0));
 		uint32_t len = range_len(range);
 
 		if (!range_indices_in_bounds(range, array->size)) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
@@ -1520,28 +1752,28 @@ OP_GET_SLICE: {
 			Value to_add = array->values[range->start + i * range->step];
 			array_add_back(vm, slice, to_add);
 		}
-		pop_push(current_module_record, OBJECT_VAL(slice));
+		pop_push(vm, OBJECT_VAL(slice));
 		DISPATCH();
 	}
 	case OBJECT_STRING: {
-		ObjectString *string = AS_CRUX_STRING(PEEK(current_module_record, 0));
+		ObjectString *string = AS_CRUX_STRING(PEEK(vm, 0));
 		uint32_t len = range_len(range);
 
 		if (!range_indices_in_bounds(range, string->code_point_length)) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
 		const utf8_int8_t **codepoint_starts = NULL;
 		if (!collect_string_codepoint_starts(vm, string, &codepoint_starts)) {
-			runtime_panic(current_module_record, MEMORY, "Out of memory.");
+			runtime_panic(vm, MEMORY, "Out of memory.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
 		char *buffer = ALLOCATE(vm, char, string->byte_length + 1);
 		if (buffer == NULL) {
 			FREE_ARRAY(vm, const utf8_int8_t *, codepoint_starts, string->code_point_length + 1);
-			runtime_panic(current_module_record, MEMORY, "Out of memory.");
+			runtime_panic(vm, MEMORY, "Out of memory.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
@@ -1560,21 +1792,21 @@ OP_GET_SLICE: {
 		char *resized = GROW_ARRAY(vm, char, buffer, string->byte_length + 1, buffer_write_index + 1);
 		if (resized == NULL) {
 			FREE_ARRAY(vm, char, buffer, string->byte_length + 1);
-			runtime_panic(current_module_record, MEMORY, "Out of memory.");
+			runtime_panic(vm, MEMORY, "Out of memory.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 		buffer = resized;
 
 		ObjectString *slice = take_string(vm, buffer, buffer_write_index);
-		pop_push(current_module_record, OBJECT_VAL(slice));
+		pop_push(vm, OBJECT_VAL(slice));
 		DISPATCH();
 	}
 	case OBJECT_TUPLE: {
-		ObjectTuple *tuple = AS_CRUX_TUPLE(PEEK(current_module_record, 0));
+		ObjectTuple *tuple = AS_CRUX_TUPLE(PEEK(vm, 0));
 		uint32_t len = range_len(range);
 
 		if (!range_indices_in_bounds(range, tuple->size)) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
@@ -1582,15 +1814,15 @@ OP_GET_SLICE: {
 		for (uint32_t i = 0; i < len; i++) {
 			slice->elements[i] = tuple->elements[range->start + i * range->step];
 		}
-		pop_push(current_module_record, OBJECT_VAL(slice));
+		pop_push(vm, OBJECT_VAL(slice));
 		DISPATCH();
 	}
 	case OBJECT_BUFFER: {
-		ObjectBuffer *buffer = AS_CRUX_BUFFER(PEEK(current_module_record, 0));
+		ObjectBuffer *buffer = AS_CRUX_BUFFER(PEEK(vm, 0));
 		uint32_t len = range_len(range);
 
 		if (!range_indices_in_bounds(range, buffer->write_pos - buffer->read_pos)) {
-			runtime_panic(current_module_record, BOUNDS, "Index out of bounds.");
+			runtime_panic(vm, BOUNDS, "Index out of bounds.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
 
@@ -1600,12 +1832,12 @@ OP_GET_SLICE: {
 			slice->values[i] = INT_VAL(buffer->data[buffer->read_pos + index]);
 		}
 		slice->size = len;
-		pop_push(current_module_record, OBJECT_VAL(slice));
+		pop_push(vm, OBJECT_VAL(slice));
 		DISPATCH();
 	}
 
 	default: {
-		runtime_panic(current_module_record, TYPE, "Can only slice 'Array | String | Tuple | Buffer'");
+		runtime_panic(vm, TYPE, "Can only slice 'Array | String | Tuple | Buffer'");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 	}
@@ -1614,8 +1846,8 @@ OP_GET_SLICE: {
 
 // value in collection
 OP_IN: {
-	Value right = pop(current_module_record);
-	Value left = pop(current_module_record);
+	Value right = pop(vm);
+	Value left = pop(vm);
 
 	ObjectType right_type = object_get_type(AS_CRUX_OBJECT(right));
 
@@ -1630,23 +1862,23 @@ OP_IN: {
 					break;
 				}
 			}
-			push(current_module_record, found ? TRUE_VAL : FALSE_VAL);
+			push(vm, found ? TRUE_VAL : FALSE_VAL);
 			break;
 		}
 		case OBJECT_STRING: {
 			ObjectString *str = AS_CRUX_STRING(right);
 			if (!IS_CRUX_STRING(left)) {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 				break;
 			}
 			ObjectString *goal = AS_CRUX_STRING(left);
 			if (goal->byte_length == 0) {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 				break;
 			}
 
 			bool found = utf8str(str->chars, goal->chars) != NULL;
-			push(current_module_record, found ? TRUE_VAL : FALSE_VAL);
+			push(vm, found ? TRUE_VAL : FALSE_VAL);
 			break;
 		}
 		case OBJECT_TUPLE: {
@@ -1658,13 +1890,13 @@ OP_IN: {
 					break;
 				}
 			}
-			push(current_module_record, found ? TRUE_VAL : FALSE_VAL);
+			push(vm, found ? TRUE_VAL : FALSE_VAL);
 			break;
 		}
 		case OBJECT_BUFFER: {
 			ObjectBuffer *buffer = AS_CRUX_BUFFER(right);
 			if (!IS_INT(left)) {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 				break;
 			}
 			bool found = false;
@@ -1676,59 +1908,59 @@ OP_IN: {
 				}
 			}
 
-			push(current_module_record, found ? TRUE_VAL : FALSE_VAL);
+			push(vm, found ? TRUE_VAL : FALSE_VAL);
 			break;
 		}
 		case OBJECT_SET: {
 			ObjectSet *set = AS_CRUX_SET(right);
 			if (object_table_contains_key(set->entries, left)) {
-				push(current_module_record, TRUE_VAL);
+				push(vm, TRUE_VAL);
 			} else {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 			}
 			break;
 		}
 		case OBJECT_RANGE: {
 			ObjectRange *range = AS_CRUX_RANGE(right);
 			if (!IS_INT(left)) {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 				break;
 			}
 			int32_t int_val = AS_INT(left);
-			push(current_module_record, range_contains(range, int_val) ? TRUE_VAL : FALSE_VAL);
+			push(vm, range_contains(range, int_val) ? TRUE_VAL : FALSE_VAL);
 			break;
 		}
 		case OBJECT_TABLE: {
 			ObjectTable *table = AS_CRUX_TABLE(right);
 			if (object_table_contains_key(table, left)) {
-				push(current_module_record, TRUE_VAL);
+				push(vm, TRUE_VAL);
 			} else {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 			}
 			break;
 		}
 		case OBJECT_VECTOR: {
 			ObjectVector *vector = AS_CRUX_VECTOR(right);
 			if (vector->dimensions == 0) {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 				break;
 			}
 			if (!IS_INT(left) && !IS_FLOAT(left)) {
-				push(current_module_record, FALSE_VAL);
+				push(vm, FALSE_VAL);
 				break;
 			}
 			double double_val = TO_DOUBLE(left);
 			if (vector->dimensions > STATIC_VECTOR_SIZE) {
 				for (uint32_t i = 0; i < vector->dimensions; i++) {
 					if (vector->as.h_components[i] != double_val) {
-						push(current_module_record, FALSE_VAL);
+						push(vm, FALSE_VAL);
 						break;
 					}
 				}
 			} else {
 				for (uint32_t i = 0; i < vector->dimensions; i++) {
 					if (vector->as.s_components[i] != double_val) {
-						push(current_module_record, FALSE_VAL);
+						push(vm, FALSE_VAL);
 						break;
 					}
 				}
@@ -1736,7 +1968,7 @@ OP_IN: {
 			break;
 		}
 		default: {
-			runtime_panic(current_module_record, TYPE,
+			runtime_panic(vm, TYPE,
 						  "Can only check 'in' for 'Array | String | Tuple | Buffer | Set | Range | Table'");
 			return INTERPRET_RUNTIME_ERROR;
 		}
@@ -1747,173 +1979,174 @@ OP_IN: {
 }
 
 OP_OK: {
-	Value value = PEEK(current_module_record, 0);
+	Value value = PEEK(vm, 0);
 	ObjectResult *result = new_ok_result(vm, value);
-	pop(current_module_record);
-	push(current_module_record, OBJECT_VAL(result));
+	pop(vm);
+	push(vm, OBJECT_VAL(result));
 	DISPATCH();
 }
 
 OP_ERR: {
-	Value err = PEEK(current_module_record, 0);
+	Value err = PEEK(vm, 0);
 	ObjectError *error = new_error(vm, to_string(vm, err), RUNTIME, false);
-	push(current_module_record, OBJECT_VAL(error));
+	push(vm, OBJECT_VAL(error));
 	ObjectResult *result = new_error_result(vm, error);
-	pop(current_module_record);
-	pop(current_module_record);
-	push(current_module_record, OBJECT_VAL(result));
+	pop(vm);
+	pop(vm);
+	push(vm, OBJECT_VAL(result));
 	DISPATCH();
 }
 
 OP_SOME: {
-	Value value = PEEK(current_module_record, 0);
+	Value value = PEEK(vm, 0);
 	ObjectOption *some = new_option(vm, value, true);
-	pop(current_module_record);
-	push(current_module_record, OBJECT_VAL(some));
+	pop(vm);
+	push(vm, OBJECT_VAL(some));
 	DISPATCH();
 }
 
 OP_NONE: {
 	ObjectOption *none = new_option(vm, NIL_VAL, false);
-	push(current_module_record, OBJECT_VAL(none));
+	push(vm, OBJECT_VAL(none));
 	DISPATCH();
 }
 
 OP_ADD_INT: {
-	int32_t b = AS_INT(current_module_record->stack_top[-1]);
-	int32_t a = AS_INT(current_module_record->stack_top[-2]);
+	int32_t b = AS_INT(vm->stack_top[-1]);
+	int32_t a = AS_INT(vm->stack_top[-2]);
 	const int64_t result = (int64_t)a + (int64_t)b;
-	current_module_record->stack_top--;
+	vm->stack_top--;
 	if (result >= INT32_MIN && result <= INT32_MAX) {
-		current_module_record->stack_top[-1] = INT_VAL((int32_t)result);
+		vm->stack_top[-1] = INT_VAL((int32_t)result);
 	} else {
-		current_module_record->stack_top[-1] = FLOAT_VAL((double)result);
+		vm->stack_top[-1] = FLOAT_VAL((double)result);
 	}
 	DISPATCH();
 }
 
 OP_ADD_NUM: {
-	double b = TO_DOUBLE(current_module_record->stack_top[-1]);
-	double a = TO_DOUBLE(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = FLOAT_VAL(a + b);
+	double b = TO_DOUBLE(vm->stack_top[-1]);
+	double a = TO_DOUBLE(vm->stack_top[-2]);
+	vm->stack_top--;
+	vm->stack_top[-1] = FLOAT_VAL(a + b);
 	DISPATCH();
 }
 
 OP_SUBTRACT_INT: {
-	int32_t b = AS_INT(current_module_record->stack_top[-1]);
-	int32_t a = AS_INT(current_module_record->stack_top[-2]);
+	int32_t b = AS_INT(vm->stack_top[-1]);
+	int32_t a = AS_INT(vm->stack_top[-2]);
 	const int64_t result = (int64_t)a - (int64_t)b;
-	current_module_record->stack_top--;
+	vm->stack_top--;
 	if (result >= INT32_MIN && result <= INT32_MAX) {
-		current_module_record->stack_top[-1] = INT_VAL((int32_t)result);
+		vm->stack_top[-1] = INT_VAL((int32_t)result);
 	} else {
-		current_module_record->stack_top[-1] = FLOAT_VAL((double)result);
+		vm->stack_top[-1] = FLOAT_VAL((double)result);
 	}
 	DISPATCH();
 }
 
 OP_SUBTRACT_NUM: {
-	double b = TO_DOUBLE(current_module_record->stack_top[-1]);
-	double a = TO_DOUBLE(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = FLOAT_VAL(a - b);
+	double b = TO_DOUBLE(vm->stack_top[-1]);
+	double a = TO_DOUBLE(vm->stack_top[-2]);
+	vm->stack_top--;
+	vm->stack_top[-1] = FLOAT_VAL(a - b);
 	DISPATCH();
 }
 
 OP_MULTIPLY_INT: {
-	int32_t b = AS_INT(current_module_record->stack_top[-1]);
-	int32_t a = AS_INT(current_module_record->stack_top[-2]);
+	int32_t b = AS_INT(vm->stack_top[-1]);
+	int32_t a = AS_INT(vm->stack_top[-2]);
 	const int64_t result = (int64_t)a * (int64_t)b;
-	current_module_record->stack_top--;
+	vm->stack_top--;
 	if (result >= INT32_MIN && result <= INT32_MAX) {
-		current_module_record->stack_top[-1] = INT_VAL((int32_t)result);
+		vm->stack_top[-1] = INT_VAL((int32_t)result);
 	} else {
-		current_module_record->stack_top[-1] = FLOAT_VAL((double)result);
+		vm->stack_top[-1] = FLOAT_VAL((double)result);
 	}
 	DISPATCH();
 }
 
 OP_MULTIPLY_NUM: {
-	double b = TO_DOUBLE(current_module_record->stack_top[-1]);
-	double a = TO_DOUBLE(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = FLOAT_VAL(a * b);
+	double b = TO_DOUBLE(vm->stack_top[-1]);
+	double a = TO_DOUBLE(vm->stack_top[-2]);
+	vm->stack_top--;
+	vm->stack_top[-1] = FLOAT_VAL(a * b);
 	DISPATCH();
 }
 
 OP_DIVIDE_NUM: {
-	double b = TO_DOUBLE(current_module_record->stack_top[-1]);
+	double b = TO_DOUBLE(vm->stack_top[-1]);
 	if (b == 0.0) {
-		runtime_panic(current_module_record, MATH, "Division by zero.");
+		runtime_panic(vm, MATH, "Division by zero.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	double a = TO_DOUBLE(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = FLOAT_VAL(a / b);
+	double a = TO_DOUBLE(vm->stack_top[-2]);
+	vm->stack_top--;
+	vm->stack_top[-1] = FLOAT_VAL(a / b);
 	DISPATCH();
 }
 
 OP_INT_DIVIDE_INT: {
-	int32_t b = AS_INT(current_module_record->stack_top[-1]);
+	int32_t b = AS_INT(vm->stack_top[-1]);
 	if (b == 0) {
-		runtime_panic(current_module_record, MATH, "Integer division by zero.");
+		runtime_panic(vm, MATH, "Integer division by zero.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	int32_t a = AS_INT(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
+	int32_t a = AS_INT(vm->stack_top[-2]);
+	vm->stack_top--;
 
 	if (a == INT32_MIN && b == -1) {
-		current_module_record->stack_top[-1] = FLOAT_VAL(-(double)INT32_MIN);
+		vm->stack_top[-1] = FLOAT_VAL(-(double)INT32_MIN);
 	} else {
-		current_module_record->stack_top[-1] = INT_VAL(a / b);
+		vm->stack_top[-1] = INT_VAL(a / b);
 	}
 	DISPATCH();
 }
 
 OP_MODULUS_INT: {
-	int32_t b = AS_INT(current_module_record->stack_top[-1]);
+	int32_t b = AS_INT(vm->stack_top[-1]);
 	if (b == 0) {
-		runtime_panic(current_module_record, MATH, "Modulo by zero.");
+		runtime_panic(vm, MATH, "Modulo by zero.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	int32_t a = AS_INT(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
+	int32_t a = AS_INT(vm->stack_top[-2]);
+	vm->stack_top--;
 
 	if (a == INT32_MIN && b == -1) {
-		current_module_record->stack_top[-1] = INT_VAL(0);
+		vm->stack_top[-1] = INT_VAL(0);
 	} else {
-		current_module_record->stack_top[-1] = INT_VAL(a % b);
+		vm->stack_top[-1] = INT_VAL(a % b);
 	}
 	DISPATCH();
 }
 
 OP_POWER_INT: {
-	int32_t b = AS_INT(current_module_record->stack_top[-1]);
-	int32_t a = AS_INT(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = FLOAT_VAL(pow((double)a, (double)b));
+	int32_t b = AS_INT(vm->stack_top[-1]);
+	int32_t a = AS_INT(vm->stack_top[-2]);
+	vm->stack_top--;
+	vm->stack_top[-1] = FLOAT_VAL(pow((double)a, (double)b));
 	DISPATCH();
 }
 
 OP_POWER_NUM: {
-	double b = TO_DOUBLE(current_module_record->stack_top[-1]);
-	double a = TO_DOUBLE(current_module_record->stack_top[-2]);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = FLOAT_VAL(pow(a, b));
+	double b = TO_DOUBLE(vm->stack_top[-1]);
+	double a = TO_DOUBLE(vm->stack_top[-2]);
+	vm->stack_top--;
+	vm->stack_top[-1] = FLOAT_VAL(pow(a, b));
 	DISPATCH();
 }
 
 OP_ADD_VECTOR_VECTOR: {
-	ObjectVector *right = AS_CRUX_VECTOR(current_module_record->stack_top[-1]);
-	ObjectVector *left = AS_CRUX_VECTOR(current_module_record->stack_top[-2]);
+	const uint16_t reuse = READ_SHORT();
+	ObjectVector *right = AS_CRUX_VECTOR(vm->stack_top[-1]);
+	ObjectVector *left = AS_CRUX_VECTOR(vm->stack_top[-2]);
 
 	if (left->dimensions != right->dimensions) {
-		runtime_panic(current_module_record, MATH, "Vectors must have same dimensions to add.");
+		runtime_panic(vm, MATH, "Vectors must have same dimensions to add.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	ObjectVector *res_vec = new_vector(vm, left->dimensions);
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, left->dimensions);
 	double *l_data = VECTOR_COMPONENTS(left);
 	double *r_data = VECTOR_COMPONENTS(right);
 	double *out_data = VECTOR_COMPONENTS(res_vec);
@@ -1922,21 +2155,22 @@ OP_ADD_VECTOR_VECTOR: {
 		out_data[i] = l_data[i] + r_data[i];
 	}
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_SUBTRACT_VECTOR_VECTOR: {
-	ObjectVector *right = AS_CRUX_VECTOR(current_module_record->stack_top[-1]);
-	ObjectVector *left = AS_CRUX_VECTOR(current_module_record->stack_top[-2]);
+	const uint16_t reuse = READ_SHORT();
+	ObjectVector *right = AS_CRUX_VECTOR(vm->stack_top[-1]);
+	ObjectVector *left = AS_CRUX_VECTOR(vm->stack_top[-2]);
 
 	if (left->dimensions != right->dimensions) {
-		runtime_panic(current_module_record, MATH, "Vectors must have same dimensions to subtract.");
+		runtime_panic(vm, MATH, "Vectors must have same dimensions to subtract.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	ObjectVector *res_vec = new_vector(vm, left->dimensions);
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, left->dimensions);
 	double *l_data = VECTOR_COMPONENTS(left);
 	double *r_data = VECTOR_COMPONENTS(right);
 	double *out_data = VECTOR_COMPONENTS(res_vec);
@@ -1945,66 +2179,76 @@ OP_SUBTRACT_VECTOR_VECTOR: {
 		out_data[i] = l_data[i] - r_data[i];
 	}
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_MULTIPLY_VECTOR_VECTOR: { // Cross Product
-	ObjectVector *right = AS_CRUX_VECTOR(current_module_record->stack_top[-1]);
-	ObjectVector *left = AS_CRUX_VECTOR(current_module_record->stack_top[-2]);
+	const uint16_t reuse = READ_SHORT();
+	ObjectVector *right = AS_CRUX_VECTOR(vm->stack_top[-1]);
+	ObjectVector *left = AS_CRUX_VECTOR(vm->stack_top[-2]);
 
 	if (left->dimensions != 3 || right->dimensions != 3) {
-		runtime_panic(current_module_record, MATH, "Cross product requires 3D vectors.");
+		runtime_panic(vm, MATH, "Cross product requires 3D vectors.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	ObjectVector *res_vec = new_vector(vm, 3);
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, 3);
 	double *l_data = VECTOR_COMPONENTS(left);
 	double *r_data = VECTOR_COMPONENTS(right);
 	double *out_data = VECTOR_COMPONENTS(res_vec);
 
-	out_data[0] = l_data[1] * r_data[2] - l_data[2] * r_data[1];
-	out_data[1] = l_data[2] * r_data[0] - l_data[0] * r_data[2];
-	out_data[2] = l_data[0] * r_data[1] - l_data[1] * r_data[0];
+	// the result may overwrite an operand, so every component is computed first
+	const double x = l_data[1] * r_data[2] - l_data[2] * r_data[1];
+	const double y = l_data[2] * r_data[0] - l_data[0] * r_data[2];
+	const double z = l_data[0] * r_data[1] - l_data[1] * r_data[0];
+	out_data[0] = x;
+	out_data[1] = y;
+	out_data[2] = z;
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_DIVIDE_VECTOR_VECTOR: { // Component-wise division
-	ObjectVector *right = AS_CRUX_VECTOR(current_module_record->stack_top[-1]);
-	ObjectVector *left = AS_CRUX_VECTOR(current_module_record->stack_top[-2]);
+	const uint16_t reuse = READ_SHORT();
+	ObjectVector *right = AS_CRUX_VECTOR(vm->stack_top[-1]);
+	ObjectVector *left = AS_CRUX_VECTOR(vm->stack_top[-2]);
 
 	if (left->dimensions != right->dimensions) {
-		runtime_panic(current_module_record, MATH, "Vectors must have same dimensions to divide.");
+		runtime_panic(vm, MATH, "Vectors must have same dimensions to divide.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	ObjectVector *res_vec = new_vector(vm, left->dimensions);
-	double *l_data = VECTOR_COMPONENTS(left);
 	double *r_data = VECTOR_COMPONENTS(right);
-	double *out_data = VECTOR_COMPONENTS(res_vec);
-
-	for (uint32_t i = 0; i < left->dimensions; i++) {
+	for (uint32_t i = 0; i < right->dimensions; i++) {
 		if (r_data[i] == 0.0) {
-			runtime_panic(current_module_record, MATH, "Vector component division by zero.");
+			runtime_panic(vm, MATH, "Vector component division by zero.");
 			return INTERPRET_RUNTIME_ERROR;
 		}
+	}
+
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, left->dimensions);
+	double *l_data = VECTOR_COMPONENTS(left);
+	double *out_data = VECTOR_COMPONENTS(res_vec);
+
+	for (uint32_t i = 0; i < left->dimensions; i++) {
 		out_data[i] = l_data[i] / r_data[i];
 	}
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_MULTIPLY_VECTOR_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectVector *left = AS_CRUX_VECTOR(current_module_record->stack_top[-2]);
+	const uint16_t reuse = READ_SHORT();
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectVector *left = AS_CRUX_VECTOR(vm->stack_top[-2]);
 
-	ObjectVector *res_vec = new_vector(vm, left->dimensions);
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, left->dimensions);
 	double *l_data = VECTOR_COMPONENTS(left);
 	double *out_data = VECTOR_COMPONENTS(res_vec);
 
@@ -2012,16 +2256,17 @@ OP_MULTIPLY_VECTOR_SCALAR: {
 		out_data[i] = l_data[i] * scalar;
 	}
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_MULTIPLY_SCALAR_VECTOR: {
-	ObjectVector *right = AS_CRUX_VECTOR(current_module_record->stack_top[-1]);
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-2]);
+	const uint16_t reuse = READ_SHORT();
+	ObjectVector *right = AS_CRUX_VECTOR(vm->stack_top[-1]);
+	double scalar = TO_DOUBLE(vm->stack_top[-2]);
 
-	ObjectVector *res_vec = new_vector(vm, right->dimensions);
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, right->dimensions);
 	double *r_data = VECTOR_COMPONENTS(right);
 	double *out_data = VECTOR_COMPONENTS(res_vec);
 
@@ -2029,20 +2274,21 @@ OP_MULTIPLY_SCALAR_VECTOR: {
 		out_data[i] = scalar * r_data[i];
 	}
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_DIVIDE_VECTOR_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
+	const uint16_t reuse = READ_SHORT();
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
 	if (scalar == 0.0) {
-		runtime_panic(current_module_record, MATH, "Vector division by zero scalar.");
+		runtime_panic(vm, MATH, "Vector division by zero scalar.");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
-	ObjectVector *left = AS_CRUX_VECTOR(current_module_record->stack_top[-2]);
-	ObjectVector *res_vec = new_vector(vm, left->dimensions);
+	ObjectVector *left = AS_CRUX_VECTOR(vm->stack_top[-2]);
+	ObjectVector *res_vec = vector_result(vm, vm->stack_top - 2, reuse, left->dimensions);
 	double *l_data = VECTOR_COMPONENTS(left);
 	double *out_data = VECTOR_COMPONENTS(res_vec);
 
@@ -2050,181 +2296,196 @@ OP_DIVIDE_VECTOR_SCALAR: {
 		out_data[i] = l_data[i] / scalar;
 	}
 
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = OBJECT_VAL(res_vec);
+	vm->stack_top--;
+	vm->stack_top[-1] = OBJECT_VAL(res_vec);
 	DISPATCH();
 }
 
 OP_ADD_COMPLEX_COMPLEX: {
-	ObjectComplex *right = AS_CRUX_COMPLEX(current_module_record->stack_top[-1]);
-	ObjectComplex *left = AS_CRUX_COMPLEX(current_module_record->stack_top[-2]);
-	Value result = complex_add_value(vm, left, right);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	const uint16_t reuse = READ_SHORT();
+	ObjectComplex *right = AS_CRUX_COMPLEX(vm->stack_top[-1]);
+	ObjectComplex *left = AS_CRUX_COMPLEX(vm->stack_top[-2]);
+	Value result = complex_add_value(vm, left, right,
+									 complex_result_target(vm->stack_top - 2, reuse));
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_SUBTRACT_COMPLEX_COMPLEX: {
-	ObjectComplex *right = AS_CRUX_COMPLEX(current_module_record->stack_top[-1]);
-	ObjectComplex *left = AS_CRUX_COMPLEX(current_module_record->stack_top[-2]);
-	Value result = complex_subtract_value(vm, left, right);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	const uint16_t reuse = READ_SHORT();
+	ObjectComplex *right = AS_CRUX_COMPLEX(vm->stack_top[-1]);
+	ObjectComplex *left = AS_CRUX_COMPLEX(vm->stack_top[-2]);
+	Value result = complex_subtract_value(vm, left, right,
+										  complex_result_target(vm->stack_top - 2, reuse));
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_MULTIPLY_COMPLEX_COMPLEX: {
-	ObjectComplex *right = AS_CRUX_COMPLEX(current_module_record->stack_top[-1]);
-	ObjectComplex *left = AS_CRUX_COMPLEX(current_module_record->stack_top[-2]);
-	Value result = complex_multiply_value(vm, left, right);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	const uint16_t reuse = READ_SHORT();
+	ObjectComplex *right = AS_CRUX_COMPLEX(vm->stack_top[-1]);
+	ObjectComplex *left = AS_CRUX_COMPLEX(vm->stack_top[-2]);
+	Value result = complex_multiply_value(vm, left, right,
+										  complex_result_target(vm->stack_top - 2, reuse));
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_DIVIDE_COMPLEX_COMPLEX: {
-	ObjectComplex *right = AS_CRUX_COMPLEX(current_module_record->stack_top[-1]);
-	ObjectComplex *left = AS_CRUX_COMPLEX(current_module_record->stack_top[-2]);
-	Value result = complex_divide_value(vm, left, right);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	const uint16_t reuse = READ_SHORT();
+	ObjectComplex *right = AS_CRUX_COMPLEX(vm->stack_top[-1]);
+	ObjectComplex *left = AS_CRUX_COMPLEX(vm->stack_top[-2]);
+	Value result = complex_divide_value(vm, left, right,
+										complex_result_target(vm->stack_top - 2, reuse));
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_MULTIPLY_COMPLEX_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectComplex *left = AS_CRUX_COMPLEX(current_module_record->stack_top[-2]);
-	Value result = complex_scalar_multiply_value(vm, left, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	const uint16_t reuse = READ_SHORT();
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectComplex *left = AS_CRUX_COMPLEX(vm->stack_top[-2]);
+	Value result = complex_scalar_multiply_value(vm, left, scalar,
+												 complex_result_target(vm->stack_top - 2, reuse));
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_MULTIPLY_SCALAR_COMPLEX: {
-	ObjectComplex *right = AS_CRUX_COMPLEX(current_module_record->stack_top[-1]);
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-2]);
-	Value result = complex_scalar_multiply_value(vm, right, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	const uint16_t reuse = READ_SHORT();
+	ObjectComplex *right = AS_CRUX_COMPLEX(vm->stack_top[-1]);
+	double scalar = TO_DOUBLE(vm->stack_top[-2]);
+	Value result = complex_scalar_multiply_value(vm, right, scalar,
+												 complex_result_target(vm->stack_top - 2, reuse));
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_DIVIDE_COMPLEX_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectComplex *left = AS_CRUX_COMPLEX(current_module_record->stack_top[-2]);
-	ObjectResult *res = AS_CRUX_RESULT(complex_scalar_divide_value(vm, left, scalar));
-	if (!res->is_ok) {
-		runtime_panic(current_module_record, res->as.error->type, "%s", res->as.error->message->chars);
+	const uint16_t reuse = READ_SHORT();
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectComplex *left = AS_CRUX_COMPLEX(vm->stack_top[-2]);
+	Value result = complex_scalar_divide_value(vm, left, scalar,
+											   complex_result_target(vm->stack_top - 2, reuse));
+	if (IS_CRUX_RESULT(result)) { // only returned for division by zero
+		const ObjectError *error = AS_CRUX_RESULT(result)->as.error;
+		runtime_panic(vm, error->type, "%s", error->message->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = res->as.value;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_ADD_MATRIX_MATRIX: {
-	ObjectMatrix *right = AS_CRUX_MATRIX(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	ObjectMatrix *right = AS_CRUX_MATRIX(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	ObjectResult *res = AS_CRUX_RESULT(matrix_add_value(vm, left, right));
 	if (!res->is_ok) {
-		runtime_panic(current_module_record, res->as.error->type, "%s", res->as.error->message->chars);
+		runtime_panic(vm, res->as.error->type, "%s", res->as.error->message->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = res->as.value;
+	vm->stack_top--;
+	vm->stack_top[-1] = res->as.value;
 	DISPATCH();
 }
 
 OP_SUBTRACT_MATRIX_MATRIX: {
-	ObjectMatrix *right = AS_CRUX_MATRIX(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	ObjectMatrix *right = AS_CRUX_MATRIX(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	ObjectResult *res = AS_CRUX_RESULT(matrix_subtract_value(vm, left, right));
 	if (!res->is_ok) {
-		runtime_panic(current_module_record, res->as.error->type, "%s", res->as.error->message->chars);
+		runtime_panic(vm, res->as.error->type, "%s", res->as.error->message->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = res->as.value;
+	vm->stack_top--;
+	vm->stack_top[-1] = res->as.value;
 	DISPATCH();
 }
 
 OP_ADD_MATRIX_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	Value result = matrix_scalar_add_value(vm, left, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_ADD_SCALAR_MATRIX: {
-	ObjectMatrix *right = AS_CRUX_MATRIX(current_module_record->stack_top[-1]);
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-2]);
+	ObjectMatrix *right = AS_CRUX_MATRIX(vm->stack_top[-1]);
+	double scalar = TO_DOUBLE(vm->stack_top[-2]);
 	Value result = matrix_scalar_add_value(vm, right, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_SUBTRACT_MATRIX_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	Value result = matrix_scalar_subtract_value(vm, left, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_SUBTRACT_SCALAR_MATRIX: {
-	ObjectMatrix *right = AS_CRUX_MATRIX(current_module_record->stack_top[-1]);
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-2]);
+	ObjectMatrix *right = AS_CRUX_MATRIX(vm->stack_top[-1]);
+	double scalar = TO_DOUBLE(vm->stack_top[-2]);
 	Value result = scalar_matrix_subtract_value(vm, scalar, right);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_MULTIPLY_MATRIX_MATRIX: {
-	ObjectMatrix *right = AS_CRUX_MATRIX(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	ObjectMatrix *right = AS_CRUX_MATRIX(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	ObjectResult *res = AS_CRUX_RESULT(matrix_multiply_value(vm, left, right));
 	if (!res->is_ok) {
-		runtime_panic(current_module_record, res->as.error->type, "%s", res->as.error->message->chars);
+		runtime_panic(vm, res->as.error->type, "%s", res->as.error->message->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = res->as.value;
+	vm->stack_top--;
+	vm->stack_top[-1] = res->as.value;
 	DISPATCH();
 }
 
 OP_MULTIPLY_MATRIX_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	Value result = matrix_scale_value(vm, left, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_MULTIPLY_SCALAR_MATRIX: {
-	ObjectMatrix *right = AS_CRUX_MATRIX(current_module_record->stack_top[-1]);
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-2]);
+	ObjectMatrix *right = AS_CRUX_MATRIX(vm->stack_top[-1]);
+	double scalar = TO_DOUBLE(vm->stack_top[-2]);
 	Value result = matrix_scale_value(vm, right, scalar);
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = result;
+	vm->stack_top--;
+	vm->stack_top[-1] = result;
 	DISPATCH();
 }
 
 OP_DIVIDE_MATRIX_SCALAR: {
-	double scalar = TO_DOUBLE(current_module_record->stack_top[-1]);
-	ObjectMatrix *left = AS_CRUX_MATRIX(current_module_record->stack_top[-2]);
+	double scalar = TO_DOUBLE(vm->stack_top[-1]);
+	ObjectMatrix *left = AS_CRUX_MATRIX(vm->stack_top[-2]);
 	ObjectResult *res = AS_CRUX_RESULT(matrix_scalar_divide_value(vm, left, scalar));
 	if (!res->is_ok) {
-		runtime_panic(current_module_record, res->as.error->type, "%s", res->as.error->message->chars);
+		runtime_panic(vm, res->as.error->type, "%s", res->as.error->message->chars);
 		return INTERPRET_RUNTIME_ERROR;
 	}
-	current_module_record->stack_top--;
-	current_module_record->stack_top[-1] = res->as.value;
+	vm->stack_top--;
+	vm->stack_top[-1] = res->as.value;
 	DISPATCH();
 }
 
@@ -2232,13 +2493,12 @@ OP_INVOKE_STDLIB: {
 	Value callable = READ_CONSTANT();
 	int arg_count = READ_SHORT();
 
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	const Value receiver = PEEK(current_module_record, arg_count);
-	const Value original = PEEK(current_module_record,
+	const Value receiver = PEEK(vm, arg_count);
+	const Value original = PEEK(vm,
 								arg_count + 1); // Store the original caller
 
 	if (!IS_CRUX_OBJECT(receiver)) {
-		runtime_panic(current_module_record, TYPE, "Only instances have methods");
+		runtime_panic(vm, TYPE, "Only instances have methods");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -2247,19 +2507,19 @@ OP_INVOKE_STDLIB: {
 	mark_value(vm, original);
 
 	// Save original stack order
-	current_module_record->stack_top[-arg_count - 1] = callable;
-	current_module_record->stack_top[-arg_count] = receiver;
+	vm->stack_top[-arg_count - 1] = callable;
+	vm->stack_top[-arg_count] = receiver;
 
 	if (!call_value(vm, callable, arg_count)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
 	// restore the caller and put the result in the right place
-	const Value result = pop(current_module_record);
-	push(current_module_record, original);
-	push(current_module_record, result);
+	const Value result = pop(vm);
+	push(vm, original);
+	push(vm, result);
 
-	frame = &current_module_record->frames[current_module_record->frame_count - 1];
+	frame = &vm->frames[vm->frame_count - 1];
 
 	DISPATCH();
 }
@@ -2268,13 +2528,12 @@ OP_INVOKE_STDLIB_UNWRAP: {
 	Value callable = READ_CONSTANT();
 	int arg_count = READ_SHORT();
 
-	ObjectModuleRecord *current_module_record = vm->current_module_record;
-	const Value receiver = PEEK(current_module_record, arg_count);
-	const Value original = PEEK(current_module_record,
+	const Value receiver = PEEK(vm, arg_count);
+	const Value original = PEEK(vm,
 								arg_count + 1); // Store the original caller
 
 	if (!IS_CRUX_OBJECT(receiver)) {
-		runtime_panic(current_module_record, TYPE, "Only instances have methods");
+		runtime_panic(vm, TYPE, "Only instances have methods");
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
@@ -2283,30 +2542,20 @@ OP_INVOKE_STDLIB_UNWRAP: {
 	mark_value(vm, original);
 
 	// Save original stack order
-	current_module_record->stack_top[-arg_count - 1] = callable;
-	current_module_record->stack_top[-arg_count] = receiver;
+	vm->stack_top[-arg_count - 1] = callable;
+	vm->stack_top[-arg_count] = receiver;
 
-	if (!call_value(vm, callable, arg_count)) {
+	// call_native() unwraps the result, and the native does not have to box it
+	if (!call_native(vm, AS_CRUX_NATIVE_CALLABLE(callable), arg_count, true)) {
 		return INTERPRET_RUNTIME_ERROR;
 	}
 
 	// restore the caller and put the result in the right place
-	const Value result = pop(current_module_record);
-	push(current_module_record, original);
+	const Value result = pop(vm);
+	push(vm, original);
+	push(vm, result);
 
-	if (!IS_CRUX_RESULT(result)) {
-		runtime_panic(current_module_record, TYPE, "Only the 'result' type supports unwrapping.");
-		return INTERPRET_RUNTIME_ERROR;
-	}
-	ObjectResult *result_obj = AS_CRUX_RESULT(result);
-	if (result_obj->is_ok) {
-		push(current_module_record, result_obj->as.value);
-	} else {
-		ObjectError *error = result_obj->as.error;
-		runtime_panic(current_module_record, RUNTIME, "Panic: %s", error->message->chars);
-	}
-
-	frame = &current_module_record->frames[current_module_record->frame_count - 1];
+	frame = &vm->frames[vm->frame_count - 1];
 
 	DISPATCH();
 }
@@ -2315,10 +2564,10 @@ OP_POP_N: {
 	uint16_t pop_count = READ_SHORT();
 #ifdef STACK_SAFETY
 	for (uint16_t i = 0; i < pop_count; i++) {
-		pop(current_module_record);
+		pop(vm);
 	}
 #else
-	current_module_record->stack_top -= pop_count;
+	vm->stack_top -= pop_count;
 #endif
 	DISPATCH();
 }
@@ -2327,54 +2576,77 @@ OP_DEFINE_PUB_GLOBAL: {
 	uint16_t index = READ_SHORT();
 	ObjectString *name = READ_STRING();
 	ObjectModuleRecord *frame_module_record = frame->closure->function->module_record;
-	frame_module_record->globals[index] = PEEK(current_module_record, 0);
-	table_set(vm, &frame_module_record->publics, name, PEEK(current_module_record, 0));
+	frame_module_record->globals[index] = PEEK(vm, 0);
+	table_set(vm, &frame_module_record->publics, name, PEEK(vm, 0));
 
-	pop(current_module_record);
+	pop(vm);
 	DISPATCH();
 }
 
 OP_0_INT: {
-	push(current_module_record, INT_VAL(0));
+	push(vm, INT_VAL(0));
 	DISPATCH();
 }
 OP_1_INT: {
-	push(current_module_record, INT_VAL(1));
+	push(vm, INT_VAL(1));
 	DISPATCH();
 }
 OP_2_INT: {
-	push(current_module_record, INT_VAL(2));
+	push(vm, INT_VAL(2));
 	DISPATCH();
 }
 OP_0_FLOAT: {
-	push(current_module_record, FLOAT_VAL(0));
+	push(vm, FLOAT_VAL(0));
 	DISPATCH();
 }
 OP_1_FLOAT: {
-	push(current_module_record, FLOAT_VAL(1));
+	push(vm, FLOAT_VAL(1));
 	DISPATCH();
 }
 OP_2_FLOAT: {
-	push(current_module_record, FLOAT_VAL(2));
+	push(vm, FLOAT_VAL(2));
+	DISPATCH();
+}
+
+OP_YIELD: {
+	// only emitted inside generator bodies, which always run as the current coroutine's base frame.
+	// The yielded value keeps its slot, and resuming overwrites it with the sent value
+	vm->current_coroutine->transfer = PEEK(vm, 0);
+	return INTERPRET_YIELD;
+}
+
+OP_NEW_STRUCT: {
+	// the struct type sits below its field values, which the compiler ordered by slot
+	const uint16_t fieldCount = READ_SHORT();
+	Value *fieldValues = vm->stack_top - fieldCount;
+	ObjectStructInstance *structInstance = new_struct_instance(vm, AS_CRUX_STRUCT(fieldValues[-1]), fieldCount);
+	if (fieldCount > 0) {
+		memcpy(structInstance->fields, fieldValues, sizeof(Value) * fieldCount);
+	}
+	vm->stack_top = fieldValues - 1;
+	push(vm, OBJECT_VAL(structInstance));
 	DISPATCH();
 }
 
 end: {
 	printf("        ");
-	for (Value *slot = current_module_record->stack; slot < current_module_record->stack_top; slot++) {
+	for (Value *slot = vm->stack; slot < vm->stack_top; slot++) {
 		printf("[");
 		print_value(*slot, false);
 		printf("]");
 	}
 	printf("\n");
 
-	disassemble_instruction(&frame->closure->function->chunk, (int)(frame->ip - frame->closure->function->chunk.code));
+	disassemble_instruction(&frame->closure->function->chunk,
+							(int)(frame->ip - frame->closure->function->chunk.threaded));
 
-	instruction = READ_SHORT();
-	goto *dispatchTable[instruction];
+	goto *(frame->ip++)->handler;
 }
 
 #undef READ_CONSTANT
+#undef QUICKEN_BINARY
+#undef GUARD_BINARY
+#undef QUICK_COMPARISON
 #undef BINARY_OP
 #undef BOOL_BINARY_OP
 #undef READ_STRING
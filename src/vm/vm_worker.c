@@ -0,0 +1,716 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "file_handler.h"
+#include "object.h"
+#include "worker.h"
+
+#define WORKER_MESSAGE_MAX_DEPTH 128
+
+typedef enum {
+	MESSAGE_NIL,
+	MESSAGE_FALSE,
+	MESSAGE_TRUE,
+	MESSAGE_INT,
+	MESSAGE_FLOAT,
+	MESSAGE_STRING,
+	MESSAGE_ARRAY,
+	MESSAGE_TABLE,
+	MESSAGE_TUPLE,
+} MessageTag;
+
+struct WorkerMessage {
+	WorkerMessage *next; // link while the message waits in a channel
+	uint8_t *bytes;
+	size_t length;
+	size_t capacity;
+};
+
+typedef struct {
+	const uint8_t *at;
+} MessageReader;
+
+void free_worker_message(WorkerMessage *message)
+{
+	if (message == NULL) {
+		return;
+	}
+	free(message->bytes);
+	free(message);
+}
+
+static bool write_bytes(WorkerMessage *message, const void *bytes, const size_t length)
+{
+	if (message->length + length > message->capacity) {
+		size_t new_capacity = message->capacity < 64 ? 64 : message->capacity * 2;
+		while (new_capacity < message->length + length) {
+			new_capacity *= 2;
+		}
+		uint8_t *grown = realloc(message->bytes, new_capacity);
+		if (grown == NULL) {
+			return false;
+		}
+		message->bytes = grown;
+		message->capacity = new_capacity;
+	}
+	memcpy(message->bytes + message->length, bytes, length);
+	message->length += length;
+	return true;
+}
+
+static bool write_tag(WorkerMessage *message, const MessageTag tag)
+{
+	const uint8_t byte = (uint8_t)tag;
+	return write_bytes(message, &byte, 1);
+}
+
+static bool write_count(WorkerMessage *message, const MessageTag tag, const uint32_t count)
+{
+	return write_tag(message, tag) && write_bytes(message, &count, sizeof(count));
+}
+
+static bool encode_value(WorkerMessage *message, const Value value, const int depth, const char **error_out)
+{
+	if (depth > WORKER_MESSAGE_MAX_DEPTH) {
+		*error_out = "Value is nested too deeply to be copied to another worker.";
+		return false;
+	}
+
+	bool written = true;
+	if (IS_NIL(value)) {
+		written = write_tag(message, MESSAGE_NIL);
+	} else if (IS_BOOL(value)) {
+		written = write_tag(message, AS_BOOL(value) ? MESSAGE_TRUE : MESSAGE_FALSE);
+	} else if (IS_INT(value)) {
+		const int32_t integer = AS_INT(value);
+		written = write_tag(message, MESSAGE_INT) && write_bytes(message, &integer, sizeof(integer));
+	} else if (IS_FLOAT(value)) {
+		const double number = AS_FLOAT(value);
+		written = write_tag(message, MESSAGE_FLOAT) && write_bytes(message, &number, sizeof(number));
+	} else if (IS_CRUX_STRING(value)) {
+		const ObjectString *string = AS_CRUX_STRING(value);
+		written = write_count(message, MESSAGE_STRING, string->byte_length) &&
+				  write_bytes(message, string->chars, string->byte_length);
+	} else if (IS_CRUX_ARRAY(value)) {
+		const ObjectArray *array = AS_CRUX_ARRAY(value);
+		written = write_count(message, MESSAGE_ARRAY, array->size);
+		for (uint32_t i = 0; written && i < array->size; i++) {
+			if (!encode_value(message, array->values[i], depth + 1, error_out)) {
+				return false;
+			}
+		}
+	} else if (IS_CRUX_TABLE(value)) {
+		const ObjectTable *table = AS_CRUX_TABLE(value);
+		written = write_count(message, MESSAGE_TABLE, table->size);
+		for (uint32_t i = 0; written && i < table->capacity; i++) {
+			const ObjectTableEntry *entry = &table->entries[i];
+			if (!entry->is_occupied) {
+				continue;
+			}
+			if (!encode_value(message, entry->key, depth + 1, error_out) ||
+				!encode_value(message, entry->value, depth + 1, error_out)) {
+				return false;
+			}
+		}
+	} else if (IS_CRUX_TUPLE(value)) {
+		const ObjectTuple *tuple = AS_CRUX_TUPLE(value);
+		written = write_count(message, MESSAGE_TUPLE, tuple->size);
+		for (uint32_t i = 0; written && i < tuple->size; i++) {
+			if (!encode_value(message, tuple->elements[i], depth + 1, error_out)) {
+				return false;
+			}
+		}
+	} else {
+		*error_out = "Only Nil, Bool, Int, Float, String, Array, Table and Tuple values can be copied to another worker.";
+		return false;
+	}
+
+	if (!written) {
+		*error_out = "Failed to allocate memory for the worker message.";
+	}
+	return written;
+}
+
+WorkerMessage *encode_worker_message(const Value value, const char **error_out)
+{
+	WorkerMessage *message = calloc(1, sizeof(WorkerMessage));
+	if (message == NULL) {
+		*error_out = "Failed to allocate memory for the worker message.";
+		return NULL;
+	}
+	if (!encode_value(message, value, 0, error_out)) {
+		free_worker_message(message);
+		return NULL;
+	}
+	return message;
+}
+
+WorkerMessage *encode_worker_values(const Value *values, const uint32_t count, const char **error_out)
+{
+	WorkerMessage *message = calloc(1, sizeof(WorkerMessage));
+	if (message == NULL || !write_count(message, MESSAGE_ARRAY, count)) {
+		free_worker_message(message);
+		*error_out = "Failed to allocate memory for the worker message.";
+		return NULL;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (!encode_value(message, values[i], 1, error_out)) {
+			free_worker_message(message);
+			return NULL;
+		}
+	}
+	return message;
+}
+
+static uint32_t read_count(MessageReader *reader)
+{
+	uint32_t count;
+	memcpy(&count, reader->at, sizeof(count));
+	reader->at += sizeof(count);
+	return count;
+}
+
+/**
+ * Messages are only produced by encode_worker_message(), so the reader trusts their structure.
+ */
+static bool decode_value(VM *vm, MessageReader *reader, Value *value_out)
+{
+	const MessageTag tag = (MessageTag)*reader->at++;
+	switch (tag) {
+	case MESSAGE_NIL:
+		*value_out = NIL_VAL;
+		return true;
+	case MESSAGE_FALSE:
+		*value_out = FALSE_VAL;
+		return true;
+	case MESSAGE_TRUE:
+		*value_out = TRUE_VAL;
+		return true;
+	case MESSAGE_INT: {
+		int32_t integer;
+		memcpy(&integer, reader->at, sizeof(integer));
+		reader->at += sizeof(integer);
+		*value_out = INT_VAL(integer);
+		return true;
+	}
+	case MESSAGE_FLOAT: {
+		double number;
+		memcpy(&number, reader->at, sizeof(number));
+		reader->at += sizeof(number);
+		*value_out = FLOAT_VAL(number);
+		return true;
+	}
+	case MESSAGE_STRING: {
+		const uint32_t length = read_count(reader);
+		ObjectString *string = copy_string(vm, (const char *)reader->at, length);
+		reader->at += length;
+		*value_out = OBJECT_VAL(string);
+		return string != NULL;
+	}
+	case MESSAGE_ARRAY: {
+		const uint32_t size = read_count(reader);
+		ObjectArray *array = new_array(vm, size);
+		push(vm, OBJECT_VAL(array));
+		for (uint32_t i = 0; i < size; i++) {
+			Value element;
+			if (!decode_value(vm, reader, &element)) {
+				pop(vm);
+				return false;
+			}
+			push(vm, element);
+			const bool added = array_add_back(vm, array, element);
+			pop(vm);
+			if (!added) {
+				pop(vm);
+				return false;
+			}
+		}
+		pop(vm);
+		*value_out = OBJECT_VAL(array);
+		return true;
+	}
+	case MESSAGE_TABLE: {
+		const uint32_t size = read_count(reader);
+		ObjectTable *table = new_object_table(vm, (int)size);
+		push(vm, OBJECT_VAL(table));
+		for (uint32_t i = 0; i < size; i++) {
+			Value key;
+			Value entry_value;
+			if (!decode_value(vm, reader, &key)) {
+				pop(vm);
+				return false;
+			}
+			push(vm, key);
+			if (!decode_value(vm, reader, &entry_value)) {
+				pop_two(vm);
+				return false;
+			}
+			push(vm, entry_value);
+			const bool set = object_table_set(vm, table, key, entry_value);
+			pop_two(vm);
+			if (!set) {
+				pop(vm);
+				return false;
+			}
+		}
+		pop(vm);
+		*value_out = OBJECT_VAL(table);
+		return true;
+	}
+	case MESSAGE_TUPLE: {
+		const uint32_t size = read_count(reader);
+		ObjectTuple *tuple = new_tuple(vm, size);
+		for (uint32_t i = 0; i < size; i++) {
+			tuple->elements[i] = NIL_VAL;
+		}
+		push(vm, OBJECT_VAL(tuple));
+		for (uint32_t i = 0; i < size; i++) {
+			if (!decode_value(vm, reader, &tuple->elements[i])) {
+				pop(vm);
+				return false;
+			}
+		}
+		pop(vm);
+		*value_out = OBJECT_VAL(tuple);
+		return true;
+	}
+	}
+	return false;
+}
+
+bool decode_worker_message(VM *vm, const WorkerMessage *message, Value *value_out)
+{
+	MessageReader reader = {.at = message->bytes};
+	return decode_value(vm, &reader, value_out);
+}
+
+bool load_isolate(VM *vm, const char *path, const char *function_name, const int arity, Value *function_out,
+				  const char **error_out)
+{
+	const FileResult file = read_file(path);
+	if (file.error != NULL) {
+		free_file_result(file);
+		*error_out = "Failed to read the isolate's script.";
+		return false;
+	}
+	const InterpretResult loaded = interpret(vm, file.content);
+	free(file.content);
+	if (loaded != INTERPRET_OK) {
+		*error_out = "The isolate's script failed to run.";
+		return false;
+	}
+
+	const ObjectModuleRecord *module_record = vm->current_module_record;
+	const ObjectString *name = copy_string(vm, function_name, (uint32_t)strlen(function_name));
+	uint32_t index;
+	if (!get_module_global_index(module_record, name, &index)) {
+		*error_out = "The isolate's script does not define the function.";
+		return false;
+	}
+	const Value function = module_record->globals[index];
+	if (!IS_CRUX_CLOSURE(function) || AS_CRUX_CLOSURE(function)->function->arity != arity) {
+		*error_out = "The isolate's function does not take the expected number of arguments.";
+		return false;
+	}
+	*function_out = function;
+	return true;
+}
+
+bool call_isolate_function(VM *vm, const Value function, const Value *args, const int arg_count, Value *result_out)
+{
+	// the call may grow the stack and move it
+	const ptrdiff_t stack_depth = vm->stack_top - vm->stack;
+	const uint32_t frame_count = vm->frame_count;
+	if (setjmp(vm->jump_buffer) != 0) {
+		return false;
+	}
+	// the script frame is the caller, so that returning from the function hands back its result
+	ObjectClosure *script = vm->current_module_record->module_closure;
+	push(vm, OBJECT_VAL(script));
+	call(vm, script, 0);
+	push(vm, function);
+	for (int i = 0; i < arg_count; i++) {
+		push(vm, args[i]);
+	}
+	const bool called = call_from_native(vm, function, arg_count, result_out) == INTERPRET_OK;
+	vm->stack_top = vm->stack + stack_depth;
+	vm->frame_count = frame_count;
+	return called;
+}
+
+#ifdef _WIN32
+
+static const char *const unsupported_error = "Workers are not supported on Windows.";
+
+bool spawn_worker(VM *vm, const char *path, const char *function_name, WorkerMessage *argument, uint32_t *id_out,
+				  const char **error_out)
+{
+	(void)vm;
+	(void)path;
+	(void)function_name;
+	(void)id_out;
+	free_worker_message(argument);
+	*error_out = unsupported_error;
+	return false;
+}
+
+bool send_to_worker(VM *vm, const uint32_t id, WorkerMessage *message, const char **error_out)
+{
+	(void)vm;
+	(void)id;
+	free_worker_message(message);
+	*error_out = unsupported_error;
+	return false;
+}
+
+WorkerMessage *receive_from_worker(VM *vm, const uint32_t id, const char **error_out)
+{
+	(void)vm;
+	(void)id;
+	*error_out = unsupported_error;
+	return NULL;
+}
+
+bool join_worker(VM *vm, const uint32_t id, WorkerMessage **result_out, const char **error_out)
+{
+	(void)vm;
+	(void)id;
+	(void)result_out;
+	*error_out = unsupported_error;
+	return false;
+}
+
+bool send_to_parent(VM *vm, WorkerMessage *message, const char **error_out)
+{
+	(void)vm;
+	free_worker_message(message);
+	*error_out = unsupported_error;
+	return false;
+}
+
+WorkerMessage *receive_from_parent(VM *vm, const char **error_out)
+{
+	(void)vm;
+	*error_out = unsupported_error;
+	return NULL;
+}
+
+void free_workers(VM *vm)
+{
+	(void)vm;
+}
+
+#else
+
+/**
+ * A queue of messages from one thread to another.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	WorkerMessage *head;
+	WorkerMessage *tail;
+	bool closed; // no message will be queued anymore
+} Channel;
+
+struct Worker {
+	pthread_t thread;
+	char *path;
+	char *function_name;
+	const char *argv[2]; // the worker VM's sys.args(), the script path is also its module path
+	WorkerMessage *argument;
+	Channel inbox; // parent to worker
+	Channel outbox; // worker to parent
+	WorkerMessage *result; // set before the outbox is closed
+	const char *error; // static message, set instead of result when the worker failed
+};
+
+static void init_channel(Channel *channel)
+{
+	pthread_mutex_init(&channel->lock, NULL);
+	pthread_cond_init(&channel->ready, NULL);
+	channel->head = NULL;
+	channel->tail = NULL;
+	channel->closed = false;
+}
+
+static void free_channel(Channel *channel)
+{
+	WorkerMessage *message = channel->head;
+	while (message != NULL) {
+		WorkerMessage *next = message->next;
+		free_worker_message(message);
+		message = next;
+	}
+	pthread_cond_destroy(&channel->ready);
+	pthread_mutex_destroy(&channel->lock);
+}
+
+static bool channel_send(Channel *channel, WorkerMessage *message)
+{
+	pthread_mutex_lock(&channel->lock);
+	if (channel->closed) {
+		pthread_mutex_unlock(&channel->lock);
+		free_worker_message(message);
+		return false;
+	}
+	message->next = NULL;
+	if (channel->tail == NULL) {
+		channel->head = message;
+	} else {
+		channel->tail->next = message;
+	}
+	channel->tail = message;
+	pthread_cond_signal(&channel->ready);
+	pthread_mutex_unlock(&channel->lock);
+	return true;
+}
+
+/**
+ * Waits for a message. Returns NULL once the channel is closed and empty.
+ */
+static WorkerMessage *channel_receive(Channel *channel)
+{
+	pthread_mutex_lock(&channel->lock);
+	while (channel->head == NULL && !channel->closed) {
+		pthread_cond_wait(&channel->ready, &channel->lock);
+	}
+	WorkerMessage *message = channel->head;
+	if (message != NULL) {
+		channel->head = message->next;
+		if (channel->head == NULL) {
+			channel->tail = NULL;
+		}
+	}
+	pthread_mutex_unlock(&channel->lock);
+	return message;
+}
+
+static void channel_close(Channel *channel)
+{
+	pthread_mutex_lock(&channel->lock);
+	channel->closed = true;
+	pthread_cond_broadcast(&channel->ready);
+	pthread_mutex_unlock(&channel->lock);
+}
+
+static void free_worker(Worker *worker)
+{
+	free_channel(&worker->inbox);
+	free_channel(&worker->outbox);
+	free_worker_message(worker->argument);
+	free_worker_message(worker->result);
+	free(worker->path);
+	free(worker->function_name);
+	free(worker);
+}
+
+/**
+ * Runs the worker script and its function. Returns NULL on success or a static message describing the failure.
+ */
+static const char *run_worker_function(VM *vm, const Worker *worker, WorkerMessage **result_out)
+{
+	const char *error = NULL;
+	Value function;
+	if (!load_isolate(vm, worker->path, worker->function_name, 1, &function, &error)) {
+		return error;
+	}
+
+	Value argument;
+	if (!decode_worker_message(vm, worker->argument, &argument)) {
+		return "Failed to copy the argument into the worker.";
+	}
+	Value result;
+	if (!call_isolate_function(vm, function, &argument, 1, &result)) {
+		return "The worker function panicked.";
+	}
+	*result_out = encode_worker_message(result, &error);
+	return error;
+}
+
+static void *worker_main(void *arg)
+{
+	Worker *worker = arg;
+	WorkerMessage *result = NULL;
+	const char *error = NULL;
+
+	VM *vm = new_vm(2, worker->argv);
+	if (vm == NULL) {
+		error = "Failed to create the worker's virtual machine.";
+	} else {
+		vm->worker = worker;
+		error = run_worker_function(vm, worker, &result);
+		free_vm(vm);
+	}
+
+	if (error != NULL) {
+		free_worker_message(result);
+		result = NULL;
+	}
+	channel_close(&worker->inbox);
+	pthread_mutex_lock(&worker->outbox.lock);
+	worker->result = result;
+	worker->error = error;
+	pthread_mutex_unlock(&worker->outbox.lock);
+	channel_close(&worker->outbox);
+	return NULL;
+}
+
+static char *copy_c_string(const char *string)
+{
+	const size_t length = strlen(string) + 1;
+	char *copy = malloc(length);
+	if (copy != NULL) {
+		memcpy(copy, string, length);
+	}
+	return copy;
+}
+
+bool spawn_worker(VM *vm, const char *path, const char *function_name, WorkerMessage *argument, uint32_t *id_out,
+				  const char **error_out)
+{
+	WorkerSet *workers = &vm->workers;
+	if (workers->count == workers->capacity) {
+		const uint32_t new_capacity = workers->capacity < 8 ? 8 : workers->capacity * 2;
+		Worker **items = realloc(workers->items, sizeof(Worker *) * new_capacity);
+		if (items == NULL) {
+			free_worker_message(argument);
+			*error_out = "Failed to allocate memory for the worker.";
+			return false;
+		}
+		workers->items = items;
+		workers->capacity = new_capacity;
+	}
+
+	Worker *worker = calloc(1, sizeof(Worker));
+	if (worker == NULL) {
+		free_worker_message(argument);
+		*error_out = "Failed to allocate memory for the worker.";
+		return false;
+	}
+	init_channel(&worker->inbox);
+	init_channel(&worker->outbox);
+	worker->argument = argument;
+	worker->path = copy_c_string(path);
+	worker->function_name = copy_c_string(function_name);
+	if (worker->path == NULL || worker->function_name == NULL) {
+		free_worker(worker);
+		*error_out = "Failed to allocate memory for the worker.";
+		return false;
+	}
+	worker->argv[0] = "crux";
+	worker->argv[1] = worker->path;
+
+	if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+		free_worker(worker);
+		*error_out = "Failed to start the worker thread.";
+		return false;
+	}
+	*id_out = workers->count;
+	workers->items[workers->count++] = worker;
+	return true;
+}
+
+static Worker *find_worker(const VM *vm, const uint32_t id, const char **error_out)
+{
+	if (id >= vm->workers.count || vm->workers.items[id] == NULL) {
+		*error_out = "No running worker has this id.";
+		return NULL;
+	}
+	return vm->workers.items[id];
+}
+
+bool send_to_worker(VM *vm, const uint32_t id, WorkerMessage *message, const char **error_out)
+{
+	Worker *worker = find_worker(vm, id, error_out);
+	if (worker == NULL) {
+		free_worker_message(message);
+		return false;
+	}
+	if (!channel_send(&worker->inbox, message)) {
+		*error_out = "The worker has already finished.";
+		return false;
+	}
+	return true;
+}
+
+WorkerMessage *receive_from_worker(VM *vm, const uint32_t id, const char **error_out)
+{
+	Worker *worker = find_worker(vm, id, error_out);
+	if (worker == NULL) {
+		return NULL;
+	}
+	WorkerMessage *message = channel_receive(&worker->outbox);
+	if (message == NULL) {
+		*error_out = "The worker finished without sending another message.";
+	}
+	return message;
+}
+
+bool join_worker(VM *vm, const uint32_t id, WorkerMessage **result_out, const char **error_out)
+{
+	Worker *worker = find_worker(vm, id, error_out);
+	if (worker == NULL) {
+		return false;
+	}
+	pthread_join(worker->thread, NULL);
+	vm->workers.items[id] = NULL;
+
+	const bool succeeded = worker->error == NULL;
+	if (succeeded) {
+		*result_out = worker->result;
+		worker->result = NULL;
+	} else {
+		*error_out = worker->error;
+	}
+	free_worker(worker);
+	return succeeded;
+}
+
+bool send_to_parent(VM *vm, WorkerMessage *message, const char **error_out)
+{
+	if (vm->worker == NULL) {
+		free_worker_message(message);
+		*error_out = "send_parent() can only be called inside a worker.";
+		return false;
+	}
+	return channel_send(&vm->worker->outbox, message);
+}
+
+WorkerMessage *receive_from_parent(VM *vm, const char **error_out)
+{
+	if (vm->worker == NULL) {
+		*error_out = "receive_parent() can only be called inside a worker.";
+		return NULL;
+	}
+	WorkerMessage *message = channel_receive(&vm->worker->inbox);
+	if (message == NULL) {
+		*error_out = "The parent stopped sending messages to this worker.";
+	}
+	return message;
+}
+
+void free_workers(VM *vm)
+{
+	WorkerSet *workers = &vm->workers;
+	for (uint32_t i = 0; i < workers->count; i++) {
+		Worker *worker = workers->items[i];
+		if (worker == NULL) {
+			continue;
+		}
+		// wakes the worker up if it waits for a message that can no longer come
+		channel_close(&worker->inbox);
+		pthread_join(worker->thread, NULL);
+		free_worker(worker);
+	}
+	free(workers->items);
+	workers->items = NULL;
+	workers->count = 0;
+	workers->capacity = 0;
+}
+
+#endif
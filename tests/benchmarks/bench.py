@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""Run the curated Crux macro benchmark suite with warm-up runs, repeated timing and a baseline comparison.
+
+Each benchmark runs in a scratch directory (they write their renders/ output relative to the script), is timed
+--warmup times without recording and --repeat times with recording, and is summarized by its median wall time with
+a distribution-free 95% confidence interval of the median. --json writes the results, --baseline compares against an
+earlier --json file and exits with status 1 when a benchmark got slower by more than --threshold percent with
+non-overlapping confidence intervals.
+"""
+import argparse
+import json
+import math
+import platform
+import shutil
+import statistics
+import subprocess
+import tempfile
+import time
+from pathlib import Path
+from typing import Any
+
+REPO_ROOT = Path(__file__).resolve().parents[2]
+BENCHMARK_DIR = REPO_ROOT / "tests" / "benchmarks"
+DEFAULT_EXE = REPO_ROOT / "build" / "crux"
+
+SUITE = [
+    "fib",
+    "mandelbrot",
+    "ray_tracer",
+    "string_processing",
+    "terrain_gen",
+    "tables",
+    "structs",
+    "closures",
+]
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Time the curated Crux benchmark suite."
+    )
+    parser.add_argument(
+        "benchmarks",
+        nargs="*",
+        default=SUITE,
+        help=f"Benchmarks to run, by name. Default: {' '.join(SUITE)}",
+    )
+    parser.add_argument(
+        "--exe",
+        type=Path,
+        default=DEFAULT_EXE,
+        help=f"Path to the crux executable. Default: {DEFAULT_EXE}",
+    )
+    parser.add_argument(
+        "--repeat",
+        type=int,
+        default=5,
+        help="How many timed runs per benchmark.",
+    )
+    parser.add_argument(
+        "--warmup",
+        type=int,
+        default=1,
+        help="How many untimed runs per benchmark before the timed ones.",
+    )
+    parser.add_argument(
+        "--json",
+        type=Path,
+        help="Write the results to a JSON file.",
+    )
+    parser.add_argument(
+        "--baseline",
+        type=Path,
+        help="Compare against a JSON file written by an earlier --json run.",
+    )
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=5.0,
+        help="Slowdown in percent above which a benchmark counts as a regression.",
+    )
+    return parser.parse_args()
+
+
+def median_confidence_interval(samples: list[float]) -> tuple[float, float]:
+    """Order statistics bounding the median with at least 95% confidence, from the binomial(n, 1/2) tails."""
+    ordered = sorted(samples)
+    count = len(ordered)
+    low = 0
+    tail = 0.0
+    for k in range(count // 2):
+        probability = math.comb(count, k) / 2**count
+        if tail + probability > 0.025:
+            break
+        tail += probability
+        low = k + 1
+    return ordered[low], ordered[count - 1 - low]
+
+
+def run_once(exe: Path, script: Path, workdir: Path) -> float:
+    started = time.perf_counter()
+    completed = subprocess.run(
+        [str(exe), script.name],
+        cwd=workdir,
+        text=True,
+        capture_output=True,
+        check=False,
+    )
+    wall_ms = (time.perf_counter() - started) * 1000.0
+    if completed.returncode != 0:
+        raise RuntimeError(
+            f"{script.name} failed with exit code {completed.returncode}\n"
+            f"STDOUT:\n{completed.stdout}\n"
+            f"STDERR:\n{completed.stderr}"
+        )
+    return wall_ms
+
+
+def run_benchmark(exe: Path, name: str, repeat: int, warmup: int) -> dict[str, Any]:
+    source = BENCHMARK_DIR / f"{name}.crux"
+    if not source.is_file():
+        raise FileNotFoundError(f"Benchmark not found: {source}")
+
+    with tempfile.TemporaryDirectory(prefix=f"crux-bench-{name}-") as scratch:
+        workdir = Path(scratch)
+        (workdir / "renders").mkdir()
+        script = workdir / source.name
+        shutil.copyfile(source, script)
+
+        for _ in range(warmup):
+            run_once(exe, script, workdir)
+        samples = [run_once(exe, script, workdir) for _ in range(repeat)]
+
+    ci_low, ci_high = median_confidence_interval(samples)
+    return {
+        "name": name,
+        "median_ms": statistics.median(samples),
+        "ci_low_ms": ci_low,
+        "ci_high_ms": ci_high,
+        "min_ms": min(samples),
+        "max_ms": max(samples),
+        "stdev_ms": statistics.stdev(samples) if len(samples) > 1 else 0.0,
+        "samples_ms": samples,
+    }
+
+
+def git_revision() -> str:
+    completed = subprocess.run(
+        ["git", "rev-parse", "--short", "HEAD"],
+        cwd=REPO_ROOT,
+        text=True,
+        capture_output=True,
+        check=False,
+    )
+    return completed.stdout.strip() if completed.returncode == 0 else "unknown"
+
+
+def compare(results: list[dict[str, Any]], baseline_path: Path, threshold: float) -> bool:
+    baseline = {
+        entry["name"]: entry
+        for entry in json.loads(baseline_path.read_text(encoding="utf-8"))["benchmarks"]
+    }
+    regressed = False
+    print(f"\n{'benchmark':<20} {'baseline ms':>12} {'current ms':>12} {'change':>9}")
+    for result in results:
+        previous = baseline.get(result["name"])
+        if previous is None or previous["median_ms"] <= 0:
+            continue
+        change = (result["median_ms"] / previous["median_ms"] - 1.0) * 100.0
+        slower = change > threshold and result["ci_low_ms"] > previous["ci_high_ms"]
+        regressed = regressed or slower
+        print(
+            f"{result['name']:<20} {previous['median_ms']:>12.1f} {result['median_ms']:>12.1f} "
+            f"{change:>+8.1f}%{'  REGRESSION' if slower else ''}"
+        )
+    return regressed
+
+
+def main() -> int:
+    args = parse_args()
+    exe = (REPO_ROOT / args.exe).resolve() if not args.exe.is_absolute() else args.exe
+
+    if not exe.exists():
+        raise FileNotFoundError(f"Executable not found: {exe}")
+    if args.repeat < 1:
+        raise ValueError("--repeat must be at least 1")
+    if args.warmup < 0:
+        raise ValueError("--warmup must not be negative")
+
+    print(f"{'benchmark':<20} {'median ms':>12} {'95% CI low':>12} {'95% CI high':>12}")
+    results = []
+    for name in args.benchmarks:
+        result = run_benchmark(exe, name, args.repeat, args.warmup)
+        results.append(result)
+        print(
+            f"{name:<20} {result['median_ms']:>12.1f} {result['ci_low_ms']:>12.1f} "
+            f"{result['ci_high_ms']:>12.1f}"
+        )
+
+    if args.json:
+        args.json.parent.mkdir(parents=True, exist_ok=True)
+        args.json.write_text(
+            json.dumps(
+                {
+                    "revision": git_revision(),
+                    "executable": str(exe),
+                    "platform": platform.platform(),
+                    "repeat": args.repeat,
+                    "warmup": args.warmup,
+                    "benchmarks": results,
+                },
+                indent=2,
+            )
+            + "\n",
+            encoding="utf-8",
+        )
+
+    if args.baseline and compare(results, args.baseline, args.threshold):
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
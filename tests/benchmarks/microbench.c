@@ -0,0 +1,428 @@
+/**
+ * Microbenchmarks for the runtime's hot C paths: string tables, string interning, the slab allocator and the phases
+ * of a garbage collection.
+ *
+ * Built by the crux-microbench CMake target and run by crux-bench. Every benchmark is timed --repeat times after
+ * --warmup untimed runs and reported as the median time per operation with a 95% confidence interval of the median.
+ * --json writes the results, and --baseline compares against a file written by an earlier --json run, exiting with
+ * status 1 if a benchmark became slower by more than --threshold percent with non-overlapping intervals.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "garbage_collector.h"
+#include "object.h"
+#include "slab_allocator.h"
+#include "table.h"
+#include "vm.h"
+
+#define DEFAULT_REPEAT 15
+#define DEFAULT_WARMUP 3
+#define DEFAULT_THRESHOLD_PERCENT 5.0
+#define MAX_RESULTS 32
+#define KEY_LENGTH 24
+
+typedef struct {
+	VM *vm;
+	ObjectArray *keep_alive; // rooted on the VM stack so benchmark data survives the GC benchmarks
+	ObjectString **keys;
+	char (*fresh_chars)[KEY_LENGTH];
+	uint32_t run;
+} BenchContext;
+
+typedef struct {
+	const char *name;
+	uint32_t operations;
+	uint64_t (*run)(BenchContext *context, uint32_t operations); // returns the elapsed nanoseconds
+} MicroBenchmark;
+
+typedef struct {
+	const char *name;
+	double median_ns;
+	double ci_low_ns;
+	double ci_high_ns;
+	double min_ns;
+} BenchResult;
+
+typedef struct {
+	char name[64];
+	double median_ns;
+	double ci_high_ns;
+} BaselineEntry;
+
+static uint64_t now_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (counter.QuadPart * 1000000000LL) / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Keeps the compiler from discarding results that are only computed for timing
+static volatile uint64_t sink;
+
+static uint64_t bench_table_set(BenchContext *context, const uint32_t operations)
+{
+	Table table;
+	init_table(&table);
+	const uint64_t start = now_ns();
+	for (uint32_t i = 0; i < operations; i++) {
+		table_set(context->vm, &table, context->keys[i], INT_VAL((int32_t)i));
+	}
+	const uint64_t elapsed = now_ns() - start;
+	sink += table.count;
+	free_table(context->vm, &table);
+	return elapsed;
+}
+
+static uint64_t bench_table_get(BenchContext *context, const uint32_t operations)
+{
+	Table table;
+	init_table(&table);
+	for (uint32_t i = 0; i < operations; i++) {
+		table_set(context->vm, &table, context->keys[i], INT_VAL((int32_t)i));
+	}
+	uint64_t found = 0;
+	const uint64_t start = now_ns();
+	for (uint32_t i = 0; i < operations; i++) {
+		Value value;
+		found += table_get(&table, context->keys[(i * 7919u) % operations], &value);
+	}
+	const uint64_t elapsed = now_ns() - start;
+	sink += found;
+	free_table(context->vm, &table);
+	return elapsed;
+}
+
+static uint64_t bench_copy_string_interned(BenchContext *context, const uint32_t operations)
+{
+	const uint64_t start = now_ns();
+	for (uint32_t i = 0; i < operations; i++) {
+		const ObjectString *key = context->keys[i];
+		sink += (uintptr_t)copy_string(context->vm, key->chars, key->byte_length);
+	}
+	return now_ns() - start;
+}
+
+static uint64_t bench_copy_string_new(BenchContext *context, const uint32_t operations)
+{
+	// every run interns strings no earlier run has seen, the GC is paused so they stay in the string table
+	context->run++;
+	for (uint32_t i = 0; i < operations; i++) {
+		snprintf(context->fresh_chars[i], KEY_LENGTH, "fresh-%u-%u", context->run, i);
+	}
+	const uint64_t start = now_ns();
+	for (uint32_t i = 0; i < operations; i++) {
+		const char *chars = context->fresh_chars[i];
+		sink += (uintptr_t)copy_string(context->vm, chars, (uint32_t)strlen(chars));
+	}
+	return now_ns() - start;
+}
+
+static uint64_t bench_slab_alloc_free(BenchContext *context, const uint32_t operations)
+{
+	void **slots = malloc(sizeof(void *) * operations);
+	if (slots == NULL) {
+		return 0;
+	}
+	SlabAllocator *slab = context->vm->slab_32;
+	const uint64_t start = now_ns();
+	for (uint32_t i = 0; i < operations; i++) {
+		slots[i] = allocate_from_slab(slab);
+	}
+	for (uint32_t i = operations; i > 0; i--) {
+		free_from_slab(slab, slots[i - 1]);
+	}
+	const uint64_t elapsed = now_ns() - start;
+	free(slots);
+	return elapsed;
+}
+
+typedef enum { GC_PHASE_TOTAL, GC_PHASE_MARK_ROOTS, GC_PHASE_TRACE, GC_PHASE_SWEEP } GcPhase;
+
+/**
+ * Collects a heap of <operations> objects, half of them reachable through an array, and returns one phase's time.
+ */
+static uint64_t gc_cycle(BenchContext *context, const uint32_t operations, const GcPhase phase)
+{
+	VM *vm = context->vm;
+
+	ObjectArray *live = new_array(vm, operations / 2);
+	push(vm, OBJECT_VAL(live));
+	for (uint32_t i = 0; i < operations; i++) {
+		ObjectArray *object = new_array(vm, 1);
+		if (i % 2 == 0) {
+			array_add_back(vm, live, OBJECT_VAL(object));
+		}
+	}
+
+	vm->gc_status = RUNNING;
+	collect_garbage(vm, GC_TRIGGER_EXPLICIT);
+	vm->gc_status = PAUSED;
+	pop(vm);
+
+	switch (phase) {
+	case GC_PHASE_MARK_ROOTS:
+		return vm->gc_last_mark_roots_ns;
+	case GC_PHASE_TRACE:
+		return vm->gc_last_trace_ns;
+	case GC_PHASE_SWEEP:
+		return vm->gc_last_sweep_ns;
+	default:
+		return vm->gc_last_total_ns;
+	}
+}
+
+static uint64_t bench_gc_total(BenchContext *context, const uint32_t operations)
+{
+	return gc_cycle(context, operations, GC_PHASE_TOTAL);
+}
+
+static uint64_t bench_gc_mark_roots(BenchContext *context, const uint32_t operations)
+{
+	return gc_cycle(context, operations, GC_PHASE_MARK_ROOTS);
+}
+
+static uint64_t bench_gc_trace(BenchContext *context, const uint32_t operations)
+{
+	return gc_cycle(context, operations, GC_PHASE_TRACE);
+}
+
+static uint64_t bench_gc_sweep(BenchContext *context, const uint32_t operations)
+{
+	return gc_cycle(context, operations, GC_PHASE_SWEEP);
+}
+
+#define KEY_COUNT 65536
+
+static const MicroBenchmark benchmarks[] = {
+	{"table_set", KEY_COUNT, bench_table_set},
+	{"table_get", KEY_COUNT, bench_table_get},
+	{"copy_string_interned", KEY_COUNT, bench_copy_string_interned},
+	{"copy_string_new", KEY_COUNT, bench_copy_string_new},
+	{"slab_alloc_free", KEY_COUNT, bench_slab_alloc_free},
+	{"gc_total", 50000, bench_gc_total},
+	{"gc_mark_roots", 50000, bench_gc_mark_roots},
+	{"gc_trace", 50000, bench_gc_trace},
+	{"gc_sweep", 50000, bench_gc_sweep},
+};
+
+static int compare_doubles(const void *a, const void *b)
+{
+	const double left = *(const double *)a;
+	const double right = *(const double *)b;
+	return left < right ? -1 : left > right ? 1 : 0;
+}
+
+/**
+ * Distribution-free confidence interval of the median: the order statistics whose binomial(n, 1/2) tail
+ * probabilities leave at most 2.5% on each side. Sorts <samples>.
+ */
+static void summarize(double *samples, const int count, BenchResult *result)
+{
+	qsort(samples, count, sizeof(double), compare_doubles);
+	result->min_ns = samples[0];
+	result->median_ns = count % 2 == 1 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+
+	int low = 0;
+	double tail = 0.0;
+	double probability = 1.0;
+	for (int i = 0; i < count; i++) {
+		probability *= 0.5;
+	}
+	// probability holds C(count, k) / 2^count while k walks up from 0
+	for (int k = 0; k < count / 2; k++) {
+		if (tail + probability > 0.025) {
+			break;
+		}
+		tail += probability;
+		low = k + 1;
+		probability = probability * (count - k) / (k + 1);
+	}
+	result->ci_low_ns = samples[low];
+	result->ci_high_ns = samples[count - 1 - low];
+}
+
+static int load_baseline(const char *path, BaselineEntry *entries, const int capacity)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open baseline \"%s\".\n", path);
+		return -1;
+	}
+	// one benchmark per line, as written by write_json
+	int count = 0;
+	char line[512];
+	while (count < capacity && fgets(line, sizeof(line), file) != NULL) {
+		const char *name = strstr(line, "\"name\": \"");
+		const char *median = strstr(line, "\"median_ns\": ");
+		const char *ci_high = strstr(line, "\"ci_high_ns\": ");
+		if (name == NULL || median == NULL || ci_high == NULL) {
+			continue;
+		}
+		BaselineEntry *entry = &entries[count];
+		if (sscanf(name, "\"name\": \"%63[^\"]\"", entry->name) == 1 &&
+			sscanf(median, "\"median_ns\": %lf", &entry->median_ns) == 1 &&
+			sscanf(ci_high, "\"ci_high_ns\": %lf", &entry->ci_high_ns) == 1) {
+			count++;
+		}
+	}
+	fclose(file);
+	return count;
+}
+
+static bool write_json(const char *path, const BenchResult *results, const int count, const int repeat)
+{
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "{\n  \"unit\": \"ns/op\",\n  \"repeat\": %d,\n  \"benchmarks\": [\n", repeat);
+	for (int i = 0; i < count; i++) {
+		const BenchResult *result = &results[i];
+		fprintf(file,
+				"    {\"name\": \"%s\", \"median_ns\": %.4f, \"ci_low_ns\": %.4f, \"ci_high_ns\": %.4f, \"min_ns\": "
+				"%.4f}%s\n",
+				result->name, result->median_ns, result->ci_low_ns, result->ci_high_ns, result->min_ns,
+				i + 1 < count ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+static void usage(const char *program)
+{
+	fprintf(stderr,
+			"Usage: %s [--repeat N] [--warmup N] [--filter TEXT] [--json PATH] [--baseline PATH] [--threshold "
+			"PERCENT]\n",
+			program);
+}
+
+int main(const int argc, const char *argv[])
+{
+	int repeat = DEFAULT_REPEAT;
+	int warmup = DEFAULT_WARMUP;
+	double threshold = DEFAULT_THRESHOLD_PERCENT;
+	const char *filter = NULL;
+	const char *json_path = NULL;
+	const char *baseline_path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--repeat") == 0 && has_value) {
+			repeat = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+			warmup = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--json") == 0 && has_value) {
+			json_path = argv[++i];
+		} else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+			baseline_path = argv[++i];
+		} else if (strcmp(argv[i], "--threshold") == 0 && has_value) {
+			threshold = atof(argv[++i]);
+		} else {
+			usage(argv[0]);
+			return 64;
+		}
+	}
+	if (repeat < 1 || warmup < 0) {
+		usage(argv[0]);
+		return 64;
+	}
+
+	const char *vm_argv[] = {argv[0]};
+	VM *vm = new_vm(1, vm_argv);
+	if (vm == NULL) {
+		return 1;
+	}
+	vm->gc_status = PAUSED;
+
+	BenchContext context = {.vm = vm};
+	context.keys = malloc(sizeof(ObjectString *) * KEY_COUNT);
+	context.fresh_chars = malloc(sizeof(*context.fresh_chars) * KEY_COUNT);
+	double *samples = malloc(sizeof(double) * repeat);
+	if (context.keys == NULL || context.fresh_chars == NULL || samples == NULL) {
+		fprintf(stderr, "Failed to allocate benchmark data.\n");
+		return 1;
+	}
+	context.keep_alive = new_array(vm, KEY_COUNT);
+	push(vm, OBJECT_VAL(context.keep_alive));
+	for (uint32_t i = 0; i < KEY_COUNT; i++) {
+		char chars[KEY_LENGTH];
+		const int length = snprintf(chars, sizeof(chars), "key-%u", i);
+		context.keys[i] = copy_string(vm, chars, (uint32_t)length);
+		array_add_back(vm, context.keep_alive, OBJECT_VAL(context.keys[i]));
+	}
+
+	BenchResult results[MAX_RESULTS];
+	int result_count = 0;
+	printf("%-22s %14s %14s %14s\n", "benchmark", "median ns/op", "95% CI low", "95% CI high");
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]) && result_count < MAX_RESULTS; i++) {
+		const MicroBenchmark *benchmark = &benchmarks[i];
+		if (filter != NULL && strstr(benchmark->name, filter) == NULL) {
+			continue;
+		}
+		for (int run = 0; run < warmup; run++) {
+			benchmark->run(&context, benchmark->operations);
+		}
+		for (int run = 0; run < repeat; run++) {
+			samples[run] = (double)benchmark->run(&context, benchmark->operations) / benchmark->operations;
+		}
+		BenchResult *result = &results[result_count++];
+		result->name = benchmark->name;
+		summarize(samples, repeat, result);
+		printf("%-22s %14.3f %14.3f %14.3f\n", result->name, result->median_ns, result->ci_low_ns,
+			   result->ci_high_ns);
+	}
+
+	int exit_code = 0;
+	if (json_path != NULL && !write_json(json_path, results, result_count, repeat)) {
+		fprintf(stderr, "Could not write results to \"%s\".\n", json_path);
+		exit_code = 1;
+	}
+
+	if (baseline_path != NULL) {
+		BaselineEntry baseline[MAX_RESULTS];
+		const int baseline_count = load_baseline(baseline_path, baseline, MAX_RESULTS);
+		if (baseline_count < 0) {
+			exit_code = 1;
+		}
+		printf("\n%-22s %14s %14s %9s\n", "benchmark", "baseline", "current", "change");
+		for (int i = 0; i < result_count; i++) {
+			for (int j = 0; j < baseline_count; j++) {
+				if (strcmp(results[i].name, baseline[j].name) != 0 || baseline[j].median_ns <= 0.0) {
+					continue;
+				}
+				const double change = (results[i].median_ns / baseline[j].median_ns - 1.0) * 100.0;
+				const bool regressed = change > threshold && results[i].ci_low_ns > baseline[j].ci_high_ns;
+				printf("%-22s %14.3f %14.3f %+8.1f%%%s\n", results[i].name, baseline[j].median_ns,
+					   results[i].median_ns, change, regressed ? "  REGRESSION" : "");
+				if (regressed) {
+					exit_code = 1;
+				}
+			}
+		}
+	}
+
+	pop(vm);
+	free(samples);
+	free(context.fresh_chars);
+	free(context.keys);
+	free_vm(vm);
+	return exit_code;
+}